@@ -24,6 +24,7 @@
 #include <boost/function.hpp>
 #include <boost/operators.hpp>
 #include <string>
+#include <vector>
 
 namespace shd{ namespace convert{
 
@@ -101,6 +102,17 @@ namespace shd{ namespace convert{
         const priority_type prio = -1
     );
 
+    /*!
+     * Get the priorities of all converters registered for a conversion.
+     * Converters that need CPU features the host does not have
+     * are not registered, so they do not show up in this list.
+     * \param id identify the conversion
+     * \return the registered priorities in ascending order (may be empty)
+     */
+    SHD_API std::vector<priority_type> get_converter_priorities(
+        const id_type &id
+    );
+
     /*!
      * Register the size of a particular item.
      * \param format the item format
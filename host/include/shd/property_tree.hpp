@@ -194,6 +194,44 @@ property<T>::~property(void){
     /* NOP */
 }
 
+/*!
+ * A handle to a property in a shd::property_tree:
+ * Resolve the path once with property_tree::resolve(),
+ * then use the handle without looking up the path again.
+ * The handle keeps the property alive,
+ * even after the property was removed from the tree.
+ */
+template <typename T> class property_handle{
+public:
+    //! Create an empty handle
+    property_handle(void){
+        /* NOP */
+    }
+
+    //! Create a handle to the given property
+    property_handle(const boost::shared_ptr<property<T> > &prop):
+        _prop(prop)
+    {
+        /* NOP */
+    }
+
+    //! True if the handle refers to a property
+    bool valid(void) const{
+        return bool(_prop);
+    }
+
+    property<T> &operator*(void) const{
+        return *_prop;
+    }
+
+    property<T> *operator->(void) const{
+        return _prop.get();
+    }
+
+private:
+    boost::shared_ptr<property<T> > _prop;
+};
+
 /*!
  * FS Path: A glorified string with path manipulations.
  * Inspired by boost filesystem path, but without the dependency.
@@ -246,6 +284,15 @@ public:
     //! Get access to a property in the tree
     template <typename T> property<T> &access(const fs_path &path);
 
+    /*!
+     * Get a handle to a property in the tree.
+     * Hot paths can keep the handle instead of calling access() every time.
+     * \param path the path of the property
+     * eturn a handle to the property
+     * 	hrows shd::lookup_error if there is no property at path
+     */
+    template <typename T> property_handle<T> resolve(const fs_path &path);
+
 private:
     //! Internal create property with wild-card type
     virtual void _create(const fs_path &path, const boost::shared_ptr<void> &prop) = 0;
@@ -162,6 +162,10 @@ namespace shd{
         return *boost::static_pointer_cast<property<T> >(this->_access(path));
     }
 
+    template <typename T> property_handle<T> property_tree::resolve(const fs_path &path){
+        return property_handle<T>(boost::static_pointer_cast<property<T> >(this->_access(path)));
+    }
+
 } //namespace shd
 
 #endif /* INCLUDED_SHD_PROPERTY_TREE_IPP */
@@ -191,6 +191,18 @@ public:
      */
     void sr_write(const std::string &reg, const uint32_t data, const size_t port = 0);
 
+    /*! Allows setting several registers on the settings bus in one transaction.
+     *
+     * The writes are sent back to back, and the call returns once all of
+     * them are acked. This saves a round trip per register compared to
+     * separate sr_write() calls that need to be acked each.
+     *
+     * \param writes List of settings registers and their new values, written in order.
+     * \param port Port on which to write
+     * \throw shd::io_error if any of the writes failed
+     */
+    void sr_write(const wb_iface::poke32_list_type &writes, const size_t port = 0);
+
     /*! Allows reading one register on the settings bus (64-Bit version).
      *
      * \param reg The settings register to be read.
@@ -340,6 +352,13 @@ public:
         return _tree->access<T>(get_arg_path(key, port) / "value").get();
     }
 
+    //! Resolve a block argument once, so it can be read repeatedly without
+    // looking up its path in the property tree again.
+    template <typename T>
+    property_handle<T> resolve_arg(const std::string &key, const size_t port = 0) const {
+        return _tree->resolve<T>(get_arg_path(key, port) / "value");
+    }
+
     std::string get_arg_type(const std::string &key, const size_t port = 0) const;
 
 protected:
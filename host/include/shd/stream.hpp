@@ -22,6 +22,7 @@
 #include <shd/types/metadata.hpp>
 #include <shd/types/device_addr.hpp>
 #include <shd/types/stream_cmd.hpp>
+#include <shd/types/stream_metrics.hpp>
 #include <shd/types/ref_vector.hpp>
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
@@ -130,6 +131,19 @@ struct SHD_API stream_args_t{
      *
      * - noclear: Used by tx_dsp_core_200 and rx_dsp_core_200
      *
+     * - convert_threads: number of extra threads that convert the channels
+     * of a multi-channel streamer in parallel with the calling thread.
+     * Defaults to 0 (the calling thread converts all channels).
+     * At most one thread per channel besides the caller is used.
+     *
+     * - convert_cpus: CPUs to pin the convert threads to, separated by ':'
+     * (e.g. "2:3:4"). By default, the CPUs after the caller's CPU are used.
+     *
+     * - host_rate, host_freq: RX only, with the fc32 CPU format. Resample
+     * the samples to host_rate and shift host_freq to 0 Hz on the host
+     * (see shd::rx_host_dsp). dsp_threads and dsp_cpus set the threads of
+     * this stage like convert_threads and convert_cpus.
+     *
      * The following are not implemented, but are listed for conceptual purposes:
      * - function: magnitude or phase/magnitude
      * - units: numeric units like counts or dBm
@@ -235,6 +249,14 @@ public:
      * \param stream_cmd the stream command to issue
      */
     virtual void issue_stream_cmd(const stream_cmd_t &stream_cmd) = 0;
+
+    /*!
+     * Get the counters of this streamer and its transports.
+     * May be called from any thread while streaming.
+     * Streamers that keep no counters return zeros.
+     * \return a snapshot of the counters
+     */
+    virtual stream_metrics_t get_metrics(void) const;
 };
 
 /*!
@@ -294,6 +316,14 @@ public:
     virtual bool recv_async_msg(
         async_metadata_t &async_metadata, double timeout = 0.1
     ) = 0;
+
+    /*!
+     * Get the counters of this streamer and its transports.
+     * May be called from any thread while streaming.
+     * Streamers that keep no counters return zeros.
+     * \return a snapshot of the counters
+     */
+    virtual stream_metrics_t get_metrics(void) const;
 };
 
 } //namespace shd
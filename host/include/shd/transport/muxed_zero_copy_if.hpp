@@ -34,8 +34,15 @@ namespace shd { namespace transport {
  * This class handles demuxing receive streams into the
  * appropriate virtual streams with the given classifier
  * function. A worker therad is spawned to handle the demuxing.
+ *
+ * Received frames are not copied: a stream's consumer gets the base
+ * transport's buffer, and the frame returns to the base transport when
+ * the consumer releases it. Consumers should release frames promptly
+ * since all streams share the frames of the base transport.
+ * Streams may send from different threads, the base transport must
+ * allow its send buffers to be committed concurrently.
  */
-class muxed_zero_copy_if : private boost::noncopyable {
+class SHD_API muxed_zero_copy_if : private boost::noncopyable {
 public:
     typedef boost::shared_ptr<muxed_zero_copy_if> sptr;
 
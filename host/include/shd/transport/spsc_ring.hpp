@@ -0,0 +1,248 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_TRANSPORT_SPSC_RING_HPP
+#define INCLUDED_SHD_TRANSPORT_SPSC_RING_HPP
+
+#include <shd/config.hpp>
+#include <shd/types/time_spec.hpp>
+#include <shd/utils/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+#include <vector>
+
+namespace shd{ namespace transport{
+
+    namespace spsc_ring_detail{
+
+        /*!
+         * Block until *addr no longer holds val, until a wake() on addr,
+         * or until the timeout expires. May return early (spuriously).
+         * Uses a futex on Linux and a short sleep elsewhere.
+         * \param addr the address of the 32-bit word to wait on
+         * \param val the value that was last seen at addr
+         * \param timeout the maximum time to block in seconds
+         */
+        SHD_API void wait(volatile uint32_t *addr, const uint32_t val, const double timeout);
+
+        //! Wake all threads blocked in wait() on addr
+        SHD_API void wake(volatile uint32_t *addr);
+
+    } //namespace spsc_ring_detail
+
+    /*!
+     * A lock-free single-producer, single-consumer ring:
+     * A drop-in replacement for bounded_buffer when exactly one thread
+     * pushes and exactly one thread pops.
+     * Push and pop never take a lock. A thread that has to wait spins
+     * for a short while, then yields, then blocks on the index it waits for.
+     * The other side only makes a system call when a thread is blocked.
+     */
+    template <typename elem_type> class spsc_ring : boost::noncopyable{
+    public:
+
+        /*!
+         * Create a new ring.
+         * \param capacity the maximum number of elements in the ring
+         */
+        spsc_ring(const size_t capacity):
+            _capacity(uint32_t(capacity)),
+            _mask(round_up_pow2(capacity)-1),
+            _elems(_mask+1),
+            _tail(0), _head_cache(0), _push_waiters(0),
+            _head(0), _tail_cache(0), _pop_waiters(0)
+        {
+            /* NOP */
+        }
+
+        //! Get the maximum number of elements in the ring
+        size_t capacity(void) const{
+            return _capacity;
+        }
+
+        /*!
+         * Push a new element into the ring immediately.
+         * The element will not be pushed when the ring is full.
+         * \param elem the new element to push
+         * \return false when the ring is full
+         */
+        SHD_INLINE bool push_with_haste(const elem_type &elem){
+            if (not this->can_push()) return false;
+            const uint32_t tail = _tail;
+            _elems[tail & _mask] = elem;
+            BOOST_IPC_DETAIL::atomic_inc32(&_tail); //publish the element
+            if (BOOST_IPC_DETAIL::atomic_read32(&_pop_waiters) != 0){
+                spsc_ring_detail::wake(&_tail);
+            }
+            return true;
+        }
+
+        /*!
+         * Push a new element into the ring.
+         * Wait until the ring becomes non-full.
+         * \param elem the new element to push
+         */
+        SHD_INLINE void push_with_wait(const elem_type &elem){
+            while (not this->push_with_timed_wait(elem, 1.0)){
+                /* keep waiting */
+            }
+        }
+
+        /*!
+         * Push a new element into the ring.
+         * Wait until the ring becomes non-full or timeout.
+         * \param elem the new element to push
+         * \param timeout the timeout in seconds
+         * \return false when the operation times out
+         */
+        SHD_INLINE bool push_with_timed_wait(const elem_type &elem, const double timeout){
+            if (this->push_with_haste(elem)) return true;
+            if (not this->wait_for(&spsc_ring::can_push, &_head, &_push_waiters, timeout)) return false;
+            return this->push_with_haste(elem);
+        }
+
+        /*!
+         * Pop an element from the ring immediately.
+         * The element will not be popped when the ring is empty.
+         * \param elem the element reference pop to
+         * \return false when the ring is empty
+         */
+        SHD_INLINE bool pop_with_haste(elem_type &elem){
+            if (not this->can_pop()) return false;
+            const uint32_t head = _head;
+            //release the slot's reference so the element can be freed
+            elem = _elems[head & _mask];
+            _elems[head & _mask] = elem_type();
+            BOOST_IPC_DETAIL::atomic_inc32(&_head); //free the slot
+            if (BOOST_IPC_DETAIL::atomic_read32(&_push_waiters) != 0){
+                spsc_ring_detail::wake(&_head);
+            }
+            return true;
+        }
+
+        /*!
+         * Pop an element from the ring.
+         * Wait until the ring becomes non-empty.
+         * \param elem the element reference pop to
+         */
+        SHD_INLINE void pop_with_wait(elem_type &elem){
+            while (not this->pop_with_timed_wait(elem, 1.0)){
+                /* keep waiting */
+            }
+        }
+
+        /*!
+         * Pop an element from the ring.
+         * Wait until the ring becomes non-empty or timeout.
+         * \param elem the element reference pop to
+         * \param timeout the timeout in seconds
+         * \return false when the operation times out
+         */
+        SHD_INLINE bool pop_with_timed_wait(elem_type &elem, const double timeout){
+            if (this->pop_with_haste(elem)) return true;
+            if (not this->wait_for(&spsc_ring::can_pop, &_tail, &_pop_waiters, timeout)) return false;
+            return this->pop_with_haste(elem);
+        }
+
+    private:
+        //! Polls of the other side's index before yielding
+        static const size_t SPIN_ITERATIONS = 1024;
+        //! Yields before blocking
+        static const size_t YIELD_ITERATIONS = 16;
+
+        typedef bool (spsc_ring::*ready_fcn_t)(void);
+
+        //! Producer side: is there a free slot? (refreshes the cached head)
+        SHD_INLINE bool can_push(void){
+            if (_tail - _head_cache < _capacity) return true;
+            _head_cache = BOOST_IPC_DETAIL::atomic_read32(&_head);
+            return _tail - _head_cache < _capacity;
+        }
+
+        //! Consumer side: is there an element? (refreshes the cached tail)
+        SHD_INLINE bool can_pop(void){
+            if (_tail_cache != _head) return true;
+            _tail_cache = BOOST_IPC_DETAIL::atomic_read32(&_tail);
+            return _tail_cache != _head;
+        }
+
+        /*!
+         * Wait adaptively until ready() is true: spin, then yield, then
+         * block on the other side's index. The other side only wakes
+         * this thread when it sees the waiters count is non-zero.
+         */
+        bool wait_for(
+            ready_fcn_t ready,
+            volatile uint32_t *index,
+            volatile uint32_t *waiters,
+            const double timeout
+        ){
+            for (size_t i = 0; i < SPIN_ITERATIONS; i++){
+                if ((this->*ready)()) return true;
+            }
+            if (timeout <= 0.0) return false;
+
+            const time_spec_t exit_time = time_spec_t::get_system_time() + time_spec_t(timeout);
+            for (size_t i = 0; i < YIELD_ITERATIONS; i++){
+                boost::this_thread::yield();
+                if ((this->*ready)()) return true;
+            }
+
+            while (true){
+                //announce the waiter before the last check,
+                //the other side updates its index before it checks the waiters
+                BOOST_IPC_DETAIL::atomic_inc32(waiters);
+                const uint32_t seen = BOOST_IPC_DETAIL::atomic_read32(index);
+                const double remaining = (exit_time - time_spec_t::get_system_time()).get_real_secs();
+                if ((this->*ready)() or remaining <= 0.0){
+                    BOOST_IPC_DETAIL::atomic_dec32(waiters);
+                    return (this->*ready)();
+                }
+                spsc_ring_detail::wait(index, seen, remaining);
+                BOOST_IPC_DETAIL::atomic_dec32(waiters);
+            }
+        }
+
+        static uint32_t round_up_pow2(const size_t n){
+            uint32_t pow2 = 1;
+            while (pow2 < n) pow2 <<= 1;
+            return pow2;
+        }
+
+        const uint32_t _capacity;
+        const uint32_t _mask;
+        std::vector<elem_type> _elems;
+
+        //keep the producer's and the consumer's state on separate cache lines
+        char _pad0[64];
+
+        //written by the producer
+        volatile uint32_t _tail;
+        uint32_t _head_cache;
+        volatile uint32_t _push_waiters;
+        char _pad1[64];
+
+        //written by the consumer
+        volatile uint32_t _head;
+        uint32_t _tail_cache;
+        volatile uint32_t _pop_waiters;
+        char _pad2[64];
+    };
+
+}} //namespace
+
+#endif /* INCLUDED_SHD_TRANSPORT_SPSC_RING_HPP */
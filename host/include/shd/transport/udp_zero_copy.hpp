@@ -22,6 +22,7 @@
 #include <shd/transport/zero_copy.hpp>
 #include <shd/types/device_addr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <stdint.h>
 
 namespace shd{ namespace transport{
 
@@ -42,6 +43,12 @@ public:
         size_t  send_buff_size;
     };
 
+    //! Receive syscall counters, see get_recv_stats()
+    struct recv_stats_t {
+        uint64_t num_frames;
+        uint64_t num_syscalls;
+    };
+
     typedef boost::shared_ptr<udp_zero_copy> sptr;
 
     /*!
@@ -59,6 +66,23 @@ public:
      * \param default_buff_args Default values for frame sizes and num frames
      * \param[out] buff_params_out Returns the actual buffer sizes
      * \param hints optional parameters to pass to the underlying transport
+     *
+     * Besides the frame and buffer sizes, the hints may contain
+     * recv_batch=N: On platforms with recvmmsg(), up to N frames are
+     * received with a single system call and handed out one at a time
+     * by get_recv_buff(). The default of 1 uses one recv() per frame.
+     * send_batch=N: On platforms with sendmmsg(), committed send frames
+     * are queued and sent with a single system call once N frames are
+     * queued, once the oldest queued frame is older than
+     * send_batch_timeout seconds (checked on commit, default 100e-6),
+     * or when flush_send_buffs() is called. The default of 1 sends
+     * every frame on commit.
+     * recv_xport=tpacket: On Linux, datagrams are received through a
+     * memory mapped TPACKET_V3 ring and handed out without a copy.
+     * This requires CAP_NET_RAW and unfragmented datagrams; the ring is
+     * sized by recv_ring_block_size, recv_ring_num_blocks and
+     * recv_ring_block_timeout (ms). The transport falls back to the
+     * socket receive path when the ring cannot be created.
      */
     static sptr make(
         const std::string &addr,
@@ -67,6 +91,21 @@ public:
         udp_zero_copy::buff_params& buff_params_out,
         const device_addr_t &hints = device_addr_t()
     );
+
+    /*!
+     * Get the number of frames received and the number of receive
+     * system calls it took to get them. The counters are updated by
+     * get_recv_buff(), read them from the same thread.
+     * \return the receive counters since the transport was made
+     */
+    virtual recv_stats_t get_recv_stats(void) const = 0;
+
+    /*!
+     * Send all frames that are queued because of the send_batch hint.
+     * Callers that use send batching must flush at the end of a burst
+     * of frames. Without send batching, this does nothing.
+     */
+    virtual void flush_send_buffs(void) = 0;
 };
 
 }} //namespace
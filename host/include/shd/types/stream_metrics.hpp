@@ -0,0 +1,113 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_TYPES_STREAM_METRICS_HPP
+#define INCLUDED_SHD_TYPES_STREAM_METRICS_HPP
+
+#include <shd/config.hpp>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace shd{
+
+    /*!
+     * Counters of a streamer since it was made.
+     *
+     * The counters are kept all the time. They are updated by the
+     * thread that streams and may be read from any other thread, so a
+     * snapshot can be a packet apart between the counters.
+     *
+     * Counters that do not apply to a direction stay zero. On the TX
+     * side, the errors the device reports (underflows, sequence errors,
+     * late packets) are counted as they are read with recv_async_msg().
+     */
+    struct SHD_API stream_metrics_t{
+
+        //! Number of buckets in the call latency histogram
+        static const size_t NUM_LATENCY_BUCKETS = 24;
+
+        //! Counters of one transport of the streamer
+        struct SHD_API xport_metrics_t{
+            xport_metrics_t(void);
+            //! Packets received or sent
+            uint64_t num_packets;
+            //! Bytes received or sent, headers included
+            uint64_t num_bytes;
+            //! RX: packets that came out of sequence (dropped packets)
+            uint64_t num_seq_errors;
+            //! TX: times there was no buffer (flow control credit) right away
+            uint64_t num_fc_stalls;
+            //! RX: flow control acks sent to the device
+            uint64_t num_fc_acks;
+            //! RX: packets that were waiting in the buffer when recv() asked
+            uint64_t num_queued_packets;
+            /*!
+             * RX: the longest run of packets that were waiting in the buffer.
+             * The receive buffer held a backlog for that many packets, when
+             * it nears the flow control window the buffer is too small.
+             */
+            uint64_t max_queued_packets;
+            //! Seconds spent waiting on the transport for buffers
+            double wait_secs;
+        };
+
+        stream_metrics_t(void);
+
+        //! Calls of recv() or send()
+        uint64_t num_calls;
+        //! Samples per channel received or sent
+        uint64_t num_samps;
+        //! Calls that returned on a timeout
+        uint64_t num_timeouts;
+        //! RX: overflows reported inline
+        uint64_t num_overflows;
+        //! TX: underflows reported by the device
+        uint64_t num_underflows;
+        //! RX: dropped packets, TX: sequence errors reported by the device
+        uint64_t num_seq_errors;
+        //! RX: late stream commands, TX: packets that arrived late
+        uint64_t num_late_cmds;
+        //! TX: times a transport had no buffer (flow control credit) right away
+        uint64_t num_fc_stalls;
+        //! Seconds spent converting samples
+        double convert_secs;
+        //! Seconds spent waiting on the transports for buffers
+        double wait_secs;
+
+        /*!
+         * Latency histogram of the recv() or send() calls.
+         * Bucket 0 counts the calls shorter than 1 us, bucket i the
+         * calls from 2^(i-1) up to 2^i us. The last bucket counts all
+         * longer calls.
+         */
+        std::vector<uint64_t> latency_hist;
+
+        //! Counters per transport, one per channel
+        std::vector<xport_metrics_t> xports;
+
+        /*!
+         * Format the counters as a JSON object on a single line.
+         * \param name the name to put into the object, none when empty
+         * \return the JSON string
+         */
+        std::string to_string(const std::string &name = "") const;
+    };
+
+} //namespace shd
+
+#endif /* INCLUDED_SHD_TYPES_STREAM_METRICS_HPP */
@@ -22,6 +22,8 @@
 #include <shd/types/time_spec.hpp>
 #include <stdint.h>
 #include <boost/shared_ptr.hpp>
+#include <utility>
+#include <vector>
 
 namespace shd
 {
@@ -31,6 +33,7 @@ class SHD_API wb_iface
 public:
     typedef boost::shared_ptr<wb_iface> sptr;
     typedef uint32_t wb_addr_type;
+    typedef std::vector<std::pair<wb_addr_type, uint32_t> > poke32_list_type;
 
     virtual ~wb_iface(void);
 
@@ -62,6 +65,15 @@ public:
      */
     virtual uint32_t peek32(const wb_addr_type addr);
 
+    /*!
+     * Write a list of registers (32 bits), in order.
+     * The default implementation calls poke32() for every write.
+     * Control interfaces override this to send all writes before
+     * collecting the acks, and to report a failed write from this call.
+     * \param writes a list of address and data pairs
+     */
+    virtual void poke32_batch(const poke32_list_type &writes);
+
     /*!
      * Write a register (16 bits)
      * \param addr the address
@@ -95,6 +107,56 @@ public:
     virtual void set_time(const time_spec_t& t) = 0;
 };
 
+/*!
+ * A transaction of register writes:
+ * Queue the writes with poke32(), then send them with commit().
+ *
+ * \code
+ * wb_transaction transaction(iface);
+ * transaction.poke32(REG_A, 0x1);
+ * transaction.poke32(REG_B, 0x2);
+ * transaction.commit(); //throws if any of the writes failed
+ * \endcode
+ *
+ * Writes that were never committed are dropped.
+ */
+class wb_transaction
+{
+public:
+    wb_transaction(wb_iface &iface):
+        _iface(iface)
+    {
+        /* NOP */
+    }
+
+    //! Queue a register write (32 bits)
+    void poke32(const wb_iface::wb_addr_type addr, const uint32_t data){
+        _writes.push_back(std::make_pair(addr, data));
+    }
+
+    //! Send all queued writes, see wb_iface::poke32_batch()
+    void commit(void){
+        if (_writes.empty()) return;
+        wb_iface::poke32_list_type writes;
+        writes.swap(_writes);
+        _iface.poke32_batch(writes);
+    }
+
+    //! The number of queued writes
+    size_t size(void) const{
+        return _writes.size();
+    }
+
+    //! The interface the writes go to
+    wb_iface &get_iface(void) const{
+        return _iface;
+    }
+
+private:
+    wb_iface &_iface;
+    wb_iface::poke32_list_type _writes;
+};
+
 } //namespace shd
 
 #endif /* INCLUDED_SHD_TYPES_WB_IFACE_HPP */
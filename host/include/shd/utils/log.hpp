@@ -31,7 +31,11 @@
  *
  * The logger enables SHD library code to easily log events into a file.
  * Log entries are time-stamped and stored with file, line, and function.
- * Each call to the SHD_LOG macros is synchronous and thread-safe.
+ * Each call to the SHD_LOG macros is thread-safe and does not block:
+ * The entry is time-stamped at the call site and put on a lock-free
+ * queue of the calling thread. A logger thread writes the entries in
+ * batches. When a thread logs faster than the logger thread can write,
+ * the queue fills up and further entries are dropped and counted.
  *
  * The log file can be found in the path <temp-directory>/shd.log,
  * where <temp-directory> is the user or system's temporary directory.
@@ -69,6 +73,8 @@
 
 namespace shd{ namespace _log{
 
+    struct log_record;
+
     //! Verbosity levels for the logger
     enum verbosity_t{
         always      = 1,
@@ -111,8 +117,17 @@ namespace shd{ namespace _log{
     private:
         std::ostringstream _ss;
         bool _log_it;
+        log_record *_record;
     };
 
+    /*!
+     * Wait until the entries logged so far are written to the log file.
+     */
+    SHD_API void flush(void);
+
+    //! Get the number of entries dropped because the logger fell behind
+    SHD_API size_t get_num_dropped(void);
+
 }} //namespace shd::_log
 
 #endif /* INCLUDED_SHD_UTILS_LOG_HPP */
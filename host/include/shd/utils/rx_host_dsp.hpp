@@ -0,0 +1,87 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_UTILS_RX_HOST_DSP_HPP
+#define INCLUDED_SHD_UTILS_RX_HOST_DSP_HPP
+
+#include <shd/config.hpp>
+#include <shd/stream.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace shd{
+
+/*!
+ * A DSP stage on the host for the fc32 samples of an RX streamer.
+ *
+ * It mixes each channel with an NCO, then resamples it to any rate
+ * with a fractional polyphase filter. This gives rates the device's
+ * decimators cannot make and frequency offsets finer than its CORDIC.
+ * The channels can be processed in parallel on worker threads.
+ *
+ * multi_smini::get_rx_stream() adds the stage when the stream args
+ * have one of these keys:
+ * - host_rate: the output rate in samples per second. It must be
+ *   within a factor of 64 of the device's rate. The filter gets longer
+ *   as the ratio goes down, so set the device to the lowest rate it can
+ *   make above the output rate.
+ * - host_freq: the frequency in Hz, relative to the received center
+ *   frequency, that is shifted to 0 Hz
+ * - dsp_threads: worker threads besides the caller (default 0)
+ * - dsp_cpus: CPUs to pin the workers to, separated by ':'
+ *
+ * The time specs are those of the output samples: output n is centered
+ * on the input sample at n times the rate ratio. An overflow or another
+ * error starts the filters and the NCO over. A burst of num_samps is
+ * requested from the device in input samples, and its end is flushed
+ * through the filter.
+ */
+class SHD_API rx_host_dsp : public rx_streamer{
+public:
+    typedef boost::shared_ptr<rx_host_dsp> sptr;
+
+    virtual ~rx_host_dsp(void) = 0;
+
+    //! Do the stream args ask for the host DSP stage?
+    static bool is_requested(const stream_args_t &args);
+
+    /*!
+     * Make the DSP stage on a streamer.
+     * \param rx_stream the streamer, it must have the fc32 cpu format
+     * \param args the stream args of the streamer
+     * \param rate the sample rate of the streamer
+     * \throws shd::value_error for another cpu format or a bad rate
+     */
+    static sptr make(
+        rx_streamer::sptr rx_stream,
+        const stream_args_t &args,
+        const double rate
+    );
+
+    //! Get the output rate in samples per second
+    virtual double get_rate(void) const = 0;
+
+    //! Get the length of the resampling filter in input samples, 0 without one
+    virtual size_t get_num_taps(void) const = 0;
+
+    //! Get the name of the SIMD kernels in use
+    static std::string get_simd_name(void);
+};
+
+} //namespace shd
+
+#endif /* INCLUDED_SHD_UTILS_RX_HOST_DSP_HPP */
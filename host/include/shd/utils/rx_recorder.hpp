@@ -0,0 +1,110 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_UTILS_RX_RECORDER_HPP
+#define INCLUDED_SHD_UTILS_RX_RECORDER_HPP
+
+#include <shd/config.hpp>
+#include <shd/stream.hpp>
+#include <shd/types/device_addr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace shd{
+
+/*!
+ * Records the samples of an RX streamer to files, one file per channel.
+ *
+ * recv() fills large buffers in place. Full buffers go through a
+ * lock-free ring to a writer thread, which writes them past the page
+ * cache (O_DIRECT) where the file system supports it. The receive
+ * thread never waits for the disk unless all buffers are full.
+ *
+ * Recorder arguments:
+ * - buff_size: bytes per channel and buffer (default 4 MiB)
+ * - num_buffs: number of buffers between receiving and writing (default 8)
+ * - direct: 0 to always go through the page cache (default 1)
+ */
+class SHD_API rx_recorder : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<rx_recorder> sptr;
+
+    struct stats_t{
+        stats_t(void);
+        //! Samples per channel received
+        uint64_t num_samps;
+        //! Bytes written to all files
+        uint64_t num_bytes_written;
+        //! Overflows reported by the streamer
+        size_t num_overflows;
+        //! Other errors reported by the streamer
+        size_t num_errors;
+        //! Times the receive thread had to wait for a free buffer
+        size_t num_stalls;
+        //! Seconds the receive thread waited for free buffers
+        double stall_secs;
+        //! Seconds the writer spent writing
+        double write_secs;
+        //! Are the files written past the page cache?
+        bool direct_io;
+    };
+
+    virtual ~rx_recorder(void) = 0;
+
+    /*!
+     * Make a new recorder.
+     * \param rx_stream the streamer to receive from
+     * \param cpu_format the sample format of the streamer (like "sc16")
+     * \param files a file name per channel of the streamer
+     * \param args the recorder arguments
+     * \throws shd::value_error for the wrong number of files
+     * \throws shd::io_error when a file cannot be created
+     */
+    static sptr make(
+        rx_streamer::sptr rx_stream,
+        const std::string &cpu_format,
+        const std::vector<std::string> &files,
+        const device_addr_t &args = device_addr_t()
+    );
+
+    /*!
+     * Receive and record samples on the calling thread.
+     * Returns when the samples are received, when stop() is called, on
+     * a receive timeout or on an error other than an overflow.
+     * The stream command is up to the caller.
+     * \param num_samps the samples per channel to record, 0 for no limit
+     * \param timeout the receive timeout in seconds
+     * \return the number of samples per channel recorded
+     */
+    virtual uint64_t record(const uint64_t num_samps, const double timeout = 1.0) = 0;
+
+    //! Make record() return, may be called from any thread
+    virtual void stop(void) = 0;
+
+    //! Write all samples and close the files
+    virtual void close(void) = 0;
+
+    //! Get the statistics so far
+    virtual stats_t get_stats(void) = 0;
+};
+
+} //namespace shd
+
+#endif /* INCLUDED_SHD_UTILS_RX_RECORDER_HPP */
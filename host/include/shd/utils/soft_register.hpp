@@ -113,6 +113,7 @@ public:
 
     virtual void initialize(wb_iface& iface, bool sync = false) = 0;
     virtual void flush() = 0;
+    virtual void flush(wb_transaction& transaction) = 0;
     virtual void refresh() = 0;
     virtual size_t get_bitwidth() = 0;
     virtual bool is_readable() = 0;
@@ -227,6 +228,26 @@ public:
         }
     }
 
+    /*!
+     * Write the contents of the soft-copy to hardware as part of a transaction.
+     * Only 32-bit registers on the interface of the transaction are queued.
+     * Other registers commit the transaction and are written right away,
+     * so the order of the writes does not change.
+     */
+    SHD_INLINE void flush(wb_transaction& transaction)
+    {
+        if (writable && _iface == &transaction.get_iface() &&
+            get_bitwidth() > 16 && get_bitwidth() <= 32) {
+            if (_flush_mode == ALWAYS_FLUSH || _soft_copy.is_dirty()) {
+                transaction.poke32(_wr_addr, static_cast<uint32_t>(_soft_copy));
+                _soft_copy.mark_clean();
+            }
+        } else {
+            transaction.commit();
+            flush();
+        }
+    }
+
     /*!
      * Read the contents of the register from hardware and update the soft copy.
      */
@@ -345,6 +366,12 @@ public:
         soft_register_t<reg_data_t, readable, writable>::flush();
     }
 
+    SHD_INLINE void flush(wb_transaction& transaction)
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        soft_register_t<reg_data_t, readable, writable>::flush(transaction);
+    }
+
     SHD_INLINE void refresh()
     {
         boost::lock_guard<boost::mutex> lock(_mutex);
@@ -463,7 +490,7 @@ public:
  */
 class SHD_API soft_regmap_t : public soft_regmap_accessor_t, public boost::noncopyable {
 public:
-    soft_regmap_t(const std::string& name) : _name(name) {}
+    soft_regmap_t(const std::string& name) : _name(name), _iface(NULL) {}
     virtual ~soft_regmap_t() {};
 
     /*!
@@ -479,6 +506,7 @@ public:
      */
     void initialize(wb_iface& iface, bool sync = false) {
         boost::lock_guard<boost::mutex> lock(_mutex);
+        _iface = &iface;
         BOOST_FOREACH(soft_register_base* reg, _reglist) {
             reg->initialize(iface, sync);
         }
@@ -488,12 +516,22 @@ public:
      * Flush all registers to hardware.
      * The order of writing is the same as the order in
      * which registers were added to the map.
+     * Once the map is initialized, the writes go out as one
+     * transaction (see wb_iface::poke32_batch()).
      */
     void flush() {
         boost::lock_guard<boost::mutex> lock(_mutex);
+        if (not _iface) {
+            BOOST_FOREACH(soft_register_base* reg, _reglist) {
+                reg->flush();
+            }
+            return;
+        }
+        wb_transaction transaction(*_iface);
         BOOST_FOREACH(soft_register_base* reg, _reglist) {
-            reg->flush();
+            reg->flush(transaction);
         }
+        transaction.commit();
     }
 
     /*!
@@ -560,6 +598,7 @@ private:
     const std::string   _name;
     regmap_t            _regmap;    //For lookups
     reglist_t           _reglist;   //To maintain order
+    wb_iface*           _iface;     //Set by initialize()
     boost::mutex        _mutex;
 };
 
@@ -0,0 +1,80 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_UTILS_STREAM_METRICS_EXPORT_HPP
+#define INCLUDED_SHD_UTILS_STREAM_METRICS_EXPORT_HPP
+
+#include <shd/config.hpp>
+#include <shd/types/stream_metrics.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+#include <string>
+
+namespace shd{
+
+/*!
+ * Dumps the counters of all streamers of the process periodically.
+ *
+ * Every period, each streamer is written as a JSON object on a line
+ * of its own (see stream_metrics_t::to_string()), with the name of
+ * the streamer and the wall clock time in seconds added.
+ *
+ * The destination is set with the environment variable
+ * SHD_STREAM_METRICS or with set_destination():
+ * - "file:<path>" or "<path>" appends to a file
+ * - "unix:<path>" sends to a Unix stream socket that listens on the path,
+ *   connecting again when the connection breaks
+ *
+ * The period is set with SHD_STREAM_METRICS_PERIOD in seconds (default 1).
+ */
+class SHD_API stream_metrics_export : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<stream_metrics_export> sptr;
+    typedef boost::function<stream_metrics_t(void)> source_type;
+
+    virtual ~stream_metrics_export(void) = 0;
+
+    /*!
+     * Register a source of counters, like a streamer.
+     * The source is dumped until the returned object is destroyed.
+     * The source is never called after that.
+     * \param kind the start of the name, like "rx", a number is appended
+     * \param source the function that gets the counters from any thread
+     * \return the registration
+     */
+    static sptr register_source(const std::string &kind, const source_type &source);
+
+    //! Get the name the source is dumped as
+    virtual const std::string &get_name(void) const = 0;
+
+    /*!
+     * Start dumping to a destination, or stop.
+     * Overrides the environment variables.
+     * \param dest the destination as above, empty to stop
+     * \param period the seconds between the dumps
+     * \throws shd::value_error for a malformed destination
+     */
+    static void set_destination(const std::string &dest, const double period = 1.0);
+
+    //! Get a dump of all sources, one JSON object per line
+    static std::string dump(void);
+};
+
+} //namespace shd
+
+#endif /* INCLUDED_SHD_UTILS_STREAM_METRICS_EXPORT_HPP */
@@ -0,0 +1,111 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_SHD_UTILS_TX_PLAYER_HPP
+#define INCLUDED_SHD_UTILS_TX_PLAYER_HPP
+
+#include <shd/config.hpp>
+#include <shd/stream.hpp>
+#include <shd/types/device_addr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace shd{
+
+/*!
+ * Plays files of samples out of a TX streamer, one file per channel.
+ *
+ * A reader thread reads ahead into large buffers, past the page cache
+ * (O_DIRECT) where the file system supports it, and hands them through
+ * a lock-free ring to the sending thread. send() is called on the
+ * buffers in place, so the sending thread never waits for the disk
+ * unless all buffers are empty.
+ *
+ * Player arguments:
+ * - buff_size: bytes per channel and buffer (default 4 MiB)
+ * - num_buffs: number of buffers read ahead (default 8)
+ * - direct: 0 to always go through the page cache (default 1)
+ */
+class SHD_API tx_player : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<tx_player> sptr;
+
+    struct stats_t{
+        stats_t(void);
+        //! Samples per channel sent
+        uint64_t num_samps;
+        //! Times the files were played to the end
+        uint64_t num_loops;
+        //! Times the sending thread had to wait for a full buffer
+        size_t num_stalls;
+        //! Seconds the sending thread waited for full buffers
+        double stall_secs;
+        //! Seconds the reader spent reading
+        double read_secs;
+        //! Are the files read past the page cache?
+        bool direct_io;
+    };
+
+    virtual ~tx_player(void) = 0;
+
+    /*!
+     * Make a new player. Reading ahead starts right away.
+     * \param tx_stream the streamer to send to
+     * \param cpu_format the sample format of the streamer (like "sc16")
+     * \param files a file name per channel of the streamer, all of the same size
+     * \param args the player arguments
+     * \throws shd::value_error for the wrong number of files or file sizes
+     * \throws shd::io_error when a file cannot be opened
+     */
+    static sptr make(
+        tx_streamer::sptr tx_stream,
+        const std::string &cpu_format,
+        const std::vector<std::string> &files,
+        const device_addr_t &args = device_addr_t()
+    );
+
+    /*!
+     * Send the files on the calling thread as one burst.
+     * The first packet is sent with the given metadata, so a start of
+     * burst and a time spec there make a timed start. The burst ends
+     * with an end of burst packet.
+     * Returns when the files were played num_loops times or when stop()
+     * is called. The next call starts over from the start of the files.
+     * \param md the metadata of the first packet
+     * \param num_loops the times to play the files, 0 for no limit
+     * \param timeout the send timeout in seconds
+     * \return the number of samples per channel sent
+     */
+    virtual uint64_t play(
+        const tx_metadata_t &md,
+        const size_t num_loops = 1,
+        const double timeout = 1.0
+    ) = 0;
+
+    //! Make play() return, may be called from any thread
+    virtual void stop(void) = 0;
+
+    //! Get the statistics so far
+    virtual stats_t get_stats(void) = 0;
+};
+
+} //namespace shd
+
+#endif /* INCLUDED_SHD_UTILS_TX_PLAYER_HPP */
@@ -0,0 +1,213 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_avx.hpp"
+#include <shd/utils/byteswap.hpp>
+
+using namespace shd::convert;
+
+/***********************************************************************
+ * Kernels: convert the bulk of the samples and return the number of
+ * samples converted, the caller converts the remainder. The rounding
+ * and saturation match the SSE2 converters: fc32 is rounded to nearest,
+ * fc64 is truncated, both saturate when packing.
+ **********************************************************************/
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t fc32_to_item32_sc16_avx2(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256 scalar = _mm256_set1_ps(float(scale_factor));
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input */
+        const __m256 tmplo = _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+0));
+        const __m256 tmphi = _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+4));
+
+        /* convert and scale */
+        const __m256i tmpilo = _mm256_cvtps_epi32(_mm256_mul_ps(tmplo, scalar));
+        const __m256i tmpihi = _mm256_cvtps_epi32(_mm256_mul_ps(tmphi, scalar));
+
+        /* pack (per 128-bit lane, so restore the order) + swap to wire order */
+        __m256i tmpi = _mm256_packs_epi32(tmpilo, tmpihi);
+        tmpi = _mm256_permute4x64_epi64(tmpi, _MM_SHUFFLE(3, 1, 2, 0));
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t fc64_to_item32_sc16_avx2(
+    const fc64_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256d scalar = _mm256_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input, convert and scale */
+        const __m128i tmpi0 = _mm256_cvttpd_epi32(_mm256_mul_pd(
+            _mm256_loadu_pd(reinterpret_cast<const double *>(input+i+0)), scalar));
+        const __m128i tmpi1 = _mm256_cvttpd_epi32(_mm256_mul_pd(
+            _mm256_loadu_pd(reinterpret_cast<const double *>(input+i+2)), scalar));
+        const __m128i tmpi2 = _mm256_cvttpd_epi32(_mm256_mul_pd(
+            _mm256_loadu_pd(reinterpret_cast<const double *>(input+i+4)), scalar));
+        const __m128i tmpi3 = _mm256_cvttpd_epi32(_mm256_mul_pd(
+            _mm256_loadu_pd(reinterpret_cast<const double *>(input+i+6)), scalar));
+
+        /* pack + swap to wire order */
+        __m256i tmpi = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_packs_epi32(tmpi0, tmpi1)), _mm_packs_epi32(tmpi2, tmpi3), 1);
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t fc32_to_item32_sc8_avx2(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256 scalar = _mm256_set1_ps(float(scale_factor));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (size_t j = 0; i+15 < nsamps; i+=16, j+=8){
+        /* load from input, convert and scale */
+        const __m256i tmpi0 = _mm256_cvtps_epi32(_mm256_mul_ps(
+            _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+0)), scalar));
+        const __m256i tmpi1 = _mm256_cvtps_epi32(_mm256_mul_ps(
+            _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+4)), scalar));
+        const __m256i tmpi2 = _mm256_cvtps_epi32(_mm256_mul_ps(
+            _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+8)), scalar));
+        const __m256i tmpi3 = _mm256_cvtps_epi32(_mm256_mul_ps(
+            _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+12)), scalar));
+
+        /* pack (per 128-bit lane, so restore the item order) + swap to wire order */
+        __m256i tmpi = _mm256_packs_epi16(
+            _mm256_packs_epi32(tmpi0, tmpi1), _mm256_packs_epi32(tmpi2, tmpi3));
+        tmpi = _mm256_permutevar8x32_epi32(tmpi, order);
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+j), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t fc64_to_item32_sc8_avx2(
+    const fc64_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256d scalar = _mm256_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (size_t j = 0; i+15 < nsamps; i+=16, j+=8){
+        /* load from input, convert and scale */
+        __m128i tmpi32[8];
+        for (size_t k = 0; k < 8; k++){
+            tmpi32[k] = _mm256_cvttpd_epi32(_mm256_mul_pd(
+                _mm256_loadu_pd(reinterpret_cast<const double *>(input+i+2*k)), scalar));
+        }
+
+        /* pack + swap to wire order */
+        const __m128i tmpilo = _mm_packs_epi16(
+            _mm_packs_epi32(tmpi32[0], tmpi32[1]), _mm_packs_epi32(tmpi32[2], tmpi32[3]));
+        const __m128i tmpihi = _mm_packs_epi16(
+            _mm_packs_epi32(tmpi32[4], tmpi32[5]), _mm_packs_epi32(tmpi32[6], tmpi32[7]));
+        __m256i tmpi = _mm256_inserti128_si256(_mm256_castsi128_si256(tmpilo), tmpihi, 1);
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+j), tmpi);
+    }
+    return i;
+}
+
+/***********************************************************************
+ * fc32/fc64 -> sc16 item32
+ **********************************************************************/
+DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_le, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc16_avx2<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_be, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc16_avx2<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc16_item32_le, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc16_avx2<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc16_item32_be, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc16_avx2<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+/***********************************************************************
+ * fc32/fc64 -> sc8 item32
+ **********************************************************************/
+DECLARE_CONVERTER_IF(fc32, 1, sc8_item32_le, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc8_avx2<SWAP_SC8_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htowx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc32, 1, sc8_item32_be, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc8_avx2<SWAP_SC8_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htonx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc8_item32_le, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc8_avx2<SWAP_SC8_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htowx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc8_item32_be, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc8_avx2<SWAP_SC8_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htonx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
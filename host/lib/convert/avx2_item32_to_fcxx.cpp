@@ -0,0 +1,241 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_avx.hpp"
+#include <shd/utils/byteswap.hpp>
+
+using namespace shd::convert;
+
+/***********************************************************************
+ * Kernels: convert the bulk of the samples 8 items at a time and return
+ * the number of samples converted, the caller converts the remainder.
+ * The loads and stores are unaligned, which costs nothing on aligned
+ * data with the CPUs that have AVX2.
+ **********************************************************************/
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t item32_sc16_to_fc32_avx2(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256 scalar = _mm256_set1_ps(float(scale_factor));
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        /* sign extend, convert and scale */
+        const __m256 tmplo = _mm256_mul_ps(_mm256_cvtepi32_ps(
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(tmpi))), scalar);
+        const __m256 tmphi = _mm256_mul_ps(_mm256_cvtepi32_ps(
+            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(tmpi, 1))), scalar);
+
+        /* store to output */
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+0), tmplo);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+4), tmphi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t item32_sc16_to_fc64_avx2(
+    const item32_t *input, fc64_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256d scalar = _mm256_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        /* sign extend */
+        const __m256i tmpilo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(tmpi));
+        const __m256i tmpihi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(tmpi, 1));
+
+        /* convert and scale */
+        const __m256d tmp0 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(tmpilo)), scalar);
+        const __m256d tmp1 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(tmpilo, 1)), scalar);
+        const __m256d tmp2 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(tmpihi)), scalar);
+        const __m256d tmp3 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(tmpihi, 1)), scalar);
+
+        /* store to output */
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+0), tmp0);
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+2), tmp1);
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+4), tmp2);
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+6), tmp3);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t item32_sc8_to_fc32_avx2(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256 scalar = _mm256_set1_ps(float(scale_factor));
+
+    size_t j = 0;
+    for (size_t i = 0; j+15 < nsamps; j+=16, i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+        const __m128i tmpilo = _mm256_castsi256_si128(tmpi);
+        const __m128i tmpihi = _mm256_extracti128_si256(tmpi, 1);
+
+        /* sign extend 8 values at a time, convert and scale */
+        const __m256 tmp0 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(tmpilo)), scalar);
+        const __m256 tmp1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(tmpilo, 8))), scalar);
+        const __m256 tmp2 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(tmpihi)), scalar);
+        const __m256 tmp3 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(tmpihi, 8))), scalar);
+
+        /* store to output */
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+j+0), tmp0);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+j+4), tmp1);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+j+8), tmp2);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+j+12), tmp3);
+    }
+    return j;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX2 size_t item32_sc8_to_fc64_avx2(
+    const item32_t *input, fc64_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m256d scalar = _mm256_set1_pd(scale_factor);
+
+    size_t j = 0;
+    for (size_t i = 0; j+15 < nsamps; j+=16, i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        const __m128i tmpi8[4] = {
+            _mm256_castsi256_si128(tmpi),
+            _mm_srli_si128(_mm256_castsi256_si128(tmpi), 8),
+            _mm256_extracti128_si256(tmpi, 1),
+            _mm_srli_si128(_mm256_extracti128_si256(tmpi, 1), 8)
+        };
+
+        for (size_t k = 0; k < 4; k++){
+            /* sign extend 8 values, convert and scale */
+            const __m256i tmpi32 = _mm256_cvtepi8_epi32(tmpi8[k]);
+            const __m256d tmplo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(tmpi32)), scalar);
+            const __m256d tmphi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(tmpi32, 1)), scalar);
+
+            /* store to output */
+            _mm256_storeu_pd(reinterpret_cast<double *>(output+j+4*k+0), tmplo);
+            _mm256_storeu_pd(reinterpret_cast<double *>(output+j+4*k+2), tmphi);
+        }
+    }
+    return j;
+}
+
+/***********************************************************************
+ * sc16 item32 -> fc32/fc64
+ **********************************************************************/
+DECLARE_CONVERTER_IF(sc16_item32_le, 1, fc32, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc32_avx2<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_be, 1, fc32, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc32_avx2<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_le, 1, fc64, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc64_avx2<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_be, 1, fc64, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc64_avx2<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+/***********************************************************************
+ * sc8 item32 -> fc32/fc64
+ * An input that does not start on an item boundary begins with the
+ * second sample of an item, handle that one like the SSE2 converters.
+ **********************************************************************/
+DECLARE_CONVERTER_IF(sc8_item32_le, 1, fc32, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::wtohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc32_avx2<SWAP_SC8_LE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::wtohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_be, 1, fc32, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::ntohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc32_avx2<SWAP_SC8_BE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::ntohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_le, 1, fc64, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::wtohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc64_avx2<SWAP_SC8_LE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::wtohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_be, 1, fc64, 1, PRIORITY_SIMD_AVX2, cpu_has_avx2()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::ntohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc64_avx2<SWAP_SC8_BE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::ntohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
@@ -0,0 +1,196 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_avx.hpp"
+#include <shd/utils/byteswap.hpp>
+
+using namespace shd::convert;
+
+/***********************************************************************
+ * Kernels: convert the bulk of the samples and return the number of
+ * samples converted, the caller converts the remainder. The rounding
+ * and saturation match the SSE2 converters: fc32 is rounded to nearest,
+ * fc64 is truncated, both saturate when narrowing.
+ **********************************************************************/
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t fc32_to_item32_sc16_avx512(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512 scalar = _mm512_set1_ps(float(scale_factor));
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input, convert and scale */
+        const __m512i tmpi32 = _mm512_cvtps_epi32(_mm512_mul_ps(
+            _mm512_loadu_ps(reinterpret_cast<const float *>(input+i)), scalar));
+
+        /* narrow with saturation + swap to wire order */
+        const __m256i tmpi = swap_item32_x8<swap>(_mm512_cvtsepi32_epi16(tmpi32));
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t fc64_to_item32_sc16_avx512(
+    const fc64_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512d scalar = _mm512_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input, convert and scale */
+        const __m256i tmpilo = _mm512_cvttpd_epi32(_mm512_mul_pd(
+            _mm512_loadu_pd(reinterpret_cast<const double *>(input+i+0)), scalar));
+        const __m256i tmpihi = _mm512_cvttpd_epi32(_mm512_mul_pd(
+            _mm512_loadu_pd(reinterpret_cast<const double *>(input+i+4)), scalar));
+
+        /* narrow with saturation + swap to wire order */
+        const __m512i tmpi32 = _mm512_inserti64x4(_mm512_castsi256_si512(tmpilo), tmpihi, 1);
+        const __m256i tmpi = swap_item32_x8<swap>(_mm512_cvtsepi32_epi16(tmpi32));
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t fc32_to_item32_sc8_avx512(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512 scalar = _mm512_set1_ps(float(scale_factor));
+
+    size_t i = 0;
+    for (size_t j = 0; i+15 < nsamps; i+=16, j+=8){
+        /* load from input, convert and scale */
+        const __m512i tmpilo = _mm512_cvtps_epi32(_mm512_mul_ps(
+            _mm512_loadu_ps(reinterpret_cast<const float *>(input+i+0)), scalar));
+        const __m512i tmpihi = _mm512_cvtps_epi32(_mm512_mul_ps(
+            _mm512_loadu_ps(reinterpret_cast<const float *>(input+i+8)), scalar));
+
+        /* narrow with saturation + swap to wire order */
+        __m256i tmpi = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm512_cvtsepi32_epi8(tmpilo)), _mm512_cvtsepi32_epi8(tmpihi), 1);
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+j), tmpi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t fc64_to_item32_sc8_avx512(
+    const fc64_t *input, item32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512d scalar = _mm512_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (size_t j = 0; i+15 < nsamps; i+=16, j+=8){
+        /* load from input, convert and scale */
+        __m256i tmpi32[4];
+        for (size_t k = 0; k < 4; k++){
+            tmpi32[k] = _mm512_cvttpd_epi32(_mm512_mul_pd(
+                _mm512_loadu_pd(reinterpret_cast<const double *>(input+i+4*k)), scalar));
+        }
+
+        /* narrow with saturation + swap to wire order */
+        const __m128i tmpilo = _mm512_cvtsepi32_epi8(
+            _mm512_inserti64x4(_mm512_castsi256_si512(tmpi32[0]), tmpi32[1], 1));
+        const __m128i tmpihi = _mm512_cvtsepi32_epi8(
+            _mm512_inserti64x4(_mm512_castsi256_si512(tmpi32[2]), tmpi32[3], 1));
+        __m256i tmpi = _mm256_inserti128_si256(_mm256_castsi128_si256(tmpilo), tmpihi, 1);
+        tmpi = swap_item32_x8<swap>(tmpi);
+
+        /* store to output */
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+j), tmpi);
+    }
+    return i;
+}
+
+/***********************************************************************
+ * fc32/fc64 -> sc16 item32
+ **********************************************************************/
+DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_le, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc16_avx512<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_be, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc16_avx512<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc16_item32_le, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc16_avx512<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc16_item32_be, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc16_avx512<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc16<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+/***********************************************************************
+ * fc32/fc64 -> sc8 item32
+ **********************************************************************/
+DECLARE_CONVERTER_IF(fc32, 1, sc8_item32_le, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc8_avx512<SWAP_SC8_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htowx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc32, 1, sc8_item32_be, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc32_to_item32_sc8_avx512<SWAP_SC8_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htonx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc8_item32_le, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc8_avx512<SWAP_SC8_LE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htowx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(fc64, 1, sc8_item32_be, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(outputs[0]);
+
+    const size_t i = fc64_to_item32_sc8_avx512<SWAP_SC8_BE>(input, output, nsamps, scale_factor);
+    xx_to_item32_sc8<shd::htonx>(input+i, output+(i/2), nsamps-i, scale_factor);
+}
@@ -0,0 +1,225 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_avx.hpp"
+#include <shd/utils/byteswap.hpp>
+
+using namespace shd::convert;
+
+/***********************************************************************
+ * Kernels: convert the bulk of the samples 8 items at a time and return
+ * the number of samples converted, the caller converts the remainder.
+ * The items are reordered with 256-bit shuffles, which only need AVX2
+ * (always present with AVX-512F), the conversions use 512-bit registers.
+ **********************************************************************/
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t item32_sc16_to_fc32_avx512(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512 scalar = _mm512_set1_ps(float(scale_factor));
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        /* sign extend, convert and scale */
+        const __m512 tmp = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(tmpi)), scalar);
+
+        /* store to output */
+        _mm512_storeu_ps(reinterpret_cast<float *>(output+i), tmp);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t item32_sc16_to_fc64_avx512(
+    const item32_t *input, fc64_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512d scalar = _mm512_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (; i+7 < nsamps; i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        /* sign extend */
+        const __m512i tmpi32 = _mm512_cvtepi16_epi32(tmpi);
+
+        /* convert and scale */
+        const __m512d tmplo = _mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(tmpi32)), scalar);
+        const __m512d tmphi = _mm512_mul_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(tmpi32, 1)), scalar);
+
+        /* store to output */
+        _mm512_storeu_pd(reinterpret_cast<double *>(output+i+0), tmplo);
+        _mm512_storeu_pd(reinterpret_cast<double *>(output+i+4), tmphi);
+    }
+    return i;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t item32_sc8_to_fc32_avx512(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512 scalar = _mm512_set1_ps(float(scale_factor));
+
+    size_t j = 0;
+    for (size_t i = 0; j+15 < nsamps; j+=16, i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        /* sign extend, convert and scale */
+        const __m512 tmplo = _mm512_mul_ps(_mm512_cvtepi32_ps(
+            _mm512_cvtepi8_epi32(_mm256_castsi256_si128(tmpi))), scalar);
+        const __m512 tmphi = _mm512_mul_ps(_mm512_cvtepi32_ps(
+            _mm512_cvtepi8_epi32(_mm256_extracti128_si256(tmpi, 1))), scalar);
+
+        /* store to output */
+        _mm512_storeu_ps(reinterpret_cast<float *>(output+j+0), tmplo);
+        _mm512_storeu_ps(reinterpret_cast<float *>(output+j+8), tmphi);
+    }
+    return j;
+}
+
+template <item32_swap_t swap>
+static SHD_TARGET_AVX512 size_t item32_sc8_to_fc64_avx512(
+    const item32_t *input, fc64_t *output, const size_t nsamps, const double scale_factor
+){
+    const __m512d scalar = _mm512_set1_pd(scale_factor);
+
+    size_t j = 0;
+    for (size_t i = 0; j+15 < nsamps; j+=16, i+=8){
+        /* load from input + swap into I/Q order */
+        const __m256i tmpi = swap_item32_x8<swap>(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+i)));
+
+        const __m128i tmpi8[4] = {
+            _mm256_castsi256_si128(tmpi),
+            _mm_srli_si128(_mm256_castsi256_si128(tmpi), 8),
+            _mm256_extracti128_si256(tmpi, 1),
+            _mm_srli_si128(_mm256_extracti128_si256(tmpi, 1), 8)
+        };
+
+        for (size_t k = 0; k < 4; k++){
+            /* sign extend 8 values, convert and scale */
+            const __m512d tmp = _mm512_mul_pd(_mm512_cvtepi32_pd(_mm256_cvtepi8_epi32(tmpi8[k])), scalar);
+
+            /* store to output */
+            _mm512_storeu_pd(reinterpret_cast<double *>(output+j+4*k), tmp);
+        }
+    }
+    return j;
+}
+
+/***********************************************************************
+ * sc16 item32 -> fc32/fc64
+ **********************************************************************/
+DECLARE_CONVERTER_IF(sc16_item32_le, 1, fc32, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc32_avx512<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_be, 1, fc32, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc32_avx512<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_le, 1, fc64, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc64_avx512<SWAP_SC16_LE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htowx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc16_item32_be, 1, fc64, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    const size_t i = item32_sc16_to_fc64_avx512<SWAP_SC16_BE>(input, output, nsamps, scale_factor);
+    item32_sc16_to_xx<shd::htonx>(input+i, output+i, nsamps-i, scale_factor);
+}
+
+/***********************************************************************
+ * sc8 item32 -> fc32/fc64
+ * An input that does not start on an item boundary begins with the
+ * second sample of an item, handle that one like the SSE2 converters.
+ **********************************************************************/
+DECLARE_CONVERTER_IF(sc8_item32_le, 1, fc32, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::wtohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc32_avx512<SWAP_SC8_LE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::wtohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_be, 1, fc32, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::ntohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc32_avx512<SWAP_SC8_BE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::ntohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_le, 1, fc64, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::wtohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc64_avx512<SWAP_SC8_LE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::wtohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
+
+DECLARE_CONVERTER_IF(sc8_item32_be, 1, fc64, 1, PRIORITY_SIMD_AVX512, cpu_has_avx512f()){
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
+    fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]);
+
+    size_t num_samps = nsamps;
+    if ((size_t(inputs[0]) & 0x3) != 0){
+        item32_sc8_to_xx<shd::ntohx>(input++, output++, 1, scale_factor);
+        num_samps--;
+    }
+
+    const size_t j = item32_sc8_to_fc64_avx512<SWAP_SC8_BE>(input, output, num_samps, scale_factor);
+    item32_sc8_to_xx<shd::ntohx>(input+j/2, output+j, num_samps-j, scale_factor);
+}
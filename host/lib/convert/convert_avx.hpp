@@ -0,0 +1,64 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_CONVERT_AVX_HPP
+#define INCLUDED_LIBSHD_CONVERT_AVX_HPP
+
+#include "convert_common.hpp"
+#include <immintrin.h>
+
+/***********************************************************************
+ * The AVX2 and AVX-512 converters are not built with -mavx2/-mavx512f.
+ * Only their kernels are compiled for the wider instruction set, so the
+ * inline code they share with the other converters (the scalar helpers,
+ * std::complex, the registry) is never emitted with instructions the
+ * host may not have. The converters are only registered when the CPU
+ * supports the instruction set, see cpu_has_avx2() and cpu_has_avx512f().
+ **********************************************************************/
+#define SHD_TARGET_AVX2   __attribute__((target("avx2")))
+#define SHD_TARGET_AVX512 __attribute__((target("avx512f")))
+
+//! Byte reordering between an item32 on the wire and host order I/Q
+enum item32_swap_t{
+    SWAP_SC16_LE, //swap the 16-bit halves
+    SWAP_SC16_BE, //swap the bytes within each 16-bit half
+    SWAP_SC8_LE,  //reverse the 4 bytes
+    SWAP_SC8_BE   //already in I0 Q0 I1 Q1 order
+};
+
+/*!
+ * Reorder 8 item32s between wire and host order.
+ * Each reordering is its own inverse, so this works in both directions.
+ */
+template <item32_swap_t swap>
+static SHD_INLINE SHD_TARGET_AVX2 __m256i swap_item32_x8(const __m256i in){
+    switch (swap){
+    case SWAP_SC16_LE: return _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+    case SWAP_SC16_BE: return _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+    case SWAP_SC8_LE: return _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    case SWAP_SC8_BE: return in;
+    }
+    return in;
+}
+
+#endif /* INCLUDED_LIBSHD_CONVERT_AVX_HPP */
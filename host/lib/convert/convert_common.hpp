@@ -23,7 +23,7 @@
 #include <stdint.h>
 #include <complex>
 
-#define _DECLARE_CONVERTER(name, in_form, num_in, out_form, num_out, prio) \
+#define _DECLARE_CONVERTER(name, in_form, num_in, out_form, num_out, prio, cond) \
     struct name : public shd::convert::converter{ \
         static sptr make(void){return sptr(new name());} \
         double scale_factor; \
@@ -31,6 +31,7 @@
         void operator()(const input_type&, const output_type&, const size_t); \
     }; \
     SHD_STATIC_BLOCK(__register_##name##_##prio){ \
+        if (not (cond)) return; \
         shd::convert::id_type id; \
         id.input_format = #in_form; \
         id.num_inputs = num_in; \
@@ -56,7 +57,17 @@
  * - `scale_factor`: Scaling factor for float conversions
  */
 #define DECLARE_CONVERTER(in_form, num_in, out_form, num_out, prio) \
-    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio)
+    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio, true)
+
+/*! Declare a converter that is only registered when a runtime check passes
+ *
+ * Same as DECLARE_CONVERTER(), but the converter is only registered when
+ * `cond` evaluates to true at load time. This is used for converters that
+ * require an instruction set which is not available on every host, such
+ * as the AVX2 and AVX-512 converters (see cpu_has_avx2()).
+ */
+#define DECLARE_CONVERTER_IF(in_form, num_in, out_form, num_out, prio, cond) \
+    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio, cond)
 
 /***********************************************************************
  * Setup priorities
@@ -73,6 +84,28 @@ static const int PRIORITY_SIMD = 3;
 static const int PRIORITY_TABLE = 1;
 #endif
 
+//wider SIMD, only registered when the host CPU supports it
+static const int PRIORITY_SIMD_AVX2 = 4;
+static const int PRIORITY_SIMD_AVX512 = 5;
+
+/***********************************************************************
+ * Runtime CPU feature checks
+ **********************************************************************/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+SHD_INLINE bool cpu_has_avx2(void){
+    __builtin_cpu_init(); //required when called from static initializers
+    return __builtin_cpu_supports("avx2");
+}
+
+SHD_INLINE bool cpu_has_avx512f(void){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#else
+SHD_INLINE bool cpu_has_avx2(void){return false;}
+SHD_INLINE bool cpu_has_avx512f(void){return false;}
+#endif
+
 /***********************************************************************
  * Typedefs
  **********************************************************************/
@@ -24,6 +24,7 @@
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 #include <complex>
+#include <algorithm>
 
 using namespace shd;
 
@@ -128,6 +129,15 @@ convert::function_type convert::get_converter(
     return get_table()[id][best_prio];
 }
 
+std::vector<convert::priority_type> convert::get_converter_priorities(
+    const id_type &id
+){
+    std::vector<priority_type> prios;
+    if (get_table().has_key(id)) prios = get_table()[id].keys();
+    std::sort(prios.begin(), prios.end());
+    return prios;
+}
+
 /***********************************************************************
  * Mappings for item format to byte size for all items we can
  **********************************************************************/
@@ -30,6 +30,9 @@
 #include <boost/graph/depth_first_search.hpp>
 #include <boost/graph/topological_sort.hpp>
 #include <boost/graph/adjacency_list.hpp>
+#include <algorithm>
+#include <queue>
+#include <functional>
 
 #ifdef SHD_EXPERT_LOGGING
 #define EX_LOG(depth, str) _log(depth, str)
@@ -50,7 +53,7 @@ typedef boost::adjacency_list<
 > expert_graph_t;
 
 typedef std::map<std::string, expert_graph_t::vertex_descriptor> vertex_map_t;
-typedef std::list<expert_graph_t::vertex_descriptor>             node_queue_t;
+typedef std::vector<expert_graph_t::vertex_descriptor>           node_queue_t;
 
 typedef boost::graph_traits<expert_graph_t>::edge_iterator       edge_iter;
 typedef boost::graph_traits<expert_graph_t>::vertex_iterator     vertex_iter;
@@ -73,7 +76,7 @@ private:    //Visitor class for cycle detection algorithm
 
 public:
     expert_container_impl(const std::string& name):
-        _name(name)
+        _name(name), _sorted_valid(false), _visit_generation(0)
     {
     }
 
@@ -100,20 +103,21 @@ public:
     {
         boost::lock_guard<boost::recursive_mutex> resolve_lock(_resolve_mutex);
         boost::lock_guard<boost::mutex> lock(_mutex);
-        EX_LOG(0, "resolve_from (overridden to resolve_all)");
-        // Do a full resolve of the graph
-        // Not optimizing the traversal using node_name to reduce experts complexity
-        _resolve_helper("", "", false);
+        EX_LOG(0, "resolve_from (incremental)");
+        // Only the workers downstream of a dirty node can run. All dirty nodes
+        // are considered (not just node_name) to produce the same result as a
+        // full resolve.
+        _resolve_incremental();
     }
 
     void resolve_to(const std::string&)
     {
         boost::lock_guard<boost::recursive_mutex> resolve_lock(_resolve_mutex);
         boost::lock_guard<boost::mutex> lock(_mutex);
-        EX_LOG(0, "resolve_to (overridden to resolve_all)");
-        // Do a full resolve of the graph
-        // Not optimizing the traversal using node_name to reduce experts complexity
-        _resolve_helper("", "", false);
+        EX_LOG(0, "resolve_to (incremental)");
+        // Anything upstream of node_name that is out of date is downstream
+        // of a dirty node, so the incremental resolve covers it.
+        _resolve_incremental();
     }
 
     dag_vertex_t& retrieve(const std::string& name) const
@@ -303,6 +307,7 @@ protected:
 
         try {
             //Add a vertex in this graph for the data node
+            _sorted_valid = false;
             expert_graph_t::vertex_descriptor gr_node = boost::add_vertex(data_node, _expert_dag);
             EX_LOG(1, str(boost::format("added vertex %s") % data_node->get_name()));
             _datanode_map.insert(vertex_map_t::value_type(data_node->get_name(), gr_node));
@@ -342,6 +347,7 @@ protected:
 
         try {
             //Add a vertex in this graph for the worker node
+            _sorted_valid = false;
             expert_graph_t::vertex_descriptor gr_node = boost::add_vertex(worker, _expert_dag);
             EX_LOG(1, str(boost::format("added vertex %s") % worker->get_name()));
             _worker_map.insert(vertex_map_t::value_type(worker->get_name(), gr_node));
@@ -407,29 +413,19 @@ protected:
         // Release all nodes in the map
         _worker_map.clear();
         _datanode_map.clear();
+
+        // Release the cached topological order
+        _sorted_valid = false;
+        _sorted_nodes.clear();
+        _sorted_rank.clear();
+        _sorted_datanodes.clear();
+        _visit_stamp.clear();
     }
 
 private:
     void _resolve_helper(std::string start, std::string stop, bool force)
     {
-        //Sort the graph topologically. This ensures that for all dependencies, the dependant
-        //is always after all of its dependencies.
-        node_queue_t sorted_nodes;
-        try {
-            boost::topological_sort(_expert_dag, std::front_inserter(sorted_nodes));
-        } catch (boost::not_a_dag&) {
-            std::vector<std::string> back_edges;
-            cycle_det_visitor cdet_vis(back_edges);
-            boost::depth_first_search(_expert_dag, boost::visitor(cdet_vis));
-            if (not back_edges.empty()) {
-                std::string edges;
-                BOOST_FOREACH(const std::string& e, back_edges) {
-                    edges += "* " + e + "";
-                }
-                throw shd::runtime_error("Cannot resolve expert because it has at least one cycle!\n"
-                                         "The following back-edges were found:" + edges);
-            }
-        }
+        const node_queue_t& sorted_nodes = _get_sorted_nodes();
         if (sorted_nodes.empty()) return;
 
         //Determine the start and stop node. If one is not explicitly specified then
@@ -442,7 +438,7 @@ private:
         //First Pass: Resolve all nodes if they are dirty, in a topological order
         std::list<dag_vertex_t*> resolved_workers;
         bool start_node_encountered = false;
-        for (node_queue_t::iterator node_iter = sorted_nodes.begin();
+        for (node_queue_t::const_iterator node_iter = sorted_nodes.begin();
              node_iter != sorted_nodes.end();
              ++node_iter
         ) {
@@ -481,6 +477,108 @@ private:
         }
     }
 
+    void _resolve_incremental()
+    {
+        const node_queue_t& sorted_nodes = _get_sorted_nodes();
+        if (sorted_nodes.empty()) return;
+
+        //A worker is only dirty if one of its inputs is dirty, and an input can
+        //only become dirty when a worker that writes it runs. So starting at the
+        //dirty data nodes and following the edges of the nodes that are dirty
+        //reaches every node that a full resolve would run. Visiting them in
+        //order of their rank in the topological order, lowest first, makes the
+        //nodes run in the same order as in a full resolve.
+        if (++_visit_generation == 0) {
+            std::fill(_visit_stamp.begin(), _visit_stamp.end(), 0);
+            _visit_generation = 1;
+        }
+        std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t> > pending;
+        BOOST_FOREACH(expert_graph_t::vertex_descriptor vertex, _sorted_datanodes) {
+            if (_get_vertex(vertex).is_dirty()) {
+                _visit_stamp[vertex] = _visit_generation;
+                pending.push(_sorted_rank[vertex]);
+            }
+        }
+
+        //First Pass: Resolve the dirty nodes, in a topological order
+        std::list<dag_vertex_t*> resolved_workers;
+        while (not pending.empty()) {
+            const expert_graph_t::vertex_descriptor vertex = sorted_nodes[pending.top()];
+            pending.pop();
+            dag_vertex_t& node = _get_vertex(vertex);
+            if (not node.is_dirty()) {
+                EX_LOG(1, str(boost::format("skipped node %s (clean) [%s]") %
+                                node.get_name() % node.to_string()));
+                continue;
+            }
+            node.resolve();
+            if (node.get_class() == CLASS_WORKER) {
+                resolved_workers.push_back(&node);
+            }
+            EX_LOG(1, str(boost::format("resolved node %s (%s) [%s]") %
+                            node.get_name() % (node.is_dirty()?"dirty":"clean") % node.to_string()));
+
+            //Successors have a higher rank so they are still to be visited
+            typedef boost::graph_traits<expert_graph_t>::adjacency_iterator adj_iter;
+            for (std::pair<adj_iter, adj_iter> ai = boost::adjacent_vertices(vertex, _expert_dag);
+                 ai.first != ai.second;
+                 ++ai.first
+            ) {
+                if (_visit_stamp[*ai.first] != _visit_generation) {
+                    _visit_stamp[*ai.first] = _visit_generation;
+                    pending.push(_sorted_rank[*ai.first]);
+                }
+            }
+        }
+
+        //Second Pass: Mark all the workers clean (see _resolve_helper)
+        for (std::list<dag_vertex_t*>::iterator worker = resolved_workers.begin();
+             worker != resolved_workers.end();
+             ++worker
+        ) {
+            (*worker)->mark_clean();
+        }
+    }
+
+    const node_queue_t& _get_sorted_nodes()
+    {
+        if (_sorted_valid) return _sorted_nodes;
+
+        //Sort the graph topologically. This ensures that for all dependencies, the dependant
+        //is always after all of its dependencies. The graph only changes when nodes are
+        //added so the order is computed once and reused by all resolves.
+        std::list<expert_graph_t::vertex_descriptor> sorted_list;
+        try {
+            boost::topological_sort(_expert_dag, std::front_inserter(sorted_list));
+        } catch (boost::not_a_dag&) {
+            std::vector<std::string> back_edges;
+            cycle_det_visitor cdet_vis(back_edges);
+            boost::depth_first_search(_expert_dag, boost::visitor(cdet_vis));
+            if (not back_edges.empty()) {
+                std::string edges;
+                BOOST_FOREACH(const std::string& e, back_edges) {
+                    edges += "* " + e + "";
+                }
+                throw shd::runtime_error("Cannot resolve expert because it has at least one cycle!\n"
+                                         "The following back-edges were found:" + edges);
+            }
+        }
+
+        _sorted_nodes.assign(sorted_list.begin(), sorted_list.end());
+        _sorted_rank.assign(boost::num_vertices(_expert_dag), 0);
+        _sorted_datanodes.clear();
+        for (size_t rank = 0; rank < _sorted_nodes.size(); rank++) {
+            _sorted_rank[_sorted_nodes[rank]] = rank;
+            if (_get_vertex(_sorted_nodes[rank]).get_class() != CLASS_WORKER) {
+                _sorted_datanodes.push_back(_sorted_nodes[rank]);
+            }
+        }
+        _visit_stamp.assign(boost::num_vertices(_expert_dag), 0);
+        _visit_generation = 0;
+        _sorted_valid = true;
+        return _sorted_nodes;
+    }
+
     expert_graph_t::vertex_descriptor _lookup_vertex(const std::string& name) const
     {
         expert_graph_t::vertex_descriptor vertex;
@@ -524,6 +622,12 @@ private:
     vertex_map_t            _datanode_map;      //A map from vertex name to vertex descriptor for data nodes
     boost::mutex            _mutex;
     boost::recursive_mutex  _resolve_mutex;
+    bool                    _sorted_valid;      //True if the cached topological order matches the graph
+    node_queue_t            _sorted_nodes;      //All vertices in topological order
+    std::vector<size_t>     _sorted_rank;       //The position of each vertex in _sorted_nodes
+    node_queue_t            _sorted_datanodes;  //The data nodes in topological order
+    std::vector<uint32_t>   _visit_stamp;       //The last incremental resolve that queued each vertex
+    uint32_t                _visit_generation;
 };
 
 expert_container::sptr expert_container::make(const std::string& name)
@@ -69,6 +69,8 @@ namespace shd { namespace experts {
          * Nodes and their dependencies are resolved only if they are
          * dirty i.e. their contained values have changed since the
          * last resolve.
+         * Only the nodes downstream of a dirty node are visited,
+         * which gives the same result as resolve_all().
          * This call requires an acyclic expert graph.
          *
          * \param node_name Name of the node to start resolving from
@@ -87,6 +89,8 @@ namespace shd { namespace experts {
          * Nodes and their dependencies are resolved only if they are
          * dirty i.e. their contained values have changed since the
          * last resolve.
+         * Only the nodes downstream of a dirty node are visited,
+         * which gives the same result as resolve_all().
          * This call requires an acyclic expert graph.
          *
          * \param node_name Name of the node to resolve
@@ -18,7 +18,9 @@
 #include <shd/property_tree.hpp>
 #include <shd/types/dict.hpp>
 #include <boost/foreach.hpp>
-#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/make_shared.hpp>
 #include <iostream>
 
@@ -32,6 +34,26 @@ using namespace shd;
     boost::tokenizer<boost::char_separator<char> > \
     (path, boost::char_separator<char>("/"))
 
+/***********************************************************************
+ * Canonical form of a path for the property index:
+ * every name is preceded by exactly one slash, e.g. "/mboards/0/name"
+ **********************************************************************/
+static std::string path_to_key(const std::string &path){
+    std::string key;
+    key.reserve(path.size()+1);
+    bool at_separator = true;
+    BOOST_FOREACH(const char ch, path){
+        if (ch == '/'){
+            at_separator = true;
+            continue;
+        }
+        if (at_separator) key += '/';
+        at_separator = false;
+        key += ch;
+    }
+    return key;
+}
+
 /***********************************************************************
  * Property path implementation wrapper
  **********************************************************************/
@@ -85,7 +107,7 @@ public:
 
     sptr subtree(const fs_path &path_) const{
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::shared_lock<boost::shared_mutex> lock(_guts->mutex);
 
         property_tree_impl *subtree = new property_tree_impl(path);
         subtree->_guts = this->_guts; //copy the guts sptr
@@ -94,7 +116,7 @@ public:
 
     void remove(const fs_path &path_){
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::unique_lock<boost::shared_mutex> lock(_guts->mutex);
 
         node_type *parent = NULL;
         node_type *node = &_guts->root;
@@ -105,11 +127,23 @@ public:
         }
         if (parent == NULL) throw shd::runtime_error("Cannot uproot");
         parent->pop(fs_path(path.leaf()));
+
+        //drop the property and everything below it from the index
+        const std::string key = path_to_key(path);
+        const std::string prefix = key + "/";
+        index_type::iterator it = _guts->index.begin();
+        while (it != _guts->index.end()){
+            if (it->first == key or it->first.compare(0, prefix.size(), prefix) == 0){
+                it = _guts->index.erase(it);
+            }
+            else ++it;
+        }
     }
 
     bool exists(const fs_path &path_) const{
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::shared_lock<boost::shared_mutex> lock(_guts->mutex);
+        if (_guts->index.count(path_to_key(path)) != 0) return true;
 
         node_type *node = &_guts->root;
         BOOST_FOREACH(const std::string &name, path_tokenizer(path)){
@@ -121,7 +155,7 @@ public:
 
     std::vector<std::string> list(const fs_path &path_) const{
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::shared_lock<boost::shared_mutex> lock(_guts->mutex);
 
         node_type *node = &_guts->root;
         BOOST_FOREACH(const std::string &name, path_tokenizer(path)){
@@ -134,7 +168,7 @@ public:
 
     void _create(const fs_path &path_, const boost::shared_ptr<void> &prop){
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::unique_lock<boost::shared_mutex> lock(_guts->mutex);
 
         node_type *node = &_guts->root;
         BOOST_FOREACH(const std::string &name, path_tokenizer(path)){
@@ -143,12 +177,18 @@ public:
         }
         if (node->prop.get() != NULL) throw shd::runtime_error("Cannot create! Property already exists at: " + path);
         node->prop = prop;
+        _guts->index[path_to_key(path)] = prop;
     }
 
     boost::shared_ptr<void> &_access(const fs_path &path_) const{
         const fs_path path = _root / path_;
-        boost::mutex::scoped_lock lock(_guts->mutex);
+        boost::shared_lock<boost::shared_mutex> lock(_guts->mutex);
 
+        //fast path: every property is in the index
+        const index_type::iterator it = _guts->index.find(path_to_key(path));
+        if (it != _guts->index.end()) return it->second;
+
+        //slow path: walk the tree to report the error
         node_type *node = &_guts->root;
         BOOST_FOREACH(const std::string &name, path_tokenizer(path)){
             if (not node->has_key(name)) throw_path_not_found(path);
@@ -168,10 +208,14 @@ private:
         boost::shared_ptr<void> prop;
     };
 
+    //index of all properties by canonical path, see path_to_key()
+    typedef boost::unordered_map<std::string, boost::shared_ptr<void> > index_type;
+
     //tree guts which may be referenced in a subtree
     struct tree_guts_type{
         node_type root;
-        boost::mutex mutex;
+        index_type index;
+        boost::shared_mutex mutex;
     };
 
     //members, the tree and root prefix
@@ -239,6 +239,23 @@ void block_ctrl_base::sr_write(const uint32_t reg, const uint32_t data, const si
     }
 }
 
+void block_ctrl_base::sr_write(const wb_iface::poke32_list_type &writes, const size_t port)
+{
+    if (not _ctrl_ifaces.count(port)) {
+        throw shd::key_error(str(boost::format("[%s] sr_write(): No such port: %d") % get_block_id().get() % port));
+    }
+    wb_iface::poke32_list_type addr_writes(writes);
+    for (size_t i = 0; i < addr_writes.size(); i++) {
+        addr_writes[i].first = _sr_to_addr(addr_writes[i].first);
+    }
+    try {
+        _ctrl_ifaces[port]->poke32_batch(addr_writes);
+    }
+    catch(const std::exception &ex) {
+        throw shd::io_error(str(boost::format("[%s] sr_write() failed: %s") % get_block_id().get() % ex.what()));
+    }
+}
+
 void block_ctrl_base::sr_write(const std::string &reg, const uint32_t data, const size_t port)
 {
     uint32_t reg_addr = 255;
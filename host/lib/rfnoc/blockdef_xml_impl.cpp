@@ -28,7 +28,11 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
 #include <cstdlib>
+#include <ctime>
 
 using namespace shd;
 using namespace shd::rfnoc;
@@ -212,30 +216,33 @@ public:
         return (rhs.find(lhs) == 0);
     }
 
-    //! Open the file at filename and see if it's a block definition for the given NoC ID
-    static bool has_noc_id(uint64_t noc_id, const fs::path &filename)
+    //! See if a parsed file is a block definition for the given NoC ID
+    static bool has_noc_id(uint64_t noc_id, const fs::path &filename, const pt::ptree &propt)
     {
-        pt::ptree propt;
         try {
-            read_xml(filename.string(), propt);
-            BOOST_FOREACH(pt::ptree::value_type &v, propt.get_child("nocblock.ids")) {
+            BOOST_FOREACH(const pt::ptree::value_type &v, propt.get_child("nocblock.ids")) {
                 if (v.first == "id" and match_noc_id(v.second.data(), noc_id)) {
                     return true;
                 }
             }
         } catch (std::exception &e) {
-            SHD_MSG(warning) << "has_noc_id(): caught exception " << e.what() << std::endl;
+            SHD_MSG(warning) << "has_noc_id(): caught exception in " << filename.string()
+                             << ": " << e.what() << std::endl;
             return false;
         }
         return false;
     }
 
-    blockdef_xml_impl(const fs::path &filename, uint64_t noc_id, xml_repr_t type=DESCRIBES_BLOCK) :
+    blockdef_xml_impl(
+            const fs::path &filename,
+            boost::shared_ptr<const pt::ptree> propt,
+            uint64_t noc_id,
+            xml_repr_t type=DESCRIBES_BLOCK
+    ) :
         _type(type),
-        _noc_id(noc_id)
+        _noc_id(noc_id),
+        _pt(propt)
     {
-        //SHD_MSG(status) << "Reading XML file: " << filename.string().c_str() << std::endl;
-        read_xml(filename.string(), _pt);
         try {
             // Check key is valid
             get_key();
@@ -271,15 +278,15 @@ public:
     std::string get_key() const
     {
         try {
-            return _pt.get<std::string>("nocblock.key");
+            return _pt->get<std::string>("nocblock.key");
         } catch (const pt::ptree_bad_path &) {
-            return _pt.get<std::string>("nocblock.blockname");
+            return _pt->get<std::string>("nocblock.blockname");
         }
     }
 
     std::string get_name() const
     {
-        return _pt.get<std::string>("nocblock.blockname");
+        return _pt->get<std::string>("nocblock.blockname");
     }
 
     uint64_t noc_id() const
@@ -302,7 +309,7 @@ public:
         std::set<size_t> port_numbers;
         size_t n_ports = 0;
         ports_t ports;
-        BOOST_FOREACH(pt::ptree::value_type &v, _pt.get_child("nocblock.ports")) {
+        BOOST_FOREACH(const pt::ptree::value_type &v, _pt->get_child("nocblock.ports")) {
             if (v.first != port_type) continue;
             // Now we have the correct sink or source node:
             port_t port;
@@ -353,7 +360,7 @@ public:
         args_t args;
         bool is_valid = true;
         pt::ptree def;
-        BOOST_FOREACH(pt::ptree::value_type &v, _pt.get_child("nocblock.args", def)) {
+        BOOST_FOREACH(const pt::ptree::value_type &v, _pt->get_child("nocblock.args", def)) {
             arg_t arg;
             if (v.first != "arg") continue;
             BOOST_FOREACH(const std::string &key, arg_t::ARG_ARGS.keys()) {
@@ -391,7 +398,7 @@ public:
     {
         registers_t registers;
         pt::ptree def;
-        BOOST_FOREACH(pt::ptree::value_type &v, _pt.get_child("nocblock.registers", def)) {
+        BOOST_FOREACH(const pt::ptree::value_type &v, _pt->get_child("nocblock.registers", def)) {
             if (v.first != reg_type) continue;
             registers[v.second.get<std::string>("name")] =
                 boost::lexical_cast<size_t>(v.second.get<size_t>("address"));
@@ -408,11 +415,77 @@ private:
     const uint64_t _noc_id;
 
     //! This is a boost property tree, not the same as
-    // our property tree.
-    pt::ptree _pt;
+    // our property tree. It is shared with the block definition index.
+    boost::shared_ptr<const pt::ptree> _pt;
 
 };
 
+/****************************************************************************
+ * The block definition index
+ ****************************************************************************/
+//! A block definition file and its parsed contents
+struct blockdef_file_t
+{
+    fs::path filename;
+    boost::shared_ptr<const pt::ptree> propt;
+};
+typedef std::vector<blockdef_file_t> blockdef_index_t;
+
+/*!
+ * Parse all block definition files in the given directories, once per
+ * process. Every block of every device is looked up in the same index.
+ * The index is built again when the list of directories changes or one
+ * of them was modified (a file was added, removed or renamed).
+ */
+static boost::shared_ptr<const blockdef_index_t> get_blockdef_index(const std::vector<fs::path> &dirs)
+{
+    static boost::mutex index_mutex;
+    static std::vector<fs::path> index_dirs;
+    static std::vector<std::time_t> index_mtimes;
+    static boost::shared_ptr<const blockdef_index_t> index;
+
+    std::vector<std::time_t> mtimes;
+    BOOST_FOREACH(const fs::path &dir, dirs) {
+        mtimes.push_back(fs::last_write_time(dir));
+    }
+
+    boost::mutex::scoped_lock lock(index_mutex);
+    if (index and dirs == index_dirs and mtimes == index_mtimes) {
+        return index;
+    }
+
+    boost::shared_ptr<blockdef_index_t> new_index = boost::make_shared<blockdef_index_t>();
+    BOOST_FOREACH(const fs::path &dir, dirs) {
+        // Iterate over all .xml files
+        fs::directory_iterator end_itr;
+        for (fs::directory_iterator i(dir); i != end_itr; ++i) {
+            if (not fs::exists(*i) or fs::is_directory(*i) or fs::is_empty(*i)) {
+                continue;
+            }
+            if (i->path().filename().extension() != XML_EXTENSION) {
+                continue;
+            }
+            boost::shared_ptr<pt::ptree> propt = boost::make_shared<pt::ptree>();
+            try {
+                read_xml(i->path().string(), *propt);
+            } catch (std::exception &e) {
+                SHD_MSG(warning) << "Skipping block definition " << i->path().string()
+                                 << ": " << e.what() << std::endl;
+                continue;
+            }
+            blockdef_file_t file;
+            file.filename = i->path();
+            file.propt = propt;
+            new_index->push_back(file);
+        }
+    }
+
+    index_dirs = dirs;
+    index_mtimes = mtimes;
+    index = new_index;
+    return index;
+}
+
 blockdef::sptr blockdef::make_from_noc_id(uint64_t noc_id)
 {
     std::vector<fs::path> paths = blockdef_xml_impl::get_xml_paths();
@@ -435,20 +508,10 @@ blockdef::sptr blockdef::make_from_noc_id(uint64_t noc_id)
         );
     }
 
-    // Iterate over all paths
-    BOOST_FOREACH(const fs::path &path, valid) {
-        // Iterate over all .xml files
-        fs::directory_iterator end_itr;
-        for (fs::directory_iterator i(path); i != end_itr; ++i) {
-            if (not fs::exists(*i) or fs::is_directory(*i) or fs::is_empty(*i)) {
-                continue;
-            }
-            if (i->path().filename().extension() != XML_EXTENSION) {
-                continue;
-            }
-            if (blockdef_xml_impl::has_noc_id(noc_id, i->path())) {
-                return blockdef::sptr(new blockdef_xml_impl(i->path(), noc_id));
-            }
+    // Search the parsed files in the same order the directories are listed
+    BOOST_FOREACH(const blockdef_file_t &file, *get_blockdef_index(valid)) {
+        if (blockdef_xml_impl::has_noc_id(noc_id, file.filename, *file.propt)) {
+            return blockdef::sptr(new blockdef_xml_impl(file.filename, file.propt, noc_id));
         }
     }
 
@@ -29,6 +29,7 @@
 #include <boost/thread/thread.hpp>
 #include <boost/format.hpp>
 #include <boost/bind.hpp>
+#include <algorithm>
 #include <queue>
 
 using namespace shd;
@@ -67,6 +68,7 @@ public:
         if (resp_xport) {
             while (resp_xport->get_recv_buff(0.0)) {} //flush
         }
+        _ack_window = _resp_queue_size;
         this->set_time(shd::time_spec_t(0.0));
         this->set_tick_rate(1.0); //something possible but bogus
     }
@@ -87,14 +89,34 @@ public:
     {
         boost::mutex::scoped_lock lock(_mutex);
         this->send_pkt(addr/4, data);
-        this->wait_for_ack(false);
+        this->wait_for_ack(false, _ack_window - 1);
+    }
+
+    void poke32_batch(const poke32_list_type &writes)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        //the acks of earlier writes belong to those writes
+        this->wait_for_ack(false, 0);
+        try
+        {
+            for (size_t i = 0; i < writes.size(); i++)
+            {
+                this->send_pkt(writes[i].first/4, writes[i].second);
+                this->wait_for_ack(false, _ack_window - 1);
+            }
+            this->wait_for_ack(false, 0);
+        }
+        catch(const std::exception &ex)
+        {
+            throw shd::io_error(str(boost::format("Block ctrl (%s) transaction of %u writes failed - %s") % _name % writes.size() % ex.what()));
+        }
     }
 
     uint32_t peek32(const wb_addr_type addr)
     {
         boost::mutex::scoped_lock lock(_mutex);
         this->send_pkt(_rb_address, addr/8);
-        const uint64_t res = this->wait_for_ack(true);
+        const uint64_t res = this->wait_for_ack(true, 0);
         const uint32_t lo = uint32_t(res & 0xffffffff);
         const uint32_t hi = uint32_t(res >> 32);
         return ((addr/4) & 0x1)? hi : lo;
@@ -104,7 +126,7 @@ public:
     {
         boost::mutex::scoped_lock lock(_mutex);
         this->send_pkt(_rb_address, addr/8);
-        return this->wait_for_ack(true);
+        return this->wait_for_ack(true, 0);
     }
 
     /*******************************************************************
@@ -130,6 +152,12 @@ public:
         _tick_rate = rate;
     }
 
+    void set_ack_window(const size_t window)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _ack_window = std::max<size_t>(1, std::min(window, _resp_queue_size));
+    }
+
 private:
     // This is the buffer type for response messages
     struct resp_buff_type
@@ -180,9 +208,10 @@ private:
         _seq_out++;//inc seq for next call
     }
 
-    SHD_INLINE uint64_t wait_for_ack(const bool readback)
+    //! Collect acks until at most max_outstanding are left (all of them for a readback)
+    SHD_INLINE uint64_t wait_for_ack(const bool readback, const size_t max_outstanding)
     {
-        while (readback or (_outstanding_seqs.size() >= _resp_queue_size))
+        while (readback or (_outstanding_seqs.size() > max_outstanding))
         {
             //get seq to ack from outstanding packets list
             SHD_ASSERT_THROW(not _outstanding_seqs.empty());
@@ -359,6 +388,7 @@ private:
     std::queue<size_t> _outstanding_seqs;
     bounded_buffer<resp_buff_type> _resp_queue;
     const size_t _resp_queue_size;
+    size_t _ack_window;
 
     const size_t _rb_address;
 };
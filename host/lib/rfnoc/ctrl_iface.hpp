@@ -61,6 +61,13 @@ public:
 
     //! Set the tick rate (converting time into ticks)
     virtual void set_tick_rate(const double rate) = 0;
+
+    /*!
+     * Set the number of writes that may wait for their acks at once.
+     * Defaults to (and is limited by) the number of response frames.
+     * A window of 1 makes every write wait for its own ack.
+     */
+    virtual void set_ack_window(const size_t window) = 0;
 };
 
 }} /* namespace shd::rfnoc */
@@ -117,7 +117,7 @@ void block_iface::run_and_check(const std::string &code, const std::string &erro
     boost::mutex::scoped_lock local_interpreter_lock(_lil_mutex);
 
     SHD_NOCSCRIPT_LOG() << "[NocScript] Executing and asserting code: " << code << std::endl;
-    expression::sptr e = _parser->create_expr_tree(code);
+    expression::sptr e = _get_expr_tree(code);
     expression_literal result = e->eval();
     if (not result.to_bool()) {
         if (error_message.empty()) {
@@ -136,8 +136,47 @@ void block_iface::run_and_check(const std::string &code, const std::string &erro
     _vars.clear(); // We go out of scope, and so do NocScript variables
 }
 
+expression::sptr block_iface::_get_expr_tree(const std::string &code)
+{
+    std::map<std::string, expression::sptr>::const_iterator it = _expr_cache.find(code);
+    if (it != _expr_cache.end()) {
+        return it->second;
+    }
+    // Argument types are fixed by the block definition, so a tree stays
+    // valid for the lifetime of the block.
+    expression::sptr e = _parser->create_expr_tree(code);
+    _expr_cache[code] = e;
+    return e;
+}
 
-expression_literal block_iface::_nocscript__sr_write(expression_container::expr_list_type args)
+const block_iface::arg_slot_t &block_iface::_get_arg_slot(const std::string &argname)
+{
+    std::map<std::string, arg_slot_t>::const_iterator it = _arg_slots.find(argname);
+    if (it != _arg_slots.end()) {
+        return it->second;
+    }
+
+    arg_slot_t slot;
+    const std::string var_type = _block_ptr->get_arg_type(argname);
+    if (var_type == "int") {
+        slot.type = expression::TYPE_INT;
+        slot.int_val = _block_ptr->resolve_arg<int>(argname);
+    } else if (var_type == "string") {
+        slot.type = expression::TYPE_STRING;
+        slot.string_val = _block_ptr->resolve_arg<std::string>(argname);
+    } else if (var_type == "double") {
+        slot.type = expression::TYPE_DOUBLE;
+        slot.double_val = _block_ptr->resolve_arg<double>(argname);
+    } else if (var_type == "int_vector") {
+        SHD_THROW_INVALID_CODE_PATH(); // TODO
+    } else {
+        SHD_THROW_INVALID_CODE_PATH();
+    }
+    return _arg_slots[argname] = slot;
+}
+
+
+expression_literal block_iface::_nocscript__sr_write(const expression_container::expr_list_type &args)
 {
     const std::string reg_name = args[0]->eval().get_string();
     const uint32_t reg_val = uint32_t(args[1]->eval().get_int());
@@ -157,32 +196,20 @@ expression_literal block_iface::_nocscript__sr_write(expression_container::expr_
 
 expression::type_t block_iface::_nocscript__arg_get_type(const std::string &varname)
 {
-    const std::string var_type = _block_ptr->get_arg_type(varname);
-    if (var_type == "int") {
-        return expression::TYPE_INT;
-    } else if (var_type == "string") {
-        return expression::TYPE_STRING;
-    } else if (var_type == "double") {
-        return expression::TYPE_DOUBLE;
-    } else if (var_type == "int_vector") {
-        SHD_THROW_INVALID_CODE_PATH(); // TODO
-    } else {
-        SHD_THROW_INVALID_CODE_PATH();
-    }
+    return _get_arg_slot(varname).type;
 }
 
 expression_literal block_iface::_nocscript__arg_get_val(const std::string &varname)
 {
-    const std::string var_type = _block_ptr->get_arg_type(varname);
-    if (var_type == "int") {
-        return expression_literal(_block_ptr->get_arg<int>(varname));
-    } else if (var_type == "string") {
-        return expression_literal(_block_ptr->get_arg<std::string>(varname));
-    } else if (var_type == "double") {
-        return expression_literal(_block_ptr->get_arg<double>(varname));
-    } else if (var_type == "int_vector") {
-        SHD_THROW_INVALID_CODE_PATH(); // TODO
-    } else {
+    const arg_slot_t &slot = _get_arg_slot(varname);
+    switch (slot.type) {
+    case expression::TYPE_INT:
+        return expression_literal(slot.int_val->get());
+    case expression::TYPE_STRING:
+        return expression_literal(slot.string_val->get());
+    case expression::TYPE_DOUBLE:
+        return expression_literal(slot.double_val->get());
+    default:
         SHD_THROW_INVALID_CODE_PATH();
     }
 }
@@ -46,17 +46,34 @@ class block_iface {
      * \param code Must be a valid NocScript expression that returns a boolean value.
      *             If it returns false, this is interpreted as failure.
      * \param error_message If the expression fails, this error message is printed.
+     * The expression tree for \p code is only parsed on the first call,
+     * further calls with the same code evaluate the cached tree.
+     *
      * \throws shd::runtime_error if the expression returns false.
      * \throws shd::syntax_error if the expression is invalid.
      */
     void run_and_check(const std::string &code, const std::string &error_message="");
 
   private:
+    //! A block argument ($foo), resolved on first use
+    struct arg_slot_t {
+        expression::type_t type;
+        property_handle<int> int_val;
+        property_handle<double> double_val;
+        property_handle<std::string> string_val;
+    };
+
     //! For the local interpreter lock (lil)
     boost::mutex _lil_mutex;
 
+    //! Return the parsed expression tree for \p code, parsing it if required
+    expression::sptr _get_expr_tree(const std::string &code);
+
+    //! Return the slot of argument \p argname, resolving it if required
+    const arg_slot_t &_get_arg_slot(const std::string &argname);
+
     //! Wrapper for block_ctrl_base::sr_write, so we can call it from within NocScript
-    expression_literal _nocscript__sr_write(expression_container::expr_list_type);
+    expression_literal _nocscript__sr_write(const expression_container::expr_list_type &);
 
     //! Argument type getter that can be used within NocScript
     expression::type_t _nocscript__arg_get_type(const std::string &argname);
@@ -86,6 +103,12 @@ class block_iface {
 
     //! Container for scoped variables
     std::map<std::string, expression_literal> _vars;
+
+    //! Parsed expression trees, by code. Only accessed under the lil.
+    std::map<std::string, expression::sptr> _expr_cache;
+
+    //! Resolved block arguments, by name. Only accessed under the lil.
+    std::map<std::string, arg_slot_t> _arg_slots;
 };
 
 }}} /* namespace shd::rfnoc::nocscript */
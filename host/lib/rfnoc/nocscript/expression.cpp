@@ -86,6 +86,12 @@ expression_literal::expression_literal(
     default:
         SHD_THROW_INVALID_CODE_PATH();
     }
+
+    // Only strings need the token from here on. Dropping it keeps
+    // copies of numeric literals (i.e., every eval()) allocation-free.
+    if (_type != expression::TYPE_STRING) {
+        _val.clear();
+    }
 }
 
 expression_literal::expression_literal(bool b)
@@ -143,11 +149,11 @@ bool expression_literal::to_bool() const
 {
     switch (_type) {
         case TYPE_INT:
-            return bool(boost::lexical_cast<int>(_val));
+            return bool(_int_val);
         case TYPE_STRING:
             return not _val.empty();
         case TYPE_DOUBLE:
-            return bool(boost::lexical_cast<double>(_val));
+            return bool(_double_val);
         case TYPE_BOOL:
             return _bool_val;
         case TYPE_INT_VECTOR:
@@ -352,6 +358,7 @@ void expression_function::add(expression::sptr new_expr)
 {
     expression_container::add(new_expr);
     _arg_types.push_back(new_expr->infer_type());
+    _func.clear();
 }
 
 expression::type_t expression_function::infer_type() const
@@ -361,7 +368,13 @@ expression::type_t expression_function::infer_type() const
 
 expression_literal expression_function::eval()
 {
-    return _func_table->eval(_name, _arg_types, _sub_exprs);
+    if (_func.empty()) {
+        _func = _func_table->get_function(_name, _arg_types);
+        if (_func.empty()) {
+            return _func_table->eval(_name, _arg_types, _sub_exprs);
+        }
+    }
+    return _func(_sub_exprs);
 }
 
 
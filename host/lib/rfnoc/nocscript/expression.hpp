@@ -314,6 +314,10 @@ class expression_function : public expression_container
     expression::type_t infer_type() const;
 
     /*! Evaluate all arguments, then the function itself.
+     *
+     * The function object is looked up in the function table on the
+     * first call only, so evaluating the same tree again skips the
+     * lookup by name and signature.
      */
     expression_literal eval();
 
@@ -324,6 +328,8 @@ class expression_function : public expression_container
     std::string _name;
     const boost::shared_ptr<function_table> _func_table;
     std::vector<expression::type_t> _arg_types;
+    //! The function object, once looked up (see eval())
+    boost::function<expression_literal(expr_list_type&)> _func;
 };
 
 
@@ -79,6 +79,20 @@ class function_table_impl : public function_table
         return it->second.find(arg_types)->second.return_type;
     }
 
+    function_ptr get_function(
+            const std::string &name,
+            const expression_function::argtype_list_type &arg_types
+    ) const {
+        table_type::const_iterator it = _table.find(name);
+        if (it == _table.end() or (it->second.find(arg_types) == it->second.end())) {
+            throw shd::syntax_error(str(
+                        boost::format("Cannot find function %s, not a known signature")
+                        % expression_function::to_string(name, arg_types)
+            ));
+        }
+        return it->second.find(arg_types)->second.function;
+    }
+
     expression_literal eval(
             const std::string &name,
             const expression_function::argtype_list_type &arg_types,
@@ -59,6 +59,20 @@ class function_table
             const expression_function::argtype_list_type &arg_types
     ) const = 0;
 
+    /*! Look up the function object for a given name and argument type list
+     *
+     * Function expressions resolve their function object once and then
+     * call it directly, rather than looking it up on every eval().
+     *
+     * \returns The function object, or an empty function_ptr if this table
+     *          can only call functions through eval()
+     * \throws shd::syntax_error if no such function is registered
+     */
+    virtual function_ptr get_function(
+            const std::string &,
+            const expression_function::argtype_list_type &
+    ) const { return function_ptr(); };
+
     /*! Calls the function \p name with the argument list \p arguments
      *
      * \param arg_types A list of types for each argument
@@ -17,6 +17,7 @@
 
 #include <shd/types/sid.hpp>
 #include <shd/transport/zero_copy.hpp>
+#include <boost/function.hpp>
 
 namespace shd {
 
@@ -31,6 +32,8 @@ namespace shd {
         size_t send_buff_size;
         shd::sid_t send_sid;
         shd::sid_t recv_sid;
+        //! Pushes out frames the send transport holds back for batching (may be empty)
+        boost::function<void(void)> flush_send;
     };
 
 };
@@ -20,10 +20,12 @@
 #include <shd/utils/paths.hpp>
 #include <shd/utils/msg.hpp>
 #include <shd/utils/csv.hpp>
-#include <shd/types/dict.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/thread/mutex.hpp>
+#include <algorithm>
 #include <cstdio>
 #include <complex>
 #include <fstream>
@@ -52,35 +54,44 @@ static bool fe_cal_comp(fe_cal_t a, fe_cal_t b){
     return (a.lo_freq < b.lo_freq);
 }
 
-static shd::dict<std::string, std::vector<fe_cal_t> > fe_cal_cache;
+//! A calibration table, sorted by LO frequency
+typedef std::vector<fe_cal_t> fe_cal_table_t;
+
+/*!
+ * The calibration tables by file name (prefix and serial).
+ * A table is loaded on the first tune of a frontend. An empty pointer
+ * records that there is no file, so later tunes never touch the filesystem.
+ */
+typedef boost::unordered_map<std::string, boost::shared_ptr<const fe_cal_table_t> > cal_cache_type;
+static cal_cache_type fe_cal_cache;
+
+static const double FREQ_EPSILON = 0.1;
+
+//! Is the table entry the same frequency as lo_freq or above it?
+static bool fe_cal_freq_comp(const double lo_freq, const fe_cal_t &data)
+{
+    return data.lo_freq + FREQ_EPSILON > lo_freq;
+}
 
 static bool is_same_freq(const double f1, const double f2)
 {
-    const double epsilon = 0.1;
-    return ((f1 - epsilon) < f2 and (f1 + epsilon) > f2);
+    return ((f1 - FREQ_EPSILON) < f2 and (f1 + FREQ_EPSILON) > f2);
 }
 
 static std::complex<double> get_fe_correction(
-    const std::string &key, const double lo_freq
+    const fe_cal_table_t &datas, const double lo_freq
 ){
-    const std::vector<fe_cal_t> &datas = fe_cal_cache[key];
-    if (datas.empty()) throw shd::runtime_error("empty calibration table " + key);
-
-    //search for lo freq
-    size_t lo_index = 0;
-    size_t hi_index = datas.size()-1;
-    for (size_t i = 0; i < datas.size(); i++){
-        if (is_same_freq(datas[i].lo_freq, lo_freq))
-        {
-            hi_index = i;
-            lo_index = i;
-            break;
-        }
-        if (datas[i].lo_freq > lo_freq){
-            hi_index = i;
-            break;
-        }
-        lo_index = i;
+    //binary search for the first entry that is at or above lo freq
+    const fe_cal_table_t::const_iterator it = std::upper_bound(
+        datas.begin(), datas.end(), lo_freq, &fe_cal_freq_comp);
+    size_t lo_index, hi_index;
+    if (it == datas.end()){
+        lo_index = hi_index = datas.size()-1;
+    } else if (is_same_freq(it->lo_freq, lo_freq)){
+        lo_index = hi_index = it - datas.begin();
+    } else {
+        hi_index = it - datas.begin();
+        lo_index = (hi_index == 0)? 0 : hi_index-1;
     }
 
     if (lo_index == 0) return std::complex<double>(datas[lo_index].iq_corr_real, datas[lo_index].iq_corr_imag);
@@ -93,6 +104,41 @@ static std::complex<double> get_fe_correction(
     );
 }
 
+static boost::shared_ptr<const fe_cal_table_t> load_fe_cal_table(const std::string &file_name)
+{
+    //make the calibration file path
+    const fs::path cal_data_path = fs::path(shd::get_app_path()) / ".shd" / "cal" / file_name;
+    if (not fs::exists(cal_data_path)) return boost::shared_ptr<const fe_cal_table_t>();
+
+    //parse csv file
+    std::ifstream cal_data(cal_data_path.string().c_str());
+    const shd::csv::rows_type rows = shd::csv::to_rows(cal_data);
+
+    bool read_data = false, skip_next = false;;
+    boost::shared_ptr<fe_cal_table_t> datas = boost::make_shared<fe_cal_table_t>();
+    BOOST_FOREACH(const shd::csv::row_type &row, rows){
+        if (not read_data and not row.empty() and row[0] == "DATA STARTS HERE"){
+            read_data = true;
+            skip_next = true;
+            continue;
+        }
+        if (not read_data) continue;
+        if (skip_next){
+            skip_next = false;
+            continue;
+        }
+        fe_cal_t data;
+        std::sscanf(row[0].c_str(), "%lf" , &data.lo_freq);
+        std::sscanf(row[1].c_str(), "%lf" , &data.iq_corr_real);
+        std::sscanf(row[2].c_str(), "%lf" , &data.iq_corr_imag);
+        datas->push_back(data);
+    }
+    std::sort(datas->begin(), datas->end(), fe_cal_comp);
+    if (datas->empty()) throw shd::runtime_error("empty calibration table " + cal_data_path.string());
+    SHD_MSG(status) << "Loaded " << cal_data_path.string() << std::endl;
+    return datas;
+}
+
 static void apply_fe_corrections(
     shd::property_tree::sptr sub_tree,
     const shd::fs_path &db_path,
@@ -103,42 +149,16 @@ static void apply_fe_corrections(
     //extract eeprom serial
     const shd::smini::dboard_eeprom_t db_eeprom = sub_tree->access<shd::smini::dboard_eeprom_t>(db_path).get();
 
-    //make the calibration file path
-    const fs::path cal_data_path = fs::path(shd::get_app_path()) / ".shd" / "cal" / (file_prefix + db_eeprom.serial + ".csv");
-    if (not fs::exists(cal_data_path)) return;
-
-    //parse csv file or get from cache
-    if (not fe_cal_cache.has_key(cal_data_path.string())){
-        std::ifstream cal_data(cal_data_path.string().c_str());
-        const shd::csv::rows_type rows = shd::csv::to_rows(cal_data);
-
-        bool read_data = false, skip_next = false;;
-        std::vector<fe_cal_t> datas;
-        BOOST_FOREACH(const shd::csv::row_type &row, rows){
-            if (not read_data and not row.empty() and row[0] == "DATA STARTS HERE"){
-                read_data = true;
-                skip_next = true;
-                continue;
-            }
-            if (not read_data) continue;
-            if (skip_next){
-                skip_next = false;
-                continue;
-            }
-            fe_cal_t data;
-            std::sscanf(row[0].c_str(), "%lf" , &data.lo_freq);
-            std::sscanf(row[1].c_str(), "%lf" , &data.iq_corr_real);
-            std::sscanf(row[2].c_str(), "%lf" , &data.iq_corr_imag);
-            datas.push_back(data);
-        }
-        std::sort(datas.begin(), datas.end(), fe_cal_comp);
-        fe_cal_cache[cal_data_path.string()] = datas;
-        SHD_MSG(status) << "Loaded " << cal_data_path.string() << std::endl;
-
+    //get the table from the cache or load it
+    const std::string file_name = file_prefix + db_eeprom.serial + ".csv";
+    cal_cache_type::const_iterator cached = fe_cal_cache.find(file_name);
+    if (cached == fe_cal_cache.end()){
+        cached = fe_cal_cache.insert(std::make_pair(file_name, load_fe_cal_table(file_name))).first;
     }
+    if (not cached->second) return;
 
     sub_tree->access<std::complex<double> >(fe_path)
-        .set(get_fe_correction(cal_data_path.string(), lo_freq));
+        .set(get_fe_correction(*cached->second, lo_freq));
 }
 
 /***********************************************************************
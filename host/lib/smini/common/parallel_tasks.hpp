@@ -0,0 +1,111 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_SMINI_COMMON_PARALLEL_TASKS_HPP
+#define INCLUDED_LIBSHD_SMINI_COMMON_PARALLEL_TASKS_HPP
+
+#include <shd/config.hpp>
+#include <shd/exception.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace shd{ namespace smini{
+
+    typedef boost::function<void(void)> parallel_task_t;
+
+    namespace parallel_tasks_detail{
+
+        struct state_t{
+            state_t(const std::vector<parallel_task_t> &tasks_):
+                tasks(tasks_), next(0), errors(tasks_.size())
+            {
+                /* NOP */
+            }
+
+            const std::vector<parallel_task_t> &tasks;
+            boost::mutex mutex;
+            size_t next;
+            std::vector<boost::shared_ptr<shd::exception> > errors;
+        };
+
+        //! Take tasks off the list until it is empty
+        inline void run_tasks(state_t &state){
+            while (true){
+                size_t index;
+                {
+                    boost::mutex::scoped_lock lock(state.mutex);
+                    if (state.next == state.tasks.size()) return;
+                    index = state.next++;
+                }
+                try{
+                    state.tasks[index]();
+                }
+                catch(const shd::exception &e){
+                    state.errors[index].reset(e.dynamic_clone());
+                }
+                catch(const std::exception &e){
+                    state.errors[index].reset(new shd::runtime_error(e.what()));
+                }
+                catch(...){
+                    state.errors[index].reset(new shd::runtime_error("unknown exception"));
+                }
+            }
+        }
+
+    } /* namespace parallel_tasks_detail */
+
+    /*!
+     * Run independent tasks on at most max_threads threads (the calling
+     * thread being one of them) and wait until all of them are done.
+     *
+     * A task that throws does not stop the others. When all tasks are
+     * done, the exception of the failed task with the lowest index is
+     * rethrown, so which error the caller sees does not depend on the
+     * scheduling. With one thread, the tasks run in order on the calling
+     * thread and the first exception stops the rest.
+     *
+     * \param tasks the tasks to run
+     * \param max_threads the maximum number of tasks to run at once
+     */
+    inline void run_in_parallel(const std::vector<parallel_task_t> &tasks, const size_t max_threads){
+        const size_t num_threads = std::min(std::max(max_threads, size_t(1)), tasks.size());
+        if (num_threads <= 1){
+            for (size_t i = 0; i < tasks.size(); i++) tasks[i]();
+            return;
+        }
+
+        parallel_tasks_detail::state_t state(tasks);
+        boost::thread_group threads;
+        for (size_t i = 1; i < num_threads; i++){
+            threads.create_thread(boost::bind(&parallel_tasks_detail::run_tasks, boost::ref(state)));
+        }
+        parallel_tasks_detail::run_tasks(state);
+        threads.join_all();
+
+        for (size_t i = 0; i < state.errors.size(); i++){
+            if (state.errors[i]) state.errors[i]->dynamic_throw();
+        }
+    }
+
+}} //namespace shd::smini
+
+#endif /* INCLUDED_LIBSHD_SMINI_COMMON_PARALLEL_TASKS_HPP */
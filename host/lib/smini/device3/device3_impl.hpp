@@ -39,6 +39,7 @@ namespace shd { namespace smini {
  * Default settings (any device3 may override these)
  **********************************************************************/
 static const size_t DEVICE3_RX_FC_REQUEST_FREQ         = 32;    //per flow-control window
+static const size_t DEVICE3_RX_FC_MIN_REQUEST_FREQ     = 4;     //per flow-control window
 static const size_t DEVICE3_TX_FC_RESPONSE_FREQ        = 8;
 static const size_t DEVICE3_TX_FC_RESPONSE_CYCLES      = 0;     // Cycles: Off.
 
@@ -72,6 +73,8 @@ public:
         size_t rx_max_len_hdr;
         //! How often we send ACKs to the upstream block per one full FC window
         size_t rx_fc_request_freq;
+        //! How seldom we may send ACKs per one full FC window when the consumer keeps up
+        size_t rx_fc_min_request_freq;
         //! How often the downstream block should send ACKs per one full FC window
         size_t tx_fc_response_freq;
         //! How often the downstream block should send ACKs in cycles
@@ -80,6 +83,7 @@ public:
             : tx_max_len_hdr(DEVICE3_TX_MAX_HDR_LEN)
             , rx_max_len_hdr(DEVICE3_RX_MAX_HDR_LEN)
             , rx_fc_request_freq(DEVICE3_RX_FC_REQUEST_FREQ)
+            , rx_fc_min_request_freq(DEVICE3_RX_FC_MIN_REQUEST_FREQ)
             , tx_fc_response_freq(DEVICE3_TX_FC_RESPONSE_FREQ)
             , tx_fc_response_cycles(DEVICE3_TX_FC_RESPONSE_CYCLES)
         {};
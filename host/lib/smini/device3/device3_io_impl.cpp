@@ -27,11 +27,11 @@
 #include "../common/async_packet_handler.hpp"
 #include "../../transport/super_recv_packet_handler.hpp"
 #include "../../transport/super_send_packet_handler.hpp"
+#include "../../transport/tx_fc_credits.hpp"
 #include "../../rfnoc/rx_stream_terminator.hpp"
 #include "../../rfnoc/tx_stream_terminator.hpp"
 #include <shd/rfnoc/rate_node_ctrl.hpp>
 #include <shd/rfnoc/radio_ctrl.hpp>
-#include <shd/transport/zero_copy_flow_ctrl.hpp>
 #include <boost/atomic.hpp>
 
 #define SHD_STREAMER_LOG() SHD_LOGV(never)
@@ -152,12 +152,29 @@ void generate_channel_list(
 /***********************************************************************
  * RX Flow Control Functions
  **********************************************************************/
-//! Stores the state of RX flow control
+//! Stores the state of RX flow control and the ack packet info, made once
 struct rx_fc_cache_t
 {
-    rx_fc_cache_t():
-        last_seq_in(0){}
+    rx_fc_cache_t(const sid_t &sid, const endianness_t endianness):
+        last_seq_in(0), endianness(endianness)
+    {
+        static const size_t RXFC_PACKET_LEN_IN_WORDS = 2;
+        packet_info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_FC;
+        packet_info.num_payload_words32 = RXFC_PACKET_LEN_IN_WORDS;
+        packet_info.num_payload_bytes = packet_info.num_payload_words32*sizeof(uint32_t);
+        packet_info.packet_count = 0;
+        packet_info.sob = false;
+        packet_info.eob = false;
+        packet_info.sid = sid.get();
+        packet_info.has_sid = true;
+        packet_info.has_cid = false;
+        packet_info.has_tsi = false;
+        packet_info.has_tsf = false;
+        packet_info.has_tlr = false;
+    }
     size_t last_seq_in;
+    const endianness_t endianness;
+    vrt::if_packet_info_t packet_info;
 };
 
 /*! Determine the size of the flow control window in number of packets.
@@ -213,31 +230,28 @@ static size_t get_rx_flow_control_window(
  *
  * This function should only be called by the function handling
  * the rx stream, usually recv() in super_recv_packet_handler.
+ * It never blocks: when the transport has no free send buffer, no
+ * packet is sent and the streamer acks again with a later packet.
+ * An ack covers all packets up to its sequence number, so nothing
+ * is lost by skipping one.
  *
- * \param sid The SID that goes into this packet. This is the reversed()
- *            version of the data stream's SID.
  * \param xport A transport object over which to send the data
- * \param big_endian Endianness of the transport
- * \param seq32_state Pointer to a variable that saves the 32-Bit state
- *                    of the sequence numbers, since we only have 12 Bit
- *                    sequence numbers in CHDR.
+ * \param fc_cache The 32-Bit state of the sequence numbers, since we
+ *                 only have 12 Bit sequence numbers in CHDR, and the
+ *                 packet info of the ack.
  * \param last_seq The value to send: The last consumed packet's sequence number.
+ * \returns false when there was no send buffer
  */
-static void handle_rx_flowctrl(
-        const sid_t &sid,
+static bool handle_rx_flowctrl(
         zero_copy_if::sptr xport,
-        endianness_t endianness,
         boost::shared_ptr<rx_fc_cache_t> fc_cache,
         const size_t last_seq
 ) {
-    static const size_t RXFC_PACKET_LEN_IN_WORDS    = 2;
     static const size_t RXFC_CMD_CODE_OFFSET        = 0;
     static const size_t RXFC_SEQ_NUM_OFFSET         = 1;
 
     managed_send_buffer::sptr buff = xport->get_send_buff(0.0);
-    if (not buff) {
-        throw shd::runtime_error("handle_rx_flowctrl timed out getting a send buffer");
-    }
+    if (not buff) return false;
     uint32_t *pkt = buff->cast<uint32_t *>();
 
     // Recover sequence number. The sequence numbers handled by the streamers
@@ -254,21 +268,10 @@ static void handle_rx_flowctrl(
     //SHD_MSG(status) << "sending flow ctrl packet " << fc_pkt_count++ << ", acking " << str(boost::format("%04d\tseq_sw==0x%08x") % last_seq % seq32) << std::endl;
 
     //load packet info
-    vrt::if_packet_info_t packet_info;
-    packet_info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_FC;
-    packet_info.num_payload_words32 = RXFC_PACKET_LEN_IN_WORDS;
-    packet_info.num_payload_bytes = packet_info.num_payload_words32*sizeof(uint32_t);
+    vrt::if_packet_info_t &packet_info = fc_cache->packet_info;
     packet_info.packet_count = seq32;
-    packet_info.sob = false;
-    packet_info.eob = false;
-    packet_info.sid = sid.get();
-    packet_info.has_sid = true;
-    packet_info.has_cid = false;
-    packet_info.has_tsi = false;
-    packet_info.has_tsf = false;
-    packet_info.has_tlr = false;
-
-    if (endianness == ENDIANNESS_BIG) {
+
+    if (fc_cache->endianness == ENDIANNESS_BIG) {
         // Load Header:
         vrt::chdr::if_hdr_pack_be(pkt, packet_info);
         // Load Payload: (the sequence number)
@@ -293,6 +296,7 @@ static void handle_rx_flowctrl(
 
     //send the buffer over the interface
     buff->commit(sizeof(uint32_t)*(packet_info.num_packet_words32));
+    return true;
 }
 
 /***********************************************************************
@@ -300,17 +304,6 @@ static void handle_rx_flowctrl(
  **********************************************************************/
 #define DEVICE3_ASYNC_EVENT_CODE_FLOW_CTRL 0
 
-//! Stores the state of TX flow control
-struct tx_fc_cache_t
-{
-    tx_fc_cache_t(size_t capacity):
-        last_seq_ack(0),
-        space(capacity) {}
-
-    size_t last_seq_ack;
-    size_t space;
-};
-
 /*! Return the size of the flow control window in packets.
  *
  * If the return value of this function is F, the last tx'd packet
@@ -334,54 +327,58 @@ static size_t get_tx_flow_control_window(
     return window_in_pkts;
 }
 
-static bool tx_flow_ctrl(
-    boost::shared_ptr<tx_fc_cache_t> fc_cache,
-	zero_copy_if::sptr async_xport,
+/*! Read the flow control responses of a TX stream.
+ *  The responses that are already waiting are read in one go, and the
+ *  credit is published once for all of them.
+ *
+ * This is run inside a shd::task as long as this streamer lives.
+ */
+static void handle_tx_flowctrl(
+    boost::shared_ptr<tx_fc_credits> credits,
+    zero_copy_if::sptr xport,
     uint32_t (*endian_conv)(uint32_t),
-    void (*unpack)(const uint32_t *packet_buff, vrt::if_packet_info_t &),
-    managed_buffer::sptr
+    void (*unpack)(const uint32_t *packet_buff, vrt::if_packet_info_t &)
 ) {
-    while (true)
+    managed_recv_buffer::sptr buff = xport->get_recv_buff();
+    for (size_t i = 0; buff and i < xport->get_num_recv_frames(); i++)
     {
-        // If there is space
-        if (fc_cache->space)
+        vrt::if_packet_info_t if_packet_info;
+        if_packet_info.num_packet_words32 = buff->size()/sizeof(uint32_t);
+        const uint32_t *packet_buff = buff->cast<const uint32_t *>();
+        try {
+            unpack(packet_buff, if_packet_info);
+            if (if_packet_info.packet_type == vrt::if_packet_info_t::PACKET_TYPE_FC) {
+                credits->ack(endian_conv(packet_buff[if_packet_info.num_header_words32+1]));
+            } else {
+                SHD_MSG(error) << "Unexpected packet type received by flow control handler: " << if_packet_info.packet_type << std::endl;
+            }
+        }
+        catch(const std::exception &ex)
         {
-            // All is good - packet will be sent
-            fc_cache->space--;
-            return true;
+            SHD_MSG(error) << "Error unpacking async flow control packet: " << ex.what() << std::endl;
         }
+        buff = xport->get_recv_buff(0.0);
+    }
+    credits->publish();
+}
 
-		// Look for a flow control message to update the space available in the buffer.
-        // A minimal timeout is used because larger timeouts can cause the thread to be
-        // scheduled out for too long at high data rates and result in underruns.
-		managed_recv_buffer::sptr buff = async_xport->get_recv_buff(0.000001);
-		if (buff)
-		{
-			vrt::if_packet_info_t if_packet_info;
-			if_packet_info.num_packet_words32 = buff->size()/sizeof(uint32_t);
-			const uint32_t *packet_buff = buff->cast<const uint32_t *>();
-			try {
-				unpack(packet_buff, if_packet_info);
-			}
-			catch(const std::exception &ex)
-			{
-				SHD_MSG(error) << "Error unpacking async flow control packet: " << ex.what() << std::endl;
-				continue;
-			}
-
-			if (if_packet_info.packet_type != vrt::if_packet_info_t::PACKET_TYPE_FC)
-			{
-				SHD_MSG(error) << "Unexpected packet type received by flow control handler: " << if_packet_info.packet_type << std::endl;
-				continue;
-			}
-
-			// update the amount of space
-			size_t seq_ack = endian_conv(packet_buff[if_packet_info.num_header_words32+1]);
-			fc_cache->space += (seq_ack - fc_cache->last_seq_ack) & HW_SEQ_NUM_MASK;
-			fc_cache->last_seq_ack = seq_ack;
-		}
+/*! Get a send buffer when the device has room for the packet.
+ *  Waiting for credit counts against the timeout, so a streamer out
+ *  of credit returns like one out of send frames.
+ */
+static managed_send_buffer::sptr get_tx_buff_with_flowctrl(
+    boost::shared_ptr<tx_fc_credits> credits,
+    zero_copy_if::sptr xport,
+    const double timeout
+) {
+    if (not credits->wait(timeout)) {
+        return managed_send_buffer::sptr(); //timeout waiting for flow control
+    }
+    managed_send_buffer::sptr buff = xport->get_send_buff(timeout);
+    if (buff) {
+        credits->consume(); //this will actually be a send
     }
-    return false;
+    return buff;
 }
 
 /***********************************************************************
@@ -604,7 +601,8 @@ rx_streamer::sptr device3_impl::get_rx_stream(const stream_args_t &args_)
         const size_t pkt_size = spp * bpi + stream_options.rx_max_len_hdr;
         const size_t fc_window = get_rx_flow_control_window(pkt_size, xport.recv_buff_size, rx_hints);
         const size_t fc_handle_window = std::max<size_t>(1, fc_window / stream_options.rx_fc_request_freq);
-        SHD_STREAMER_LOG()<< "[RX Streamer] Flow Control Window (minus one) = " << fc_window-1 << ", Flow Control Handler Window = " << fc_handle_window << std::endl;
+        const size_t fc_max_handle_window = std::max<size_t>(fc_handle_window, fc_window / stream_options.rx_fc_min_request_freq);
+        SHD_STREAMER_LOG()<< "[RX Streamer] Flow Control Window (minus one) = " << fc_window-1 << ", Flow Control Handler Window = " << fc_handle_window << " to " << fc_max_handle_window << std::endl;
         blk_ctrl->configure_flow_control_out(
                 fc_window-1, // Leave one space for overrun packets TODO make this obsolete
                 block_port
@@ -631,18 +629,19 @@ rx_streamer::sptr device3_impl::get_rx_stream(const stream_args_t &args_)
 
         //Give the streamer a functor to send flow control messages
         //handle_rx_flowctrl is static and has no lifetime issues
-        boost::shared_ptr<rx_fc_cache_t> fc_cache(new rx_fc_cache_t());
+        boost::shared_ptr<rx_fc_cache_t> fc_cache(new rx_fc_cache_t(
+            xport.send_sid, get_transport_endianness(mb_index)
+        ));
         my_streamer->set_xport_handle_flowctrl(
             stream_i, boost::bind(
                 &handle_rx_flowctrl,
-                xport.send_sid,
                 xport.send,
-                get_transport_endianness(mb_index),
                 fc_cache,
                 _1
             ),
             fc_handle_window,
-            true/*init*/
+            true/*init*/,
+            fc_max_handle_window
         );
 
         //Give the streamer a functor issue stream cmd
@@ -656,6 +655,9 @@ rx_streamer::sptr device3_impl::get_rx_stream(const stream_args_t &args_)
         my_streamer->set_xport_chan_sid(stream_i, true, xport.send_sid);
     }
 
+    // Optionally convert the channels on a pool of worker threads
+    my_streamer->set_convert_threads(args.args);
+
     // Connect the terminator to the streamer
     my_streamer->set_terminator(recv_terminator);
 
@@ -712,11 +714,13 @@ public:
 	device3_send_packet_streamer(const size_t max_num_samps) : sph::send_packet_streamer(max_num_samps) {};
 	~device3_send_packet_streamer() {
 		_tx_async_msg_task.reset();	// Make sure the async task is destroyed before the transports
+		_tx_fc_tasks.clear();
 	};
 
 	both_xports_t _xport;
 	both_xports_t _async_xport;
 	task::sptr _tx_async_msg_task;
+	std::vector<task::sptr> _tx_fc_tasks; // One per channel
 };
 
 tx_streamer::sptr device3_impl::get_tx_stream(const shd::stream_args_t &args_)
@@ -879,24 +883,28 @@ tx_streamer::sptr device3_impl::get_tx_stream(const shd::stream_args_t &args_)
             }
         }
 
-        // Add flow control
-        boost::shared_ptr<tx_fc_cache_t> fc_cache(new tx_fc_cache_t(fc_window));
-        my_streamer->_xport.send = zero_copy_flow_ctrl::make(
-            my_streamer->_xport.send,
-            boost::bind(
-				&tx_flow_ctrl,
-				fc_cache,
-				my_streamer->_xport.recv,
-				(endianness == ENDIANNESS_BIG ? shd::ntohx<uint32_t> : shd::wtohx<uint32_t>),
-				(endianness == ENDIANNESS_BIG ? vrt::chdr::if_hdr_unpack_be : vrt::chdr::if_hdr_unpack_le),
-				 _1),
-            NULL);
+        // Add flow control: a task reads the responses of this channel,
+        // sending a packet takes its credit
+        boost::shared_ptr<tx_fc_credits> credits(new tx_fc_credits(fc_window, HW_SEQ_NUM_MASK));
+        my_streamer->_tx_fc_tasks.push_back(task::make(
+                boost::bind(
+                    &handle_tx_flowctrl,
+                    credits,
+                    xport.recv,
+                    (endianness == ENDIANNESS_BIG ? shd::ntohx<uint32_t> : shd::wtohx<uint32_t>),
+                    (endianness == ENDIANNESS_BIG ? vrt::chdr::if_hdr_unpack_be : vrt::chdr::if_hdr_unpack_le)
+                )
+        ));
 
         //Give the streamer a functor to get the send buffer
         my_streamer->set_xport_chan_get_buff(
             stream_i,
-            boost::bind(&zero_copy_if::get_send_buff, my_streamer->_xport.send, _1)
+            boost::bind(&get_tx_buff_with_flowctrl, credits, xport.send, _1)
         );
+        //Give the streamer a functor to push out batched send frames
+        if (xport.flush_send) {
+            my_streamer->set_xport_chan_flush(stream_i, xport.flush_send);
+        }
         //Give the streamer a functor handled received async messages
         my_streamer->set_async_receiver(
             boost::bind(&async_md_type::pop_with_timed_wait, async_md, _1, _2)
@@ -906,6 +914,9 @@ tx_streamer::sptr device3_impl::get_tx_stream(const shd::stream_args_t &args_)
         my_streamer->set_enable_trailer(false);
     }
 
+    // Optionally convert the channels on a pool of worker threads
+    my_streamer->set_convert_threads(args.args);
+
     // Connect the terminator to the streamer
     my_streamer->set_terminator(send_terminator);
 
@@ -239,7 +239,7 @@ static size_t get_rx_flow_control_window(size_t frame_size, size_t sw_buff_size,
     return window_in_pkts;
 }
 
-static void handle_rx_flowctrl(
+static bool handle_rx_flowctrl(
     const uint32_t sid,
     zero_copy_if::sptr xport,
     boost::shared_ptr<e300_rx_fc_cache_t> fc_cache,
@@ -288,6 +288,7 @@ static void handle_rx_flowctrl(
 
     //send the buffer over the interface
     buff->commit(sizeof(uint32_t)*(packet_info.num_packet_words32));
+    return true;
 }
 
 
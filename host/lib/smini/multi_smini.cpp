@@ -22,6 +22,7 @@
 #include <shd/utils/log.hpp>
 #include <shd/utils/math.hpp>
 #include <shd/utils/gain_group.hpp>
+#include <shd/utils/rx_host_dsp.hpp>
 #include <shd/smini/dboard_id.hpp>
 #include <shd/smini/mboard_eeprom.hpp>
 #include <shd/smini/dboard_eeprom.hpp>
@@ -765,10 +766,13 @@ public:
      ******************************************************************/
     rx_streamer::sptr get_rx_stream(const stream_args_t &args) {
         _check_link_rate(args, false);
-        if (is_device3()) {
-            return _legacy_compat->get_rx_stream(args);
+        rx_streamer::sptr rx_stream = is_device3()?
+            _legacy_compat->get_rx_stream(args) : this->get_device()->get_rx_stream(args);
+        if (rx_host_dsp::is_requested(args)) {
+            const size_t chan = args.channels.empty()? 0 : args.channels[0];
+            return rx_host_dsp::make(rx_stream, args, this->get_rx_rate(chan));
         }
-        return this->get_device()->get_rx_stream(args);
+        return rx_stream;
     }
 
     void set_rx_subdev_spec(const subdev_spec_t &spec, size_t mboard){
@@ -410,7 +410,7 @@ void n230_stream_manager::_handle_overflow(const size_t i)
     }
 }
 
-void n230_stream_manager::_handle_rx_flowctrl(
+bool n230_stream_manager::_handle_rx_flowctrl(
     const sid_t& sid,
     zero_copy_if::sptr xport,
     boost::shared_ptr<rx_fc_cache_t> fc_cache,
@@ -457,6 +457,7 @@ void n230_stream_manager::_handle_rx_flowctrl(
 
     //send the buffer over the interface
     buff->commit(sizeof(uint32_t)*(packet_info.num_packet_words32));
+    return true;
 }
 
 void n230_stream_manager::_handle_tx_async_msgs(
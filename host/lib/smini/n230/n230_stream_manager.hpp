@@ -100,7 +100,7 @@ private:
     static size_t _get_rx_flow_control_window(
         size_t frame_size, size_t sw_buff_size);
 
-    static void _handle_rx_flowctrl(
+    static bool _handle_rx_flowctrl(
         const sid_t& sid,
         transport::zero_copy_if::sptr xport,
         boost::shared_ptr<rx_fc_cache_t> fc_cache,
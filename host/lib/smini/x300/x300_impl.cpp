@@ -19,11 +19,14 @@
 #include "x300_lvbitx.hpp"
 #include "x310_lvbitx.hpp"
 #include "x300_mb_eeprom.hpp"
+#include "x300_mtu_cache.hpp"
 #include "apply_corrections.hpp"
+#include "parallel_tasks.hpp"
 #include <boost/algorithm/string.hpp>
 #include <boost/asio.hpp>
 #include <shd/utils/static.hpp>
 #include <shd/utils/msg.hpp>
+#include <shd/utils/log.hpp>
 #include <shd/utils/paths.hpp>
 #include <shd/utils/safe_call.hpp>
 #include <shd/smini/subdev_spec.hpp>
@@ -217,7 +220,7 @@ static device_addrs_t x300_find_pcie(const device_addr_t &hint, bool explicit_qu
 
             //Hold on to the registry mutex as long as zpu_ctrl is alive
             //to prevent any use by different threads while enumerating
-            boost::mutex::scoped_lock(pcie_zpu_iface_registry_mutex);
+            boost::mutex::scoped_lock lock(pcie_zpu_iface_registry_mutex);
 
             if (get_pcie_zpu_iface_registry().has_key(resource_d)) {
                 zpu_ctrl = get_pcie_zpu_iface_registry()[resource_d].lock();
@@ -395,6 +398,43 @@ static void x300_load_fw(wb_iface::sptr fw_reg_ctrl, const std::string &file_nam
     SHD_MSG(status) << " done!" << std::endl;
 }
 
+/***********************************************************************
+ * Initialization timing
+ **********************************************************************/
+//! Logs how long each step of the initialization takes
+class x300_init_timer
+{
+public:
+    x300_init_timer(const std::string &name):
+        _name(name),
+        _start(time_spec_t::get_system_time()),
+        _last(_start)
+    {
+        /* NOP */
+    }
+
+    //! Log the time since the last step, or since the start
+    void step(const std::string &name)
+    {
+        const time_spec_t now = time_spec_t::get_system_time();
+        SHD_LOG << boost::format("[X300] %s: %s took %.1f ms")
+            % _name % name % ((now - _last).get_real_secs()*1e3) << std::endl;
+        _last = now;
+    }
+
+    //! Log the time since the start
+    void done(void)
+    {
+        SHD_LOG << boost::format("[X300] %s: all steps took %.1f ms")
+            % _name % ((time_spec_t::get_system_time() - _start).get_real_secs()*1e3) << std::endl;
+    }
+
+private:
+    const std::string _name;
+    const time_spec_t _start;
+    time_spec_t _last;
+};
+
 x300_impl::x300_impl(const shd::device_addr_t &dev_addr) 
     : device3_impl()
     , _sid_framer(0)
@@ -405,10 +445,35 @@ x300_impl::x300_impl(const shd::device_addr_t &dev_addr)
 
     const device_addrs_t device_args = separate_device_addr(dev_addr);
     _mb.resize(device_args.size());
+    x300_init_timer timer("device");
+
+    //The motherboards are independent until their blocks are enumerated,
+    //so claim, check and clock them concurrently
+    const size_t max_init_threads = dev_addr.cast<size_t>("init_threads", X300_MAX_INIT_THREADS);
+    std::vector<parallel_task_t> mb_setups;
+    for (size_t i = 0; i < device_args.size(); i++)
+    {
+        mb_setups.push_back(boost::bind(&x300_impl::setup_mb, this, i, device_args[i]));
+    }
+    run_in_parallel(mb_setups, max_init_threads);
+    timer.step("motherboard setup");
+
+    //Join point: enumerate the blocks one motherboard after the other,
+    //so the block IDs and source addresses do not depend on the timing
+    for (size_t i = 0; i < device_args.size(); i++)
+    {
+        this->setup_rfnoc_blocks(i, device_args[i]);
+    }
+    timer.step("RFNoC block enumeration");
+
+    std::vector<parallel_task_t> radio_setups;
     for (size_t i = 0; i < device_args.size(); i++)
     {
-        this->setup_mb(i, device_args[i]);
+        radio_setups.push_back(boost::bind(&x300_impl::setup_radios, this, i, device_args[i]));
     }
+    run_in_parallel(radio_setups, max_init_threads);
+    timer.step("radio setup");
+    timer.done();
 }
 
 void x300_impl::mboard_members_t::discover_eth(
@@ -518,6 +583,7 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
     const fs_path mb_path = "/mboards/"+boost::lexical_cast<std::string>(mb_i);
     mboard_members_t &mb = _mb[mb_i];
     mb.initialization_done = false;
+    x300_init_timer timer(str(boost::format("mboard %u") % mb_i));
 
     std::vector<std::string> eth_addrs;
     // Not choosing eth0 based on resource might cause user issues
@@ -583,103 +649,18 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
         _tree->create<double>(mb_path / "link_max_rate").set(X300_MAX_RATE_PCIE);
     }
 
+    timer.step("transport setup");
+
     BOOST_FOREACH(const std::string &key, dev_addr.keys())
     {
         if (key.find("recv") != std::string::npos) mb.recv_args[key] = dev_addr[key];
         if (key.find("send") != std::string::npos) mb.send_args[key] = dev_addr[key];
     }
 
-    if (mb.xport_path == "eth" ) {
-        /* This is an ETH connection. Figure out what the maximum supported frame
-         * size is for the transport in the up and down directions. The frame size
-         * depends on the host PIC's NIC's MTU settings. To determine the frame size,
-         * we test for support up to an expected "ceiling". If the user
-         * specified a frame size, we use that frame size as the ceiling. If no
-         * frame size was specified, we use the maximum SHD frame size.
-         *
-         * To optimize performance, the frame size should be greater than or equal
-         * to the frame size that SHD uses so that frames don't get split across
-         * multiple transmission units - this is why the limits passed into the
-         * 'determine_max_frame_size' function are actually frame sizes. */
-        frame_size_t req_max_frame_size;
-        req_max_frame_size.recv_frame_size = (mb.recv_args.has_key("recv_frame_size")) \
-            ? boost::lexical_cast<size_t>(mb.recv_args["recv_frame_size"]) \
-            : X300_10GE_DATA_FRAME_MAX_SIZE;
-        req_max_frame_size.send_frame_size = (mb.send_args.has_key("send_frame_size")) \
-            ? boost::lexical_cast<size_t>(mb.send_args["send_frame_size"]) \
-            : X300_10GE_DATA_FRAME_MAX_SIZE;
-
-        #if defined SHD_PLATFORM_LINUX
-            const std::string mtu_tool("ip link");
-        #elif defined SHD_PLATFORM_WIN32
-            const std::string mtu_tool("netsh");
-        #else
-            const std::string mtu_tool("ifconfig");
-        #endif
-
-        // Detect the frame size on the path to the SMINI
-        try {
-            frame_size_t pri_frame_sizes = determine_max_frame_size(
-                eth_addrs.at(0), req_max_frame_size
-            );
-
-            _max_frame_sizes = pri_frame_sizes;
-            if (eth_addrs.size() > 1) {
-                frame_size_t sec_frame_sizes = determine_max_frame_size(
-                    eth_addrs.at(1), req_max_frame_size
-                );
-
-                // Choose the minimum of the max frame sizes
-                // to ensure we don't exceed any one of the links' MTU
-                _max_frame_sizes.recv_frame_size = std::min(
-                    pri_frame_sizes.recv_frame_size,
-                    sec_frame_sizes.recv_frame_size
-                );
-
-                _max_frame_sizes.send_frame_size = std::min(
-                    pri_frame_sizes.send_frame_size,
-                    sec_frame_sizes.send_frame_size
-                );
-            }
-        } catch(std::exception &e) {
-            SHD_MSG(error) << e.what() << std::endl;
-        }
-
-        if ((mb.recv_args.has_key("recv_frame_size"))
-                && (req_max_frame_size.recv_frame_size > _max_frame_sizes.recv_frame_size)) {
-            SHD_MSG(warning)
-                << boost::format("You requested a receive frame size of (%lu) but your NIC's max frame size is (%lu).")
-                % req_max_frame_size.recv_frame_size
-                % _max_frame_sizes.recv_frame_size
-                << std::endl
-                << boost::format("Please verify your NIC's MTU setting using '%s' or set the recv_frame_size argument appropriately.")
-                % mtu_tool << std::endl
-                << "SHD will use the auto-detected max frame size for this connection."
-                << std::endl;
-        }
-
-        if ((mb.recv_args.has_key("send_frame_size"))
-                && (req_max_frame_size.send_frame_size > _max_frame_sizes.send_frame_size)) {
-            SHD_MSG(warning)
-                << boost::format("You requested a send frame size of (%lu) but your NIC's max frame size is (%lu).")
-                % req_max_frame_size.send_frame_size
-                % _max_frame_sizes.send_frame_size
-                << std::endl
-                << boost::format("Please verify your NIC's MTU setting using '%s' or set the send_frame_size argument appropriately.")
-                % mtu_tool << std::endl
-                << "SHD will use the auto-detected max frame size for this connection."
-                << std::endl;
-        }
-
-        _tree->create<size_t>(mb_path / "mtu/recv").set(_max_frame_sizes.recv_frame_size);
-        _tree->create<size_t>(mb_path / "mtu/send").set(std::min(_max_frame_sizes.send_frame_size, X300_ETH_DATA_FRAME_MAX_TX_SIZE));
-        _tree->create<double>(mb_path / "link_max_rate").set(X300_MAX_RATE_10GIGE);
-    }
-
     //create basic communication
     SHD_MSG(status) << "Setup basic communication..." << std::endl;
     if (mb.xport_path == "nirio") {
-        boost::mutex::scoped_lock(pcie_zpu_iface_registry_mutex);
+        boost::mutex::scoped_lock lock(pcie_zpu_iface_registry_mutex);
         if (get_pcie_zpu_iface_registry().has_key(mb.get_pri_eth().addr)) {
             throw shd::assertion_error("Someone else has a ZPU transport to the device open. Internal error!");
         } else {
@@ -723,6 +704,7 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
             SR_ADDR(SET0_BASE, ZPU_RB_SPI));
     mb.zpu_i2c = i2c_core_100_wb32::make(mb.zpu_ctrl, I2C1_BASE);
     mb.zpu_i2c->set_clock_rate(X300_BUS_CLOCK_RATE/2);
+    timer.step("claim and compat checks");
 
     ////////////////////////////////////////////////////////////////////
     // print network routes mapping
@@ -841,6 +823,100 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
                 "Software is too new for this hardware. Please downgrade to a driver that supports hardware revision %d.")
                 % mb.hw_rev));
     }
+    timer.step("EEPROM and revision checks");
+
+    ////////////////////////////////////////////////////////////////////
+    // determine the maximum frame size of the ethernet links
+    ////////////////////////////////////////////////////////////////////
+    if (mb.xport_path == "eth" ) {
+        /* This is an ETH connection. Figure out what the maximum supported frame
+         * size is for the transport in the up and down directions. The frame size
+         * depends on the host PIC's NIC's MTU settings. To determine the frame size,
+         * we test for support up to an expected "ceiling". If the user
+         * specified a frame size, we use that frame size as the ceiling. If no
+         * frame size was specified, we use the maximum SHD frame size.
+         *
+         * To optimize performance, the frame size should be greater than or equal
+         * to the frame size that SHD uses so that frames don't get split across
+         * multiple transmission units - this is why the limits passed into the
+         * 'determine_max_frame_size' function are actually frame sizes. */
+        frame_size_t req_max_frame_size;
+        req_max_frame_size.recv_frame_size = (mb.recv_args.has_key("recv_frame_size")) \
+            ? boost::lexical_cast<size_t>(mb.recv_args["recv_frame_size"]) \
+            : X300_10GE_DATA_FRAME_MAX_SIZE;
+        req_max_frame_size.send_frame_size = (mb.send_args.has_key("send_frame_size")) \
+            ? boost::lexical_cast<size_t>(mb.send_args["send_frame_size"]) \
+            : X300_10GE_DATA_FRAME_MAX_SIZE;
+
+        #if defined SHD_PLATFORM_LINUX
+            const std::string mtu_tool("ip link");
+        #elif defined SHD_PLATFORM_WIN32
+            const std::string mtu_tool("netsh");
+        #else
+            const std::string mtu_tool("ifconfig");
+        #endif
+
+        // Detect the frame size on the path to the SMINI, or confirm the cached one
+        const std::string fw_version = _tree->access<std::string>(mb_path / "fw_version").get();
+        try {
+            frame_size_t pri_frame_sizes = get_max_frame_size(
+                eth_addrs.at(0), req_max_frame_size, mb_eeprom["serial"], fw_version
+            );
+
+            mb.max_frame_sizes = pri_frame_sizes;
+            if (eth_addrs.size() > 1) {
+                frame_size_t sec_frame_sizes = get_max_frame_size(
+                    eth_addrs.at(1), req_max_frame_size, mb_eeprom["serial"], fw_version
+                );
+
+                // Choose the minimum of the max frame sizes
+                // to ensure we don't exceed any one of the links' MTU
+                mb.max_frame_sizes.recv_frame_size = std::min(
+                    pri_frame_sizes.recv_frame_size,
+                    sec_frame_sizes.recv_frame_size
+                );
+
+                mb.max_frame_sizes.send_frame_size = std::min(
+                    pri_frame_sizes.send_frame_size,
+                    sec_frame_sizes.send_frame_size
+                );
+            }
+        } catch(std::exception &e) {
+            SHD_MSG(error) << e.what() << std::endl;
+        }
+
+        if ((mb.recv_args.has_key("recv_frame_size"))
+                && (req_max_frame_size.recv_frame_size > mb.max_frame_sizes.recv_frame_size)) {
+            SHD_MSG(warning)
+                << boost::format("You requested a receive frame size of (%lu) but your NIC's max frame size is (%lu).")
+                % req_max_frame_size.recv_frame_size
+                % mb.max_frame_sizes.recv_frame_size
+                << std::endl
+                << boost::format("Please verify your NIC's MTU setting using '%s' or set the recv_frame_size argument appropriately.")
+                % mtu_tool << std::endl
+                << "SHD will use the auto-detected max frame size for this connection."
+                << std::endl;
+        }
+
+        if ((mb.recv_args.has_key("send_frame_size"))
+                && (req_max_frame_size.send_frame_size > mb.max_frame_sizes.send_frame_size)) {
+            SHD_MSG(warning)
+                << boost::format("You requested a send frame size of (%lu) but your NIC's max frame size is (%lu).")
+                % req_max_frame_size.send_frame_size
+                % mb.max_frame_sizes.send_frame_size
+                << std::endl
+                << boost::format("Please verify your NIC's MTU setting using '%s' or set the send_frame_size argument appropriately.")
+                % mtu_tool << std::endl
+                << "SHD will use the auto-detected max frame size for this connection."
+                << std::endl;
+        }
+
+        _tree->create<size_t>(mb_path / "mtu/recv").set(mb.max_frame_sizes.recv_frame_size);
+        _tree->create<size_t>(mb_path / "mtu/send").set(std::min(mb.max_frame_sizes.send_frame_size, X300_ETH_DATA_FRAME_MAX_TX_SIZE));
+        _tree->create<double>(mb_path / "link_max_rate").set(X300_MAX_RATE_10GIGE);
+    }
+
+    timer.step("frame size detection");
 
     ////////////////////////////////////////////////////////////////////
     // create clock control objects
@@ -900,6 +976,7 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
             mb.zpu_ctrl->poke32(SR_ADDR(X300_FW_SHMEM_BASE, X300_FW_SHMEM_GPSDO_STATUS), dont_look_for_gpsdo);
         }
     }
+    timer.step("clocking and GPSDO");
 
     ////////////////////////////////////////////////////////////////////
     //clear router?
@@ -907,6 +984,7 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
     for (size_t i = 0; i < 512; i++) {
         mb.zpu_ctrl->poke32(SR_ADDR(SETXB_BASE, i), 0);
     }
+    timer.step("router clear");
 
 
     ////////////////////////////////////////////////////////////////////
@@ -958,6 +1036,13 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
     ////////////////////////////////////////////////////////////////////
     _tree->create<sensor_value_t>(mb_path / "sensors" / "ref_locked")
         .set_publisher(boost::bind(&x300_impl::get_ref_locked, this, mb));
+    timer.step("time and clock sources");
+    timer.done();
+}
+
+void x300_impl::setup_rfnoc_blocks(const size_t mb_i, const shd::device_addr_t &dev_addr)
+{
+    mboard_members_t &mb = _mb[mb_i];
 
     //////////////// RFNOC /////////////////
     const size_t n_rfnoc_blocks = mb.zpu_ctrl->peek32(SR_ADDR(SET0_BASE, ZPU_RB_NUM_CE));
@@ -970,6 +1055,11 @@ void x300_impl::setup_mb(const size_t mb_i, const shd::device_addr_t &dev_addr)
         mb.if_pkt_is_big_endian ? ENDIANNESS_BIG : ENDIANNESS_LITTLE
     );
     //////////////// RFNOC /////////////////
+}
+
+void x300_impl::setup_radios(const size_t mb_i, const shd::device_addr_t &dev_addr)
+{
+    mboard_members_t &mb = _mb[mb_i];
 
     // If we have a radio, we must configure its codec control:
     const std::string radio_blockid_hint = str(boost::format("%d/Radio") % mb_i);
@@ -1034,7 +1124,7 @@ x300_impl::~x300_impl(void)
             //kill the claimer task and unclaim the device
             mb.claimer_task.reset();
             {   //Critical section
-                boost::mutex::scoped_lock(pcie_zpu_iface_registry_mutex);
+                boost::mutex::scoped_lock lock(pcie_zpu_iface_registry_mutex);
                 release(mb.zpu_ctrl);
                 //If the process is killed, the entire registry will disappear so we
                 //don't need to worry about unclean shutdowns here.
@@ -1227,28 +1317,28 @@ shd::both_xports_t x300_impl::make_transport(
 
         /* Print a warning if the system's max available frame size is less than the most optimal
          * frame size for this type of connection. */
-        if (_max_frame_sizes.send_frame_size < eth_data_rec_frame_size) {
+        if (mb.max_frame_sizes.send_frame_size < eth_data_rec_frame_size) {
             SHD_MSG(warning)
                 << boost::format("For this connection, SHD recommends a send frame size of at least %lu for best\nperformance, but your system's MTU will only allow %lu.")
                 % eth_data_rec_frame_size
-                % _max_frame_sizes.send_frame_size
+                % mb.max_frame_sizes.send_frame_size
                 << std::endl
                 << "This will negatively impact your maximum achievable sample rate."
                 << std::endl;
         }
 
-        if (_max_frame_sizes.recv_frame_size < eth_data_rec_frame_size) {
+        if (mb.max_frame_sizes.recv_frame_size < eth_data_rec_frame_size) {
             SHD_MSG(warning)
                 << boost::format("For this connection, SHD recommends a receive frame size of at least %lu for best\nperformance, but your system's MTU will only allow %lu.")
                 % eth_data_rec_frame_size
-                % _max_frame_sizes.recv_frame_size
+                % mb.max_frame_sizes.recv_frame_size
                 << std::endl
                 << "This will negatively impact your maximum achievable sample rate."
                 << std::endl;
         }
 
-        size_t system_max_send_frame_size = (size_t) _max_frame_sizes.send_frame_size;
-        size_t system_max_recv_frame_size = (size_t) _max_frame_sizes.recv_frame_size;
+        size_t system_max_send_frame_size = (size_t) mb.max_frame_sizes.send_frame_size;
+        size_t system_max_recv_frame_size = (size_t) mb.max_frame_sizes.recv_frame_size;
 
         // Make sure frame sizes do not exceed the max available value supported by SHD
         default_buff_args.send_frame_size =
@@ -1274,12 +1364,14 @@ shd::both_xports_t x300_impl::make_transport(
         //make a new transport - fpga has no idea how to talk to us on this yet
         udp_zero_copy::buff_params buff_params;
 
-        xports.recv = udp_zero_copy::make(
+        udp_zero_copy::sptr udp_xport = udp_zero_copy::make(
                 interface_addr,
                 BOOST_STRINGIZE(X300_VITA_UDP_PORT),
                 default_buff_args,
                 buff_params,
                 xport_args);
+        xports.recv = udp_xport;
+        xports.flush_send = boost::bind(&udp_zero_copy::flush_send_buffs, udp_xport);
 
         // Create a threaded transport for the receive chain only
         // Note that this shouldn't affect PCIe
@@ -1311,6 +1403,7 @@ shd::both_xports_t x300_impl::make_transport(
         buff->cast<uint32_t *>()[1] = shd::htonx(xports.send_sid.get());
         buff->commit(8);
         buff.reset();
+        xports.flush_send(); //in case the send_batch hint is set
 
         //reprogram the ethernet dispatcher's udp port (should be safe to always set)
         SHD_LOG << "reprogram the ethernet dispatcher's udp port" << std::endl;
@@ -1471,7 +1564,7 @@ void x300_impl::sync_times(mboard_members_t &mb, const shd::time_spec_t& t)
 
 bool x300_impl::wait_for_clk_locked(mboard_members_t& mb, uint32_t which, double timeout)
 {
-    boost::system_time timeout_time = boost::get_system_time() + boost::posix_time::milliseconds(timeout * 1000.0);
+    boost::system_time timeout_time = boost::get_system_time() + boost::posix_time::milliseconds(long(timeout * 1000.0));
     do {
         if (mb.fw_regmap->clock_status_reg.read(which)==1)
             return true;
@@ -1597,6 +1690,56 @@ void x300_impl::release(wb_iface::sptr iface)
 /***********************************************************************
  * Frame size detection
  **********************************************************************/
+x300_impl::frame_size_t x300_impl::get_max_frame_size(const std::string &addr,
+        const frame_size_t &user_frame_size, const std::string &serial,
+        const std::string &fw_version)
+{
+    const std::string key = x300_mtu_cache::make_key(serial, fw_version, addr,
+            user_frame_size.recv_frame_size, user_frame_size.send_frame_size);
+
+    frame_size_t frame_size;
+    if (x300_mtu_cache::lookup(key, frame_size.recv_frame_size, frame_size.send_frame_size)) {
+        if (confirm_frame_size(addr, frame_size)) {
+            SHD_MSG(status) << "Using cached maximum frame size of "
+                << frame_size.send_frame_size << " bytes." << std::endl;
+            return frame_size;
+        }
+        SHD_MSG(status) << "The cached frame size no longer works." << std::endl;
+        x300_mtu_cache::remove(key);
+    }
+
+    frame_size = determine_max_frame_size(addr, user_frame_size);
+    x300_mtu_cache::store(key, frame_size.recv_frame_size, frame_size.send_frame_size);
+    return frame_size;
+}
+
+bool x300_impl::confirm_frame_size(const std::string &addr, const frame_size_t &frame_size)
+{
+    try {
+        udp_simple::sptr udp = udp_simple::make_connected(addr,
+                BOOST_STRINGIZE(X300_MTU_DETECT_UDP_PORT));
+
+        const size_t max_size = std::max(frame_size.recv_frame_size, frame_size.send_frame_size);
+        if (max_size < sizeof(x300_mtu_t)) return false;
+        std::vector<uint8_t> buffer(max_size);
+        x300_mtu_t *request = reinterpret_cast<x300_mtu_t *>(&buffer.front());
+        static const double echo_timeout = 0.020; //20 ms
+
+        //one echo checks both directions: the firmware replies with as many
+        //bytes as requested and reports how many bytes it received
+        request->flags = shd::htonx<uint32_t>(X300_MTU_DETECT_ECHO_REQUEST);
+        request->size = shd::htonx<uint32_t>(frame_size.recv_frame_size);
+        udp->send(boost::asio::buffer(buffer, frame_size.send_frame_size));
+
+        const size_t len = udp->recv(boost::asio::buffer(buffer), echo_timeout);
+        return len >= frame_size.recv_frame_size
+            and (shd::ntohx<uint32_t>(request->flags) & X300_MTU_DETECT_ECHO_REPLY)
+            and shd::ntohx<uint32_t>(request->size) >= frame_size.send_frame_size;
+    } catch(const std::exception &) {
+        return false;
+    }
+}
+
 x300_impl::frame_size_t x300_impl::determine_max_frame_size(const std::string &addr,
         const frame_size_t &user_frame_size)
 {
@@ -77,6 +77,8 @@ static const size_t X300_ETH_MSG_NUM_FRAMES         = 64;
 static const size_t X300_ETH_DATA_NUM_FRAMES        = 32;
 static const double X300_DEFAULT_SYSREF_RATE        = 10e6;
 
+static const size_t X300_MAX_INIT_THREADS           = 8;     // Motherboards set up at once
+
 static const size_t X300_MAX_RATE_PCIE              = 800000000; // bytes/s
 static const size_t X300_MAX_RATE_10GIGE            = (size_t)(  // bytes/s
         10e9 / 8 *                                               // wire speed multiplied by percentage of packets that is sample data
@@ -127,7 +129,12 @@ class x300_impl : public shd::smini::device3_impl
 public:
 
     x300_impl(const shd::device_addr_t &);
+    //! Claim, check and clock one motherboard, can run concurrently for all of them
     void setup_mb(const size_t which, const shd::device_addr_t &);
+    //! Enumerate the blocks of one motherboard, must run for one after the other
+    void setup_rfnoc_blocks(const size_t which, const shd::device_addr_t &);
+    //! Set up the radios of one motherboard, can run concurrently for all of them
+    void setup_radios(const size_t which, const shd::device_addr_t &);
     ~x300_impl(void);
 
     // device claim functions
@@ -154,6 +161,12 @@ protected:
 
 private:
 
+    struct frame_size_t
+    {
+        size_t recv_frame_size;
+        size_t send_frame_size;
+    };
+
     //vector of member objects per motherboard
     struct mboard_members_t
     {
@@ -165,6 +178,7 @@ private:
         size_t next_src_addr;
         size_t next_tx_src_addr;
         size_t next_rx_src_addr;
+        frame_size_t max_frame_sizes;
 
         // Discover the ethernet connections per motherboard
         void discover_eth(const shd::smini::mboard_eeprom_t mb_eeprom,
@@ -233,13 +247,6 @@ private:
         const shd::device_addr_t& args
     );
 
-    struct frame_size_t
-    {
-        size_t recv_frame_size;
-        size_t send_frame_size;
-    };
-    frame_size_t _max_frame_sizes;
-
     /*!
      * Automatically determine the maximum frame size available by sending a UDP packet
      * to the device and see which packet sizes actually work. This way, we can take
@@ -247,6 +254,18 @@ private:
      */
     frame_size_t determine_max_frame_size(const std::string &addr, const frame_size_t &user_mtu);
 
+    /*!
+     * Get the maximum frame size of a link from the per-host cache and
+     * confirm it with a single echo. Falls back to determine_max_frame_size()
+     * when there is no entry or the cached size does not work anymore,
+     * and stores the result for the next time.
+     */
+    frame_size_t get_max_frame_size(const std::string &addr, const frame_size_t &user_mtu,
+            const std::string &serial, const std::string &fw_version);
+
+    //! Check with one echo that frames of the given sizes get through in both directions
+    bool confirm_frame_size(const std::string &addr, const frame_size_t &frame_size);
+
     ////////////////////////////////////////////////////////////////////
     //
     //Caching for transport interface re-use -- like sharing a DMA.
@@ -0,0 +1,207 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "x300_mtu_cache.hpp"
+#include "x300_fw_common.h"
+#include <shd/utils/paths.hpp>
+#include <shd/utils/log.hpp>
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+#ifdef SHD_PLATFORM_LINUX
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace asio = boost::asio;
+namespace fs = boost::filesystem;
+
+/***********************************************************************
+ * Helpers
+ **********************************************************************/
+static boost::mutex &get_cache_mutex(void){
+    static boost::mutex mutex;
+    return mutex;
+}
+
+static fs::path get_cache_path(void){
+    return fs::path(shd::get_app_path()) / ".shd" / "x300_frame_sizes.csv";
+}
+
+/*!
+ * The MTU of the interface that owns a local address, or 0 if unknown.
+ * Part of the key, so raising the MTU of the NIC gets the link probed again.
+ */
+static size_t get_iface_mtu(const asio::ip::address_v4 &local_addr){
+#ifdef SHD_PLATFORM_LINUX
+    size_t mtu = 0;
+    struct ifaddrs *ifap;
+    if (::getifaddrs(&ifap) != 0) return 0;
+    for (struct ifaddrs *iter = ifap; iter != NULL; iter = iter->ifa_next){
+        if (iter->ifa_addr == NULL or iter->ifa_addr->sa_family != AF_INET) continue;
+        const uint32_t addr = ntohl(reinterpret_cast<const sockaddr_in *>(iter->ifa_addr)->sin_addr.s_addr);
+        if (addr != local_addr.to_ulong()) continue;
+
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) break;
+        struct ifreq ifr;
+        std::memset(&ifr, 0, sizeof(ifr));
+        std::strncpy(ifr.ifr_name, iter->ifa_name, IFNAMSIZ-1);
+        if (::ioctl(fd, SIOCGIFMTU, &ifr) == 0) mtu = size_t(ifr.ifr_mtu);
+        ::close(fd);
+        break;
+    }
+    ::freeifaddrs(ifap);
+    return mtu;
+#else
+    (void) local_addr;
+    return 0;
+#endif
+}
+
+typedef std::vector<std::vector<std::string> > cache_rows_t;
+
+//! Each row is the key fields followed by the receive and send frame sizes
+static cache_rows_t read_rows(void){
+    cache_rows_t rows;
+    std::ifstream file(get_cache_path().string().c_str());
+    std::string line;
+    while (std::getline(file, line)){
+        if (line.empty() or line[0] == '#') continue;
+        std::vector<std::string> row;
+        boost::split(row, line, boost::is_any_of(","));
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+static void write_rows(const cache_rows_t &rows){
+    const fs::path path = get_cache_path();
+    try {
+        fs::create_directories(path.parent_path());
+        //write a new file and move it into place, so a reader never sees half of it
+        const fs::path tmp_path = path.parent_path() / fs::unique_path("x300_frame_sizes-%%%%-%%%%.tmp");
+        {
+            std::ofstream file(tmp_path.string().c_str());
+            file << "# serial,fw compat,host interface,device address,max recv,max send,recv frame size,send frame size" << std::endl;
+            BOOST_FOREACH(const std::vector<std::string> &row, rows){
+                file << boost::algorithm::join(row, ",") << std::endl;
+            }
+            if (not file) throw std::runtime_error("write failed");
+        }
+        fs::rename(tmp_path, path);
+    }
+    catch (const std::exception &e){
+        SHD_LOGV(rarely) << "Could not update " << path.string() << ": " << e.what() << std::endl;
+    }
+}
+
+static std::string row_key(const std::vector<std::string> &row){
+    if (row.size() < 2) return "";
+    return boost::algorithm::join(std::vector<std::string>(row.begin(), row.end()-2), ",");
+}
+
+/***********************************************************************
+ * Cache access
+ **********************************************************************/
+std::string x300_mtu_cache::make_key(
+    const std::string &serial,
+    const std::string &fw_version,
+    const std::string &addr,
+    const size_t max_recv_frame_size,
+    const size_t max_send_frame_size
+){
+    if (serial.empty() or fw_version.empty()) return "";
+
+    //a connected udp socket tells which local address routes to the device
+    std::string host_iface;
+    try {
+        asio::io_service io_service;
+        asio::ip::udp::resolver resolver(io_service);
+        asio::ip::udp::resolver::query query(asio::ip::udp::v4(), addr, BOOST_STRINGIZE(X300_MTU_DETECT_UDP_PORT));
+        const asio::ip::udp::endpoint device_endpoint = *resolver.resolve(query);
+        asio::ip::udp::socket socket(io_service, asio::ip::udp::v4());
+        socket.connect(device_endpoint);
+        const asio::ip::address_v4 local_addr = socket.local_endpoint().address().to_v4();
+        host_iface = str(boost::format("%s/%u") % local_addr.to_string() % get_iface_mtu(local_addr));
+    }
+    catch (const std::exception &){
+        return "";
+    }
+
+    return str(boost::format("%s,%s,%s,%s,%u,%u")
+        % serial % fw_version % host_iface % addr
+        % max_recv_frame_size % max_send_frame_size);
+}
+
+bool x300_mtu_cache::lookup(const std::string &key, size_t &recv_frame_size, size_t &send_frame_size){
+    if (key.empty()) return false;
+    boost::mutex::scoped_lock lock(get_cache_mutex());
+    BOOST_FOREACH(const std::vector<std::string> &row, read_rows()){
+        if (row_key(row) != key) continue;
+        try {
+            recv_frame_size = boost::lexical_cast<size_t>(row[row.size()-2]);
+            send_frame_size = boost::lexical_cast<size_t>(row[row.size()-1]);
+            return true;
+        }
+        catch (const boost::bad_lexical_cast &){
+            return false;
+        }
+    }
+    return false;
+}
+
+void x300_mtu_cache::store(const std::string &key, const size_t recv_frame_size, const size_t send_frame_size){
+    if (key.empty()) return;
+    boost::mutex::scoped_lock lock(get_cache_mutex());
+    cache_rows_t rows;
+    BOOST_FOREACH(const std::vector<std::string> &row, read_rows()){
+        if (row_key(row) != key) rows.push_back(row);
+    }
+    std::vector<std::string> row;
+    boost::split(row, key, boost::is_any_of(","));
+    row.push_back(boost::lexical_cast<std::string>(recv_frame_size));
+    row.push_back(boost::lexical_cast<std::string>(send_frame_size));
+    rows.push_back(row);
+    write_rows(rows);
+}
+
+void x300_mtu_cache::remove(const std::string &key){
+    if (key.empty()) return;
+    boost::mutex::scoped_lock lock(get_cache_mutex());
+    cache_rows_t rows;
+    bool found = false;
+    BOOST_FOREACH(const std::vector<std::string> &row, read_rows()){
+        if (row_key(row) == key) found = true;
+        else rows.push_back(row);
+    }
+    if (found) write_rows(rows);
+}
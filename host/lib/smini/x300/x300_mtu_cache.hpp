@@ -0,0 +1,66 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_X300_MTU_CACHE_HPP
+#define INCLUDED_X300_MTU_CACHE_HPP
+
+#include <string>
+#include <cstddef>
+
+/*!
+ * A per-host cache of the frame sizes detected on X300 Ethernet links.
+ *
+ * The entries live in a CSV file in the application path (see
+ * shd::get_app_path()). Every entry is keyed by the device serial, its
+ * firmware compat number, the host interface the device is reached
+ * through, the device address and the requested frame size ceilings, so
+ * changing any of those makes the link be probed again.
+ */
+namespace x300_mtu_cache {
+
+    /*!
+     * Make the key for one link.
+     * \param serial the motherboard serial number
+     * \param fw_version the firmware compat number ("major.minor")
+     * \param addr the IP address of the device
+     * \param max_recv_frame_size the receive frame size ceiling
+     * \param max_send_frame_size the send frame size ceiling
+     * \return the key, or an empty string when the link cannot be identified
+     */
+    std::string make_key(
+        const std::string &serial,
+        const std::string &fw_version,
+        const std::string &addr,
+        const size_t max_recv_frame_size,
+        const size_t max_send_frame_size
+    );
+
+    /*!
+     * Look up the frame sizes stored for a link.
+     * \return true when the cache has an entry for the key
+     */
+    bool lookup(const std::string &key, size_t &recv_frame_size, size_t &send_frame_size);
+
+    //! Store the frame sizes detected on a link, replacing an old entry
+    void store(const std::string &key, const size_t recv_frame_size, const size_t send_frame_size);
+
+    //! Forget the frame sizes stored for a link
+    void remove(const std::string &key);
+
+} /* namespace x300_mtu_cache */
+
+#endif /* INCLUDED_X300_MTU_CACHE_HPP */
@@ -24,7 +24,17 @@ rx_streamer::~rx_streamer(void)
     //empty
 }
 
+stream_metrics_t rx_streamer::get_metrics(void) const
+{
+    return stream_metrics_t();
+}
+
 tx_streamer::~tx_streamer(void)
 {
     //empty
 }
+
+stream_metrics_t tx_streamer::get_metrics(void) const
+{
+    return stream_metrics_t();
+}
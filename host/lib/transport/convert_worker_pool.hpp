@@ -0,0 +1,244 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_TRANSPORT_CONVERT_WORKER_POOL_HPP
+#define INCLUDED_LIBSHD_TRANSPORT_CONVERT_WORKER_POOL_HPP
+
+#include <shd/config.hpp>
+#include <shd/exception.hpp>
+#include <shd/types/device_addr.hpp>
+#include <shd/utils/atomic.hpp>
+#include <shd/utils/msg.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/utility.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace shd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Convert worker pool
+ *
+ * Runs a task for each channel of a streamer in parallel.
+ * Task i runs on thread i % (num_workers + 1), where thread 0 is the
+ * thread that calls run(), so every channel is always converted by the
+ * same core. The workers are persistent and pinned to CPUs. Between
+ * calls they spin for a short while so back-to-back packets are picked
+ * up without a wakeup, then they park on a condition variable.
+ **********************************************************************/
+class convert_worker_pool : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<convert_worker_pool> sptr;
+    typedef boost::function<void(const size_t)> task_type;
+
+    /*!
+     * Make a pool from stream args:
+     *  - convert_threads: number of worker threads besides the caller
+     *  - convert_cpus: CPUs for the workers, separated by ':'.
+     *    By default, the workers are pinned to the CPUs that follow
+     *    the CPU of the calling thread in the process' CPU set.
+     * \param args the stream args
+     * \param num_tasks the number of tasks per run (channels)
+     * \param task the task to run for each channel
+     * \param prefix the prefix of the arg keys, for pools of other stages
+     * \return a new pool, or null when no workers were requested
+     */
+    static sptr make(
+        const device_addr_t &args,
+        const size_t num_tasks,
+        const task_type &task,
+        const std::string &prefix = "convert"
+    ){
+        //more workers than channels minus the caller would be idle
+        const size_t num_workers = std::min<size_t>(
+            args.cast<size_t>(prefix + "_threads", 0), (num_tasks > 0)? num_tasks-1 : 0);
+        if (num_workers == 0) return sptr();
+
+        std::vector<int> cpus;
+        if (args.has_key(prefix + "_cpus")){
+            std::vector<std::string> cpu_strs;
+            boost::split(cpu_strs, args[prefix + "_cpus"], boost::is_any_of(":"), boost::token_compress_on);
+            BOOST_FOREACH(const std::string &cpu, cpu_strs){
+                cpus.push_back(boost::lexical_cast<int>(cpu));
+            }
+        }
+        else cpus = get_default_cpus(num_workers);
+
+        return sptr(new convert_worker_pool(num_workers, task, cpus));
+    }
+
+    convert_worker_pool(const size_t num_workers, const task_type &task, const std::vector<int> &cpus):
+        _task(task), _num_threads(num_workers+1), _num_tasks(0), _stop(false)
+    {
+        //workers wait for the generation after this one, even if they start late
+        const uint32_t generation = _generation.read();
+        for (size_t i = 0; i < num_workers; i++){
+            const int cpu = cpus.empty()? -1 : cpus[i % cpus.size()];
+            _threads.create_thread(boost::bind(&convert_worker_pool::worker_loop, this, i+1, cpu, generation));
+        }
+    }
+
+    ~convert_worker_pool(void){
+        _stop = true;
+        this->start_generation();
+        _threads.join_all();
+    }
+
+    //! Get the number of threads that run tasks, including the caller
+    size_t get_num_threads(void) const{
+        return _num_threads;
+    }
+
+    /*!
+     * Run task(0) through task(num_tasks-1) and wait for all of them.
+     * The calling thread runs its share of the tasks as well.
+     */
+    SHD_INLINE void run(const size_t num_tasks){
+        _num_tasks = num_tasks;
+        _num_pending.write(uint32_t(_num_threads-1));
+        this->start_generation();
+
+        this->run_tasks(0);
+
+        //wait on the workers, they are usually done by now
+        size_t spins = 0;
+        while (_num_pending.read() != 0){
+            if (spins++ > SPIN_ITERATIONS) boost::this_thread::yield();
+        }
+        if (not _error.empty()){
+            const std::string error = _error;
+            _error.clear();
+            throw shd::runtime_error("convert worker: " + error);
+        }
+    }
+
+private:
+    //! Iterations a worker spins on the generation before parking
+    static const size_t SPIN_ITERATIONS = 1 << 16;
+
+    SHD_INLINE void run_tasks(const size_t thread_index){
+        for (size_t i = thread_index; i < _num_tasks; i += _num_threads){
+            _task(i);
+        }
+    }
+
+    void start_generation(void){
+        _generation.inc();
+        //a worker that is about to park checks the generation under the lock
+        if (_num_parked.read() != 0){
+            boost::mutex::scoped_lock lock(_mutex);
+            _cond.notify_all();
+        }
+    }
+
+    void worker_loop(const size_t thread_index, const int cpu, uint32_t generation){
+        pin_to_cpu(cpu);
+        while (true){
+            //wait for the next generation: spin, then park
+            size_t spins = 0;
+            while (_generation.read() == generation and spins++ < SPIN_ITERATIONS){
+                /* spin */
+            }
+            if (_generation.read() == generation){
+                boost::mutex::scoped_lock lock(_mutex);
+                _num_parked.inc();
+                while (_generation.read() == generation) _cond.wait(lock);
+                _num_parked.dec();
+            }
+            generation = _generation.read();
+            if (_stop) return;
+
+            try{
+                this->run_tasks(thread_index);
+            }
+            catch(const std::exception &e){
+                boost::mutex::scoped_lock lock(_mutex);
+                _error = e.what();
+            }
+            _num_pending.dec();
+        }
+    }
+
+    static void pin_to_cpu(const int cpu){
+        if (cpu < 0) return;
+        #ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0){
+            SHD_MSG(warning) << "Unable to pin convert worker to CPU " << cpu << std::endl;
+        }
+        #endif /*__linux__*/
+    }
+
+    static std::vector<int> get_default_cpus(const size_t num_workers){
+        std::vector<int> cpus;
+        #ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return cpus;
+        std::vector<int> allowed;
+        for (int i = 0; i < CPU_SETSIZE; i++){
+            if (CPU_ISSET(i, &cpu_set)) allowed.push_back(i);
+        }
+        //start after the caller's CPU so the caller keeps its core,
+        //leave the workers unpinned when there is no other core
+        const int caller_cpu = sched_getcpu();
+        allowed.erase(std::remove(allowed.begin(), allowed.end(), caller_cpu), allowed.end());
+        if (allowed.empty()) return cpus;
+        size_t first = 0;
+        while (first < allowed.size() and allowed[first] < caller_cpu) first++;
+        for (size_t i = 0; i < num_workers; i++){
+            cpus.push_back(allowed[(first + i) % allowed.size()]);
+        }
+        #else
+        (void)num_workers;
+        #endif /*__linux__*/
+        return cpus;
+    }
+
+    const task_type _task;
+    const size_t _num_threads;
+    size_t _num_tasks;
+    volatile bool _stop;
+    std::string _error;
+
+    atomic_uint32_t _generation;
+    atomic_uint32_t _num_pending;
+    atomic_uint32_t _num_parked;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    boost::thread_group _threads;
+};
+
+}}} //namespace
+
+#endif /* INCLUDED_LIBSHD_TRANSPORT_CONVERT_WORKER_POOL_HPP */
@@ -16,13 +16,14 @@
 //
 
 #include <shd/transport/muxed_zero_copy_if.hpp>
-#include <shd/transport/bounded_buffer.hpp>
+#include <shd/transport/spsc_ring.hpp>
 #include <shd/exception.hpp>
 #include <shd/utils/safe_call.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/locks.hpp>
+#include <algorithm>
 #include <map>
 
 using namespace shd;
@@ -56,7 +57,7 @@ public:
             //Wait for loop to finish
             //No timeout on join. The recv loop is guaranteed
             //to terminate in a reasonable amount of time because
-            //there are no timed blocks on the underlying.
+            //it only blocks on the underlying for RECV_TIMEOUT.
             _recv_thread.join();
             //Flush base transport
             while (_base_xport->get_recv_buff(0.0001)) /*NOP*/;
@@ -96,30 +97,8 @@ public:
     }
 
 private:
-    /*
-     * @class stream_mrb is used to copy the data and release the original
-     * managed receive buffer back to the base transport.
-     */
-    class stream_mrb : public managed_recv_buffer
-    {
-    public:
-        stream_mrb(size_t size) : _buff(new char[size]) {}
-
-        ~stream_mrb() {
-            delete[] _buff;
-        }
-
-        void release() {}
-
-        SHD_INLINE sptr get_new(char *buff, size_t len)
-        {
-            memcpy(_buff, buff, len);
-            return make(this, _buff, len);
-        }
-
-    private:
-        char *_buff;
-    };
+    //! How long the demux thread blocks on the base transport at a time
+    static const double RECV_TIMEOUT;
 
     class stream_impl : public zero_copy_if
     {
@@ -138,13 +117,9 @@ private:
             _send_frame_size(_muxed_xport->base_xport()->get_send_frame_size()),
             _num_recv_frames(num_recv_frames),
             _recv_frame_size(_muxed_xport->base_xport()->get_recv_frame_size()),
-            _buff_queue(num_recv_frames),
-            _buffers(num_recv_frames),
-            _buffer_index(0)
+            _buff_queue(std::max<size_t>(num_recv_frames, 1))
         {
-            for (size_t i = 0; i < num_recv_frames; i++) {
-                _buffers[i] = boost::make_shared<stream_mrb>(_recv_frame_size);
-            }
+            /* NOP */
         }
 
         ~stream_impl(void)
@@ -176,9 +151,10 @@ private:
             }
         }
 
-        void push_recv_buff(managed_recv_buffer::sptr buff) {
-            _buff_queue.push_with_wait(_buffers.at(_buffer_index++)->get_new(buff->cast<char*>(), buff->size()));
-            _buffer_index %= _buffers.size();
+        //! Hand the base transport's buffer to the consumer without a copy.
+        //! It goes back to the base transport when the consumer releases it.
+        void push_recv_buff(const managed_recv_buffer::sptr &buff) {
+            _buff_queue.push_with_wait(buff);
         }
 
         size_t get_num_send_frames(void) const {
@@ -191,6 +167,8 @@ private:
 
         managed_send_buffer::sptr get_send_buff(double timeout)
         {
+            //Streams may send from different threads
+            boost::lock_guard<boost::mutex> lock(_muxed_xport->_send_mutex);
             return _muxed_xport->base_xport()->get_send_buff(timeout);
         }
 
@@ -201,9 +179,7 @@ private:
         const size_t                                _send_frame_size;
         const size_t                                _num_recv_frames;
         const size_t                                _recv_frame_size;
-        bounded_buffer<managed_recv_buffer::sptr>   _buff_queue;
-        std::vector< boost::shared_ptr<stream_mrb> >    _buffers;
-        size_t                                      _buffer_index;
+        spsc_ring<managed_recv_buffer::sptr>        _buff_queue; //pushed by the recv thread only
     };
 
     inline zero_copy_if::sptr& base_xport() { return _base_xport; }
@@ -217,26 +193,7 @@ private:
         while (true) {
             {   //Uninterruptable block of code
                 boost::this_thread::disable_interruption interrupt_disabler;
-                if (not _process_next_buffer()) {
-                    //Be a good citizen and yield if no packet is processed
-                    static const size_t MIN_DUR = 1;
-                    boost::this_thread::sleep_for(boost::chrono::nanoseconds(MIN_DUR));
-                    //We call sleep(MIN_DUR) above instead of yield() to ensure that we
-                    //relinquish the current scheduler time slot.
-                    //yield() is a hint to the scheduler to end the time
-                    //slice early and schedule in another thread that is ready to run.
-                    //However in most situations, there will be no other thread and
-                    //this thread will continue to run which will rail a CPU core.
-                    //We call sleep(MIN_DUR=1) instead which will sleep for a minimum time.
-                    //Ideally we would like to use boost::chrono::.*seconds::min() but that
-                    //is bound to 0, which causes the sleep_for call to be a no-op and
-                    //thus useless to actually force a sleep.
-
-                    //****************************************************************
-                    //NOTE: This behavior makes this transport a poor choice for
-                    //      low latency communication.
-                    //****************************************************************
-                }
+                _process_next_buffer();
             }
             //Check if the master thread has requested a shutdown
             if (boost::this_thread::interruption_requested()) break;
@@ -245,13 +202,15 @@ private:
 
     bool _process_next_buffer()
     {
-        managed_recv_buffer::sptr buff = _base_xport->get_recv_buff(0.0);
+        //Block on the base transport instead of polling it and sleeping,
+        //so a frame reaches its stream as soon as it arrives.
+        managed_recv_buffer::sptr buff = _base_xport->get_recv_buff(RECV_TIMEOUT);
         if (buff) {
             stream_impl::sptr stream;
             try {
                 const uint32_t stream_num = _classify(buff->cast<void*>(), _base_xport->get_recv_frame_size());
                 {
-                    //Hold the stream mutex long enough to pull a bounded buffer
+                    //Hold the stream mutex long enough to pull a stream
                     //and lock it (increment its ref count).
                     boost::lock_guard<boost::mutex> lock(_mutex);
                     stream_map_t::iterator str_iter = _streams.find(stream_num);
@@ -262,7 +221,7 @@ private:
             } catch (std::exception&) {
                 //If _classify throws we simply drop the frame
             }
-            //Once a bounded buffer is acquired, we can rely on its
+            //Once a stream is acquired, we can rely on its ring
             //thread safety to serialize with the consumer.
             if (stream.get()) {
                 stream->push_recv_buff(buff);
@@ -274,8 +233,7 @@ private:
             //Don't yield in the next iteration.
             return true;
         } else {
-            //The base transport is idle. Return false to let the
-            //thread yield.
+            //The base transport is idle
             return false;
         }
     }
@@ -289,8 +247,11 @@ private:
     size_t                  _num_dropped_frames;
     boost::thread           _recv_thread;
     boost::mutex            _mutex;
+    boost::mutex            _send_mutex;
 };
 
+const double muxed_zero_copy_if_impl::RECV_TIMEOUT = 0.001;
+
 muxed_zero_copy_if::sptr muxed_zero_copy_if::make(
     zero_copy_if::sptr base_xport,
     muxed_zero_copy_if::stream_classifier_fn classify_fn,
@@ -0,0 +1,64 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/transport/spsc_ring.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <climits>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+using namespace shd::transport;
+
+#ifdef __linux__
+
+void spsc_ring_detail::wait(volatile uint32_t *addr, const uint32_t val, const double timeout)
+{
+    //the timeout only bounds this call, the caller tracks the deadline
+    const double secs = std::min(timeout, double(INT_MAX));
+    struct timespec ts;
+    ts.tv_sec = time_t(secs);
+    ts.tv_nsec = long((secs - double(ts.tv_sec))*1e9);
+    ::syscall(SYS_futex, const_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE, val, &ts, NULL, 0);
+}
+
+void spsc_ring_detail::wake(volatile uint32_t *addr)
+{
+    ::syscall(SYS_futex, const_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#else
+
+void spsc_ring_detail::wait(volatile uint32_t *addr, const uint32_t val, const double timeout)
+{
+    //no futex: sleep a little and let the caller poll again
+    if (*addr != val) return;
+    const long usecs = long(std::min(timeout, 100e-6)*1e6);
+    boost::this_thread::sleep(boost::posix_time::microseconds(std::max(usecs, 1L)));
+}
+
+void spsc_ring_detail::wake(volatile uint32_t *)
+{
+    /* NOP */
+}
+
+#endif /*__linux__*/
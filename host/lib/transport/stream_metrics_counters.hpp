@@ -0,0 +1,160 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_TRANSPORT_STREAM_METRICS_COUNTERS_HPP
+#define INCLUDED_LIBSHD_TRANSPORT_STREAM_METRICS_COUNTERS_HPP
+
+#include <shd/config.hpp>
+#include <shd/types/stream_metrics.hpp>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <vector>
+
+namespace shd{ namespace transport{
+
+/*!
+ * A counter with a single writer, which any thread may read.
+ * Only the writer adds, so the add needs no locked instruction.
+ */
+class metric_counter{
+public:
+    metric_counter(void): _value(0){}
+    metric_counter(const metric_counter &other): _value(other.get()){}
+    metric_counter &operator=(const metric_counter &other){
+        _value.store(other.get(), boost::memory_order_relaxed);
+        return *this;
+    }
+
+    SHD_INLINE void add(const uint64_t num){
+        _value.store(_value.load(boost::memory_order_relaxed) + num, boost::memory_order_relaxed);
+    }
+
+    SHD_INLINE void inc(void){
+        this->add(1);
+    }
+
+    SHD_INLINE void set(const uint64_t value){
+        _value.store(value, boost::memory_order_relaxed);
+    }
+
+    SHD_INLINE uint64_t get(void) const{
+        return _value.load(boost::memory_order_relaxed);
+    }
+
+private:
+    boost::atomic<uint64_t> _value;
+};
+
+/*!
+ * The counters the packet handlers keep for stream_metrics_t.
+ * Times are kept in nanoseconds.
+ *
+ * Reading the clock is the expensive part, so the handlers take one
+ * stamp after each step and charge the time since the last stamp to
+ * the step: the wait for a buffer, the conversion, the commit.
+ */
+class stream_metrics_counters{
+public:
+    struct xport_counters_t{
+        metric_counter num_packets;
+        metric_counter num_bytes;
+        metric_counter num_seq_errors;
+        metric_counter num_fc_stalls;
+        metric_counter num_fc_acks;
+        metric_counter num_queued_packets;
+        metric_counter max_queued_packets;
+        metric_counter wait_ns;
+    };
+
+    stream_metrics_counters(void): _last_stamp(0){}
+
+    //! Set the number of transports, before streaming
+    void resize(const size_t size){
+        xports.resize(size);
+    }
+
+    //! Read the clock, the time becomes the last stamp
+    SHD_INLINE uint64_t stamp(void){
+        _last_stamp = uint64_t(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch()).count());
+        return _last_stamp;
+    }
+
+    //! Get the nanoseconds since the last stamp and take a new one
+    SHD_INLINE uint64_t lap(void){
+        const uint64_t last = _last_stamp;
+        return this->stamp() - last;
+    }
+
+    //! Count a call of recv() or send() from its first to its last stamp
+    SHD_INLINE void add_call(const size_t nsamps, const uint64_t start){
+        num_calls.inc();
+        num_samps.add(nsamps);
+        const uint64_t us = (_last_stamp - start)/1000;
+        size_t bucket = 0;
+        while (bucket < stream_metrics_t::NUM_LATENCY_BUCKETS - 1 and (us >> bucket) != 0) bucket++;
+        latency_hist[bucket].inc();
+    }
+
+    //! Get a snapshot for the user
+    stream_metrics_t snapshot(void) const{
+        stream_metrics_t metrics;
+        metrics.num_calls = num_calls.get();
+        metrics.num_samps = num_samps.get();
+        metrics.num_timeouts = num_timeouts.get();
+        metrics.num_overflows = num_overflows.get();
+        metrics.num_underflows = num_underflows.get();
+        metrics.num_seq_errors = num_seq_errors.get();
+        metrics.num_late_cmds = num_late_cmds.get();
+        metrics.convert_secs = convert_ns.get()/1e9;
+        for (size_t i = 0; i < stream_metrics_t::NUM_LATENCY_BUCKETS; i++) {
+            metrics.latency_hist[i] = latency_hist[i].get();
+        }
+        metrics.xports.resize(xports.size());
+        for (size_t i = 0; i < xports.size(); i++) {
+            metrics.xports[i].num_packets = xports[i].num_packets.get();
+            metrics.xports[i].num_bytes = xports[i].num_bytes.get();
+            metrics.xports[i].num_seq_errors = xports[i].num_seq_errors.get();
+            metrics.xports[i].num_fc_stalls = xports[i].num_fc_stalls.get();
+            metrics.xports[i].num_fc_acks = xports[i].num_fc_acks.get();
+            metrics.xports[i].num_queued_packets = xports[i].num_queued_packets.get();
+            metrics.xports[i].max_queued_packets = xports[i].max_queued_packets.get();
+            metrics.xports[i].wait_secs = xports[i].wait_ns.get()/1e9;
+            metrics.num_fc_stalls += metrics.xports[i].num_fc_stalls;
+            metrics.wait_secs += metrics.xports[i].wait_secs;
+        }
+        return metrics;
+    }
+
+    metric_counter num_calls;
+    metric_counter num_samps;
+    metric_counter num_timeouts;
+    metric_counter num_overflows;
+    metric_counter num_underflows;
+    metric_counter num_seq_errors;
+    metric_counter num_late_cmds;
+    metric_counter convert_ns;
+    metric_counter latency_hist[stream_metrics_t::NUM_LATENCY_BUCKETS];
+    std::vector<xport_counters_t> xports;
+
+private:
+    uint64_t _last_stamp; //only used by the streaming thread
+};
+
+}} //namespace shd::transport
+
+#endif /* INCLUDED_LIBSHD_TRANSPORT_STREAM_METRICS_COUNTERS_HPP */
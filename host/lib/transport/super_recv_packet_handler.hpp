@@ -19,6 +19,8 @@
 #define INCLUDED_LIBSHD_TRANSPORT_SUPER_RECV_PACKET_HANDLER_HPP
 
 #include "../rfnoc/rx_stream_terminator.hpp"
+#include "convert_worker_pool.hpp"
+#include "stream_metrics_counters.hpp"
 #include <shd/config.hpp>
 #include <shd/exception.hpp>
 #include <shd/convert.hpp>
@@ -26,6 +28,7 @@
 #include <shd/utils/msg.hpp>
 #include <shd/utils/tasks.hpp>
 #include <shd/utils/byteswap.hpp>
+#include <shd/utils/stream_metrics_export.hpp>
 #include <shd/types/metadata.hpp>
 #include <shd/transport/vrt_if_packet.hpp>
 #include <shd/transport/zero_copy.hpp>
@@ -69,7 +72,8 @@ static inline void handle_overflow_nop(void){}
 class recv_packet_handler{
 public:
     typedef boost::function<managed_recv_buffer::sptr(double)> get_buff_type;
-    typedef boost::function<void(const size_t)> handle_flowctrl_type;
+    //! Sends an ack for a packet, returns false when it cannot be sent now
+    typedef boost::function<bool(const size_t)> handle_flowctrl_type;
     typedef boost::function<void(const stream_cmd_t&)> issue_stream_cmd_type;
     typedef void(*vrt_unpacker_type)(const uint32_t *, vrt::if_packet_info_t &);
     //typedef boost::function<void(const uint32_t *, vrt::if_packet_info_t &)> vrt_unpacker_type;
@@ -80,7 +84,8 @@ public:
      */
     recv_packet_handler(const size_t size = 1):
         _queue_error_for_next_call(false),
-        _buffers_infos_index(0)
+        _buffers_infos_index(0),
+        _scale_factor(1/32767.)
     {
         #ifdef  ERROR_INJECT_DROPPED_PACKETS
         recvd_packets = 0;
@@ -98,6 +103,7 @@ public:
     void resize(const size_t size){
         if (this->size() == size) return;
         _props.resize(size);
+        _metrics.resize(size);
         //re-initialize all buffers infos by re-creating the vector
         _buffers_infos = std::vector<buffers_info_type>(4, buffers_info_type(size));
     }
@@ -183,26 +189,61 @@ public:
 
     /*!
      * Set the function to handle flow control
+     *
+     * With a max_update_window larger than the update_window, the
+     * packets between acks adapt: the interval grows while recv()
+     * waits for the packets and shrinks while the packets are found
+     * waiting in the buffer. An ack that cannot be sent is retried
+     * with the next packet.
+     *
      * \param xport_chan which transport channel
      * \param handle_flowctrl the callback function
+     * \param update_window the number of packets between acks
+     * \param do_init true to ack packet zero right away
+     * \param max_update_window the largest number of packets between acks
      */
-    void set_xport_handle_flowctrl(const size_t xport_chan, const handle_flowctrl_type &handle_flowctrl, const size_t update_window, const bool do_init = false)
-    {
-        _props.at(xport_chan).handle_flowctrl = handle_flowctrl;
+    void set_xport_handle_flowctrl(
+        const size_t xport_chan,
+        const handle_flowctrl_type &handle_flowctrl,
+        const size_t update_window,
+        const bool do_init = false,
+        const size_t max_update_window = 0
+    ){
+        xport_chan_props_type &props = _props.at(xport_chan);
+        props.handle_flowctrl = handle_flowctrl;
         //we need the window size to be within the 0xfff (max 12 bit seq)
-        _props.at(xport_chan).fc_update_window = std::min<size_t>(update_window, 0xfff);
+        props.fc_min_window = std::min<size_t>(update_window, 0xfff);
+        props.fc_max_window = std::max(props.fc_min_window, std::min<size_t>(max_update_window, 0xfff));
+        props.fc_update_window = props.fc_min_window;
+        props.fc_last_ack = 0;
+        props.fc_num_queued = 0;
+        props.fc_queued_run = 0;
         if (do_init) handle_flowctrl(0);
     }
 
     //! Set the conversion routine for all channels
     void set_converter(const shd::convert::id_type &id){
         _num_outputs = id.num_outputs;
+        _convert_id = id;
         _converter = shd::convert::get_converter(id)();
+        this->update_chan_converters();
         this->set_scale_factor(1/32767.); //update after setting converter
         _bytes_per_otw_item = shd::convert::get_bytes_per_item(id.input_format);
         _bytes_per_cpu_item = shd::convert::get_bytes_per_item(id.output_format);
     }
 
+    /*!
+     * Convert the channels in parallel on a worker pool.
+     * Uses the stream args convert_threads and convert_cpus,
+     * see convert_worker_pool::make(). Call after resize().
+     */
+    void set_convert_threads(const device_addr_t &args){
+        _convert_pool = convert_worker_pool::make(args, this->size(),
+            boost::bind(&recv_packet_handler::convert_chan, this, _1));
+        this->update_chan_converters();
+        if (_converter) this->set_scale_factor(_scale_factor);
+    }
+
     //! Set the transport channel's overflow handler
     void set_overflow_handler(const size_t xport_chan, const handle_overflow_type &handle_overflow){
         _props.at(xport_chan).handle_overflow = handle_overflow;
@@ -210,7 +251,11 @@ public:
 
     //! Set the scale factor used in float conversion
     void set_scale_factor(const double scale_factor){
+        _scale_factor = scale_factor;
         _converter->set_scalar(scale_factor);
+        BOOST_FOREACH(const shd::convert::converter::sptr &conv, _chan_converters){
+            conv->set_scalar(scale_factor);
+        }
     }
 
     //! Set the callback to issue stream commands
@@ -235,10 +280,17 @@ public:
         }
     }
 
+    //! Get the counters of the streamer and its transports
+    stream_metrics_t get_metrics(void) const
+    {
+        return _metrics.snapshot();
+    }
+
     /*******************************************************************
      * Receive:
      * The entry point for the fast-path receive calls.
-     * Dispatch into combinations of single packet receive calls.
+     * Dispatch into combinations of single packet receive calls,
+     * then count the call.
      ******************************************************************/
     SHD_INLINE size_t recv(
         const shd::rx_streamer::buffs_type &buffs,
@@ -246,6 +298,20 @@ public:
         shd::rx_metadata_t &metadata,
         const double timeout,
         const bool one_packet
+    ){
+        const uint64_t start = _metrics.stamp();
+        const size_t nsamps_recvd = recv_packets(buffs, nsamps_per_buff, metadata, timeout, one_packet);
+        _metrics.add_call(nsamps_recvd, start);
+        return nsamps_recvd;
+    }
+
+private:
+    SHD_INLINE size_t recv_packets(
+        const shd::rx_streamer::buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        shd::rx_metadata_t &metadata,
+        const double timeout,
+        const bool one_packet
     ){
         //handle metadata queued from a previous receive
         if (_queue_error_for_next_call){
@@ -298,7 +364,6 @@ public:
         return accum_num_samps;
     }
 
-private:
     vrt_unpacker_type _vrt_unpacker;
     size_t _header_offset_words32;
     double _tick_rate, _samp_rate;
@@ -309,7 +374,12 @@ private:
         xport_chan_props_type(void):
             packet_count(0),
             handle_overflow(&handle_overflow_nop),
-            fc_update_window(0)
+            fc_update_window(0),
+            fc_min_window(0),
+            fc_max_window(0),
+            fc_last_ack(0),
+            fc_num_queued(0),
+            fc_queued_run(0)
         {}
         get_buff_type get_buff;
         issue_stream_cmd_type issue_stream_cmd;
@@ -317,6 +387,10 @@ private:
         handle_overflow_type handle_overflow;
         handle_flowctrl_type handle_flowctrl;
         size_t fc_update_window;
+        size_t fc_min_window, fc_max_window;
+        size_t fc_last_ack; //packet count of the last ack sent
+        size_t fc_num_queued; //packets found waiting since the last ack
+        size_t fc_queued_run; //packets found waiting in a row
 	/////// RFNOC ///////////
         bool has_sid;
         uint32_t sid;
@@ -395,6 +469,37 @@ private:
 
     shd::rfnoc::rx_stream_terminator::sptr _terminator;
 
+    stream_metrics_counters _metrics;
+
+    /*******************************************************************
+     * Send a flow control ack for a packet.
+     * Returns false when the ack could not be sent now, the packets
+     * stay unacked and the next packet tries again.
+     ******************************************************************/
+    SHD_INLINE bool send_flowctrl(const size_t index, const size_t packet_count){
+        if (not _props[index].handle_flowctrl(packet_count)) return false;
+        _props[index].fc_last_ack = packet_count;
+        _metrics.xports[index].num_fc_acks.inc();
+        return true;
+    }
+
+    /*******************************************************************
+     * Adapt the number of packets between acks after an ack:
+     * When most packets since the last ack were waiting in the buffer,
+     * it is filling up and the device must learn of the free space
+     * sooner, so halve the interval. When no packet was waiting, the
+     * consumer keeps up, so grow the interval by a quarter.
+     ******************************************************************/
+    SHD_INLINE void adapt_fc_window(xport_chan_props_type &props, const size_t num_acked){
+        if (props.fc_num_queued*2 > num_acked){
+            props.fc_update_window = std::max(props.fc_min_window, props.fc_update_window/2);
+        }
+        else if (props.fc_num_queued == 0){
+            props.fc_update_window = std::min(props.fc_max_window, props.fc_update_window + props.fc_update_window/4 + 1);
+        }
+        props.fc_num_queued = 0;
+    }
+
     /*******************************************************************
      * Get and process a single packet from the transport:
      * Receive a single packet at the given index.
@@ -409,8 +514,29 @@ private:
     ){
         //get a single packet from the transport layer
         managed_recv_buffer::sptr &buff = curr_buffer_info.buff;
-        buff = _props[index].get_buff(timeout);
+        stream_metrics_counters::xport_counters_t &xport_metrics = _metrics.xports[index];
+        xport_chan_props_type &props = _props[index];
+        //with adaptive acks, poll first to see if the packet was waiting
+        const bool fc_adaptive = props.fc_max_window > props.fc_min_window;
+        buff = props.get_buff(fc_adaptive? 0.0 : timeout);
+        const bool queued = fc_adaptive and buff.get() != NULL;
+        if (fc_adaptive and not queued and timeout > 0.0){
+            buff = props.get_buff(timeout);
+        }
+        xport_metrics.wait_ns.add(_metrics.lap());
         if (buff.get() == NULL) return PACKET_TIMEOUT_ERROR;
+        xport_metrics.num_packets.inc();
+        xport_metrics.num_bytes.add(buff->size());
+        if (fc_adaptive){
+            props.fc_queued_run = queued? props.fc_queued_run + 1 : 0;
+            if (queued){
+                props.fc_num_queued++;
+                xport_metrics.num_queued_packets.inc();
+            }
+            if (props.fc_queued_run > xport_metrics.max_queued_packets.get()){
+                xport_metrics.max_queued_packets.set(props.fc_queued_run);
+            }
+        }
 
         #ifdef  ERROR_INJECT_DROPPED_PACKETS
         if (++recvd_packets > 1000)
@@ -437,11 +563,14 @@ private:
         info.copy_buff = reinterpret_cast<const char *>(info.vrt_hdr + info.ifpi.num_header_words32);
 
         //handle flow control
-        if (_props[index].handle_flowctrl)
+        if (props.handle_flowctrl)
         {
-            if ((info.ifpi.packet_count % _props[index].fc_update_window) == 0)
+            const size_t fc_seq_mask = (info.ifpi.link_type == vrt::if_packet_info_t::LINK_TYPE_NONE)? 0xf : 0xfff;
+            const size_t num_unacked = (info.ifpi.packet_count - props.fc_last_ack) & fc_seq_mask;
+            if (num_unacked >= props.fc_update_window and
+                this->send_flowctrl(index, info.ifpi.packet_count))
             {
-                _props[index].handle_flowctrl(info.ifpi.packet_count);
+                if (fc_adaptive) this->adapt_fc_window(props, num_unacked);
             }
         }
 
@@ -466,8 +595,9 @@ private:
                 // Always update flow control in this case, because we don't
                 // know which packet was dropped and what state the upstream
                 // flow control is in.
-                _props[index].handle_flowctrl(info.ifpi.packet_count);
+                this->send_flowctrl(index, info.ifpi.packet_count);
             }
+            xport_metrics.num_seq_errors.inc();
             return PACKET_SEQUENCE_ERROR;
         }
         #endif
@@ -608,14 +738,18 @@ private:
                     // Send first as the overrun handler may flush the receive buffers which could contain
                     // packets with sequence numbers after this packet's sequence number!
                     if(_props[index].handle_flowctrl) {
-                        _props[index].handle_flowctrl(next_info[index].ifpi.packet_count);
+                        this->send_flowctrl(index, next_info[index].ifpi.packet_count);
                     }
 
                     rx_metadata_t metadata = curr_info.metadata;
                     _props[index].handle_overflow();
                     curr_info.metadata = metadata;
+                    _metrics.num_overflows.inc();
                     SHD_MSG(fastpath) << "O";
                 }
+                else if (curr_info.metadata.error_code == rx_metadata_t::ERROR_CODE_LATE_COMMAND){
+                    _metrics.num_late_cmds.inc();
+                }
                 curr_info[index].buff.reset();
                 curr_info[index].copy_buff = NULL;
                 return;
@@ -623,9 +757,10 @@ private:
             case PACKET_TIMEOUT_ERROR:
                 std::swap(curr_info, next_info); //save progress from curr -> next
                 if(_props[index].handle_flowctrl) {
-                    _props[index].handle_flowctrl(next_info[index].ifpi.packet_count);
+                    this->send_flowctrl(index, next_info[index].ifpi.packet_count);
                 }
                 curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+                _metrics.num_timeouts.inc();
                 return;
 
             case PACKET_SEQUENCE_ERROR:
@@ -636,6 +771,7 @@ private:
                     prev_info[index].ifpi.num_payload_words32*sizeof(uint32_t)/_bytes_per_otw_item, _samp_rate);
                 curr_info.metadata.out_of_sequence = true;
                 curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_OVERFLOW;
+                _metrics.num_seq_errors.inc();
                 SHD_MSG(fastpath) << "D";
                 return;
 
@@ -706,9 +842,17 @@ private:
         _convert_bytes_to_copy = bytes_to_copy;
 
         //perform N channels of conversion
-        for (size_t i = 0; i < this->size(); i++) {
-            convert_to_out_buff(i);
+        if (_convert_pool) {
+            _convert_pool->run(this->size());
+            for (size_t i = 0; i < this->size(); i++) {
+                release_chan_buff(i);
+            }
+        } else {
+            for (size_t i = 0; i < this->size(); i++) {
+                convert_to_out_buff(i);
+            }
         }
+        _metrics.convert_ns.add(_metrics.lap()); //includes unpacking and alignment
 
         //update the copy buffer's availability
         info.data_bytes_to_copy -= bytes_to_copy;
@@ -729,10 +873,16 @@ private:
      * - Updates read/write pointers
      */
     inline void convert_to_out_buff(const size_t index)
+    {
+        convert_chan(index);
+        release_chan_buff(index);
+    }
+
+    //! Convert one channel, runs on the worker threads when enabled
+    inline void convert_chan(const size_t index)
     {
         //shortcut references to local data structures
-        buffers_info_type &buff_info = get_curr_buffer_info();
-        per_buffer_info_type &info = buff_info[index];
+        per_buffer_info_type &info = get_curr_buffer_info()[index];
         const rx_streamer::buffs_type &buffs = *_convert_buffs;
 
         //fill IO buffs with pointers into the output buffer
@@ -744,14 +894,30 @@ private:
         const ref_vector<void *> out_buffs(io_buffs, _num_outputs);
 
         //perform the conversion operation
-        _converter->conv(info.copy_buff, out_buffs, _convert_nsamps);
+        const shd::convert::converter::sptr &converter =
+            _chan_converters.empty()? _converter : _chan_converters[index];
+        converter->conv(info.copy_buff, out_buffs, _convert_nsamps);
 
         //advance the pointer for the source buffer
         info.copy_buff += _convert_bytes_to_copy;
+    }
 
-        //release the buffer if fully consumed
+    //! Release a channel's buffer if fully consumed, always on the caller's thread
+    inline void release_chan_buff(const size_t index)
+    {
+        buffers_info_type &buff_info = get_curr_buffer_info();
         if (buff_info.data_bytes_to_copy == _convert_bytes_to_copy){
-            info.buff.reset(); //effectively a release
+            buff_info[index].buff.reset(); //effectively a release
+        }
+    }
+
+    //! One converter per channel when converting in parallel
+    void update_chan_converters(void)
+    {
+        _chan_converters.clear();
+        if (not _convert_pool or not _converter) return;
+        for (size_t i = 0; i < this->size(); i++){
+            _chan_converters.push_back(shd::convert::get_converter(_convert_id)());
         }
     }
 
@@ -761,6 +927,12 @@ private:
     size_t _convert_buffer_offset_bytes;
     size_t _convert_bytes_to_copy;
 
+    //! Parallel conversion state
+    convert_worker_pool::sptr _convert_pool;
+    std::vector<shd::convert::converter::sptr> _chan_converters;
+    shd::convert::id_type _convert_id;
+    double _scale_factor;
+
     /*
      * This last section is only for debugging purposes.
      * It causes a lot of prints to stderr which can be piped to a file.
@@ -826,6 +998,8 @@ class recv_packet_streamer : public recv_packet_handler, public rx_streamer{
 public:
     recv_packet_streamer(const size_t max_num_samps){
         _max_num_samps = max_num_samps;
+        _metrics_export = stream_metrics_export::register_source(
+            "rx", boost::bind(&recv_packet_streamer::get_metrics, this));
     }
 
     size_t get_num_channels(void) const{
@@ -851,8 +1025,15 @@ public:
         return recv_packet_handler::issue_stream_cmd(stream_cmd);
     }
 
+    stream_metrics_t get_metrics(void) const
+    {
+        return recv_packet_handler::get_metrics();
+    }
+
 private:
     size_t _max_num_samps;
+    //! Unregisters before the counters of the handler go away
+    stream_metrics_export::sptr _metrics_export;
 };
 
 }}} //namespace
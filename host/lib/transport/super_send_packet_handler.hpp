@@ -19,6 +19,8 @@
 #define INCLUDED_LIBSHD_TRANSPORT_SUPER_SEND_PACKET_HANDLER_HPP
 
 #include "../rfnoc/tx_stream_terminator.hpp"
+#include "convert_worker_pool.hpp"
+#include "stream_metrics_counters.hpp"
 #include <shd/config.hpp>
 #include <shd/exception.hpp>
 #include <shd/convert.hpp>
@@ -26,6 +28,7 @@
 #include <shd/utils/msg.hpp>
 #include <shd/utils/tasks.hpp>
 #include <shd/utils/byteswap.hpp>
+#include <shd/utils/stream_metrics_export.hpp>
 #include <shd/types/metadata.hpp>
 #include <shd/transport/vrt_if_packet.hpp>
 #include <shd/transport/zero_copy.hpp>
@@ -33,6 +36,7 @@
 #include <boost/thread/thread_time.hpp>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
 #include <vector>
 
@@ -59,6 +63,7 @@ namespace sph {
 class send_packet_handler{
 public:
     typedef boost::function<managed_send_buffer::sptr(double)> get_buff_type;
+    typedef boost::function<void(void)> flush_type;
     typedef boost::function<bool(shd::async_metadata_t &, const double)> async_receiver_type;
     typedef void(*vrt_packer_type)(uint32_t *, vrt::if_packet_info_t &);
     //typedef boost::function<void(uint32_t *, vrt::if_packet_info_t &)> vrt_packer_type;
@@ -68,7 +73,7 @@ public:
      * \param size the number of transport channels
      */
     send_packet_handler(const size_t size = 1):
-        _next_packet_seq(0), _cached_metadata(false)
+        _next_packet_seq(0), _cached_metadata(false), _scale_factor(32767.)
     {
         this->set_enable_trailer(true);
         this->resize(size);
@@ -82,8 +87,10 @@ public:
     void resize(const size_t size){
         if (this->size() == size) return;
         _props.resize(size);
+        _metrics.resize(size);
         static const uint64_t zero = 0;
         _zero_buffs.resize(size, &zero);
+        _convert_commit_bytes.resize(size, 0);
     }
 
     //! Get the channel width of this handler
@@ -148,15 +155,40 @@ public:
         _props.at(xport_chan).get_buff = get_buff;
     }
 
+    /*!
+     * Set the function to push out frames the transport holds back.
+     * It is called once at the end of every send() call, so transports
+     * that batch committed frames send a whole call with few syscalls.
+     * \param xport_chan which transport channel
+     * \param flush the flush function
+     */
+    void set_xport_chan_flush(const size_t xport_chan, const flush_type &flush){
+        _props.at(xport_chan).flush = flush;
+    }
+
     //! Set the conversion routine for all channels
     void set_converter(const shd::convert::id_type &id){
         _num_inputs = id.num_inputs;
+        _convert_id = id;
         _converter = shd::convert::get_converter(id)();
+        this->update_chan_converters();
         this->set_scale_factor(32767.); //update after setting converter
         _bytes_per_otw_item = shd::convert::get_bytes_per_item(id.output_format);
         _bytes_per_cpu_item = shd::convert::get_bytes_per_item(id.input_format);
     }
 
+    /*!
+     * Convert the channels in parallel on a worker pool.
+     * Uses the stream args convert_threads and convert_cpus,
+     * see convert_worker_pool::make(). Call after resize().
+     */
+    void set_convert_threads(const device_addr_t &args){
+        _convert_pool = convert_worker_pool::make(args, this->size(),
+            boost::bind(&send_packet_handler::convert_chan, this, _1));
+        this->update_chan_converters();
+        if (_converter) this->set_scale_factor(_scale_factor);
+    }
+
     /*!
      * Set the maximum number of samples per host packet.
      * Ex: A SMINI1 in dual channel mode would be half.
@@ -168,7 +200,11 @@ public:
 
     //! Set the scale factor used in float conversion
     void set_scale_factor(const double scale_factor){
+        _scale_factor = scale_factor;
         _converter->set_scalar(scale_factor);
+        BOOST_FOREACH(const shd::convert::converter::sptr &conv, _chan_converters){
+            conv->set_scalar(scale_factor);
+        }
     }
 
     //! Set the callback to get async messages
@@ -177,25 +213,64 @@ public:
         _async_receiver = async_receiver;
     }
 
-    //! Overload call to get async metadata
+    //! Overload call to get async metadata, counts the errors
     bool recv_async_msg(
         shd::async_metadata_t &async_metadata, double timeout = 0.1
     ){
-        if (_async_receiver) return _async_receiver(async_metadata, timeout);
-        boost::this_thread::sleep(boost::posix_time::microseconds(long(timeout*1e6)));
-        return false;
+        if (not _async_receiver) {
+            boost::this_thread::sleep(boost::posix_time::microseconds(long(timeout*1e6)));
+            return false;
+        }
+        if (not _async_receiver(async_metadata, timeout)) return false;
+        if (async_metadata.event_code &
+            ( async_metadata_t::EVENT_CODE_UNDERFLOW
+            | async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET)
+        ) _metrics.num_underflows.inc();
+        if (async_metadata.event_code &
+            ( async_metadata_t::EVENT_CODE_SEQ_ERROR
+            | async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST)
+        ) _metrics.num_seq_errors.inc();
+        if (async_metadata.event_code & async_metadata_t::EVENT_CODE_TIME_ERROR
+        ) _metrics.num_late_cmds.inc();
+        return true;
+    }
+
+    //! Get the counters of the streamer and its transports
+    stream_metrics_t get_metrics(void) const
+    {
+        return _metrics.snapshot();
     }
 
     /*******************************************************************
      * Send:
      * The entry point for the fast-path send calls.
-     * Dispatch into combinations of single packet send calls.
+     * Dispatch into combinations of single packet send calls,
+     * then flush the transports that batch committed frames
+     * and count the call.
      ******************************************************************/
     SHD_INLINE size_t send(
         const shd::tx_streamer::buffs_type &buffs,
         const size_t nsamps_per_buff,
         const shd::tx_metadata_t &metadata,
         const double timeout
+    ){
+        const uint64_t start = _metrics.stamp();
+        const size_t nsamps_sent = send_packets(buffs, nsamps_per_buff, metadata, timeout);
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            if (props.flush) props.flush();
+        }
+        _metrics.stamp();
+        _metrics.add_call(nsamps_sent, start);
+        return nsamps_sent;
+    }
+
+private:
+
+    SHD_INLINE size_t send_packets(
+        const shd::tx_streamer::buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        const shd::tx_metadata_t &metadata,
+        const double timeout
     ){
         //translate the metadata to vrt if packet info
         vrt::if_packet_info_t if_packet_info;
@@ -293,14 +368,13 @@ public:
 		return nsamps_sent;
     }
 
-private:
-
     vrt_packer_type _vrt_packer;
     size_t _header_offset_words32;
     double _tick_rate, _samp_rate;
     struct xport_chan_props_type{
         xport_chan_props_type(void):has_sid(false),sid(0){}
         get_buff_type get_buff;
+        flush_type flush;
         bool has_sid;
         uint32_t sid;
         managed_send_buffer::sptr buff;
@@ -320,6 +394,8 @@ private:
 
     shd::rfnoc::tx_stream_terminator::sptr _terminator;
 
+    stream_metrics_counters _metrics;
+
 #ifdef SHD_TXRX_DEBUG_PRINTS
     struct dbg_send_stat_t {
         dbg_send_stat_t(long wc, size_t nspb, size_t nss, shd::tx_metadata_t md, double to, double rate):
@@ -381,10 +457,23 @@ private:
         if_packet_info.num_payload_words32 = (if_packet_info.num_payload_bytes + 3/*round up*/)/sizeof(uint32_t);
         if_packet_info.packet_count = _next_packet_seq;
 
-        //get a buffer for each channel or timeout
-        BOOST_FOREACH(xport_chan_props_type &props, _props){
-            if (not props.buff) props.buff = props.get_buff(timeout);
-            if (not props.buff) return 0; //timeout
+        //get a buffer for each channel or timeout,
+        //no buffer right away means the device is out of credit
+        for (size_t i = 0; i < this->size(); i++){
+            xport_chan_props_type &props = _props[i];
+            if (props.buff) continue;
+            props.buff = props.get_buff(0.0);
+            if (not props.buff and timeout > 0.0){
+                stream_metrics_counters::xport_counters_t &xport_metrics = _metrics.xports[i];
+                xport_metrics.num_fc_stalls.inc();
+                _metrics.stamp();
+                props.buff = props.get_buff(timeout);
+                xport_metrics.wait_ns.add(_metrics.lap());
+            }
+            if (not props.buff){
+                _metrics.num_timeouts.inc();
+                return 0; //timeout
+            }
         }
 
         //setup the data to share with converter threads
@@ -393,26 +482,34 @@ private:
         _convert_buffer_offset_bytes = buffer_offset_bytes;
         _convert_if_packet_info = &if_packet_info;
 
-        //perform N channels of conversion
+        //perform N channels of conversion, then commit
+        if (_convert_pool) {
+            _convert_pool->run(this->size());
+        } else {
+            for (size_t i = 0; i < this->size(); i++) {
+                convert_chan(i);
+            }
+        }
+        _metrics.convert_ns.add(_metrics.lap()); //includes packing
+
+        //a commit may wait for flow control credit
         for (size_t i = 0; i < this->size(); i++) {
-            convert_to_in_buff(i);
+            stream_metrics_counters::xport_counters_t &xport_metrics = _metrics.xports[i];
+            xport_metrics.num_packets.inc();
+            xport_metrics.num_bytes.add(_convert_commit_bytes[i]);
+            commit_chan_buff(i);
+            xport_metrics.wait_ns.add(_metrics.lap());
         }
 
         _next_packet_seq++; //increment sequence after commits
         return nsamps_per_buff;
     }
 
-    /*! Run the conversion from the internal buffers to the user's input
-     *  buffer.
-     *
-     * - Calls the converter
-     * - Releases internal data buffers
-     * - Updates read/write pointers
-     */
-    SHD_INLINE void convert_to_in_buff(const size_t index)
+    //! Pack and convert one channel, runs on the worker threads when enabled
+    SHD_INLINE void convert_chan(const size_t index)
     {
         //shortcut references to local data structures
-        managed_send_buffer::sptr &buff = _props[index].buff;
+        const managed_send_buffer::sptr &buff = _props[index].buff;
         vrt::if_packet_info_t if_packet_info = *_convert_if_packet_info;
         const tx_streamer::buffs_type &buffs = *_convert_buffs;
 
@@ -432,19 +529,44 @@ private:
         otw_mem += if_packet_info.num_header_words32;
 
         //perform the conversion operation
-        _converter->conv(in_buffs, otw_mem, _convert_nsamps);
+        const shd::convert::converter::sptr &converter =
+            _chan_converters.empty()? _converter : _chan_converters[index];
+        converter->conv(in_buffs, otw_mem, _convert_nsamps);
 
-        //commit the samples to the zero-copy interface
         const size_t num_vita_words32 = _header_offset_words32+if_packet_info.num_packet_words32;
-        buff->commit(num_vita_words32*sizeof(uint32_t));
+        _convert_commit_bytes[index] = num_vita_words32*sizeof(uint32_t);
+    }
+
+    //! Commit a channel's buffer, always on the caller's thread
+    SHD_INLINE void commit_chan_buff(const size_t index)
+    {
+        managed_send_buffer::sptr &buff = _props[index].buff;
+        buff->commit(_convert_commit_bytes[index]);
         buff.reset(); //effectively a release
     }
 
+    //! One converter per channel when converting in parallel
+    void update_chan_converters(void)
+    {
+        _chan_converters.clear();
+        if (not _convert_pool or not _converter) return;
+        for (size_t i = 0; i < this->size(); i++){
+            _chan_converters.push_back(shd::convert::get_converter(_convert_id)());
+        }
+    }
+
     //! Shared variables for the worker threads
     size_t _convert_nsamps;
     const tx_streamer::buffs_type *_convert_buffs;
     size_t _convert_buffer_offset_bytes;
     vrt::if_packet_info_t *_convert_if_packet_info;
+    std::vector<size_t> _convert_commit_bytes;
+
+    //! Parallel conversion state
+    convert_worker_pool::sptr _convert_pool;
+    std::vector<shd::convert::converter::sptr> _chan_converters;
+    shd::convert::id_type _convert_id;
+    double _scale_factor;
 
 };
 
@@ -453,6 +575,8 @@ public:
     send_packet_streamer(const size_t max_num_samps){
         _max_num_samps = max_num_samps;
         this->set_max_samples_per_packet(_max_num_samps);
+        _metrics_export = stream_metrics_export::register_source(
+            "tx", boost::bind(&send_packet_streamer::get_metrics, this));
     }
 
     size_t get_num_channels(void) const{
@@ -478,8 +602,15 @@ public:
         return send_packet_handler::recv_async_msg(async_metadata, timeout);
     }
 
+    stream_metrics_t get_metrics(void) const
+    {
+        return send_packet_handler::get_metrics();
+    }
+
 private:
     size_t _max_num_samps;
+    //! Unregisters before the counters of the handler go away
+    stream_metrics_export::sptr _metrics_export;
 };
 
 } // namespace sph
@@ -0,0 +1,154 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_TRANSPORT_TX_FC_CREDITS_HPP
+#define INCLUDED_LIBSHD_TRANSPORT_TX_FC_CREDITS_HPP
+
+#include <shd/config.hpp>
+#include <shd/transport/spsc_ring.hpp>
+#include <shd/types/time_spec.hpp>
+#include <shd/utils/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+namespace shd{ namespace transport{
+
+/*!
+ * The TX flow control credit of one stream, shared by the thread that
+ * sends and the thread that reads the flow control responses.
+ *
+ * The device acks the sequence number of the last packet it consumed.
+ * The reader accumulates the acks into a count of consumed packets and
+ * publishes it with one atomic store. The sender compares it with its
+ * count of sent packets, so a send with credit never takes a lock.
+ * A sender out of credit spins for a short while, then yields, then
+ * blocks on the published count. The reader only makes a system call
+ * when a sender is blocked.
+ */
+class tx_fc_credits : boost::noncopyable{
+public:
+    /*!
+     * Create the credit for a window of packets.
+     * \param window the packets the device can buffer
+     * \param seq_mask the mask of the sequence numbers in the acks
+     */
+    tx_fc_credits(const size_t window, const uint32_t seq_mask):
+        _window(uint32_t(window)),
+        _seq_mask(seq_mask),
+        _num_sent(0),
+        _waiters(0),
+        _last_seq_ack(0),
+        _pending_acked(0),
+        _num_acked(0)
+    {
+        /* NOP */
+    }
+
+    /*******************************************************************
+     * Reader side
+     ******************************************************************/
+    //! Account for an ack, not visible to the sender before publish()
+    SHD_INLINE void ack(const uint32_t seq_ack){
+        _pending_acked += (seq_ack - _last_seq_ack) & _seq_mask;
+        _last_seq_ack = seq_ack;
+    }
+
+    //! Make the acks visible to the sender, wake it when it is blocked
+    SHD_INLINE void publish(void){
+        BOOST_IPC_DETAIL::atomic_write32(&_num_acked, _pending_acked);
+        if (BOOST_IPC_DETAIL::atomic_read32(&_waiters) != 0){
+            spsc_ring_detail::wake(&_num_acked);
+        }
+    }
+
+    /*******************************************************************
+     * Sender side
+     ******************************************************************/
+    //! Get the number of packets that can be sent right now
+    SHD_INLINE size_t get_credit(void){
+        return _window - (_num_sent - BOOST_IPC_DETAIL::atomic_read32(&_num_acked));
+    }
+
+    /*!
+     * Wait until a packet can be sent.
+     * \param timeout the maximum time to block in seconds
+     * \return false when there is no credit after the timeout
+     */
+    SHD_INLINE bool wait(const double timeout){
+        if (this->get_credit() != 0) return true;
+        return this->wait_for_ack(timeout);
+    }
+
+    //! Take the credit of a packet that will be sent
+    SHD_INLINE void consume(void){
+        _num_sent++;
+    }
+
+private:
+    //! Polls of the published count before yielding
+    static const size_t SPIN_ITERATIONS = 1024;
+    //! Yields before blocking
+    static const size_t YIELD_ITERATIONS = 16;
+
+    bool wait_for_ack(const double timeout){
+        for (size_t i = 0; i < SPIN_ITERATIONS; i++){
+            if (this->get_credit() != 0) return true;
+        }
+        if (timeout <= 0.0) return false;
+
+        const time_spec_t exit_time = time_spec_t::get_system_time() + time_spec_t(timeout);
+        for (size_t i = 0; i < YIELD_ITERATIONS; i++){
+            boost::this_thread::yield();
+            if (this->get_credit() != 0) return true;
+        }
+
+        while (true){
+            //announce the waiter before the last check,
+            //the reader publishes before it checks the waiters
+            BOOST_IPC_DETAIL::atomic_inc32(&_waiters);
+            const uint32_t seen = BOOST_IPC_DETAIL::atomic_read32(&_num_acked);
+            const double remaining = (exit_time - time_spec_t::get_system_time()).get_real_secs();
+            if (this->get_credit() != 0 or remaining <= 0.0){
+                BOOST_IPC_DETAIL::atomic_dec32(&_waiters);
+                return this->get_credit() != 0;
+            }
+            spsc_ring_detail::wait(&_num_acked, seen, remaining);
+            BOOST_IPC_DETAIL::atomic_dec32(&_waiters);
+        }
+    }
+
+    const uint32_t _window;
+    const uint32_t _seq_mask;
+
+    //keep the sender's and the reader's state on separate cache lines
+    char _pad0[64];
+
+    //written by the sender
+    uint32_t _num_sent;
+    volatile uint32_t _waiters;
+    char _pad1[64];
+
+    //written by the reader
+    uint32_t _last_seq_ack;
+    uint32_t _pending_acked;
+    volatile uint32_t _num_acked;
+    char _pad2[64];
+};
+
+}} //namespace shd::transport
+
+#endif /* INCLUDED_LIBSHD_TRANSPORT_TX_FC_CREDITS_HPP */
@@ -0,0 +1,356 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "udp_tpacket_ring.hpp"
+#include <shd/exception.hpp>
+#include <shd/utils/log.hpp>
+#include <shd/utils/atomic.hpp>
+#include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/scoped_array.hpp>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+using namespace shd;
+using namespace shd::transport;
+
+static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+static const size_t DEFAULT_NUM_BLOCKS = 32;
+static const unsigned DEFAULT_BLOCK_TIMEOUT_MS = 1;
+static const size_t UDP_HEADER_LEN = 8;
+
+static std::string errno_str(const std::string &what){
+    return str(boost::format("%s: %s") % what % strerror(errno));
+}
+
+/***********************************************************************
+ * Find the interface that owns a local IPv4 address,
+ * returns 0 (any interface) when there is no match
+ **********************************************************************/
+static int get_ifindex_for_addr(const in_addr &addr){
+    struct ifaddrs *ifap = NULL;
+    if (getifaddrs(&ifap) != 0) return 0;
+    int ifindex = 0;
+    for (struct ifaddrs *ifa = ifap; ifa != NULL; ifa = ifa->ifa_next){
+        if (ifa->ifa_addr == NULL or ifa->ifa_addr->sa_family != AF_INET) continue;
+        const sockaddr_in *sin = reinterpret_cast<const sockaddr_in *>(ifa->ifa_addr);
+        if (sin->sin_addr.s_addr != addr.s_addr) continue;
+        ifindex = int(if_nametoindex(ifa->ifa_name));
+        break;
+    }
+    freeifaddrs(ifap);
+    return ifindex;
+}
+
+class udp_tpacket_ring_impl;
+
+/***********************************************************************
+ * Reusable managed receiver buffer:
+ *  - points at a datagram inside a ring block
+ *  - releasing it drops one reference on the block
+ **********************************************************************/
+class udp_tpacket_mrb : public managed_recv_buffer{
+public:
+    udp_tpacket_mrb(udp_tpacket_ring_impl *ring):
+        _ring(ring), _block(0) { /*NOP*/ }
+
+    void release(void);
+
+    SHD_INLINE bool claim(const double timeout){
+        return _claimer.claim_with_wait(timeout);
+    }
+
+    SHD_INLINE void unclaim(void){
+        _claimer.release();
+    }
+
+    SHD_INLINE sptr get_new(const size_t block, void *mem, const size_t len){
+        _block = block;
+        return make(this, mem, len);
+    }
+
+private:
+    udp_tpacket_ring_impl *_ring;
+    size_t _block;
+    simple_claimer _claimer;
+};
+
+/***********************************************************************
+ * TPACKET_V3 ring implementation:
+ *   Blocks are walked in ring order. While the walker is inside a block
+ *   it holds one reference on it, and every buffer handed out holds
+ *   another one. The block is returned when the count drops to zero.
+ **********************************************************************/
+class udp_tpacket_ring_impl : public udp_tpacket_ring{
+public:
+    udp_tpacket_ring_impl(int sock_fd, const size_t num_frames, const device_addr_t &hints):
+        _block_size(size_t(hints.cast<double>("recv_ring_block_size", DEFAULT_BLOCK_SIZE))),
+        _num_blocks(size_t(hints.cast<double>("recv_ring_num_blocks", DEFAULT_NUM_BLOCKS))),
+        _fd(-1), _ring(NULL),
+        _blocks(new atomic_uint32_t[_num_blocks]),
+        _cur_block(0), _block_open(false), _pkts_left(0), _cur_pkt(NULL),
+        _next_mrb_index(0), _num_syscalls(0)
+    {
+        //the ring carries the datagrams for the socket's remote and local endpoints
+        sockaddr_in local_addr, remote_addr;
+        socklen_t addr_len = sizeof(local_addr);
+        if (getsockname(sock_fd, reinterpret_cast<sockaddr *>(&local_addr), &addr_len) != 0){
+            throw shd::os_error(errno_str("tpacket ring getsockname"));
+        }
+        addr_len = sizeof(remote_addr);
+        if (getpeername(sock_fd, reinterpret_cast<sockaddr *>(&remote_addr), &addr_len) != 0){
+            throw shd::os_error(errno_str("tpacket ring getpeername"));
+        }
+
+        _fd = ::socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+        if (_fd < 0){
+            throw shd::os_error(errno_str("tpacket ring packet socket (requires CAP_NET_RAW)"));
+        }
+
+        try{
+            this->setup_filter(remote_addr, local_addr);
+            this->setup_ring(unsigned(hints.cast<double>("recv_ring_block_timeout", DEFAULT_BLOCK_TIMEOUT_MS)));
+            this->bind_to_iface(local_addr);
+        }
+        catch(...){
+            this->teardown();
+            throw;
+        }
+
+        //from now on the datagrams arrive through the ring only
+        static sock_filter drop_all[] = {
+            BPF_STMT(BPF_RET | BPF_K, 0),
+        };
+        static const sock_fprog drop_all_prog = {1, drop_all};
+        if (setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &drop_all_prog, sizeof(drop_all_prog)) != 0){
+            this->teardown();
+            throw shd::os_error(errno_str("tpacket ring SO_ATTACH_FILTER on udp socket"));
+        }
+
+        for (size_t i = 0; i < num_frames; i++){
+            _mrb_pool.push_back(boost::make_shared<udp_tpacket_mrb>(this));
+        }
+
+        SHD_LOG << boost::format("Created tpacket ring: %d blocks of %d bytes")
+            % _num_blocks % _block_size << std::endl;
+    }
+
+    ~udp_tpacket_ring_impl(void){
+        this->teardown();
+    }
+
+    managed_recv_buffer::sptr get_recv_buff(const double timeout){
+        if (_next_mrb_index == _mrb_pool.size()) _next_mrb_index = 0;
+        udp_tpacket_mrb *mrb = _mrb_pool[_next_mrb_index].get();
+        if (not mrb->claim(timeout)) return managed_recv_buffer::sptr();
+
+        bool waited = false;
+        while (true){
+            if (not _block_open){
+                tpacket_block_desc *desc = this->get_block_desc(_cur_block);
+                if ((desc->hdr.bh1.block_status & TP_STATUS_USER) == 0){
+                    if (waited or not this->wait_for_block(timeout)) break;
+                    waited = true;
+                    continue;
+                }
+                __sync_synchronize(); //read the block after its status
+                _blocks[_cur_block].write(1); //the walker's reference
+                _block_open = true;
+                _pkts_left = desc->hdr.bh1.num_pkts;
+                _cur_pkt = reinterpret_cast<uint8_t *>(desc) + desc->hdr.bh1.offset_to_first_pkt;
+            }
+
+            if (_pkts_left == 0){
+                this->close_block();
+                continue;
+            }
+
+            const tpacket3_hdr *hdr = reinterpret_cast<const tpacket3_hdr *>(_cur_pkt);
+            _cur_pkt += hdr->tp_next_offset;
+            _pkts_left--;
+
+            //on loopback, the ring also sees our peer's outgoing copy
+            const sockaddr_ll *ll = reinterpret_cast<const sockaddr_ll *>(
+                reinterpret_cast<const uint8_t *>(hdr) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            if (ll->sll_pkttype == PACKET_OUTGOING) continue;
+
+            //the filter only passes unfragmented UDP, skip the headers
+            uint8_t *ip = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(hdr)) + hdr->tp_net;
+            const size_t ip_hdr_len = size_t(ip[0] & 0xf)*4;
+            if (hdr->tp_snaplen < ip_hdr_len + UDP_HEADER_LEN) continue;
+            uint16_t udp_len;
+            std::memcpy(&udp_len, ip + ip_hdr_len + 4, sizeof(udp_len));
+            const size_t payload_len = std::min<size_t>(
+                ntohs(udp_len), hdr->tp_snaplen - ip_hdr_len) - UDP_HEADER_LEN;
+
+            _blocks[_cur_block].inc();
+            _next_mrb_index++;
+            return mrb->get_new(_cur_block, ip + ip_hdr_len + UDP_HEADER_LEN, payload_len);
+        }
+
+        mrb->unclaim(); //undo claim
+        return managed_recv_buffer::sptr(); //null for timeout
+    }
+
+    uint64_t get_num_syscalls(void) const{
+        return _num_syscalls;
+    }
+
+    //! Drop one reference on a block, returns it to the kernel on the last
+    SHD_INLINE void put_block(const size_t block){
+        if (_blocks[block].dec() != 1) return;
+        __sync_synchronize(); //finish reading the block before giving it back
+        this->get_block_desc(block)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    }
+
+private:
+    SHD_INLINE tpacket_block_desc *get_block_desc(const size_t block){
+        return reinterpret_cast<tpacket_block_desc *>(_ring + block*_block_size);
+    }
+
+    SHD_INLINE void close_block(void){
+        _block_open = false;
+        this->put_block(_cur_block);
+        if (++_cur_block == _num_blocks) _cur_block = 0;
+    }
+
+    bool wait_for_block(const double timeout){
+        pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        _num_syscalls++;
+        return ::poll(&pfd, 1, int(std::ceil(timeout*1000))) > 0;
+    }
+
+    /*******************************************************************
+     * Classic BPF program on the IP header (SOCK_DGRAM has no link
+     * header): accept unfragmented UDP from the remote endpoint to
+     * the local port, drop everything else.
+     ******************************************************************/
+    void setup_filter(const sockaddr_in &remote_addr, const sockaddr_in &local_addr){
+        sock_filter code[] = {
+            BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 9),               //protocol
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 10),
+            BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, 12),              //source address
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(remote_addr.sin_addr.s_addr), 0, 8),
+            BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 6),               //flags and fragment offset
+            BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 6, 0),
+            BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, 0),               //X = IP header length
+            BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 0),               //UDP source port
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(remote_addr.sin_port), 0, 3),
+            BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 2),               //UDP destination port
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(local_addr.sin_port), 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, 0xffffffff),                  //accept
+            BPF_STMT(BPF_RET | BPF_K, 0),                           //drop
+        };
+        sock_fprog prog;
+        prog.len = sizeof(code)/sizeof(code[0]);
+        prog.filter = code;
+        if (setsockopt(_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0){
+            throw shd::os_error(errno_str("tpacket ring SO_ATTACH_FILTER"));
+        }
+    }
+
+    void setup_ring(const unsigned block_timeout_ms){
+        int version = TPACKET_V3;
+        if (setsockopt(_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0){
+            throw shd::os_error(errno_str("tpacket ring PACKET_VERSION"));
+        }
+
+        //the frame size only matters to the kernel's bookkeeping in V3
+        static const size_t frame_size = 2048;
+        tpacket_req3 req;
+        std::memset(&req, 0, sizeof(req));
+        req.tp_block_size = unsigned(_block_size);
+        req.tp_block_nr = unsigned(_num_blocks);
+        req.tp_frame_size = unsigned(frame_size);
+        req.tp_frame_nr = unsigned((_block_size/frame_size)*_num_blocks);
+        req.tp_retire_blk_tov = block_timeout_ms;
+        if (setsockopt(_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0){
+            throw shd::os_error(errno_str(str(boost::format(
+                "tpacket ring PACKET_RX_RING (%d blocks of %d bytes)") % _num_blocks % _block_size)));
+        }
+
+        void *ring = ::mmap(NULL, _block_size*_num_blocks,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, 0);
+        if (ring == MAP_FAILED){
+            throw shd::os_error(errno_str("tpacket ring mmap"));
+        }
+        _ring = static_cast<uint8_t *>(ring);
+    }
+
+    void bind_to_iface(const sockaddr_in &local_addr){
+        sockaddr_ll ll;
+        std::memset(&ll, 0, sizeof(ll));
+        ll.sll_family = AF_PACKET;
+        ll.sll_protocol = htons(ETH_P_IP);
+        ll.sll_ifindex = get_ifindex_for_addr(local_addr.sin_addr);
+        if (::bind(_fd, reinterpret_cast<sockaddr *>(&ll), sizeof(ll)) != 0){
+            throw shd::os_error(errno_str("tpacket ring bind"));
+        }
+    }
+
+    void teardown(void){
+        if (_ring != NULL) ::munmap(_ring, _block_size*_num_blocks);
+        _ring = NULL;
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1;
+    }
+
+    const size_t _block_size, _num_blocks;
+    int _fd;
+    uint8_t *_ring;
+    boost::scoped_array<atomic_uint32_t> _blocks;
+
+    //walker state -> only touched by get_recv_buff
+    size_t _cur_block;
+    bool _block_open;
+    size_t _pkts_left;
+    uint8_t *_cur_pkt;
+
+    std::vector<boost::shared_ptr<udp_tpacket_mrb> > _mrb_pool;
+    size_t _next_mrb_index;
+    uint64_t _num_syscalls;
+};
+
+void udp_tpacket_mrb::release(void){
+    _ring->put_block(_block);
+    _claimer.release();
+}
+
+/***********************************************************************
+ * tpacket ring make function
+ **********************************************************************/
+udp_tpacket_ring::sptr udp_tpacket_ring::make(
+    int sock_fd, const size_t num_frames, const device_addr_t &hints
+){
+    return udp_tpacket_ring::sptr(new udp_tpacket_ring_impl(sock_fd, num_frames, hints));
+}
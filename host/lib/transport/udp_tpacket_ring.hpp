@@ -0,0 +1,78 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_TRANSPORT_UDP_TPACKET_RING_HPP
+#define INCLUDED_LIBSHD_TRANSPORT_UDP_TPACKET_RING_HPP
+
+#include <shd/config.hpp>
+#include <shd/transport/zero_copy.hpp>
+#include <shd/types/device_addr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <stdint.h>
+
+namespace shd{ namespace transport{
+
+/*!
+ * A receive path for a connected UDP socket built on a Linux
+ * AF_PACKET TPACKET_V3 ring:
+ *
+ * The kernel writes the datagrams for the socket into memory mapped
+ * ring blocks. The managed receive buffers point straight at the UDP
+ * payload inside a block, so nothing is copied to user space.
+ * A block goes back to the kernel once every frame in it was released.
+ *
+ * The ring only sees datagrams that are not IP fragmented, so the link
+ * MTU must be large enough for the receive frame size.
+ * Opening a packet socket requires the CAP_NET_RAW capability.
+ */
+class udp_tpacket_ring : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<udp_tpacket_ring> sptr;
+
+    virtual ~udp_tpacket_ring(void) {}
+
+    /*!
+     * Make a new ring for the datagrams of a connected UDP socket.
+     * The socket's own receive path is disabled with a socket filter.
+     *
+     * Recognized hints:
+     *  - recv_ring_block_size: bytes per ring block (default 1 MiB)
+     *  - recv_ring_num_blocks: number of ring blocks (default 32)
+     *  - recv_ring_block_timeout: block retire timeout in ms (default 1)
+     *
+     * \param sock_fd the connected UDP socket
+     * \param num_frames the number of buffers that can be out at once
+     * \param hints ring configuration
+     * \throws shd::os_error if the ring could not be created
+     */
+    static sptr make(int sock_fd, const size_t num_frames, const device_addr_t &hints);
+
+    /*!
+     * Get the next datagram in the ring.
+     * \param timeout the timeout in seconds
+     * \return a buffer pointing into the ring, or null on timeout
+     */
+    virtual managed_recv_buffer::sptr get_recv_buff(const double timeout) = 0;
+
+    //! Get the number of system calls spent waiting for ring blocks
+    virtual uint64_t get_num_syscalls(void) const = 0;
+};
+
+}} //namespace
+
+#endif /* INCLUDED_LIBSHD_TRANSPORT_UDP_TPACKET_RING_HPP */
@@ -191,7 +191,8 @@ public:
         _num_send_frames(xport_params.num_send_frames),
         _recv_buffer_pool(buffer_pool::make(xport_params.num_recv_frames, xport_params.recv_frame_size)),
         _send_buffer_pool(buffer_pool::make(xport_params.num_send_frames, xport_params.send_frame_size)),
-        _next_recv_buff_index(0), _next_send_buff_index(0)
+        _next_recv_buff_index(0), _next_send_buff_index(0),
+        _num_recv_frames_total(0)
     {
         #ifdef CHECK_REG_SEND_THRESH
         check_registry_for_fast_send_threshold(this->get_send_frame_size());
@@ -258,12 +259,22 @@ public:
      ******************************************************************/
     managed_recv_buffer::sptr get_recv_buff(double timeout){
         if (_next_recv_buff_index == _num_recv_frames) _next_recv_buff_index = 0;
-        return _mrb_pool[_next_recv_buff_index]->get_new(timeout, _next_recv_buff_index);
+        managed_recv_buffer::sptr mrb = _mrb_pool[_next_recv_buff_index]->get_new(timeout, _next_recv_buff_index);
+        if (mrb) _num_recv_frames_total++;
+        return mrb;
     }
 
     size_t get_num_recv_frames(void) const {return _num_recv_frames;}
     size_t get_recv_frame_size(void) const {return _recv_frame_size;}
 
+    //overlapped IO posts one WSARecv() per frame, batching does not apply
+    recv_stats_t get_recv_stats(void) const{
+        recv_stats_t stats;
+        stats.num_frames = _num_recv_frames_total;
+        stats.num_syscalls = _num_recv_frames_total;
+        return stats;
+    }
+
     /*******************************************************************
      * Send implementation:
      * Block on the managed buffer's get call and advance the index.
@@ -276,6 +287,11 @@ public:
     size_t get_num_send_frames(void) const {return _num_send_frames;}
     size_t get_send_frame_size(void) const {return _send_frame_size;}
 
+    //overlapped IO sends every frame on commit, nothing is queued
+    void flush_send_buffs(void){
+        /* NOP */
+    }
+
     //! Read back the socket's buffer space reserved for receives
     size_t get_recv_buff_size(void) {
         int recv_buff_size = 0;
@@ -314,6 +330,7 @@ private:
     std::vector<boost::shared_ptr<udp_zero_copy_asio_msb> > _msb_pool;
     std::vector<boost::shared_ptr<udp_zero_copy_asio_mrb> > _mrb_pool;
     size_t _next_recv_buff_index, _next_send_buff_index;
+    uint64_t _num_recv_frames_total;
 
     //socket guts
     SOCKET                  _sock_fd;
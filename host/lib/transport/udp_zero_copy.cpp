@@ -22,10 +22,20 @@
 #include <shd/utils/msg.hpp>
 #include <shd/utils/log.hpp>
 #include <shd/utils/atomic.hpp>
+#include <shd/utils/safe_call.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/thread.hpp> //sleep
+#include <algorithm>
+#include <cstring>
 #include <vector>
+#if defined(HAVE_RECVMMSG) or defined(HAVE_SENDMMSG)
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_TPACKET_V3
+#include "udp_tpacket_ring.hpp"
+#endif
 
 using namespace shd;
 using namespace shd::transport;
@@ -64,11 +74,12 @@ static void check_registry_for_fast_send_threshold(const size_t mtu){
 /***********************************************************************
  * Reusable managed receiver buffer:
  *  - get_new performs the recv operation
+ *  - claim/get_filled are used by the batched receive path
  **********************************************************************/
 class udp_zero_copy_asio_mrb : public managed_recv_buffer{
 public:
-    udp_zero_copy_asio_mrb(void *mem, int sock_fd, const size_t frame_size):
-        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size), _len(0) { /*NOP*/ }
+    udp_zero_copy_asio_mrb(void *mem, int sock_fd, const size_t frame_size, uint64_t &num_syscalls):
+        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size), _len(0), _num_syscalls(num_syscalls) { /*NOP*/ }
 
     void release(void){
         _claimer.release();
@@ -78,6 +89,7 @@ public:
         if (not _claimer.claim_with_wait(timeout)) return sptr();
 
         #ifdef MSG_DONTWAIT //try a non-blocking recv() if supported
+        _num_syscalls++;
         _len = ::recv(_sock_fd, (char *)_mem, _frame_size, MSG_DONTWAIT);
         if (_len > 0){
             index++; //advances the caller's buffer
@@ -86,6 +98,7 @@ public:
         #endif
 
         if (wait_for_recv_ready(_sock_fd, timeout)){
+            _num_syscalls++;
             _len = ::recv(_sock_fd, (char *)_mem, _frame_size, 0);
             if (_len == 0)
                 throw shd::io_error("socket closed");
@@ -99,44 +112,41 @@ public:
         return sptr(); //null for timeout
     }
 
+    SHD_INLINE bool claim(const double timeout){
+        return _claimer.claim_with_wait(timeout);
+    }
+
+    SHD_INLINE void unclaim(void){
+        _claimer.release();
+    }
+
+    //! Hand out a claimed frame that was filled by the caller
+    SHD_INLINE sptr get_filled(const size_t len){
+        return make(this, _mem, len);
+    }
+
 private:
     void *_mem;
     int _sock_fd;
     size_t _frame_size;
     ssize_t _len;
+    uint64_t &_num_syscalls;
     simple_claimer _claimer;
 };
 
 /***********************************************************************
  * Reusable managed send buffer:
  *  - commit performs the send operation
+ *  - with a send batch, commit queues the frame for a later sendmmsg()
  **********************************************************************/
+class udp_zero_copy_send_batch;
+
 class udp_zero_copy_asio_msb : public managed_send_buffer{
 public:
-    udp_zero_copy_asio_msb(void *mem, int sock_fd, const size_t frame_size):
-        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size) { /*NOP*/ }
+    udp_zero_copy_asio_msb(void *mem, int sock_fd, const size_t frame_size, udp_zero_copy_send_batch *batch):
+        _mem(mem), _sock_fd(sock_fd), _frame_size(frame_size), _batch(batch) { /*NOP*/ }
 
-    void release(void){
-        //Retry logic because send may fail with ENOBUFS.
-        //This is known to occur at least on some OSX systems.
-        //But it should be safe to always check for the error.
-        while (true)
-        {
-            const ssize_t ret = ::send(_sock_fd, (const char *)_mem, size(), 0);
-            if (ret == ssize_t(size())) break;
-            if (ret == -1 and errno == ENOBUFS)
-            {
-                boost::this_thread::sleep(boost::posix_time::microseconds(1));
-                continue; //try to send again
-            }
-            if (ret == -1)
-            {
-                throw shd::io_error(str(boost::format("send error on socket: %s") % strerror(errno)));
-            }
-            SHD_ASSERT_THROW(ret == ssize_t(size()));
-        }
-        _claimer.release();
-    }
+    void release(void);
 
     SHD_INLINE sptr get_new(const double timeout, size_t &index){
         if (not _claimer.claim_with_wait(timeout)) return sptr();
@@ -144,13 +154,122 @@ public:
         return make(this, _mem, _frame_size);
     }
 
+    //! Called by the send batch once the frame is on the wire
+    SHD_INLINE void unclaim(void){
+        _claimer.release();
+    }
+
 private:
     void *_mem;
     int _sock_fd;
     size_t _frame_size;
+    udp_zero_copy_send_batch *_batch;
     simple_claimer _claimer;
 };
 
+/***********************************************************************
+ * Send batch:
+ *  - committed frames keep their claim and are queued here
+ *  - the queue is sent with one sendmmsg() when it is full,
+ *    when the oldest frame has waited longer than the timeout,
+ *    or when the owner of the transport calls flush()
+ **********************************************************************/
+class udp_zero_copy_send_batch{
+public:
+    udp_zero_copy_send_batch(int sock_fd, const size_t batch_size, const double timeout):
+        _sock_fd(sock_fd), _batch_size(batch_size), _timeout(timeout)
+    {
+        #ifdef HAVE_SENDMMSG
+        _iovecs.resize(batch_size);
+        _msgs.resize(batch_size);
+        for (size_t i = 0; i < batch_size; i++){
+            std::memset(&_msgs[i], 0, sizeof(_msgs[i]));
+            _msgs[i].msg_hdr.msg_iov = &_iovecs[i];
+            _msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        #endif /*HAVE_SENDMMSG*/
+        _msbs.reserve(batch_size);
+    }
+
+    SHD_INLINE void push(udp_zero_copy_asio_msb *msb, const void *mem, const size_t len){
+        #ifdef HAVE_SENDMMSG
+        if (_msbs.empty() and _timeout > 0.0){
+            _deadline = time_spec_t::get_system_time() + time_spec_t(_timeout);
+        }
+        _iovecs[_msbs.size()].iov_base = const_cast<void *>(mem);
+        _iovecs[_msbs.size()].iov_len = len;
+        _msbs.push_back(msb);
+        if (_msbs.size() == _batch_size or
+            (_timeout > 0.0 and time_spec_t::get_system_time() > _deadline)
+        ) this->flush();
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+    void flush(void){
+        #ifdef HAVE_SENDMMSG
+        size_t num_sent = 0;
+        while (num_sent < _msbs.size()){
+            //Retry logic because send may fail with ENOBUFS.
+            //This is known to occur at least on some OSX systems.
+            //But it should be safe to always check for the error.
+            const int ret = ::sendmmsg(_sock_fd, &_msgs[num_sent], _msbs.size() - num_sent, 0);
+            if (ret > 0){
+                num_sent += size_t(ret);
+                continue;
+            }
+            if (ret == -1 and (errno == ENOBUFS or errno == EINTR))
+            {
+                boost::this_thread::sleep(boost::posix_time::microseconds(1));
+                continue; //try to send again
+            }
+            throw shd::io_error(str(boost::format("sendmmsg error on socket: %s") % strerror(errno)));
+        }
+        for (size_t i = 0; i < _msbs.size(); i++){
+            _msbs[i]->unclaim();
+        }
+        _msbs.clear();
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+private:
+    int _sock_fd;
+    const size_t _batch_size;
+    const double _timeout;
+    time_spec_t _deadline;
+    std::vector<udp_zero_copy_asio_msb *> _msbs;
+    #ifdef HAVE_SENDMMSG
+    std::vector<iovec> _iovecs;
+    std::vector<mmsghdr> _msgs;
+    #endif /*HAVE_SENDMMSG*/
+};
+
+void udp_zero_copy_asio_msb::release(void){
+    if (_batch != NULL){
+        _batch->push(this, _mem, size());
+        return; //the batch releases the claim once the frame is sent
+    }
+
+    //Retry logic because send may fail with ENOBUFS.
+    //This is known to occur at least on some OSX systems.
+    //But it should be safe to always check for the error.
+    while (true)
+    {
+        const ssize_t ret = ::send(_sock_fd, (const char *)_mem, size(), 0);
+        if (ret == ssize_t(size())) break;
+        if (ret == -1 and errno == ENOBUFS)
+        {
+            boost::this_thread::sleep(boost::posix_time::microseconds(1));
+            continue; //try to send again
+        }
+        if (ret == -1)
+        {
+            throw shd::io_error(str(boost::format("send error on socket: %s") % strerror(errno)));
+        }
+        SHD_ASSERT_THROW(ret == ssize_t(size()));
+    }
+    _claimer.release();
+}
+
 /***********************************************************************
  * Zero Copy UDP implementation with ASIO:
  *   This is the portable zero copy implementation for systems
@@ -165,15 +284,21 @@ public:
     udp_zero_copy_asio_impl(
         const std::string &addr,
         const std::string &port,
-        const zero_copy_xport_params& xport_params
+        const zero_copy_xport_params& xport_params,
+        const size_t recv_batch_size,
+        const size_t send_batch_size,
+        const double send_batch_timeout,
+        const device_addr_t &hints
     ):
         _recv_frame_size(xport_params.recv_frame_size),
         _num_recv_frames(xport_params.num_recv_frames),
         _send_frame_size(xport_params.send_frame_size),
         _num_send_frames(xport_params.num_send_frames),
+        _recv_batch_size(std::max<size_t>(std::min(recv_batch_size, xport_params.num_recv_frames), 1)),
         _recv_buffer_pool(buffer_pool::make(xport_params.num_recv_frames, xport_params.recv_frame_size)),
         _send_buffer_pool(buffer_pool::make(xport_params.num_send_frames, xport_params.send_frame_size)),
-        _next_recv_buff_index(0), _next_send_buff_index(0)
+        _next_recv_buff_index(0), _next_send_buff_index(0),
+        _num_recv_ready(0), _num_recv_frames_total(0), _num_recv_syscalls(0)
     {
         SHD_LOG << boost::format("Creating udp transport for %s %s") % addr % port << std::endl;
 
@@ -190,23 +315,73 @@ public:
         _socket = socket_sptr(new asio::ip::udp::socket(_io_service));
         _socket->open(asio::ip::udp::v4());
         _socket->connect(receiver_endpoint);
-        _sock_fd = _socket->native();
+        _sock_fd = _socket->native_handle();
 
         //allocate re-usable managed receive buffers
         for (size_t i = 0; i < get_num_recv_frames(); i++){
             _mrb_pool.push_back(boost::make_shared<udp_zero_copy_asio_mrb>(
-                _recv_buffer_pool->at(i), _sock_fd, get_recv_frame_size()
+                _recv_buffer_pool->at(i), _sock_fd, get_recv_frame_size(), _num_recv_syscalls
             ));
         }
 
+        //optionally receive through a memory mapped packet ring
+        if (hints.get("recv_xport", "") == "tpacket"){
+            #ifdef HAVE_TPACKET_V3
+            try{
+                _recv_ring = udp_tpacket_ring::make(_sock_fd, get_num_recv_frames(), hints);
+            }
+            catch(const shd::exception &e){
+                SHD_MSG(warning) << "Cannot create the tpacket receive ring, "
+                    "falling back to socket receive:\n" << e.what() << std::endl;
+            }
+            #else
+            SHD_MSG(warning) << "recv_xport=tpacket is not supported on this platform, "
+                "falling back to socket receive" << std::endl;
+            #endif /*HAVE_TPACKET_V3*/
+        }
+
+        //one message header per frame, so a batch starting at any
+        //frame index can be handed to recvmmsg() without setup
+        #ifdef HAVE_RECVMMSG
+        _recv_iovecs.resize(get_num_recv_frames());
+        _recv_msgs.resize(get_num_recv_frames());
+        for (size_t i = 0; i < get_num_recv_frames(); i++){
+            _recv_iovecs[i].iov_base = _recv_buffer_pool->at(i);
+            _recv_iovecs[i].iov_len = get_recv_frame_size();
+            std::memset(&_recv_msgs[i], 0, sizeof(_recv_msgs[i]));
+            _recv_msgs[i].msg_hdr.msg_iov = &_recv_iovecs[i];
+            _recv_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        #else
+        if (_recv_batch_size > 1) SHD_MSG(warning)
+            << "recv_batch is not supported on this platform, receiving one frame per call" << std::endl;
+        _recv_batch_size = 1;
+        #endif /*HAVE_RECVMMSG*/
+
+        //create the send batch, the queue may hold every send frame
+        #ifdef HAVE_SENDMMSG
+        if (send_batch_size > 1){
+            _send_batch.reset(new udp_zero_copy_send_batch(
+                _sock_fd, std::min(send_batch_size, get_num_send_frames()), send_batch_timeout
+            ));
+        }
+        #else
+        if (send_batch_size > 1) SHD_MSG(warning)
+            << "send_batch is not supported on this platform, sending one frame per call" << std::endl;
+        #endif /*HAVE_SENDMMSG*/
+
         //allocate re-usable managed send buffers
         for (size_t i = 0; i < get_num_send_frames(); i++){
             _msb_pool.push_back(boost::make_shared<udp_zero_copy_asio_msb>(
-                _send_buffer_pool->at(i), _sock_fd, get_send_frame_size()
+                _send_buffer_pool->at(i), _sock_fd, get_send_frame_size(), _send_batch.get()
             ));
         }
     }
 
+    ~udp_zero_copy_asio_impl(void){
+        SHD_SAFE_CALL(this->flush_send_buffs();)
+    }
+
     //get size for internal socket buffer
     template <typename Opt> size_t get_buff_size(void) const{
         Opt option;
@@ -226,33 +401,135 @@ public:
      * Block on the managed buffer's get call and advance the index.
      ******************************************************************/
     managed_recv_buffer::sptr get_recv_buff(double timeout){
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring){
+            managed_recv_buffer::sptr mrb = _recv_ring->get_recv_buff(timeout);
+            if (mrb) _num_recv_frames_total++;
+            return mrb;
+        }
+        #endif /*HAVE_TPACKET_V3*/
         if (_next_recv_buff_index == _num_recv_frames) _next_recv_buff_index = 0;
-        return _mrb_pool[_next_recv_buff_index]->get_new(timeout, _next_recv_buff_index);
+        #ifdef HAVE_RECVMMSG
+        if (_recv_batch_size > 1) return get_recv_buff_batched(timeout);
+        #endif /*HAVE_RECVMMSG*/
+        managed_recv_buffer::sptr mrb = _mrb_pool[_next_recv_buff_index]->get_new(timeout, _next_recv_buff_index);
+        if (mrb) _num_recv_frames_total++;
+        return mrb;
     }
 
     size_t get_num_recv_frames(void) const {return _num_recv_frames;}
     size_t get_recv_frame_size(void) const {return _recv_frame_size;}
 
+    recv_stats_t get_recv_stats(void) const{
+        recv_stats_t stats;
+        stats.num_frames = _num_recv_frames_total;
+        stats.num_syscalls = _num_recv_syscalls;
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) stats.num_syscalls += _recv_ring->get_num_syscalls();
+        #endif /*HAVE_TPACKET_V3*/
+        return stats;
+    }
+
     /*******************************************************************
      * Send implementation:
      * Block on the managed buffer's get call and advance the index.
      ******************************************************************/
     managed_send_buffer::sptr get_send_buff(double timeout){
         if (_next_send_buff_index == _num_send_frames) _next_send_buff_index = 0;
+        if (_send_batch){
+            //a queued frame keeps its claim until it is sent,
+            //so flush the batch rather than waiting on it
+            managed_send_buffer::sptr msb = _msb_pool[_next_send_buff_index]->get_new(0.0, _next_send_buff_index);
+            if (msb) return msb;
+            _send_batch->flush();
+        }
         return _msb_pool[_next_send_buff_index]->get_new(timeout, _next_send_buff_index);
     }
 
     size_t get_num_send_frames(void) const {return _num_send_frames;}
     size_t get_send_frame_size(void) const {return _send_frame_size;}
 
+    void flush_send_buffs(void){
+        if (_send_batch) _send_batch->flush();
+    }
+
 private:
+    #ifdef HAVE_RECVMMSG
+    /*******************************************************************
+     * Batched receive implementation:
+     * Frames filled by the last recvmmsg() are handed out in order.
+     * Once they are used up, claim the next frame plus every free frame
+     * that directly follows it (up to the batch size, without wrapping)
+     * and fill as many of them as possible with a single recvmmsg().
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff_batched(const double timeout){
+        const size_t first = _next_recv_buff_index;
+        if (_num_recv_ready > 0){
+            _num_recv_ready--;
+            _next_recv_buff_index++;
+            _num_recv_frames_total++;
+            return _mrb_pool[first]->get_filled(_recv_msgs[first].msg_len);
+        }
+
+        if (not _mrb_pool[first]->claim(timeout)) return managed_recv_buffer::sptr();
+        const size_t max_claim = std::min(_recv_batch_size, _num_recv_frames - first);
+        size_t num_claimed = 1;
+        while (num_claimed < max_claim and _mrb_pool[first + num_claimed]->claim(0.0)){
+            num_claimed++;
+        }
+
+        int num_recvd = this->recv_batch(first, num_claimed);
+        if (num_recvd <= 0 and wait_for_recv_ready(_sock_fd, timeout)){
+            num_recvd = this->recv_batch(first, num_claimed);
+        }
+
+        //give back the frames that did not get filled
+        const size_t num_filled = (num_recvd > 0)? size_t(num_recvd) : 0;
+        for (size_t i = std::max<size_t>(num_filled, 1); i < num_claimed; i++){
+            _mrb_pool[first + i]->unclaim();
+        }
+        if (num_filled == 0){
+            _mrb_pool[first]->unclaim(); //undo claim
+            return managed_recv_buffer::sptr(); //null for timeout
+        }
+
+        _num_recv_ready = num_filled - 1;
+        _next_recv_buff_index++;
+        _num_recv_frames_total++;
+        return _mrb_pool[first]->get_filled(_recv_msgs[first].msg_len);
+    }
+
+    //! Non-blocking recvmmsg() into num frames starting at index first
+    SHD_INLINE int recv_batch(const size_t first, const size_t num){
+        _num_recv_syscalls++;
+        const int ret = ::recvmmsg(_sock_fd, &_recv_msgs[first], num, MSG_DONTWAIT, NULL);
+        if (ret < 0 and errno != EAGAIN and errno != EWOULDBLOCK and errno != EINTR){
+            throw shd::io_error(str(boost::format("recvmmsg error on socket: %s") % strerror(errno)));
+        }
+        return ret;
+    }
+    #endif /*HAVE_RECVMMSG*/
+
     //memory management -> buffers and fifos
     const size_t _recv_frame_size, _num_recv_frames;
     const size_t _send_frame_size, _num_send_frames;
+    size_t _recv_batch_size;
     buffer_pool::sptr _recv_buffer_pool, _send_buffer_pool;
     std::vector<boost::shared_ptr<udp_zero_copy_asio_msb> > _msb_pool;
     std::vector<boost::shared_ptr<udp_zero_copy_asio_mrb> > _mrb_pool;
     size_t _next_recv_buff_index, _next_send_buff_index;
+    boost::scoped_ptr<udp_zero_copy_send_batch> _send_batch;
+    #ifdef HAVE_TPACKET_V3
+    udp_tpacket_ring::sptr _recv_ring;
+    #endif /*HAVE_TPACKET_V3*/
+
+    //batched receive state -> frames filled but not yet handed out
+    size_t _num_recv_ready;
+    uint64_t _num_recv_frames_total, _num_recv_syscalls;
+    #ifdef HAVE_RECVMMSG
+    std::vector<iovec> _recv_iovecs;
+    std::vector<mmsghdr> _recv_msgs;
+    #endif /*HAVE_RECVMMSG*/
 
     //asio guts -> socket and service
     asio::io_service        _io_service;
@@ -308,6 +585,9 @@ udp_zero_copy::sptr udp_zero_copy::make(
     xport_params.num_recv_frames = size_t(hints.cast<double>("num_recv_frames", default_buff_args.num_recv_frames));
     xport_params.send_frame_size = size_t(hints.cast<double>("send_frame_size", default_buff_args.send_frame_size));
     xport_params.num_send_frames = size_t(hints.cast<double>("num_send_frames", default_buff_args.num_send_frames));
+    const size_t recv_batch_size = size_t(hints.cast<double>("recv_batch", 1));
+    const size_t send_batch_size = size_t(hints.cast<double>("send_batch", 1));
+    const double send_batch_timeout = hints.cast<double>("send_batch_timeout", 100e-6);
 
     //extract buffer size hints from the device addr
     size_t usr_recv_buff_size = size_t(hints.cast<double>("recv_buff_size", xport_params.num_recv_frames * MAX_ETHERNET_MTU));
@@ -330,7 +610,7 @@ udp_zero_copy::sptr udp_zero_copy::make(
     }
 
     udp_zero_copy_asio_impl::sptr udp_trans(
-        new udp_zero_copy_asio_impl(addr, port, xport_params)
+        new udp_zero_copy_asio_impl(addr, port, xport_params, recv_batch_size, send_batch_size, send_batch_timeout, hints)
     );
 
     //call the helper to resize send and recv buffers
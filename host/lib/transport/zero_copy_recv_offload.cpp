@@ -16,7 +16,7 @@
 //
 
 #include <shd/transport/zero_copy_recv_offload.hpp>
-#include <shd/transport/bounded_buffer.hpp>
+#include <shd/transport/spsc_ring.hpp>
 #include <shd/transport/buffer_pool.hpp>
 #include <shd/utils/msg.hpp>
 #include <shd/utils/log.hpp>
@@ -30,7 +30,8 @@
 using namespace shd;
 using namespace shd::transport;
 
-typedef bounded_buffer<managed_recv_buffer::sptr> bounded_buffer_t;
+//The receive thread is the only producer and the streamer the only consumer
+typedef spsc_ring<managed_recv_buffer::sptr> recv_ring_t;
 
 /***********************************************************************
  * Zero copy offload transport:
@@ -138,7 +139,7 @@ private:
     const double _timeout;
 
     // Shared buffers
-    bounded_buffer_t _inbox;
+    recv_ring_t _inbox;
 
     // Threading
     bool _recv_done;
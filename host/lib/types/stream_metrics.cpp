@@ -0,0 +1,70 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/types/stream_metrics.hpp>
+#include <boost/format.hpp>
+#include <sstream>
+
+using namespace shd;
+
+stream_metrics_t::xport_metrics_t::xport_metrics_t(void):
+    num_packets(0), num_bytes(0), num_seq_errors(0), num_fc_stalls(0),
+    num_fc_acks(0), num_queued_packets(0), max_queued_packets(0), wait_secs(0.0)
+{
+    /* NOP */
+}
+
+stream_metrics_t::stream_metrics_t(void):
+    num_calls(0), num_samps(0), num_timeouts(0), num_overflows(0),
+    num_underflows(0), num_seq_errors(0), num_late_cmds(0), num_fc_stalls(0),
+    convert_secs(0.0), wait_secs(0.0), latency_hist(NUM_LATENCY_BUCKETS, 0)
+{
+    /* NOP */
+}
+
+std::string stream_metrics_t::to_string(const std::string &name) const
+{
+    std::ostringstream ss;
+    ss << "{";
+    if (not name.empty()) ss << "\"name\":\"" << name << "\",";
+    ss << boost::format(
+        "\"num_calls\":%u,\"num_samps\":%u,\"num_timeouts\":%u,"
+        "\"num_overflows\":%u,\"num_underflows\":%u,\"num_seq_errors\":%u,"
+        "\"num_late_cmds\":%u,\"num_fc_stalls\":%u,"
+        "\"convert_secs\":%.6f,\"wait_secs\":%.6f,")
+        % num_calls % num_samps % num_timeouts
+        % num_overflows % num_underflows % num_seq_errors
+        % num_late_cmds % num_fc_stalls
+        % convert_secs % wait_secs;
+
+    ss << "\"latency_hist\":[";
+    for (size_t i = 0; i < latency_hist.size(); i++) {
+        ss << ((i == 0)? "" : ",") << latency_hist[i];
+    }
+    ss << "],\"xports\":[";
+    for (size_t i = 0; i < xports.size(); i++) {
+        ss << ((i == 0)? "" : ",") << boost::format(
+            "{\"num_packets\":%u,\"num_bytes\":%u,\"num_seq_errors\":%u,"
+            "\"num_fc_stalls\":%u,\"num_fc_acks\":%u,\"num_queued_packets\":%u,"
+            "\"max_queued_packets\":%u,\"wait_secs\":%.6f}")
+            % xports[i].num_packets % xports[i].num_bytes % xports[i].num_seq_errors
+            % xports[i].num_fc_stalls % xports[i].num_fc_acks % xports[i].num_queued_packets
+            % xports[i].max_queued_packets % xports[i].wait_secs;
+    }
+    ss << "]}";
+    return ss.str();
+}
@@ -45,6 +45,13 @@ uint32_t wb_iface::peek32(const wb_iface::wb_addr_type)
     throw shd::not_implemented_error("peek32 not implemented");
 }
 
+void wb_iface::poke32_batch(const wb_iface::poke32_list_type &writes)
+{
+    for (size_t i = 0; i < writes.size(); i++) {
+        this->poke32(writes[i].first, writes[i].second);
+    }
+}
+
 void wb_iface::poke16(const wb_iface::wb_addr_type, const uint16_t)
 {
     throw shd::not_implemented_error("poke16 not implemented");
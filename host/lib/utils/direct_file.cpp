@@ -0,0 +1,193 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "direct_file.hpp"
+#include <shd/exception.hpp>
+#include <boost/format.hpp>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+
+#ifdef HAVE_POSIX_FILE_IO
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+using namespace shd;
+
+static std::string errno_str(void)
+{
+    return std::strerror(errno);
+}
+
+#ifdef HAVE_POSIX_FILE_IO
+
+direct_file::direct_file(const std::string &path, const mode_t mode, const bool direct):
+    _path(path), _mode(mode), _direct(false), _size(0), _pos(0), _fd(-1), _file(NULL)
+{
+    const int flags = (mode == MODE_WRITE)? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+#ifdef HAVE_O_DIRECT
+    //file systems without direct I/O refuse the flag with EINVAL
+    if (direct) {
+        _fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        _direct = _fd >= 0;
+    }
+#endif
+    if (_fd < 0) _fd = ::open(path.c_str(), flags, 0644);
+    if (_fd < 0) {
+        throw shd::io_error(str(boost::format("cannot open %s: %s") % path % errno_str()));
+    }
+    if (mode == MODE_READ) {
+        struct stat st;
+        if (::fstat(_fd, &st) == 0) _size = uint64_t(st.st_size);
+#ifdef HAVE_O_DIRECT
+        if (not _direct) ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+}
+
+direct_file::~direct_file(void)
+{
+    if (_fd >= 0) ::close(_fd);
+}
+
+void direct_file::preallocate(const uint64_t num_bytes)
+{
+#ifdef HAVE_O_DIRECT
+    if (num_bytes > 0) ::posix_fallocate(_fd, 0, off_t(num_bytes));
+#else
+    (void)num_bytes;
+#endif
+}
+
+void direct_file::write(const char *buff, const size_t len)
+{
+    //direct I/O writes whole blocks, the padding is truncated on close
+    const size_t io_len = (_direct)? ((len + ALIGNMENT - 1)/ALIGNMENT)*ALIGNMENT : len;
+    size_t done = 0;
+    while (done < io_len) {
+        const ssize_t ret = ::pwrite(_fd, buff + done, io_len - done, off_t(_size + done));
+        if (ret < 0 and errno == EINTR) continue;
+#ifdef HAVE_O_DIRECT
+        //some file systems take the flag on open but not on write
+        if (ret < 0 and errno == EINVAL and _direct) {
+            ::fcntl(_fd, F_SETFL, ::fcntl(_fd, F_GETFL) & ~O_DIRECT);
+            _direct = false;
+            continue;
+        }
+#endif
+        if (ret <= 0) {
+            throw shd::io_error(str(boost::format("cannot write %s: %s") % _path % errno_str()));
+        }
+        done += size_t(ret);
+    }
+    _size += len;
+}
+
+size_t direct_file::read(char *buff, const size_t len)
+{
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t ret = ::pread(_fd, buff + done, len - done, off_t(_pos + done));
+        if (ret < 0 and errno == EINTR) continue;
+#ifdef HAVE_O_DIRECT
+        if (ret < 0 and errno == EINVAL and _direct) {
+            ::fcntl(_fd, F_SETFL, ::fcntl(_fd, F_GETFL) & ~O_DIRECT);
+            _direct = false;
+            continue;
+        }
+#endif
+        if (ret < 0) {
+            throw shd::io_error(str(boost::format("cannot read %s: %s") % _path % errno_str()));
+        }
+        if (ret == 0) break;
+        done += size_t(ret);
+    }
+    _pos += done;
+    return done;
+}
+
+void direct_file::close(void)
+{
+    if (_fd < 0) return;
+    const int ret = (_mode == MODE_WRITE)? ::ftruncate(_fd, off_t(_size)) : 0;
+    ::close(_fd);
+    _fd = -1;
+    if (ret != 0) {
+        throw shd::io_error(str(boost::format("cannot truncate %s: %s") % _path % errno_str()));
+    }
+}
+
+#else /* HAVE_POSIX_FILE_IO */
+
+direct_file::direct_file(const std::string &path, const mode_t mode, const bool):
+    _path(path), _mode(mode), _direct(false), _size(0), _pos(0), _fd(-1),
+    _file(std::fopen(path.c_str(), (mode == MODE_WRITE)? "wb" : "rb"))
+{
+    if (_file == NULL) {
+        throw shd::io_error(str(boost::format("cannot open %s: %s") % path % errno_str()));
+    }
+    if (mode == MODE_READ) {
+        std::FILE *file = static_cast<std::FILE *>(_file);
+        std::fseek(file, 0, SEEK_END);
+        _size = uint64_t(std::ftell(file));
+    }
+}
+
+direct_file::~direct_file(void)
+{
+    if (_file != NULL) std::fclose(static_cast<std::FILE *>(_file));
+}
+
+void direct_file::preallocate(const uint64_t)
+{
+    /* NOP */
+}
+
+void direct_file::write(const char *buff, const size_t len)
+{
+    if (std::fwrite(buff, 1, len, static_cast<std::FILE *>(_file)) != len) {
+        throw shd::io_error(str(boost::format("cannot write %s: %s") % _path % errno_str()));
+    }
+    _size += len;
+}
+
+size_t direct_file::read(char *buff, const size_t len)
+{
+    std::FILE *file = static_cast<std::FILE *>(_file);
+    std::fseek(file, long(_pos), SEEK_SET);
+    const size_t done = std::fread(buff, 1, len, file);
+    if (done < len and std::ferror(file)) {
+        throw shd::io_error(str(boost::format("cannot read %s: %s") % _path % errno_str()));
+    }
+    _pos += done;
+    return done;
+}
+
+void direct_file::close(void)
+{
+    if (_file == NULL) return;
+    const int ret = std::fclose(static_cast<std::FILE *>(_file));
+    _file = NULL;
+    if (ret != 0) {
+        throw shd::io_error(str(boost::format("cannot close %s: %s") % _path % errno_str()));
+    }
+}
+
+#endif /* HAVE_POSIX_FILE_IO */
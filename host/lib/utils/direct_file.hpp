@@ -0,0 +1,141 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_UTILS_DIRECT_FILE_HPP
+#define INCLUDED_LIBSHD_UTILS_DIRECT_FILE_HPP
+
+#include <shd/config.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace shd{
+
+/*!
+ * A file for streaming large amounts of samples to or from disk.
+ * Where the platform supports it, the file bypasses the page cache
+ * (O_DIRECT), so writing does not compete with the receive path for
+ * memory bandwidth and the kernel does not stall the writer to flush
+ * dirty pages. File systems without direct I/O (tmpfs) fall back to
+ * buffered I/O, with sequential read ahead for reading.
+ *
+ * With direct I/O, buffers must be aligned to ALIGNMENT and all but
+ * the last write or read must be a multiple of ALIGNMENT. The last
+ * write is padded and the file is truncated to its real size on close.
+ */
+class direct_file : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<direct_file> sptr;
+
+    //! Alignment of buffers and write lengths for direct I/O
+    static const size_t ALIGNMENT = 4096;
+
+    enum mode_t{
+        MODE_WRITE,
+        MODE_READ
+    };
+
+    /*!
+     * Open a file.
+     * \param path the path of the file
+     * \param mode create (or truncate) the file for writing or open it for reading
+     * \param direct try to bypass the page cache
+     * \throws shd::io_error when the file cannot be opened
+     */
+    direct_file(const std::string &path, const mode_t mode, const bool direct);
+
+    //! Closes the file
+    ~direct_file(void);
+
+    //! Does the file bypass the page cache?
+    bool is_direct(void) const{ return _direct; }
+
+    //! The number of bytes written so far, or the size of a file to read
+    uint64_t size(void) const{ return _size; }
+
+    /*!
+     * Reserve disk space up front, so the file system does not have to
+     * find blocks while streaming. A hint, errors are ignored.
+     * May be called while another thread writes.
+     * \param num_bytes the expected size of the whole file
+     */
+    void preallocate(const uint64_t num_bytes);
+
+    /*!
+     * Append to the file.
+     * \param buff the data, aligned to ALIGNMENT for direct I/O
+     * \param len the number of bytes, there must be ALIGNMENT - len % ALIGNMENT
+     *        bytes of (padding) space behind the data unless len is aligned
+     */
+    void write(const char *buff, const size_t len);
+
+    /*!
+     * Read on from the current position.
+     * \param buff the buffer, aligned to ALIGNMENT for direct I/O
+     * \param len the number of bytes, a multiple of ALIGNMENT for direct I/O
+     * \return the number of bytes read, less than len at the end of the file
+     */
+    size_t read(char *buff, const size_t len);
+
+    //! Read from the start of the file again
+    void rewind(void){ _pos = 0; }
+
+    //! Truncate to the written size and close
+    void close(void);
+
+    /*!
+     * A buffer aligned to ALIGNMENT, for use with direct I/O.
+     * The length is rounded up to a multiple of ALIGNMENT.
+     */
+    class aligned_buffer{
+    public:
+        aligned_buffer(const size_t len = 0){ resize(len); }
+        aligned_buffer(const aligned_buffer &other){ *this = other; }
+        aligned_buffer &operator=(const aligned_buffer &other){
+            resize(other._len);
+            std::copy(other._data, other._data + _len, _data);
+            return *this;
+        }
+        void resize(const size_t len){
+            _len = ((len + ALIGNMENT - 1)/ALIGNMENT)*ALIGNMENT;
+            _mem.assign(_len + ALIGNMENT, 0);
+            _data = &_mem.front() + (ALIGNMENT - (size_t(&_mem.front()) % ALIGNMENT)) % ALIGNMENT;
+        }
+        size_t size(void) const{ return _len; }
+        char *data(void){ return _data; }
+        const char *data(void) const{ return _data; }
+    private:
+        std::vector<char> _mem;
+        size_t _len;
+        char *_data;
+    };
+
+private:
+    const std::string _path;
+    const mode_t _mode;
+    bool _direct;
+    uint64_t _size, _pos;
+    int _fd;
+    void *_file;
+};
+
+} //namespace shd
+
+#endif /* INCLUDED_LIBSHD_UTILS_DIRECT_FILE_HPP */
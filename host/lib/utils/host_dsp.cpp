@@ -0,0 +1,325 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "host_dsp.hpp"
+#include <shd/exception.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX_TARGET_ATTRIBUTES
+#include <immintrin.h>
+#define SHD_TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#endif
+
+using namespace shd;
+using namespace shd::host_dsp;
+
+static const double PI = 3.14159265358979323846;
+
+/***********************************************************************
+ * Filter kernels:
+ * The dot product of an output with the taps of its phase and the
+ * deltas to the next phase, on interleaved I/Q samples. Each tap is
+ * stored twice, so I and Q are multiplied in the same lanes.
+ * The number of floats is a multiple of 16.
+ **********************************************************************/
+typedef void (*dot_type)(const float *, const float *, const float *, const size_t, const float, fc32_t &);
+
+static void dot_generic(
+    const float *x, const float *h, const float *d, const size_t n, const float mu, fc32_t &out
+){
+    float acc_h[2] = {0, 0}, acc_d[2] = {0, 0};
+    for (size_t i = 0; i < n; i += 2){
+        acc_h[0] += x[i]*h[i];
+        acc_h[1] += x[i+1]*h[i+1];
+        acc_d[0] += x[i]*d[i];
+        acc_d[1] += x[i+1]*d[i+1];
+    }
+    out = fc32_t(acc_h[0] + mu*acc_d[0], acc_h[1] + mu*acc_d[1]);
+}
+
+#ifdef __SSE2__
+static void dot_sse2(
+    const float *x, const float *h, const float *d, const size_t n, const float mu, fc32_t &out
+){
+    __m128 acc_h0 = _mm_setzero_ps(), acc_h1 = _mm_setzero_ps();
+    __m128 acc_d0 = _mm_setzero_ps(), acc_d1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8){
+        const __m128 x0 = _mm_loadu_ps(x + i);
+        const __m128 x1 = _mm_loadu_ps(x + i + 4);
+        acc_h0 = _mm_add_ps(acc_h0, _mm_mul_ps(x0, _mm_loadu_ps(h + i)));
+        acc_h1 = _mm_add_ps(acc_h1, _mm_mul_ps(x1, _mm_loadu_ps(h + i + 4)));
+        acc_d0 = _mm_add_ps(acc_d0, _mm_mul_ps(x0, _mm_loadu_ps(d + i)));
+        acc_d1 = _mm_add_ps(acc_d1, _mm_mul_ps(x1, _mm_loadu_ps(d + i + 4)));
+    }
+    //I0 Q0 I1 Q1 -> I Q
+    __m128 acc = _mm_add_ps(_mm_add_ps(acc_h0, acc_h1),
+        _mm_mul_ps(_mm_add_ps(acc_d0, acc_d1), _mm_set1_ps(mu)));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    _mm_storel_pi(reinterpret_cast<__m64 *>(&out), acc);
+}
+#endif /*__SSE2__*/
+
+#ifdef HAVE_AVX_TARGET_ATTRIBUTES
+SHD_TARGET_AVX2_FMA static void dot_avx2(
+    const float *x, const float *h, const float *d, const size_t n, const float mu, fc32_t &out
+){
+    __m256 acc_h0 = _mm256_setzero_ps(), acc_h1 = _mm256_setzero_ps();
+    __m256 acc_d0 = _mm256_setzero_ps(), acc_d1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 16){
+        const __m256 x0 = _mm256_loadu_ps(x + i);
+        const __m256 x1 = _mm256_loadu_ps(x + i + 8);
+        acc_h0 = _mm256_fmadd_ps(x0, _mm256_loadu_ps(h + i), acc_h0);
+        acc_h1 = _mm256_fmadd_ps(x1, _mm256_loadu_ps(h + i + 8), acc_h1);
+        acc_d0 = _mm256_fmadd_ps(x0, _mm256_loadu_ps(d + i), acc_d0);
+        acc_d1 = _mm256_fmadd_ps(x1, _mm256_loadu_ps(d + i + 8), acc_d1);
+    }
+    const __m256 acc8 = _mm256_fmadd_ps(_mm256_add_ps(acc_d0, acc_d1), _mm256_set1_ps(mu),
+        _mm256_add_ps(acc_h0, acc_h1));
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    _mm_storel_pi(reinterpret_cast<__m64 *>(&out), acc);
+}
+
+static bool cpu_has_avx2_fma(void){
+    __builtin_cpu_init(); //required when called from static initializers
+    return __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+}
+#endif /*HAVE_AVX_TARGET_ATTRIBUTES*/
+
+static dot_type get_dot(void){
+    #ifdef HAVE_AVX_TARGET_ATTRIBUTES
+    if (cpu_has_avx2_fma()) return &dot_avx2;
+    #endif
+    #ifdef __SSE2__
+    return &dot_sse2;
+    #else
+    return &dot_generic;
+    #endif
+}
+
+static const dot_type dot = get_dot();
+
+std::string host_dsp::get_simd_name(void){
+    #ifdef HAVE_AVX_TARGET_ATTRIBUTES
+    if (dot == &dot_avx2) return "avx2";
+    #endif
+    #ifdef __SSE2__
+    if (dot == &dot_sse2) return "sse2";
+    #endif
+    return "generic";
+}
+
+/***********************************************************************
+ * NCO
+ **********************************************************************/
+#ifdef __SSE2__
+//! Multiply two pairs of complex floats
+static SHD_INLINE __m128 cmul_sse2(const __m128 x, const __m128 y){
+    const __m128 y_re = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 y_im = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+    const __m128 x_swap = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m128 neg_re = _mm_castsi128_ps(_mm_setr_epi32(int(0x80000000), 0, int(0x80000000), 0));
+    return _mm_add_ps(_mm_mul_ps(x, y_re), _mm_xor_ps(_mm_mul_ps(x_swap, y_im), neg_re));
+}
+#endif /*__SSE2__*/
+
+//! Mix a block, starting from a phase in radians
+static void mix_block(fc32_t *samps, const size_t n, const double phase, const double step){
+    const fc32_t first(std::polar(1.0, phase));
+    #ifdef __SSE2__
+    const fc32_t second(std::polar(1.0, phase + step));
+    const fc32_t rot(std::polar(1.0, 2*step));
+    __m128 phasor = _mm_setr_ps(first.real(), first.imag(), second.real(), second.imag());
+    const __m128 rotation = _mm_setr_ps(rot.real(), rot.imag(), rot.real(), rot.imag());
+    float *x = reinterpret_cast<float *>(samps);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2){
+        _mm_storeu_ps(x + 2*i, cmul_sse2(_mm_loadu_ps(x + 2*i), phasor));
+        phasor = cmul_sse2(phasor, rotation);
+    }
+    if (i < n){
+        float last[4];
+        _mm_storeu_ps(last, phasor);
+        samps[i] *= fc32_t(last[0], last[1]);
+    }
+    #else
+    const fc32_t rot(std::polar(1.0, step));
+    fc32_t phasor = first;
+    for (size_t i = 0; i < n; i++){
+        samps[i] *= phasor;
+        phasor *= rot;
+    }
+    #endif /*__SSE2__*/
+}
+
+nco::nco(void):
+    _freq(0.0), _phase(0.0)
+{
+    /* NOP */
+}
+
+void nco::set_freq(const double freq){
+    _freq = freq - std::floor(freq);
+}
+
+void nco::reset(void){
+    _phase = 0.0;
+}
+
+void nco::mix(fc32_t *samps, const size_t num_samps){
+    static const size_t BLOCK_SIZE = 512;
+    for (size_t offset = 0; offset < num_samps; offset += BLOCK_SIZE){
+        const size_t n = std::min(BLOCK_SIZE, num_samps - offset);
+        mix_block(samps + offset, n, -2*PI*_phase, -2*PI*_freq);
+        _phase += n*_freq;
+        _phase -= std::floor(_phase);
+    }
+}
+
+/***********************************************************************
+ * Resampler
+ **********************************************************************/
+//! The taps of a filter for the narrowest of the two rates
+static const size_t BASE_NUM_TAPS = 48;
+//! The Kaiser window's beta, for about 75 dB of stopband attenuation
+static const double KAISER_BETA = 7.5;
+
+//! The modified Bessel function of order zero
+static double bessel_i0(const double x){
+    double sum = 1.0, term = 1.0;
+    for (size_t k = 1; k < 100 and term > 1e-12*sum; k++){
+        const double t = x/(2*k);
+        term *= t*t;
+        sum += term;
+    }
+    return sum;
+}
+
+resampler::resampler(const double ratio):
+    _ratio(ratio), _step(1.0/ratio), _size(0), _time(0.0)
+{
+    if (not (ratio >= 1.0/64 and ratio <= 64.0)){
+        throw shd::value_error(str(boost::format(
+            "host resampler: the rate ratio %f is not within 1/64 and 64") % ratio));
+    }
+
+    //a longer filter for a lower output rate, a multiple of 8 taps for the kernels
+    const double bandwidth = std::min(1.0, ratio);
+    _num_taps = size_t(std::ceil(BASE_NUM_TAPS/bandwidth/8))*8;
+    const double cutoff = 0.45*bandwidth; //cycles per input sample
+    const double half = _num_taps/2.0;
+
+    //tabulate the windowed sinc at each phase, one more phase for the deltas
+    std::vector<double> proto((NUM_PHASES+1)*_num_taps);
+    double sum = 0.0;
+    for (size_t p = 0; p <= NUM_PHASES; p++){
+        for (size_t k = 0; k < _num_taps; k++){
+            const double tau = double(p)/NUM_PHASES + half - 1 - k;
+            const double x = tau/half;
+            const double window = bessel_i0(KAISER_BETA*std::sqrt(std::max(0.0, 1 - x*x)))/bessel_i0(KAISER_BETA);
+            const double arg = 2*cutoff*tau;
+            const double sinc = (arg == 0.0)? 1.0 : std::sin(PI*arg)/(PI*arg);
+            proto[p*_num_taps + k] = sinc*window;
+            if (p < NUM_PHASES) sum += proto[p*_num_taps + k];
+        }
+    }
+
+    //unity gain at DC
+    const double scale = NUM_PHASES/sum;
+    _taps.resize(NUM_PHASES*2*_num_taps);
+    _deltas.resize(NUM_PHASES*2*_num_taps);
+    for (size_t p = 0; p < NUM_PHASES; p++){
+        for (size_t k = 0; k < _num_taps; k++){
+            const double tap = proto[p*_num_taps + k]*scale;
+            const double next = proto[(p+1)*_num_taps + k]*scale;
+            _taps[(p*_num_taps + k)*2] = _taps[(p*_num_taps + k)*2 + 1] = float(tap);
+            _deltas[(p*_num_taps + k)*2] = _deltas[(p*_num_taps + k)*2 + 1] = float(next - tap);
+        }
+    }
+
+    this->reset();
+}
+
+void resampler::reset(void){
+    //zeros before the first sample, so the first output is centered on it
+    _size = _num_taps/2 - 1;
+    _history.assign(std::max(_history.size(), _size), fc32_t(0, 0));
+    _time = double(_size);
+}
+
+fc32_t *resampler::prepare_input(const size_t num_samps){
+    if (_history.size() < _size + num_samps){
+        _history.resize(_size + num_samps);
+    }
+    return &_history[_size];
+}
+
+void resampler::commit_input(const size_t num_samps){
+    _size += num_samps;
+}
+
+void resampler::flush(void){
+    const size_t num_zeros = _num_taps/2;
+    std::fill_n(this->prepare_input(num_zeros), num_zeros, fc32_t(0, 0));
+    this->commit_input(num_zeros);
+}
+
+size_t resampler::get_num_ready(const size_t num_pending) const{
+    //the same steps as process(), so both agree on every output
+    const size_t size = _size + num_pending;
+    size_t num_ready = 0;
+    for (double time = _time; size_t(time) + _num_taps/2 + 1 <= size; time += _step){
+        num_ready++;
+    }
+    return num_ready;
+}
+
+size_t resampler::get_input_needed(const size_t num_out) const{
+    if (num_out == 0) return 0;
+    const size_t needed = size_t(_time + (num_out-1)*_step) + _num_taps/2 + 1;
+    return (needed > _size)? needed - _size : 1;
+}
+
+void resampler::process(fc32_t *out, const size_t num_out){
+    const size_t num_floats = 2*_num_taps;
+    const size_t first_offset = _num_taps/2 - 1;
+    for (size_t i = 0; i < num_out; i++){
+        const size_t index = size_t(_time);
+        const double phase_pos = (_time - index)*NUM_PHASES;
+        const size_t phase = size_t(phase_pos);
+        dot(
+            reinterpret_cast<const float *>(&_history[index - first_offset]),
+            &_taps[phase*num_floats], &_deltas[phase*num_floats],
+            num_floats, float(phase_pos - phase), out[i]
+        );
+        _time += _step;
+    }
+
+    //drop the history that no later output needs
+    const size_t num_drop = std::min(size_t(_time) - first_offset, _size);
+    if (num_drop != 0){
+        std::copy(_history.begin() + num_drop, _history.begin() + _size, _history.begin());
+        _size -= num_drop;
+        _time -= num_drop;
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBSHD_UTILS_HOST_DSP_HPP
+#define INCLUDED_LIBSHD_UTILS_HOST_DSP_HPP
+
+#include <shd/config.hpp>
+#include <boost/utility.hpp>
+#include <complex>
+#include <string>
+#include <vector>
+
+namespace shd{ namespace host_dsp{
+
+typedef std::complex<float> fc32_t;
+
+//! Get the name of the SIMD kernels in use ("avx2", "sse2" or "generic")
+std::string get_simd_name(void);
+
+/***********************************************************************
+ * Numerically controlled oscillator
+ *
+ * Mixes samples in place with a complex exponential. The phasor is
+ * rotated sample by sample in single precision and set again from the
+ * double precision phase every block, so the error does not build up.
+ **********************************************************************/
+class nco{
+public:
+    nco(void);
+
+    /*!
+     * Set the frequency to shift.
+     * \param freq the frequency in cycles per sample that moves to 0
+     */
+    void set_freq(const double freq);
+
+    //! Start again at phase 0
+    void reset(void);
+
+    //! Multiply the samples by exp(-j*2*pi*freq*n)
+    void mix(fc32_t *samps, const size_t num_samps);
+
+private:
+    double _freq;  //cycles per sample
+    double _phase; //cycles, in [0, 1)
+};
+
+/***********************************************************************
+ * Fractional polyphase resampler
+ *
+ * Makes output samples at any rate ratio from a windowed sinc filter
+ * tabulated at NUM_PHASES fractional delays. The taps of an output are
+ * interpolated linearly between the two nearest phases. The filter
+ * passes 40% of the lower of the two rates and stops from 50%.
+ *
+ * The input is written in place: prepare_input() returns room at the
+ * end of the history, commit_input() makes it part of the history.
+ * Output n is centered on input n/ratio, so the output starts with the
+ * first input sample and has no delay.
+ **********************************************************************/
+class resampler : boost::noncopyable{
+public:
+    //! The number of fractional delays the filter is tabulated at
+    static const size_t NUM_PHASES = 32;
+
+    /*!
+     * Make a resampler.
+     * \param ratio the output rate over the input rate
+     * \throws shd::value_error for a ratio out of the range 1/64 to 64
+     */
+    resampler(const double ratio);
+
+    //! Get the output rate over the input rate
+    double get_ratio(void) const{
+        return _ratio;
+    }
+
+    //! Get the number of input samples in the filter of an output
+    size_t get_num_taps(void) const{
+        return _num_taps;
+    }
+
+    //! Drop the history, the next input sample is the first
+    void reset(void);
+
+    //! Get room for num_samps input samples
+    fc32_t *prepare_input(const size_t num_samps);
+
+    //! Add the first num_samps samples of the room to the history
+    void commit_input(const size_t num_samps);
+
+    //! Add zeros so the outputs up to the last input can be made
+    void flush(void);
+
+    /*!
+     * Get the number of outputs the history is enough for.
+     * \param num_pending input samples that will be committed first
+     */
+    size_t get_num_ready(const size_t num_pending = 0) const;
+
+    //! Get the number of input samples needed for num_out more outputs
+    size_t get_input_needed(const size_t num_out) const;
+
+    //! Make num_out outputs, no more than get_num_ready()
+    void process(fc32_t *out, const size_t num_out);
+
+private:
+    const double _ratio;
+    const double _step; //input samples per output
+    size_t _num_taps;
+    std::vector<float> _taps;   //per phase, each tap twice for I and Q
+    std::vector<float> _deltas; //to the next phase's taps
+    std::vector<fc32_t> _history;
+    size_t _size; //samples in the history
+    double _time; //history index the next output is centered on
+};
+
+}} //namespace shd::host_dsp
+
+#endif /* INCLUDED_LIBSHD_UTILS_HOST_DSP_HPP */
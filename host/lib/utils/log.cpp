@@ -1,5 +1,5 @@
 //
-// Copyright 2012,2014,2016 Ettus Research LLC
+// Copyright 2012,2014,2016-2017 Ettus Research LLC
 //
 // This program is free software: you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
@@ -19,19 +19,85 @@
 #include <shd/utils/msg.hpp>
 #include <shd/utils/static.hpp>
 #include <shd/utils/paths.hpp>
+#include <shd/transport/spsc_ring.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <list>
+#include <vector>
 #include <cctype>
 
 namespace fs = boost::filesystem;
 namespace pt = boost::posix_time;
 namespace ip = boost::interprocess;
 
+//! Entries a thread can have queued before entries are dropped
+static const size_t LOG_QUEUE_SIZE = 1024;
+
+//! How often the logger thread looks for new entries
+static const long LOG_WRITE_PERIOD_MS = 50;
+
+/***********************************************************************
+ * A log entry, filled in at the call site, written by the logger thread
+ **********************************************************************/
+struct shd::_log::log_record{
+    pt::ptime time; //UTC, converted to local time by the logger thread
+    verbosity_t verbosity;
+    std::string file;
+    unsigned int line;
+    std::string function;
+    std::string message;
+};
+
+using shd::_log::log_record;
+
+static bool log_record_before(const log_record *lhs, const log_record *rhs){
+    return lhs->time < rhs->time;
+}
+
+//! The entries of one thread, only that thread pushes
+struct log_queue{
+    log_queue(void): ring(LOG_QUEUE_SIZE), orphaned(false){}
+    shd::transport::spsc_ring<log_record *> ring;
+    boost::atomic<bool> orphaned; //the thread has exited
+};
+
+typedef boost::shared_ptr<log_queue> log_queue_sptr;
+
+//! Called on thread exit, the logger thread drains and forgets the queue
+static void release_log_queue(log_queue_sptr *queue){
+    (*queue)->orphaned = true;
+    delete queue;
+}
+
+//! get the relative file path from the host directory
+static std::string get_rel_file_path(const fs::path &file){
+    fs::path abs_path = file.parent_path();
+    fs::path rel_path = file.leaf();
+    while (not abs_path.empty() and abs_path.leaf() != "host"){
+        rel_path = abs_path.leaf() / rel_path;
+        abs_path = abs_path.parent_path();
+    }
+    return rel_path.string();
+}
+
+static std::string format_time(const pt::ptime &utc){
+    return pt::to_simple_string(boost::date_time::c_local_adjustor<pt::ptime>::utc_to_local(utc));
+}
+
 /***********************************************************************
  * Global resources for the logger
  **********************************************************************/
@@ -39,7 +105,14 @@ class log_resource_type{
 public:
     shd::_log::verbosity_t level;
 
-    log_resource_type(void){
+    log_resource_type(void):
+        _queue(&release_log_queue),
+        _num_dropped(0),
+        _num_reported_dropped(0),
+        _flush_gen(0),
+        _done_gen(0),
+        _stopping(false)
+    {
 
         //file lock pointer must be null
         _file_lock = NULL;
@@ -58,21 +131,35 @@ public:
     }
 
     ~log_resource_type(void){
-        boost::lock_guard<boost::mutex> lock(_mutex);
+        {
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _stopping = true;
+            _wake_cond.notify_one();
+        }
+        if (_writer.joinable()) _writer.join();
         _file_stream.close();
         if (_file_lock != NULL) delete _file_lock;
+        level = shd::_log::never;
     }
 
-    void log_to_file(const std::string &log_msg){
-        boost::lock_guard<boost::mutex> lock(_mutex);
-        if (_file_lock == NULL){
-            const std::string log_path = (fs::path(shd::get_tmp_path()) / "shd.log").string();
-            _file_stream.open(log_path.c_str(), std::fstream::out | std::fstream::app);
-            _file_lock = new ip::file_lock(log_path.c_str());
+    //! Queue an entry for the logger thread, never blocks
+    void push(log_record *record){
+        if (not this->get_queue().ring.push_with_haste(record)){
+            delete record;
+            _num_dropped++;
         }
-        _file_lock->lock();
-        _file_stream << log_msg << std::flush;
-        _file_lock->unlock();
+    }
+
+    void flush(void){
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (not _writer.joinable()) return;
+        const size_t gen = ++_flush_gen;
+        _wake_cond.notify_one();
+        while (_done_gen < gen and not _stopping) _done_cond.wait(lock);
+    }
+
+    size_t get_num_dropped(void) const{
+        return _num_dropped;
     }
 
 private:
@@ -92,10 +179,123 @@ private:
         if_lls_equal(never);
     }
 
+    //! Get the queue of the calling thread, the first call registers it
+    log_queue &get_queue(void){
+        if (_queue.get() == NULL){
+            log_queue_sptr queue(new log_queue());
+            boost::lock_guard<boost::mutex> lock(_mutex);
+            _queues.push_back(queue);
+            if (not _writer.joinable() and not _stopping){
+                _writer = boost::thread(boost::bind(&log_resource_type::writer_loop, this));
+            }
+            _queue.reset(new log_queue_sptr(queue));
+        }
+        return **_queue;
+    }
+
+    void writer_loop(void){
+        std::vector<log_record *> batch;
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (true){
+            const size_t gen = _flush_gen;
+            const bool stopping = _stopping;
+            this->drain(batch);
+            lock.unlock();
+            this->write(batch);
+            lock.lock();
+            _done_gen = gen;
+            _done_cond.notify_all();
+            if (stopping) return;
+            if (_flush_gen == gen and not _stopping){
+                _wake_cond.timed_wait(lock, pt::milliseconds(LOG_WRITE_PERIOD_MS));
+            }
+        }
+    }
+
+    //! Pop the entries of all threads, called with the mutex held
+    void drain(std::vector<log_record *> &batch){
+        std::list<log_queue_sptr>::iterator it = _queues.begin();
+        while (it != _queues.end()){
+            //a thread may push right before it exits, check first
+            const bool orphaned = (*it)->orphaned;
+            log_record *record;
+            while ((*it)->ring.pop_with_haste(record)) batch.push_back(record);
+            if (orphaned) it = _queues.erase(it);
+            else ++it;
+        }
+    }
+
+    //! Write the entries in time order, with one lock and flush of the file
+    void write(std::vector<log_record *> &batch){
+        const size_t num_dropped = _num_dropped;
+        if (batch.empty() and num_dropped == _num_reported_dropped) return;
+        std::stable_sort(batch.begin(), batch.end(), &log_record_before);
+
+        std::ostringstream ss;
+        for (size_t i = 0; i < batch.size(); i++){
+            const log_record &record = *batch[i];
+            const std::string header1 = str(boost::format("-- %s - level %d") % format_time(record.time) % int(record.verbosity));
+            const std::string header2 = str(boost::format("-- %s") % record.function).substr(0, 80);
+            const std::string header3 = str(boost::format("-- %s:%u") % get_rel_file_path(record.file) % record.line);
+            const std::string border = std::string(std::max(std::max(header1.size(), header2.size()), header3.size()), '-');
+            ss  << std::endl
+                << border << std::endl
+                << header1 << std::endl
+                << header2 << std::endl
+                << header3 << std::endl
+                << border << std::endl
+                << record.message << std::endl
+            ;
+            delete batch[i];
+        }
+        batch.clear();
+        if (num_dropped != _num_reported_dropped){
+            ss  << std::endl << boost::format("-- %s - %u log entries dropped, the logger fell behind")
+                % format_time(pt::microsec_clock::universal_time()) % (num_dropped - _num_reported_dropped)
+                << std::endl;
+            _num_reported_dropped = num_dropped;
+        }
+        if (level == shd::_log::never) return; //logging failed before
+
+        try{
+            if (_file_lock == NULL){
+                const std::string log_path = (fs::path(shd::get_tmp_path()) / "shd.log").string();
+                _file_stream.open(log_path.c_str(), std::fstream::out | std::fstream::app);
+                _file_lock = new ip::file_lock(log_path.c_str());
+            }
+            _file_lock->lock();
+            _file_stream << ss.str() << std::flush;
+            _file_lock->unlock();
+        }
+        catch(const std::exception &e){
+            /*!
+             * Critical behavior below.
+             * The following steps must happen in order to avoid a lock-up condition.
+             * This is because the message facility will call into the logging facility.
+             * Therefore we must disable the logger (level = never) before messaging.
+             */
+            level = shd::_log::never;
+            SHD_MSG(error)
+                << "Logging failed: " << e.what() << std::endl
+                << "Logging has been disabled for this process" << std::endl
+            ;
+        }
+    }
+
+    //thread queues and the logger thread:
+    boost::thread_specific_ptr<log_queue_sptr> _queue;
+    std::list<log_queue_sptr> _queues;
+    boost::atomic<size_t> _num_dropped;
+    size_t _num_reported_dropped;
+    boost::mutex _mutex;
+    boost::condition_variable _wake_cond, _done_cond;
+    size_t _flush_gen, _done_gen;
+    bool _stopping;
+    boost::thread _writer;
+
     //file stream and lock:
     std::ofstream _file_stream;
     ip::file_lock *_file_lock;
-    boost::mutex _mutex;
 };
 
 SHD_SINGLETON_FCN(log_resource_type, log_rs);
@@ -103,40 +303,24 @@ SHD_SINGLETON_FCN(log_resource_type, log_rs);
 /***********************************************************************
  * The logger object implementation
  **********************************************************************/
-//! get the relative file path from the host directory
-static std::string get_rel_file_path(const fs::path &file){
-    fs::path abs_path = file.parent_path();
-    fs::path rel_path = file.leaf();
-    while (not abs_path.empty() and abs_path.leaf() != "host"){
-        rel_path = abs_path.leaf() / rel_path;
-        abs_path = abs_path.parent_path();
-    }
-    return rel_path.string();
-}
-
-
 shd::_log::log::log(
     const verbosity_t verbosity,
     const std::string &file,
     const unsigned int line,
     const std::string &function
-    )
+    ):
+    _record(NULL)
 {
     _log_it = (verbosity >= log_rs().level);
     if (_log_it)
     {
-        const std::string time = pt::to_simple_string(pt::microsec_clock::local_time());
-        const std::string header1 = str(boost::format("-- %s - level %d") % time % int(verbosity));
-        const std::string header2 = str(boost::format("-- %s") % function).substr(0, 80);
-        const std::string header3 = str(boost::format("-- %s:%u") % get_rel_file_path(file) % line);
-        const std::string border = std::string(std::max(std::max(header1.size(), header2.size()), header3.size()), '-');
-        _ss << std::endl
-            << border << std::endl
-            << header1 << std::endl
-            << header2 << std::endl
-            << header3 << std::endl
-            << border << std::endl
-        ;
+        //the rest of the header is formatted by the logger thread
+        _record = new log_record();
+        _record->time = pt::microsec_clock::universal_time();
+        _record->verbosity = verbosity;
+        _record->file = file;
+        _record->line = line;
+        _record->function = function;
     }
 }
 
@@ -145,21 +329,19 @@ shd::_log::log::~log(void)
     if (not _log_it)
         return;
 
-    _ss << std::endl;
     try{
-        log_rs().log_to_file(_ss.str());
+        _record->message = _ss.str();
+        log_rs().push(_record);
     }
-    catch(const std::exception &e){
-        /*!
-         * Critical behavior below.
-         * The following steps must happen in order to avoid a lock-up condition.
-         * This is because the message facility will call into the logging facility.
-         * Therefore we must disable the logger (level = never) before messaging.
-         */
-        log_rs().level = never;
-        SHD_MSG(error)
-            << "Logging failed: " << e.what() << std::endl
-            << "Logging has been disabled for this process" << std::endl
-        ;
+    catch(const std::exception &){
+        delete _record;
     }
 }
+
+void shd::_log::flush(void){
+    log_rs().flush();
+}
+
+size_t shd::_log::get_num_dropped(void){
+    return log_rs().get_num_dropped();
+}
@@ -0,0 +1,308 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "host_dsp.hpp"
+#include "../transport/convert_worker_pool.hpp"
+#include <shd/utils/rx_host_dsp.hpp>
+#include <shd/exception.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace shd;
+using namespace shd::host_dsp;
+
+//! The most input samples per channel pulled from the streamer at once
+static const size_t MAX_INPUT_CHUNK = 1 << 16;
+
+rx_host_dsp::~rx_host_dsp(void)
+{
+    /* NOP */
+}
+
+bool rx_host_dsp::is_requested(const stream_args_t &args)
+{
+    return args.args.has_key("host_rate") or args.args.has_key("host_freq");
+}
+
+std::string rx_host_dsp::get_simd_name(void)
+{
+    return host_dsp::get_simd_name();
+}
+
+/***********************************************************************
+ * Host DSP implementation
+ *
+ * recv() makes what the buffered input allows, then pulls more input
+ * into the resamplers' histories in place and repeats. The channels
+ * are mixed, committed and resampled by one task per channel.
+ **********************************************************************/
+class rx_host_dsp_impl : public rx_host_dsp{
+public:
+    rx_host_dsp_impl(rx_streamer::sptr rx_stream, const stream_args_t &args, const double rate):
+        _rx_stream(rx_stream),
+        _in_rate(rate),
+        _out_rate(args.args.cast<double>("host_rate", rate)),
+        _num_chans(rx_stream->get_num_channels()),
+        _task_buffs(_num_chans),
+        _task_offset(0),
+        _task_num_in(0),
+        _task_num_out(0),
+        _queued_error(false),
+        _burst_samps(0)
+    {
+        if (args.cpu_format != "fc32") {
+            throw shd::value_error(str(boost::format(
+                "host DSP: the cpu format must be fc32, not %s") % args.cpu_format));
+        }
+        if (not (rate > 0.0) or not (_out_rate > 0.0)) {
+            throw shd::value_error(str(boost::format(
+                "host DSP: bad rates %f to %f") % rate % _out_rate));
+        }
+
+        const double freq = args.args.cast<double>("host_freq", 0.0);
+        if (freq != 0.0) {
+            _ncos.resize(_num_chans);
+            for (size_t i = 0; i < _num_chans; i++) _ncos[i].set_freq(freq/rate);
+        }
+        if (_out_rate != rate) {
+            for (size_t i = 0; i < _num_chans; i++) {
+                _resamplers.push_back(boost::make_shared<resampler>(_out_rate/rate));
+            }
+        }
+
+        _pool = transport::sph::convert_worker_pool::make(
+            args.args, _num_chans, boost::bind(&rx_host_dsp_impl::run_chan, this, _1), "dsp");
+        this->reset();
+    }
+
+    size_t get_num_channels(void) const
+    {
+        return _num_chans;
+    }
+
+    size_t get_max_num_samps(void) const
+    {
+        const size_t max_num_samps = _rx_stream->get_max_num_samps();
+        if (_resamplers.empty()) return max_num_samps;
+        return std::max<size_t>(1, size_t(max_num_samps*_resamplers[0]->get_ratio()));
+    }
+
+    double get_rate(void) const
+    {
+        return _out_rate;
+    }
+
+    size_t get_num_taps(void) const
+    {
+        return _resamplers.empty()? 0 : _resamplers[0]->get_num_taps();
+    }
+
+    stream_metrics_t get_metrics(void) const
+    {
+        return _rx_stream->get_metrics();
+    }
+
+    void issue_stream_cmd(const stream_cmd_t &stream_cmd)
+    {
+        stream_cmd_t cmd = stream_cmd;
+        _burst_samps = 0;
+        if (not _resamplers.empty() and cmd.stream_mode != stream_cmd_t::STREAM_MODE_START_CONTINUOUS
+            and cmd.stream_mode != stream_cmd_t::STREAM_MODE_STOP_CONTINUOUS) {
+            //ask for the input samples that make the outputs
+            cmd.num_samps = size_t(std::ceil(cmd.num_samps/_resamplers[0]->get_ratio()));
+            _burst_samps = stream_cmd.num_samps;
+        }
+        _rx_stream->issue_stream_cmd(cmd);
+    }
+
+    size_t recv(
+        const buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        rx_metadata_t &metadata,
+        const double timeout,
+        const bool one_packet
+    ){
+        if (_resamplers.empty()) return this->recv_mixed(buffs, nsamps_per_buff, metadata, timeout, one_packet);
+
+        metadata.reset();
+        if (_queued_error) {
+            _queued_error = false;
+            metadata = _queued_metadata;
+            return 0;
+        }
+
+        size_t num_out = 0;
+        while (true) {
+            //make what the buffered input allows
+            size_t num_ready = std::min(_resamplers[0]->get_num_ready(), nsamps_per_buff - num_out);
+            if (_flushing and _burst_samps != 0) {
+                num_ready = std::min<size_t>(num_ready, _burst_samps - std::min(_burst_samps, _num_out));
+            }
+            if (num_ready != 0) {
+                if (num_out == 0) this->set_output_metadata(metadata);
+                for (size_t i = 0; i < _num_chans; i++) _task_buffs[i] = buffs[i];
+                _task_offset = num_out;
+                _task_num_out = num_ready;
+                this->run_tasks();
+                num_out += num_ready;
+                _num_out += num_ready;
+            }
+
+            //the burst ends once the flushed history is made
+            if (_flushing and (num_ready == 0 or _resamplers[0]->get_num_ready() == 0)) {
+                metadata.end_of_burst = true;
+                this->reset();
+                break;
+            }
+            if (num_out == nsamps_per_buff or (one_packet and num_out != 0)) break;
+
+            //pull more input into the histories
+            const size_t num_needed = std::min(
+                _resamplers[0]->get_input_needed(nsamps_per_buff - num_out), MAX_INPUT_CHUNK);
+            std::vector<void *> in_buffs(_num_chans);
+            for (size_t i = 0; i < _num_chans; i++) {
+                in_buffs[i] = _resamplers[i]->prepare_input(num_needed);
+            }
+            rx_metadata_t in_md;
+            const size_t num_in = _rx_stream->recv(in_buffs, num_needed, in_md, timeout, one_packet);
+            if (num_in != 0) {
+                if (_num_in == 0) {
+                    _has_time_spec = in_md.has_time_spec;
+                    _time_spec = in_md.time_spec;
+                    _start_of_burst = in_md.start_of_burst;
+                }
+                _num_in += num_in;
+                for (size_t i = 0; i < _num_chans; i++) _task_buffs[i] = in_buffs[i];
+                _task_num_in = num_in;
+                this->run_tasks();
+            }
+
+            if (in_md.end_of_burst) {
+                for (size_t i = 0; i < _num_chans; i++) _resamplers[i]->flush();
+                _flushing = true;
+                continue;
+            }
+            if (in_md.error_code != rx_metadata_t::ERROR_CODE_NONE) {
+                //anything but a timeout breaks the continuity of the samples
+                if (in_md.error_code != rx_metadata_t::ERROR_CODE_TIMEOUT) this->reset();
+                if (num_out == 0) {
+                    metadata = in_md;
+                }
+                else if (in_md.error_code != rx_metadata_t::ERROR_CODE_TIMEOUT) {
+                    _queued_error = true;
+                    _queued_metadata = in_md;
+                }
+                break;
+            }
+            if (num_in == 0) break;
+        }
+        return num_out;
+    }
+
+private:
+    //! Without resampling, mix the samples in the user's buffers
+    size_t recv_mixed(
+        const buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        rx_metadata_t &metadata,
+        const double timeout,
+        const bool one_packet
+    ){
+        const size_t num_samps = _rx_stream->recv(buffs, nsamps_per_buff, metadata, timeout, one_packet);
+        if (num_samps != 0) {
+            for (size_t i = 0; i < _num_chans; i++) _task_buffs[i] = buffs[i];
+            _task_num_in = num_samps;
+            this->run_tasks();
+        }
+        return num_samps;
+    }
+
+    void set_output_metadata(rx_metadata_t &metadata)
+    {
+        metadata.has_time_spec = _has_time_spec;
+        metadata.time_spec = _time_spec + time_spec_t::from_ticks(_num_out, _out_rate);
+        metadata.start_of_burst = _start_of_burst and _num_out == 0;
+    }
+
+    //! Run the task of each channel, then clear the work
+    void run_tasks(void)
+    {
+        if (_pool) _pool->run(_num_chans);
+        else for (size_t i = 0; i < _num_chans; i++) this->run_chan(i);
+        _task_num_in = 0;
+        _task_num_out = 0;
+    }
+
+    void run_chan(const size_t chan)
+    {
+        if (_task_num_in != 0) {
+            fc32_t *samps = static_cast<fc32_t *>(_task_buffs[chan]);
+            if (not _ncos.empty()) _ncos[chan].mix(samps, _task_num_in);
+            if (not _resamplers.empty()) _resamplers[chan]->commit_input(_task_num_in);
+        }
+        if (_task_num_out != 0) {
+            _resamplers[chan]->process(static_cast<fc32_t *>(_task_buffs[chan]) + _task_offset, _task_num_out);
+        }
+    }
+
+    //! Start the filters and the NCOs over with the next input sample
+    void reset(void)
+    {
+        for (size_t i = 0; i < _resamplers.size(); i++) _resamplers[i]->reset();
+        for (size_t i = 0; i < _ncos.size(); i++) _ncos[i].reset();
+        _num_in = 0;
+        _num_out = 0;
+        _flushing = false;
+        _has_time_spec = false;
+        _start_of_burst = false;
+    }
+
+    rx_streamer::sptr _rx_stream;
+    const double _in_rate, _out_rate;
+    const size_t _num_chans;
+    std::vector<nco> _ncos;
+    std::vector<boost::shared_ptr<resampler> > _resamplers;
+    transport::sph::convert_worker_pool::sptr _pool;
+
+    //work for the tasks
+    std::vector<void *> _task_buffs;
+    size_t _task_offset, _task_num_in, _task_num_out;
+
+    //state since the last reset
+    uint64_t _num_in, _num_out;
+    bool _flushing;
+    bool _has_time_spec, _start_of_burst;
+    time_spec_t _time_spec;
+
+    bool _queued_error;
+    rx_metadata_t _queued_metadata;
+    size_t _burst_samps;
+};
+
+/***********************************************************************
+ * The factory function
+ **********************************************************************/
+rx_host_dsp::sptr rx_host_dsp::make(
+    rx_streamer::sptr rx_stream,
+    const stream_args_t &args,
+    const double rate
+){
+    return sptr(new rx_host_dsp_impl(rx_stream, args, rate));
+}
@@ -0,0 +1,296 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "direct_file.hpp"
+#include <shd/utils/rx_recorder.hpp>
+#include <shd/utils/safe_call.hpp>
+#include <shd/transport/spsc_ring.hpp>
+#include <shd/convert.hpp>
+#include <shd/exception.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/chrono.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+
+using namespace shd;
+using namespace shd::transport;
+
+static const size_t DEFAULT_BUFF_SIZE = 4*1024*1024;
+static const size_t DEFAULT_NUM_BUFFS = 8;
+static const size_t NO_BLOCK = ~size_t(0);
+
+static double secs_since(const boost::chrono::steady_clock::time_point &start)
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+}
+
+rx_recorder::stats_t::stats_t(void):
+    num_samps(0), num_bytes_written(0), num_overflows(0), num_errors(0),
+    num_stalls(0), stall_secs(0.0), write_secs(0.0), direct_io(false)
+{
+    /* NOP */
+}
+
+rx_recorder::~rx_recorder(void)
+{
+    /* NOP */
+}
+
+/***********************************************************************
+ * Recorder implementation
+ **********************************************************************/
+class rx_recorder_impl : public rx_recorder{
+public:
+    rx_recorder_impl(
+        rx_streamer::sptr rx_stream,
+        const std::string &cpu_format,
+        const std::vector<std::string> &files,
+        const device_addr_t &args
+    ):
+        _rx_stream(rx_stream),
+        _bytes_per_samp(convert::get_bytes_per_item(cpu_format)),
+        _num_buffs(std::max<size_t>(2, args.cast<size_t>("num_buffs", DEFAULT_NUM_BUFFS))),
+        _free_ring(_num_buffs),
+        _full_ring(_num_buffs),
+        _cur(NO_BLOCK),
+        _stop(false),
+        _done(false),
+        _closed(false)
+    {
+        if (files.size() != _rx_stream->get_num_channels()) {
+            throw shd::value_error(str(boost::format(
+                "rx_recorder: %u files for %u channels") % files.size() % _rx_stream->get_num_channels()));
+        }
+
+        //whole buffers are written, so they hold a multiple of the alignment
+        const size_t buff_size = args.cast<size_t>("buff_size", DEFAULT_BUFF_SIZE);
+        const size_t align = direct_file::ALIGNMENT*_bytes_per_samp;
+        _buff_samps = std::max<size_t>(1, buff_size/align)*align/_bytes_per_samp;
+
+        const bool direct = args.cast<int>("direct", 1) != 0;
+        for (size_t i = 0; i < files.size(); i++) {
+            _files.push_back(direct_file::sptr(new direct_file(files[i], direct_file::MODE_WRITE, direct)));
+        }
+
+        _blocks.resize(_num_buffs);
+        for (size_t i = 0; i < _num_buffs; i++) {
+            _blocks[i].nsamps = 0;
+            _blocks[i].chans.resize(files.size());
+            for (size_t ch = 0; ch < files.size(); ch++) {
+                _blocks[i].chans[ch].resize(_buff_samps*_bytes_per_samp);
+            }
+            _free_ring.push_with_haste(i);
+        }
+        _buffs.resize(files.size());
+        _stats.direct_io = this->all_direct();
+
+        _writer = boost::thread(boost::bind(&rx_recorder_impl::writer_loop, this));
+    }
+
+    ~rx_recorder_impl(void)
+    {
+        SHD_SAFE_CALL(this->close();)
+    }
+
+    uint64_t record(const uint64_t num_samps, const double timeout)
+    {
+        if (_closed) throw shd::runtime_error("rx_recorder: record() after close()");
+        this->check_write_error();
+        _stop = false;
+
+        //reserve the space for what is already recorded and what is to come
+        if (num_samps != 0) {
+            const uint64_t total_samps = this->get_stats().num_samps + num_samps;
+            for (size_t ch = 0; ch < _files.size(); ch++) {
+                _files[ch]->preallocate(total_samps*_bytes_per_samp);
+            }
+        }
+
+        uint64_t recorded = 0, reported = 0;
+        while (not _stop and (num_samps == 0 or recorded < num_samps)) {
+            if (_cur == NO_BLOCK and not this->get_free_block()) break;
+            block_t &block = _blocks[_cur];
+
+            size_t nsamps = _buff_samps - block.nsamps;
+            if (num_samps != 0) nsamps = size_t(std::min<uint64_t>(nsamps, num_samps - recorded));
+            for (size_t ch = 0; ch < _buffs.size(); ch++) {
+                _buffs[ch] = block.chans[ch].data() + block.nsamps*_bytes_per_samp;
+            }
+            rx_metadata_t md;
+            const size_t got = _rx_stream->recv(_buffs, nsamps, md, timeout);
+            block.nsamps += got;
+            recorded += got;
+
+            if (block.nsamps == _buff_samps) {
+                _full_ring.push_with_wait(_cur);
+                _cur = NO_BLOCK;
+                this->check_write_error();
+                boost::mutex::scoped_lock lock(_stats_mutex);
+                _stats.num_samps += recorded - reported;
+                reported = recorded;
+            }
+
+            if (md.error_code == rx_metadata_t::ERROR_CODE_NONE) continue;
+            if (md.error_code == rx_metadata_t::ERROR_CODE_TIMEOUT) break;
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            if (md.error_code == rx_metadata_t::ERROR_CODE_OVERFLOW) {
+                _stats.num_overflows++;
+                continue;
+            }
+            _stats.num_errors++;
+            break;
+        }
+
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        _stats.num_samps += recorded - reported;
+        return recorded;
+    }
+
+    void stop(void)
+    {
+        _stop = true;
+    }
+
+    void close(void)
+    {
+        if (_closed) return;
+        _closed = true;
+
+        //the last buffer is partial
+        if (_cur != NO_BLOCK and _blocks[_cur].nsamps != 0) {
+            _full_ring.push_with_wait(_cur);
+        }
+        _cur = NO_BLOCK;
+        _done = true;
+        _writer.join();
+
+        for (size_t ch = 0; ch < _files.size(); ch++) {
+            _files[ch]->close();
+        }
+        this->check_write_error();
+    }
+
+    stats_t get_stats(void)
+    {
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        return _stats;
+    }
+
+private:
+    struct block_t{
+        std::vector<direct_file::aligned_buffer> chans;
+        size_t nsamps;
+    };
+
+    //! Get an empty buffer, wait for the writer if there is none
+    bool get_free_block(void)
+    {
+        if (not _free_ring.pop_with_haste(_cur)) {
+            const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+            while (not _free_ring.pop_with_timed_wait(_cur, 0.1)) {
+                this->check_write_error();
+                if (_stop) {
+                    _cur = NO_BLOCK;
+                    return false;
+                }
+            }
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            _stats.num_stalls++;
+            _stats.stall_secs += secs_since(start);
+        }
+        _blocks[_cur].nsamps = 0;
+        return true;
+    }
+
+    void writer_loop(void)
+    {
+        while (true) {
+            size_t index;
+            if (not _full_ring.pop_with_timed_wait(index, 0.1)) {
+                //close() pushes the last buffer before it sets done
+                if (_done and not _full_ring.pop_with_haste(index)) return;
+                if (not _done) continue;
+            }
+            this->write_block(_blocks[index]);
+            _free_ring.push_with_wait(index);
+        }
+    }
+
+    void write_block(block_t &block)
+    {
+        if (_write_error) return; //keep the buffers moving after an error
+        const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+        try {
+            for (size_t ch = 0; ch < _files.size(); ch++) {
+                _files[ch]->write(block.chans[ch].data(), block.nsamps*_bytes_per_samp);
+            }
+        }
+        catch(const shd::exception &e) {
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            _write_error.reset(e.dynamic_clone());
+            return;
+        }
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        _stats.write_secs += secs_since(start);
+        _stats.num_bytes_written += block.nsamps*_bytes_per_samp*_files.size();
+        _stats.direct_io = this->all_direct();
+    }
+
+    void check_write_error(void)
+    {
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        if (_write_error) _write_error->dynamic_throw();
+    }
+
+    bool all_direct(void) const
+    {
+        for (size_t ch = 0; ch < _files.size(); ch++) {
+            if (not _files[ch]->is_direct()) return false;
+        }
+        return true;
+    }
+
+    rx_streamer::sptr _rx_stream;
+    const size_t _bytes_per_samp;
+    const size_t _num_buffs;
+    size_t _buff_samps;
+    std::vector<direct_file::sptr> _files;
+    std::vector<block_t> _blocks;
+    spsc_ring<size_t> _free_ring, _full_ring;
+    std::vector<void *> _buffs;
+    size_t _cur; //the buffer being received into
+    volatile bool _stop, _done;
+    bool _closed;
+    boost::mutex _stats_mutex;
+    stats_t _stats;
+    boost::shared_ptr<shd::exception> _write_error;
+    boost::thread _writer;
+};
+
+/***********************************************************************
+ * Recorder factory
+ **********************************************************************/
+rx_recorder::sptr rx_recorder::make(
+    rx_streamer::sptr rx_stream,
+    const std::string &cpu_format,
+    const std::vector<std::string> &files,
+    const device_addr_t &args
+){
+    return sptr(new rx_recorder_impl(rx_stream, cpu_format, files, args));
+}
@@ -0,0 +1,254 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/stream_metrics_export.hpp>
+#include <shd/utils/tasks.hpp>
+#include <shd/utils/msg.hpp>
+#include <shd/exception.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+using namespace shd;
+namespace asio = boost::asio;
+
+static const char *DEST_ENV = "SHD_STREAM_METRICS";
+static const char *PERIOD_ENV = "SHD_STREAM_METRICS_PERIOD";
+
+stream_metrics_export::~stream_metrics_export(void)
+{
+    /* NOP */
+}
+
+/***********************************************************************
+ * Where the dumps go
+ **********************************************************************/
+class metrics_sink : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<metrics_sink> sptr;
+
+    metrics_sink(const std::string &dest)
+    {
+        if (boost::starts_with(dest, "unix:")) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            _unix_path = dest.substr(5);
+#else
+            throw shd::value_error("stream metrics: Unix sockets are not supported on this platform");
+#endif
+        }
+        else {
+            _file_path = boost::starts_with(dest, "file:")? dest.substr(5) : dest;
+            _file.open(_file_path.c_str(), std::ofstream::app);
+            if (not _file.is_open()) {
+                throw shd::value_error(str(boost::format("stream metrics: cannot open %s") % _file_path));
+            }
+        }
+        if (_unix_path.empty() and _file_path.empty()) {
+            throw shd::value_error(str(boost::format("stream metrics: no path in %s") % dest));
+        }
+    }
+
+    void write(const std::string &lines)
+    {
+        if (lines.empty()) return;
+        if (_file.is_open()) {
+            _file << lines << std::flush;
+            return;
+        }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        //connect again when the listener went away, drop the dump until then
+        boost::system::error_code ec;
+        if (not _socket) {
+            _socket.reset(new asio::local::stream_protocol::socket(_io_service));
+            _socket->connect(asio::local::stream_protocol::endpoint(_unix_path), ec);
+            if (ec) {
+                _socket.reset();
+                return;
+            }
+        }
+        asio::write(*_socket, asio::buffer(lines), ec);
+        if (ec) _socket.reset();
+#endif
+    }
+
+private:
+    std::string _file_path, _unix_path;
+    std::ofstream _file;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    asio::io_service _io_service;
+    boost::shared_ptr<asio::local::stream_protocol::socket> _socket;
+#endif
+};
+
+/***********************************************************************
+ * The sources of the process and the dumping task
+ **********************************************************************/
+class metrics_registry : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<metrics_registry> sptr;
+
+    metrics_registry(void): _next_id(0), _env_checked(false), _period(1.0)
+    {
+        /* NOP */
+    }
+
+    ~metrics_registry(void)
+    {
+        _task.reset();
+    }
+
+    size_t add(const std::string &kind, const stream_metrics_export::source_type &source, std::string &name)
+    {
+        this->check_env();
+        boost::mutex::scoped_lock lock(_sources_mutex);
+        const size_t id = _next_id++;
+        name = str(boost::format("%s%u") % kind % id);
+        _sources[id] = source_t(name, source);
+        return id;
+    }
+
+    void remove(const size_t id)
+    {
+        boost::mutex::scoped_lock lock(_sources_mutex);
+        _sources.erase(id);
+    }
+
+    void set_destination(const std::string &dest, const double period)
+    {
+        boost::mutex::scoped_lock lock(_dest_mutex);
+        _env_checked = true;
+        _task.reset(); //stop dumping to the old sink
+        _sink.reset();
+        if (dest.empty()) return;
+        _sink = boost::make_shared<metrics_sink>(dest);
+        _period = std::max(period, 0.001);
+        _task = task::make(boost::bind(&metrics_registry::export_loop, this));
+    }
+
+    std::string dump(void)
+    {
+        const boost::posix_time::time_duration now =
+            boost::posix_time::microsec_clock::universal_time() - boost::posix_time::from_time_t(0);
+        const std::string time = str(boost::format("{\"time\":%.6f,") % (now.total_microseconds()/1e6));
+
+        std::string lines;
+        boost::mutex::scoped_lock lock(_sources_mutex);
+        for (std::map<size_t, source_t>::const_iterator it = _sources.begin(); it != _sources.end(); ++it) {
+            lines += time + it->second.second().to_string(it->second.first).substr(1) + "\n";
+        }
+        return lines;
+    }
+
+private:
+    typedef std::pair<std::string, stream_metrics_export::source_type> source_t;
+
+    //! The environment sets the destination unless set_destination() was called
+    void check_env(void)
+    {
+        boost::mutex::scoped_lock lock(_dest_mutex);
+        if (_env_checked) return;
+        _env_checked = true;
+        const char *dest = std::getenv(DEST_ENV);
+        if (dest == NULL or std::string(dest).empty()) return;
+        const char *period = std::getenv(PERIOD_ENV);
+        try {
+            _sink = boost::make_shared<metrics_sink>(dest);
+            if (period != NULL) _period = std::max(boost::lexical_cast<double>(period), 0.001);
+        }
+        catch(const std::exception &e) {
+            SHD_MSG(warning) << boost::format(
+                "Not exporting stream metrics (%s=%s, %s=%s):\n%s"
+            ) % DEST_ENV % dest % PERIOD_ENV % ((period == NULL)? "" : period) % e.what() << std::endl;
+            _sink.reset();
+            return;
+        }
+        _task = task::make(boost::bind(&metrics_registry::export_loop, this));
+    }
+
+    void export_loop(void)
+    {
+        boost::this_thread::sleep(boost::posix_time::microseconds(long(_period*1e6)));
+        _sink->write(this->dump());
+    }
+
+    boost::mutex _sources_mutex, _dest_mutex;
+    std::map<size_t, source_t> _sources;
+    size_t _next_id;
+    bool _env_checked;
+    double _period;
+    metrics_sink::sptr _sink;
+    task::sptr _task;
+};
+
+//! The registrations keep the registry alive, even past static destruction
+static metrics_registry::sptr get_registry(void)
+{
+    static metrics_registry::sptr registry(new metrics_registry());
+    return registry;
+}
+
+/***********************************************************************
+ * Registration of a source
+ **********************************************************************/
+class stream_metrics_export_impl : public stream_metrics_export{
+public:
+    stream_metrics_export_impl(const std::string &kind, const source_type &source):
+        _registry(get_registry())
+    {
+        _id = _registry->add(kind, source, _name);
+    }
+
+    ~stream_metrics_export_impl(void)
+    {
+        _registry->remove(_id);
+    }
+
+    const std::string &get_name(void) const
+    {
+        return _name;
+    }
+
+private:
+    metrics_registry::sptr _registry;
+    size_t _id;
+    std::string _name;
+};
+
+stream_metrics_export::sptr stream_metrics_export::register_source(
+    const std::string &kind, const source_type &source
+){
+    return sptr(new stream_metrics_export_impl(kind, source));
+}
+
+void stream_metrics_export::set_destination(const std::string &dest, const double period)
+{
+    get_registry()->set_destination(dest, period);
+}
+
+std::string stream_metrics_export::dump(void)
+{
+    return get_registry()->dump();
+}
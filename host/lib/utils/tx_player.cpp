@@ -0,0 +1,310 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "direct_file.hpp"
+#include <shd/utils/tx_player.hpp>
+#include <shd/utils/safe_call.hpp>
+#include <shd/transport/spsc_ring.hpp>
+#include <shd/convert.hpp>
+#include <shd/exception.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/chrono.hpp>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+
+using namespace shd;
+using namespace shd::transport;
+
+static const size_t DEFAULT_BUFF_SIZE = 4*1024*1024;
+static const size_t DEFAULT_NUM_BUFFS = 8;
+static const size_t NO_BLOCK = ~size_t(0);
+
+static double secs_since(const boost::chrono::steady_clock::time_point &start)
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+}
+
+tx_player::stats_t::stats_t(void):
+    num_samps(0), num_loops(0), num_stalls(0),
+    stall_secs(0.0), read_secs(0.0), direct_io(false)
+{
+    /* NOP */
+}
+
+tx_player::~tx_player(void)
+{
+    /* NOP */
+}
+
+/***********************************************************************
+ * Player implementation
+ **********************************************************************/
+class tx_player_impl : public tx_player{
+public:
+    tx_player_impl(
+        tx_streamer::sptr tx_stream,
+        const std::string &cpu_format,
+        const std::vector<std::string> &files,
+        const device_addr_t &args
+    ):
+        _tx_stream(tx_stream),
+        _bytes_per_samp(convert::get_bytes_per_item(cpu_format)),
+        _num_buffs(std::max<size_t>(2, args.cast<size_t>("num_buffs", DEFAULT_NUM_BUFFS))),
+        _free_ring(_num_buffs),
+        _full_ring(_num_buffs),
+        _cur(NO_BLOCK),
+        _read_pos(0),
+        _in_loop(false),
+        _stop(false),
+        _done(false)
+    {
+        if (files.size() != _tx_stream->get_num_channels()) {
+            throw shd::value_error(str(boost::format(
+                "tx_player: %u files for %u channels") % files.size() % _tx_stream->get_num_channels()));
+        }
+
+        //whole buffers are read, so they hold a multiple of the alignment
+        const size_t buff_size = args.cast<size_t>("buff_size", DEFAULT_BUFF_SIZE);
+        const size_t align = direct_file::ALIGNMENT*_bytes_per_samp;
+        _buff_samps = std::max<size_t>(1, buff_size/align)*align/_bytes_per_samp;
+
+        const bool direct = args.cast<int>("direct", 1) != 0;
+        for (size_t i = 0; i < files.size(); i++) {
+            _files.push_back(direct_file::sptr(new direct_file(files[i], direct_file::MODE_READ, direct)));
+            if (_files[i]->size() != _files[0]->size()) {
+                throw shd::value_error(str(boost::format(
+                    "tx_player: %s is not as long as %s") % files[i] % files[0]));
+            }
+        }
+        _file_samps = _files[0]->size()/_bytes_per_samp;
+        if (_file_samps == 0) {
+            throw shd::value_error(str(boost::format(
+                "tx_player: %s holds no samples") % files[0]));
+        }
+
+        _blocks.resize(_num_buffs);
+        for (size_t i = 0; i < _num_buffs; i++) {
+            _blocks[i].nsamps = 0;
+            _blocks[i].first = _blocks[i].last = false;
+            _blocks[i].chans.resize(files.size());
+            for (size_t ch = 0; ch < files.size(); ch++) {
+                _blocks[i].chans[ch].resize(_buff_samps*_bytes_per_samp);
+            }
+            _free_ring.push_with_haste(i);
+        }
+        _buffs.resize(files.size());
+        _stats.direct_io = this->all_direct();
+
+        _reader = boost::thread(boost::bind(&tx_player_impl::reader_loop, this));
+    }
+
+    ~tx_player_impl(void)
+    {
+        _done = true;
+        SHD_SAFE_CALL(_reader.join();)
+    }
+
+    uint64_t play(const tx_metadata_t &md, const size_t num_loops, const double timeout)
+    {
+        this->check_read_error();
+        _stop = false;
+
+        tx_metadata_t send_md = md;
+        send_md.end_of_burst = false;
+        uint64_t sent = 0, reported = 0;
+        size_t loops = 0;
+        bool skip_to_start = _in_loop;
+        while (not _stop and (num_loops == 0 or loops < num_loops)) {
+            if (_cur == NO_BLOCK and not this->get_full_block()) break;
+            block_t &block = _blocks[_cur];
+
+            //after a stop in the middle of the files, start over
+            if (skip_to_start and not block.first) {
+                this->release_block();
+                continue;
+            }
+            skip_to_start = false;
+
+            size_t done = 0;
+            while (done < block.nsamps and not _stop) {
+                for (size_t ch = 0; ch < _buffs.size(); ch++) {
+                    _buffs[ch] = block.chans[ch].data() + done*_bytes_per_samp;
+                }
+                const size_t num_sent = _tx_stream->send(_buffs, block.nsamps - done, send_md, timeout);
+                if (num_sent == 0) continue;
+                done += num_sent;
+                send_md.start_of_burst = false;
+                send_md.has_time_spec = false;
+            }
+            sent += done;
+            const bool loop_done = block.last and done == block.nsamps;
+            _in_loop = not loop_done;
+            if (loop_done) loops++;
+            this->release_block();
+
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            _stats.num_samps += sent - reported;
+            if (loop_done) _stats.num_loops++;
+            reported = sent;
+        }
+
+        //end the burst
+        if (sent != 0) {
+            send_md.end_of_burst = true;
+            for (size_t ch = 0; ch < _buffs.size(); ch++) {
+                _buffs[ch] = _blocks.front().chans[ch].data();
+            }
+            _tx_stream->send(_buffs, 0, send_md, timeout);
+        }
+        return sent;
+    }
+
+    void stop(void)
+    {
+        _stop = true;
+    }
+
+    stats_t get_stats(void)
+    {
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        return _stats;
+    }
+
+private:
+    struct block_t{
+        std::vector<direct_file::aligned_buffer> chans;
+        size_t nsamps;
+        bool first; //starts at the start of the files
+        bool last; //ends at the end of the files
+    };
+
+    //! Get a buffer read ahead, wait for the reader if there is none
+    bool get_full_block(void)
+    {
+        if (not _full_ring.pop_with_haste(_cur)) {
+            const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+            while (not _full_ring.pop_with_timed_wait(_cur, 0.1)) {
+                this->check_read_error();
+                if (_stop) {
+                    _cur = NO_BLOCK;
+                    return false;
+                }
+            }
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            _stats.num_stalls++;
+            _stats.stall_secs += secs_since(start);
+        }
+        return true;
+    }
+
+    void release_block(void)
+    {
+        _free_ring.push_with_wait(_cur);
+        _cur = NO_BLOCK;
+    }
+
+    void reader_loop(void)
+    {
+        while (not _done) {
+            size_t index;
+            if (not _free_ring.pop_with_timed_wait(index, 0.1)) continue;
+            if (not this->read_block(_blocks[index])) return;
+            _full_ring.push_with_wait(index);
+        }
+    }
+
+    bool read_block(block_t &block)
+    {
+        const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+        const size_t nsamps = size_t(std::min<uint64_t>(_buff_samps, _file_samps - _read_pos));
+        const size_t num_bytes = nsamps*_bytes_per_samp;
+        //round up for direct I/O, the buffers have the space
+        const size_t read_len = ((num_bytes + direct_file::ALIGNMENT - 1)/direct_file::ALIGNMENT)*direct_file::ALIGNMENT;
+        try {
+            for (size_t ch = 0; ch < _files.size(); ch++) {
+                if (_files[ch]->read(block.chans[ch].data(), read_len) < num_bytes) {
+                    throw shd::io_error("tx_player: file got shorter while playing");
+                }
+            }
+        }
+        catch(const shd::exception &e) {
+            boost::mutex::scoped_lock lock(_stats_mutex);
+            _read_error.reset(e.dynamic_clone());
+            return false;
+        }
+
+        block.nsamps = nsamps;
+        block.first = (_read_pos == 0);
+        _read_pos += nsamps;
+        block.last = (_read_pos == _file_samps);
+        if (block.last) {
+            _read_pos = 0;
+            for (size_t ch = 0; ch < _files.size(); ch++) _files[ch]->rewind();
+        }
+
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        _stats.read_secs += secs_since(start);
+        _stats.direct_io = this->all_direct();
+        return true;
+    }
+
+    void check_read_error(void)
+    {
+        boost::mutex::scoped_lock lock(_stats_mutex);
+        if (_read_error) _read_error->dynamic_throw();
+    }
+
+    bool all_direct(void) const
+    {
+        for (size_t ch = 0; ch < _files.size(); ch++) {
+            if (not _files[ch]->is_direct()) return false;
+        }
+        return true;
+    }
+
+    tx_streamer::sptr _tx_stream;
+    const size_t _bytes_per_samp;
+    const size_t _num_buffs;
+    size_t _buff_samps;
+    uint64_t _file_samps;
+    std::vector<direct_file::sptr> _files;
+    std::vector<block_t> _blocks;
+    spsc_ring<size_t> _free_ring, _full_ring;
+    std::vector<const void *> _buffs;
+    size_t _cur; //the buffer being sent from
+    uint64_t _read_pos; //the next sample the reader reads
+    bool _in_loop; //did the last play() stop in the middle of the files?
+    volatile bool _stop, _done;
+    boost::mutex _stats_mutex;
+    stats_t _stats;
+    boost::shared_ptr<shd::exception> _read_error;
+    boost::thread _reader;
+};
+
+/***********************************************************************
+ * Player factory
+ **********************************************************************/
+tx_player::sptr tx_player::make(
+    tx_streamer::sptr tx_stream,
+    const std::string &cpu_format,
+    const std::vector<std::string> &files,
+    const device_addr_t &args
+){
+    return sptr(new tx_player_impl(tx_stream, cpu_format, files, args));
+}
@@ -0,0 +1,169 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "apply_corrections.hpp"
+#include <shd/property_tree.hpp>
+#include <shd/smini/dboard_eeprom.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <complex>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+
+namespace fs = boost::filesystem;
+using namespace shd;
+
+/***********************************************************************
+ * The linear search that the corrections used to do, as a reference
+ **********************************************************************/
+struct ref_cal_t{
+    double lo_freq, real, imag;
+};
+
+static std::complex<double> ref_correction(const std::vector<ref_cal_t> &datas, const double lo_freq){
+    size_t lo_index = 0;
+    size_t hi_index = datas.size()-1;
+    for (size_t i = 0; i < datas.size(); i++){
+        if ((datas[i].lo_freq - 0.1) < lo_freq and (datas[i].lo_freq + 0.1) > lo_freq){
+            hi_index = i;
+            lo_index = i;
+            break;
+        }
+        if (datas[i].lo_freq > lo_freq){
+            hi_index = i;
+            break;
+        }
+        lo_index = i;
+    }
+    if (lo_index == 0) return std::complex<double>(datas[lo_index].real, datas[lo_index].imag);
+    if (hi_index == lo_index) return std::complex<double>(datas[hi_index].real, datas[hi_index].imag);
+    const double frac = (lo_freq - datas[lo_index].lo_freq)/(datas[hi_index].lo_freq - datas[lo_index].lo_freq);
+    return std::complex<double>(
+        datas[lo_index].real + frac*(datas[hi_index].real - datas[lo_index].real),
+        datas[lo_index].imag + frac*(datas[hi_index].imag - datas[lo_index].imag)
+    );
+}
+
+/***********************************************************************
+ * A calibration directory and a tree with one frontend
+ **********************************************************************/
+struct cal_fixture{
+    cal_fixture(void):
+        cal_dir(fs::temp_directory_path() / fs::unique_path())
+    {
+        fs::create_directories(cal_dir / ".shd" / "cal");
+#ifdef SHD_PLATFORM_WIN32
+        _putenv_s("SHD_CONFIG_DIR", cal_dir.string().c_str());
+#else
+        setenv("SHD_CONFIG_DIR", cal_dir.string().c_str(), 1);
+#endif
+        tree = property_tree::make();
+        tree->create<smini::dboard_eeprom_t>("dboards/A/rx_eeprom");
+        tree->create<std::complex<double> >("rx_frontends/A/iq_balance/value")
+            .set(std::complex<double>(0.0, 0.0));
+    }
+
+    ~cal_fixture(void){
+        fs::remove_all(cal_dir);
+    }
+
+    fs::path write_table(const std::string &serial, const std::vector<ref_cal_t> &datas){
+        const fs::path path = cal_dir / ".shd" / "cal" / ("rx_iq_cal_v0.2_" + serial + ".csv");
+        std::ofstream cal_data(path.string().c_str());
+        cal_data << "name, RX Frontend Calibration\n";
+        cal_data << "serial, " << serial << "\n";
+        cal_data << "timestamp, 0\n";
+        cal_data << "version, 0, 1\n";
+        cal_data << "DATA STARTS HERE\n";
+        cal_data << "lo_frequency, correction_real, correction_imag, measured, delta\n";
+        //write the rows backwards, the loader has to sort them
+        for (size_t i = datas.size(); i > 0; i--){
+            cal_data << boost::format("%.17g, %.17g, %.17g, 0, 0\n")
+                % datas[i-1].lo_freq % datas[i-1].real % datas[i-1].imag;
+        }
+        return path;
+    }
+
+    void set_serial(const std::string &serial){
+        smini::dboard_eeprom_t db_eeprom;
+        db_eeprom.serial = serial;
+        tree->access<smini::dboard_eeprom_t>("dboards/A/rx_eeprom").set(db_eeprom);
+    }
+
+    std::complex<double> tune(const double lo_freq){
+        smini::apply_rx_fe_corrections(tree, "A", lo_freq);
+        return tree->access<std::complex<double> >("rx_frontends/A/iq_balance/value").get();
+    }
+
+    fs::path cal_dir;
+    property_tree::sptr tree;
+};
+
+static std::vector<ref_cal_t> make_table(const size_t num_points, const double start, const double step){
+    std::vector<ref_cal_t> datas;
+    for (size_t i = 0; i < num_points; i++){
+        ref_cal_t data = {start + i*step, 0.001*i, -0.002*i + 0.5};
+        datas.push_back(data);
+    }
+    return datas;
+}
+
+BOOST_AUTO_TEST_CASE(test_fe_correction_lookup){
+    cal_fixture fixture;
+    const std::vector<ref_cal_t> datas = make_table(100, 1e9, 10e6);
+    fixture.write_table("CAL0001", datas);
+    fixture.set_serial("CAL0001");
+
+    //below, at, between, just off and above the table entries
+    std::vector<double> freqs;
+    freqs.push_back(500e6);
+    for (size_t i = 0; i < datas.size(); i++){
+        freqs.push_back(datas[i].lo_freq);
+        freqs.push_back(datas[i].lo_freq + 0.05);
+        freqs.push_back(datas[i].lo_freq - 0.05);
+        freqs.push_back(datas[i].lo_freq + 3.3e6);
+    }
+    freqs.push_back(3e9);
+
+    for (size_t i = 0; i < freqs.size(); i++){
+        const std::complex<double> expected = ref_correction(datas, freqs[i]);
+        const std::complex<double> actual = fixture.tune(freqs[i]);
+        BOOST_CHECK_CLOSE(actual.real() + 1.0, expected.real() + 1.0, 1e-9);
+        BOOST_CHECK_CLOSE(actual.imag() + 1.0, expected.imag() + 1.0, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_fe_correction_cache){
+    cal_fixture fixture;
+    const std::vector<ref_cal_t> datas = make_table(8, 2e9, 100e6);
+    const fs::path path = fixture.write_table("CAL0002", datas);
+    fixture.set_serial("CAL0002");
+    const std::complex<double> loaded = fixture.tune(2.25e9);
+    BOOST_CHECK(loaded != std::complex<double>(0.0, 0.0));
+
+    //the table is loaded once, later tunes do not read the file
+    fs::remove(path);
+    BOOST_CHECK(fixture.tune(2.25e9) == loaded);
+
+    //a frontend without a file is left alone
+    fixture.tree->access<std::complex<double> >("rx_frontends/A/iq_balance/value")
+        .set(std::complex<double>(0.0, 0.0));
+    fixture.set_serial("NOCALFILE");
+    BOOST_CHECK(fixture.tune(2.25e9) == std::complex<double>(0.0, 0.0));
+}
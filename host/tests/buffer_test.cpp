@@ -17,7 +17,10 @@
 
 #include <boost/test/unit_test.hpp>
 #include <shd/transport/bounded_buffer.hpp>
+#include <shd/transport/spsc_ring.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace boost::assign;
 using namespace shd::transport;
@@ -62,3 +65,48 @@ BOOST_AUTO_TEST_CASE(test_bounded_buffer_with_pop_on_full){
     BOOST_CHECK(bb.pop_with_timed_wait(val, timeout));
     BOOST_CHECK_EQUAL(val, 3);
 }
+
+BOOST_AUTO_TEST_CASE(test_spsc_ring_with_timed_wait){
+    spsc_ring<int> ring(3);
+
+    //push elements, check for timeout
+    BOOST_CHECK(ring.push_with_timed_wait(0, timeout));
+    BOOST_CHECK(ring.push_with_timed_wait(1, timeout));
+    BOOST_CHECK(ring.push_with_timed_wait(2, timeout));
+    BOOST_CHECK(not ring.push_with_timed_wait(3, timeout));
+
+    int val;
+    //pop elements, check for timeout and check values
+    BOOST_CHECK(ring.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 0);
+    BOOST_CHECK(ring.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 1);
+    BOOST_CHECK(ring.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 2);
+    BOOST_CHECK(not ring.pop_with_timed_wait(val, timeout));
+}
+
+static void spsc_ring_producer(spsc_ring<size_t> &ring, const size_t num_elems){
+    for (size_t i = 0; i < num_elems; i++){
+        if (not ring.push_with_timed_wait(i, 10.0)) return;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_spsc_ring_threaded){
+    static const size_t num_elems = 100000;
+    spsc_ring<size_t> ring(16);
+
+    //the producer blocks on a full ring, the consumer on an empty one
+    boost::thread producer(boost::bind(&spsc_ring_producer, boost::ref(ring), num_elems));
+    size_t val = 0;
+    bool in_order = true;
+    for (size_t i = 0; i < num_elems; i++){
+        if (not ring.pop_with_timed_wait(val, 10.0) or val != i){
+            in_order = false;
+            break;
+        }
+    }
+    producer.join();
+    BOOST_CHECK(in_order);
+    BOOST_CHECK(not ring.pop_with_haste(val));
+}
@@ -23,6 +23,7 @@
 #include <complex>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
 #include <iostream>
 
 using namespace shd;
@@ -615,3 +616,100 @@ BOOST_AUTO_TEST_CASE(test_convert_types_f32_and_f32){
         test_convert_types_f32(nsamps, id);
     }
 }
+
+/***********************************************************************
+ * Test that the wider SIMD converters (AVX2, AVX-512) agree with the
+ * SSE2 converters (priority 3). The SSE2 converters handle unaligned
+ * heads and short tails with the scalar code, which truncates instead
+ * of rounding and scales fc64 in single precision. So the integer
+ * outputs may differ by one LSB and fc64 outputs by float precision.
+ * Only the converters the host CPU supports are registered and tested.
+ **********************************************************************/
+static double get_component(
+    const std::string &format, const std::vector<uint8_t> &buff, const size_t index
+){
+    if (format == "fc32") return reinterpret_cast<const float *>(&buff[0])[index];
+    if (format == "fc64") return reinterpret_cast<const double *>(&buff[0])[index];
+    if (format.find("sc8") == 0) return int8_t(buff[index]);
+    const bool be = format.find("_be") != std::string::npos;
+    return int16_t(be? (buff[2*index] << 8 | buff[2*index+1]) : (buff[2*index+1] << 8 | buff[2*index]));
+}
+
+static void test_convert_prios_against_sse2(
+    const std::string &in_format, const std::string &out_format, const double scalar
+){
+    static const int sse2_prio = 3;
+
+    convert::id_type id;
+    id.input_format = in_format;
+    id.num_inputs = 1;
+    id.output_format = out_format;
+    id.num_outputs = 1;
+    const std::vector<convert::priority_type> prios = convert::get_converter_priorities(id);
+    if (std::find(prios.begin(), prios.end(), sse2_prio) == prios.end()) return;
+
+    const size_t max_nsamps = 70, max_offset = 3;
+    const size_t in_size = convert::get_bytes_per_item(in_format);
+    const size_t out_size = convert::get_bytes_per_item(out_format);
+
+    //random input within full scale
+    std::vector<uint8_t> input((max_nsamps + max_offset)*in_size);
+    if (in_format == "fc32"){
+        float *in = reinterpret_cast<float *>(&input[0]);
+        for (size_t i = 0; i < input.size()/sizeof(float); i++){
+            in[i] = float(std::rand()/(RAND_MAX/2.0) - 1);
+        }
+    }
+    else if (in_format == "fc64"){
+        double *in = reinterpret_cast<double *>(&input[0]);
+        for (size_t i = 0; i < input.size()/sizeof(double); i++){
+            in[i] = std::rand()/(RAND_MAX/2.0) - 1;
+        }
+    }
+    else{
+        BOOST_FOREACH(uint8_t &in, input) in = uint8_t(std::rand());
+    }
+
+    //integers within one LSB, fc32 exact, fc64 to float precision
+    const double tolerance =
+        (out_format == "fc32")? 0.0 : (out_format == "fc64")? 1e-6 : 1.0;
+
+    BOOST_FOREACH(const convert::priority_type prio, prios){
+        if (prio <= sse2_prio) continue;
+        convert::converter::sptr ref = convert::get_converter(id, sse2_prio)();
+        convert::converter::sptr conv = convert::get_converter(id, prio)();
+        ref->set_scalar(scalar);
+        conv->set_scalar(scalar);
+
+        for (size_t offset = 0; offset <= max_offset; offset++){
+            for (size_t nsamps = 1; nsamps <= max_nsamps; nsamps++){
+                std::vector<uint8_t> ref_out(nsamps*out_size + 4, 0), out(nsamps*out_size + 4, 0);
+                std::vector<const void *> in_vec(1, &input[offset*in_size]);
+                std::vector<void *> ref_vec(1, &ref_out[0]), out_vec(1, &out[0]);
+                ref->conv(in_vec, ref_vec, nsamps);
+                conv->conv(in_vec, out_vec, nsamps);
+                for (size_t i = 0; i < nsamps*2; i++){
+                    const double ref_i = get_component(out_format, ref_out, i);
+                    const double out_i = get_component(out_format, out, i);
+                    BOOST_CHECK_MESSAGE(std::abs(ref_i - out_i) <= tolerance, id.to_string()
+                        << " prio " << prio << " differs from SSE2 at " << i << ": "
+                        << ref_i << " vs " << out_i << " (" << nsamps << " samples at offset " << offset << ")");
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_simd_prios_against_sse2){
+    std::vector<std::string> wire_formats = boost::assign::list_of
+        ("sc16_item32_le")("sc16_item32_be")("sc8_item32_le")("sc8_item32_be");
+    std::vector<std::string> host_formats = boost::assign::list_of("fc32")("fc64");
+
+    BOOST_FOREACH(const std::string &wire, wire_formats){
+        const double full_scale = (wire.find("sc8") == 0)? 127. : 32767.;
+        BOOST_FOREACH(const std::string &host, host_formats){
+            test_convert_prios_against_sse2(host, wire, full_scale);
+            test_convert_prios_against_sse2(wire, host, 1/full_scale);
+        }
+    }
+}
@@ -22,6 +22,7 @@
 #include "../lib/experts/expert_factory.hpp"
 #include <shd/property_tree.hpp>
 #include <fstream>
+#include <map>
 
 using namespace shd::experts;
 
@@ -254,3 +255,130 @@ BOOST_AUTO_TEST_CASE(test_experts){
     container->resolve_to("Consume_G");
     VALIDATE_ALL_DEPENDENCIES
 }
+
+//=============================================================================
+
+typedef boost::shared_ptr< std::map<std::string, int> > value_map_t;
+
+static value_map_t snapshot(expert_container::sptr container){
+    value_map_t values = boost::make_shared< std::map<std::string, int> >();
+    static const char* names[] = {"A/desired", "A/coerced", "B", "C", "D", "E", "F", "G"};
+    for (size_t i = 0; i < sizeof(names)/sizeof(names[0]); i++) {
+        const data_node_t<int>& node = dynamic_cast< const data_node_t<int>& >(container->node_retriever().lookup(names[i]));
+        (*values)[names[i]] = node.get();
+        (*values)[std::string(names[i]) + "*"] = node.is_dirty();
+    }
+    return values;
+}
+
+static expert_container::sptr make_test_graph(shd::property_tree::sptr tree, boost::shared_ptr<int> final_output){
+    expert_container::sptr container = expert_factory::create_container("example");
+    expert_factory::add_dual_prop_node<int>(container, tree, "A", 0);
+    expert_factory::add_prop_node<int>(container, tree, "B", 0);
+    expert_factory::add_data_node<int>(container, "C", 0);
+    expert_factory::add_prop_node<int>(container, tree, "D", 1);
+    expert_factory::add_prop_node<int>(container, tree, "E", 0);
+    expert_factory::add_data_node<int>(container, "F", 0);
+    expert_factory::add_data_node<int>(container, "G", 0);
+    expert_factory::add_worker_node<worker1_t>(container, container->node_retriever());
+    expert_factory::add_worker_node<worker2_t>(container, container->node_retriever());
+    expert_factory::add_worker_node<worker3_t>(container, container->node_retriever());
+    expert_factory::add_worker_node<worker4_t>(container, container->node_retriever());
+    expert_factory::add_worker_node<worker5_t>(container, container->node_retriever(), final_output);
+    expert_factory::add_worker_node<worker6_t>(container);
+    return container;
+}
+
+BOOST_AUTO_TEST_CASE(test_experts_incremental){
+    //Two copies of the same graph: one is resolved incrementally, the other fully
+    shd::property_tree::sptr inc_tree = shd::property_tree::make();
+    shd::property_tree::sptr ref_tree = shd::property_tree::make();
+    boost::shared_ptr<int> inc_output = boost::make_shared<int>();
+    boost::shared_ptr<int> ref_output = boost::make_shared<int>();
+    expert_container::sptr inc = make_test_graph(inc_tree, inc_output);
+    expert_container::sptr ref = make_test_graph(ref_tree, ref_output);
+
+    //The initial resolve starts with every node dirty
+    inc->resolve_from("A/desired");
+    ref->resolve_all();
+    BOOST_CHECK(*snapshot(inc) == *snapshot(ref));
+    BOOST_CHECK_EQUAL(*inc_output, *ref_output);
+
+    //Writes to one or several nodes, including writes that do not change the
+    //value and nodes written without a resolve in between
+    static const struct { const char* path; int value; bool resolve; } writes[] = {
+        {"A", 5, true}, {"B", 3, true}, {"D", 7, true}, {"E", -10, true},
+        {"B", 3, true}, {"A", 5, true}, {"B", -4, false}, {"D", 2, true},
+        {"A", 1, false}, {"E", 4, false}, {"B", 9, true}, {"D", 0, true},
+    };
+    for (size_t i = 0; i < sizeof(writes)/sizeof(writes[0]); i++) {
+        inc_tree->access<int>(writes[i].path).set(writes[i].value);
+        ref_tree->access<int>(writes[i].path).set(writes[i].value);
+        if (not writes[i].resolve) continue;
+        if (i % 2) {
+            inc->resolve_from(writes[i].path == std::string("A") ? "A/desired" : writes[i].path);
+        } else {
+            inc->resolve_to("G");
+        }
+        ref->resolve_all();
+        BOOST_CHECK(*snapshot(inc) == *snapshot(ref));
+        BOOST_CHECK_EQUAL(*inc_output, *ref_output);
+    }
+}
+
+//=============================================================================
+
+class counting_worker_t : public worker_node_t {
+public:
+    counting_worker_t(const node_retriever_t& db, const std::string& in, const std::string& out, boost::shared_ptr<int> count)
+    : worker_node_t(in + "->" + out), _in(db, in), _out(db, out), _count(count)
+    {
+        bind_accessor(_in);
+        bind_accessor(_out);
+    }
+
+private:
+    void resolve() {
+        _out = _in + 1;
+        (*_count)++;
+    }
+
+    data_reader_t<int> _in;
+    data_writer_t<int> _out;
+    boost::shared_ptr<int> _count;
+};
+
+BOOST_AUTO_TEST_CASE(test_experts_incremental_downstream_only){
+    expert_container::sptr container = expert_factory::create_container("chains");
+    shd::property_tree::sptr tree = shd::property_tree::make();
+    boost::shared_ptr<int> count_x = boost::make_shared<int>(0);
+    boost::shared_ptr<int> count_y = boost::make_shared<int>(0);
+
+    //Two independent chains: X0->X1->X2 and Y0->Y1
+    expert_factory::add_prop_node<int>(container, tree, "X0", 0, shd::experts::AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_data_node<int>(container, "X1", 0);
+    expert_factory::add_data_node<int>(container, "X2", 0);
+    expert_factory::add_prop_node<int>(container, tree, "Y0", 0, shd::experts::AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_data_node<int>(container, "Y1", 0);
+    expert_factory::add_worker_node<counting_worker_t>(container, container->node_retriever(), "X0", "X1", count_x);
+    expert_factory::add_worker_node<counting_worker_t>(container, container->node_retriever(), "X1", "X2", count_x);
+    expert_factory::add_worker_node<counting_worker_t>(container, container->node_retriever(), "Y0", "Y1", count_y);
+    container->resolve_all();
+    BOOST_CHECK_EQUAL(*count_x, 2);
+    BOOST_CHECK_EQUAL(*count_y, 1);
+
+    //A write only runs the workers of its own chain
+    tree->access<int>("X0").set(10);
+    BOOST_CHECK_EQUAL(*count_x, 4);
+    BOOST_CHECK_EQUAL(*count_y, 1);
+    BOOST_CHECK_EQUAL(dynamic_cast< const data_node_t<int>& >(container->node_retriever().lookup("X2")).get(), 12);
+
+    tree->access<int>("Y0").set(10);
+    BOOST_CHECK_EQUAL(*count_x, 4);
+    BOOST_CHECK_EQUAL(*count_y, 2);
+
+    //Writing the same value again does not run anything
+    tree->access<int>("X0").set(10);
+    BOOST_CHECK_EQUAL(*count_x, 4);
+    BOOST_CHECK_EQUAL(*count_y, 2);
+}
@@ -0,0 +1,101 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include <shd/utils/log.hpp>
+#include <shd/utils/paths.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+namespace fs = boost::filesystem;
+
+//the logger reads the level once, when libshd loads,
+//so the test runs with SHD_LOG_LEVEL=always (see CMakeLists.txt)
+static void require_logging(void){
+    BOOST_REQUIRE_MESSAGE(std::getenv("SHD_LOG_LEVEL") != NULL, "SHD_LOG_LEVEL is not set");
+}
+
+static void log_entries(const std::string &tag, const size_t thread, const size_t num_entries){
+    for (size_t i = 0; i < num_entries; i++){
+        SHD_LOGV(always) << tag << " " << thread << " " << i << std::endl;
+    }
+}
+
+//! Get the entry numbers of each thread in the order they were written
+static std::vector<std::vector<size_t> > read_entries(const std::string &tag, const size_t num_threads){
+    std::vector<std::vector<size_t> > entries(num_threads);
+    const std::string path = (fs::path(shd::get_tmp_path()) / "shd.log").string();
+    std::ifstream in(path.c_str());
+    std::string word;
+    while (in >> word){
+        if (word != tag) continue;
+        size_t thread, i;
+        in >> thread >> i;
+        BOOST_REQUIRE(thread < num_threads);
+        entries[thread].push_back(i);
+    }
+    return entries;
+}
+
+static std::string unique_tag(void){
+    return "log_test_" + fs::unique_path("%%%%%%%%").string();
+}
+
+BOOST_AUTO_TEST_CASE(test_log_threads){
+    require_logging();
+    const std::string tag = unique_tag();
+    const size_t num_threads = 4, num_entries = 100;
+    boost::thread_group threads;
+    for (size_t t = 0; t < num_threads; t++){
+        threads.create_thread(boost::bind(&log_entries, tag, t, num_entries));
+    }
+    threads.join_all();
+    shd::_log::flush();
+
+    //the entries of exited threads are written too, in order
+    const std::vector<std::vector<size_t> > entries = read_entries(tag, num_threads);
+    BOOST_CHECK_EQUAL(shd::_log::get_num_dropped(), 0);
+    for (size_t t = 0; t < num_threads; t++){
+        BOOST_REQUIRE_EQUAL(entries[t].size(), num_entries);
+        for (size_t i = 0; i < num_entries; i++){
+            BOOST_CHECK_EQUAL(entries[t][i], i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_log_drop){
+    require_logging();
+    const std::string tag = unique_tag();
+    const size_t num_entries = 20000;
+    const size_t dropped_before = shd::_log::get_num_dropped();
+    log_entries(tag, 0, num_entries);
+    shd::_log::flush();
+
+    //a burst may overrun the queue, but every entry is written or counted
+    const std::vector<std::vector<size_t> > entries = read_entries(tag, 1);
+    const size_t num_dropped = shd::_log::get_num_dropped() - dropped_before;
+    BOOST_CHECK_EQUAL(entries[0].size() + num_dropped, num_entries);
+    for (size_t i = 1; i < entries[0].size(); i++){
+        BOOST_CHECK(entries[0][i] > entries[0][i-1]);
+    }
+}
@@ -80,6 +80,12 @@ BOOST_AUTO_TEST_CASE(test_literals)
                                   result.begin(), result.end());
     BOOST_REQUIRE_THROW(literal_int_vec.get_bool(), shd::type_error);
     BOOST_REQUIRE_THROW(literal_int_vec.get_int(), shd::type_error);
+
+    // Literals created from C++ values, e.g. function return values
+    BOOST_CHECK_EQUAL(expression_literal(0).to_bool(), false);
+    BOOST_CHECK_EQUAL(expression_literal(7).to_bool(), true);
+    BOOST_CHECK_EQUAL(expression_literal(0.0).to_bool(), false);
+    BOOST_CHECK_EQUAL(expression_literal(0.5).to_bool(), true);
 }
 
 
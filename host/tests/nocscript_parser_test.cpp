@@ -18,6 +18,7 @@
 #include "../lib/rfnoc/nocscript/function_table.hpp"
 #include "../lib/rfnoc/nocscript/parser.hpp"
 #include <shd/exception.hpp>
+#include <shd/types/time_spec.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/assign/list_of.hpp>
@@ -165,3 +166,44 @@ BOOST_AUTO_TEST_CASE(test_multi_commmand)
     BOOST_CHECK_EQUAL(dummy_false_counter, 3);
 }
 
+
+// Quiet versions of the variable getters, for timing
+expression::type_t quiet_get_type(const std::string &)
+{
+    return expression::TYPE_INT;
+}
+
+expression_literal quiet_get_value(const std::string &)
+{
+    return expression_literal(SPP_VALUE);
+}
+
+BOOST_AUTO_TEST_CASE(test_cached_eval)
+{
+    function_table::sptr ft = function_table::make();
+    parser::sptr p = parser::make(
+            ft,
+            boost::bind(&quiet_get_type, _1),
+            boost::bind(&quiet_get_value, _1)
+    );
+    const std::string line("GE($spp, 16) AND LE($spp, 4096) AND IS_PWR_OF_2($spp)");
+    const size_t num_runs = 1000;
+
+    shd::time_spec_t start = shd::time_spec_t::get_system_time();
+    for (size_t i = 0; i < num_runs; i++) {
+        BOOST_REQUIRE(p->create_expr_tree(line)->eval().get_bool());
+    }
+    const double parse_time = (shd::time_spec_t::get_system_time() - start).get_real_secs();
+
+    // Same tree, evaluated over and over
+    expression::sptr e = p->create_expr_tree(line);
+    start = shd::time_spec_t::get_system_time();
+    for (size_t i = 0; i < num_runs; i++) {
+        BOOST_REQUIRE(e->eval().get_bool());
+    }
+    const double cached_time = (shd::time_spec_t::get_system_time() - start).get_real_secs();
+
+    std::cout << "Parse and eval: " << parse_time * 1e6 / num_runs << " us per run" << std::endl;
+    std::cout << "Cached eval:    " << cached_time * 1e6 / num_runs << " us per run" << std::endl;
+    BOOST_CHECK_LT(cached_time, parse_time / 10);
+}
@@ -0,0 +1,198 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "parallel_tasks.hpp"
+#include <shd/types/wb_iface.hpp>
+#include <shd/types/time_spec.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+using namespace shd;
+using namespace shd::smini;
+
+/***********************************************************************
+ * A firmware control layer where every register access takes a while,
+ * like a peek or poke over the network
+ **********************************************************************/
+static const wb_iface::wb_addr_type CLAIM_REG = 0x10;
+static const wb_iface::wb_addr_type CLK_STATUS_REG = 0x20;
+static const wb_iface::wb_addr_type SELF_TEST_REG = 0x30;
+
+class latency_wb_iface : public wb_iface
+{
+public:
+    typedef boost::shared_ptr<latency_wb_iface> sptr;
+
+    latency_wb_iface(const double latency, const size_t reads_until_locked):
+        _latency(latency), _reads_until_locked(reads_until_locked)
+    {
+        /* NOP */
+    }
+
+    void poke32(const wb_addr_type addr, const uint32_t data)
+    {
+        wait();
+        boost::mutex::scoped_lock lock(_mutex);
+        _regs[addr] = data;
+    }
+
+    uint32_t peek32(const wb_addr_type addr)
+    {
+        wait();
+        boost::mutex::scoped_lock lock(_mutex);
+        //the clock locks after a number of status reads
+        if (addr == CLK_STATUS_REG) {
+            return (_reads_until_locked == 0 or --_reads_until_locked == 0)? 1 : 0;
+        }
+        return _regs[addr];
+    }
+
+private:
+    void wait(void)
+    {
+        boost::this_thread::sleep(boost::posix_time::microseconds(long(_latency*1e6)));
+    }
+
+    const double _latency;
+    boost::mutex _mutex;
+    size_t _reads_until_locked;
+    std::map<wb_addr_type, uint32_t> _regs;
+};
+
+//! What a motherboard setup does: claim, wait for the clock, self test
+static void setup_board(latency_wb_iface::sptr iface, const uint32_t board_id, bool &done)
+{
+    iface->poke32(CLAIM_REG, board_id);
+    if (iface->peek32(CLAIM_REG) != board_id) throw shd::runtime_error("claim failed");
+    while (iface->peek32(CLK_STATUS_REG) == 0) {}
+    for (uint32_t i = 0; i < 4; i++) {
+        iface->poke32(SELF_TEST_REG, i);
+        if (iface->peek32(SELF_TEST_REG) != i) throw shd::runtime_error("self test failed");
+    }
+    done = true;
+}
+
+static double run_setups(const size_t num_boards, const size_t max_threads)
+{
+    std::vector<latency_wb_iface::sptr> ifaces;
+    bool done[16] = {false};
+    std::vector<parallel_task_t> tasks;
+    for (size_t i = 0; i < num_boards; i++) {
+        ifaces.push_back(boost::make_shared<latency_wb_iface>(0.001, 5));
+        tasks.push_back(boost::bind(&setup_board, ifaces.back(), uint32_t(i), boost::ref(done[i])));
+    }
+
+    const time_spec_t start = time_spec_t::get_system_time();
+    run_in_parallel(tasks, max_threads);
+    const double elapsed = (time_spec_t::get_system_time() - start).get_real_secs();
+
+    for (size_t i = 0; i < num_boards; i++) {
+        BOOST_CHECK(done[i]);
+    }
+    return elapsed;
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_board_setup)
+{
+    const double serial_time = run_setups(8, 1);
+    const double parallel_time = run_setups(8, 8);
+    std::cout << "8 boards one after the other: " << serial_time*1e3 << " ms" << std::endl;
+    std::cout << "8 boards at once:             " << parallel_time*1e3 << " ms" << std::endl;
+    //every access sleeps, so the boards overlap even on one CPU
+    BOOST_CHECK_LT(parallel_time, serial_time/2);
+}
+
+/***********************************************************************
+ * Bounded number of threads
+ **********************************************************************/
+struct concurrency_counter
+{
+    concurrency_counter(void): running(0), max_running(0), num_done(0) {}
+
+    void task(void)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            running++;
+            max_running = std::max(max_running, running);
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+        boost::mutex::scoped_lock lock(mutex);
+        running--;
+        num_done++;
+    }
+
+    boost::mutex mutex;
+    size_t running, max_running, num_done;
+};
+
+BOOST_AUTO_TEST_CASE(test_parallel_max_threads)
+{
+    concurrency_counter counter;
+    std::vector<parallel_task_t> tasks(10,
+        boost::bind(&concurrency_counter::task, &counter));
+    run_in_parallel(tasks, 3);
+    BOOST_CHECK_EQUAL(counter.num_done, 10);
+    BOOST_CHECK_LE(counter.max_running, 3);
+    BOOST_CHECK_GT(counter.max_running, 1);
+}
+
+/***********************************************************************
+ * Errors
+ **********************************************************************/
+static void throw_key_error(void)
+{
+    throw shd::key_error("board 2");
+}
+
+static void throw_value_error(void)
+{
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    throw shd::value_error("board 5");
+}
+
+static void count_task(size_t &count, boost::mutex &mutex)
+{
+    boost::mutex::scoped_lock lock(mutex);
+    count++;
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_errors)
+{
+    size_t count = 0;
+    boost::mutex mutex;
+    std::vector<parallel_task_t> tasks(8,
+        boost::bind(&count_task, boost::ref(count), boost::ref(mutex)));
+    tasks[5] = &throw_value_error;
+    tasks[2] = &throw_key_error;
+
+    //all other tasks run and the error of the first failed task comes out
+    BOOST_CHECK_THROW(run_in_parallel(tasks, 4), shd::key_error);
+    BOOST_CHECK_EQUAL(count, 6);
+
+    //one thread stops at the first error
+    count = 0;
+    BOOST_CHECK_THROW(run_in_parallel(tasks, 1), shd::key_error);
+    BOOST_CHECK_EQUAL(count, 2);
+}
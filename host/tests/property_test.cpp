@@ -225,6 +225,34 @@ BOOST_AUTO_TEST_CASE(test_prop_subtree){
 
 }
 
+BOOST_AUTO_TEST_CASE(test_prop_tree_resolve){
+    shd::property_tree::sptr tree = shd::property_tree::make();
+    tree->create<int>("/test/prop0").set(42);
+
+    //a handle and a path access refer to the same property
+    shd::property_handle<int> prop0 = tree->resolve<int>("/test/prop0");
+    BOOST_CHECK(prop0.valid());
+    BOOST_CHECK_EQUAL(prop0->get(), 42);
+    (*prop0).set(34);
+    BOOST_CHECK_EQUAL(tree->access<int>("/test/prop0").get(), 34);
+
+    //paths are looked up regardless of redundant slashes
+    BOOST_CHECK_EQUAL(tree->access<int>("test//prop0/").get(), 34);
+    BOOST_CHECK_EQUAL(tree->subtree("/test")->access<int>("prop0").get(), 34);
+    BOOST_CHECK_EQUAL(tree->subtree("/test/")->resolve<int>("/prop0")->get(), 34);
+
+    BOOST_CHECK_THROW(tree->resolve<int>("/test"), shd::runtime_error);
+    BOOST_CHECK_THROW(tree->resolve<int>("/test/prop1"), shd::lookup_error);
+
+    //the handle outlives the removal from the tree
+    tree->remove("/test");
+    BOOST_CHECK_THROW(tree->access<int>("/test/prop0"), shd::lookup_error);
+    BOOST_CHECK_EQUAL(prop0->get(), 34);
+
+    tree->create<int>("/test/prop0").set(1);
+    BOOST_CHECK_EQUAL(tree->resolve<int>("/test/prop0")->get(), 1);
+    BOOST_CHECK_EQUAL(prop0->get(), 34);
+}
 
 BOOST_AUTO_TEST_CASE(test_prop_operators)
 {
@@ -0,0 +1,210 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "radio_ctrl_core_3000.hpp"
+#include <shd/transport/vrt_if_packet.hpp>
+#include <shd/types/time_spec.hpp>
+#include <shd/utils/byteswap.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/make_shared.hpp>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+using namespace shd;
+using namespace shd::transport;
+
+static const uint32_t CTRL_SID = 0x00020010;
+static const size_t NUM_RESP_FRAMES = 16;
+
+/***********************************************************************
+ * A control endpoint that acks every packet after a round trip time
+ **********************************************************************/
+class loopback_ctrl_xport : public zero_copy_if
+{
+public:
+    typedef boost::shared_ptr<loopback_ctrl_xport> sptr;
+
+    loopback_ctrl_xport(const double rtt):
+        _rtt(rtt), _send_buff(this), _bad_seq(~size_t(0)), _num_pkts(0)
+    {
+        /* NOP */
+    }
+
+    //! Ack the packet with this sequence number with a wrong one
+    void set_bad_seq(const size_t seq){ _bad_seq = seq; }
+
+    size_t get_num_pkts(void) const{ return _num_pkts; }
+
+    const std::vector<uint32_t> &get_writes(void) const{ return _writes; }
+
+    managed_recv_buffer::sptr get_recv_buff(double timeout)
+    {
+        if (_resps.empty()) return managed_recv_buffer::sptr();
+        const double wait = (_resps.front().due - time_spec_t::get_system_time()).get_real_secs();
+        if (wait > timeout) return managed_recv_buffer::sptr();
+        if (wait > 0) boost::this_thread::sleep(boost::posix_time::microseconds(long(wait*1e6)));
+        _recv_mem = _resps.front().pkt;
+        _resps.pop_front();
+        return _recv_buff.get_new(&_recv_mem.front(), _recv_mem.size()*sizeof(uint32_t));
+    }
+
+    size_t get_num_recv_frames(void) const{ return NUM_RESP_FRAMES; }
+    size_t get_recv_frame_size(void) const{ return 64; }
+
+    managed_send_buffer::sptr get_send_buff(double)
+    {
+        _send_mem.assign(16, 0);
+        return _send_buff.get_new(&_send_mem.front(), _send_mem.size()*sizeof(uint32_t));
+    }
+
+    size_t get_num_send_frames(void) const{ return 1; }
+    size_t get_send_frame_size(void) const{ return 64; }
+
+private:
+    struct resp_t{
+        time_spec_t due;
+        std::vector<uint32_t> pkt;
+    };
+
+    class loopback_msb : public managed_send_buffer{
+    public:
+        loopback_msb(loopback_ctrl_xport *xport): _xport(xport){}
+        void release(void){ _xport->handle_pkt(size()); }
+        sptr get_new(void *mem, size_t len){ return make(this, mem, len); }
+    private:
+        loopback_ctrl_xport *_xport;
+    };
+
+    class loopback_mrb : public managed_recv_buffer{
+    public:
+        void release(void){}
+        sptr get_new(void *mem, size_t len){ return make(this, mem, len); }
+    };
+
+    void handle_pkt(const size_t len)
+    {
+        vrt::if_packet_info_t info;
+        info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+        info.num_packet_words32 = len/sizeof(uint32_t);
+        vrt::if_hdr_unpack_be(&_send_mem.front(), info);
+        _writes.push_back(shd::ntohx(_send_mem[info.num_header_words32+1]));
+        _num_pkts++;
+
+        vrt::if_packet_info_t resp_info;
+        resp_info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+        resp_info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_CONTEXT;
+        resp_info.num_payload_words32 = 2;
+        resp_info.num_payload_bytes = 8;
+        resp_info.packet_count = (info.packet_count == _bad_seq)? info.packet_count+1 : info.packet_count;
+        resp_info.sob = false;
+        resp_info.eob = false;
+        resp_info.sid = (info.sid >> 16) | (info.sid << 16);
+        resp_info.has_sid = true;
+        resp_info.has_cid = false;
+        resp_info.has_tsi = false;
+        resp_info.has_tsf = false;
+        resp_info.has_tlr = false;
+        resp_t resp;
+        resp.pkt.assign(16, 0);
+        vrt::if_hdr_pack_be(&resp.pkt.front(), resp_info);
+        resp.pkt.resize(resp_info.num_packet_words32);
+        resp.due = time_spec_t::get_system_time() + time_spec_t(_rtt);
+        _resps.push_back(resp);
+    }
+
+    const double _rtt;
+    loopback_msb _send_buff;
+    loopback_mrb _recv_buff;
+    std::vector<uint32_t> _send_mem, _recv_mem;
+    std::deque<resp_t> _resps;
+    size_t _bad_seq;
+    size_t _num_pkts;
+    std::vector<uint32_t> _writes;
+};
+
+static wb_iface::poke32_list_type make_writes(const size_t num_writes)
+{
+    wb_iface::poke32_list_type writes;
+    for (size_t i = 0; i < num_writes; i++) {
+        writes.push_back(std::make_pair(wb_iface::wb_addr_type(4*(100+i)), uint32_t(i)));
+    }
+    return writes;
+}
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_batch_writes)
+{
+    loopback_ctrl_xport::sptr xport = boost::make_shared<loopback_ctrl_xport>(0.0);
+    radio_ctrl_core_3000::sptr ctrl = radio_ctrl_core_3000::make(true, xport, xport, CTRL_SID);
+
+    ctrl->poke32_batch(make_writes(40));
+    BOOST_REQUIRE_EQUAL(xport->get_writes().size(), 40);
+    for (size_t i = 0; i < 40; i++) {
+        BOOST_CHECK_EQUAL(xport->get_writes()[i], i);
+    }
+
+    //a transaction does nothing until committed
+    wb_transaction transaction(*ctrl);
+    transaction.poke32(0x10, 1);
+    transaction.poke32(0x14, 2);
+    BOOST_CHECK_EQUAL(transaction.size(), 2);
+    BOOST_CHECK_EQUAL(xport->get_num_pkts(), 40);
+    transaction.commit();
+    BOOST_CHECK_EQUAL(transaction.size(), 0);
+    BOOST_CHECK_EQUAL(xport->get_num_pkts(), 42);
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_error)
+{
+    loopback_ctrl_xport::sptr xport = boost::make_shared<loopback_ctrl_xport>(0.0);
+    radio_ctrl_core_3000::sptr ctrl = radio_ctrl_core_3000::make(true, xport, xport, CTRL_SID);
+
+    //the bad ack belongs to the transaction, which must not return without it
+    xport->set_bad_seq(xport->get_num_pkts() + 5);
+    BOOST_CHECK_THROW(ctrl->poke32_batch(make_writes(8)), shd::io_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_ack_window)
+{
+    const size_t num_writes = 32;
+    const double rtt = 0.0005;
+    loopback_ctrl_xport::sptr xport = boost::make_shared<loopback_ctrl_xport>(rtt);
+    radio_ctrl_core_3000::sptr ctrl = radio_ctrl_core_3000::make(true, xport, xport, CTRL_SID);
+    const wb_iface::poke32_list_type writes = make_writes(num_writes);
+
+    //one round trip per write
+    ctrl->set_ack_window(1);
+    time_spec_t start = time_spec_t::get_system_time();
+    ctrl->poke32_batch(writes);
+    const double serial_time = (time_spec_t::get_system_time() - start).get_real_secs();
+
+    //writes in flight, limited to the number of response frames
+    ctrl->set_ack_window(1000);
+    start = time_spec_t::get_system_time();
+    ctrl->poke32_batch(writes);
+    const double batch_time = (time_spec_t::get_system_time() - start).get_real_secs();
+
+    std::cout << num_writes << " writes, one ack window:  " << serial_time*1e3 << " ms" << std::endl;
+    std::cout << num_writes << " writes, " << NUM_RESP_FRAMES << " ack window: " << batch_time*1e3 << " ms" << std::endl;
+    BOOST_CHECK_GE(serial_time, num_writes*rtt);
+    BOOST_CHECK_LT(batch_time, serial_time/4);
+}
@@ -0,0 +1,250 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/rx_host_dsp.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace shd;
+
+typedef std::complex<float> fc32_t;
+
+static const double PI = boost::math::constants::pi<double>();
+
+/***********************************************************************
+ * A streamer of a complex tone with time specs, in bursts or continuous
+ **********************************************************************/
+class tone_rx_streamer : public rx_streamer
+{
+public:
+    tone_rx_streamer(const size_t num_chans, const double rate, const double freq):
+        _num_chans(num_chans), _rate(rate), _freq(freq), _next(0), _burst_samps(0)
+    {
+        /* NOP */
+    }
+
+    size_t get_num_channels(void) const{ return _num_chans; }
+    size_t get_max_num_samps(void) const{ return 1000; }
+
+    size_t recv(const buffs_type &buffs, const size_t nsamps_per_buff,
+        rx_metadata_t &md, const double, const bool)
+    {
+        md.reset();
+        size_t nsamps = std::min(nsamps_per_buff, get_max_num_samps());
+        if (_burst_samps != 0) nsamps = std::min(nsamps, _burst_samps - _next);
+        if (nsamps == 0) {
+            md.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+            return 0;
+        }
+        for (size_t ch = 0; ch < _num_chans; ch++) {
+            fc32_t *samps = reinterpret_cast<fc32_t *>(buffs[ch]);
+            for (size_t i = 0; i < nsamps; i++) samps[i] = expected(ch, _freq*(_next + i));
+        }
+        md.has_time_spec = true;
+        md.time_spec = time_spec_t::from_ticks(_next, _rate);
+        md.start_of_burst = _next == 0;
+        _next += nsamps;
+        md.end_of_burst = _next == _burst_samps;
+        return nsamps;
+    }
+
+    void issue_stream_cmd(const stream_cmd_t &cmd)
+    {
+        _next = 0;
+        _burst_samps = cmd.num_samps;
+    }
+
+    //! The sample of a channel at a phase in cycles
+    static fc32_t expected(const size_t ch, const double phase)
+    {
+        return std::polar(float(1.0/(ch + 1)), float(2*PI*(phase - std::floor(phase))));
+    }
+
+private:
+    const size_t _num_chans;
+    const double _rate, _freq;
+    size_t _next, _burst_samps;
+};
+
+//! Receive num_samps or until the end of the burst
+static size_t recv_all(rx_streamer::sptr rx_stream, std::vector<std::vector<fc32_t> > &samps,
+    const size_t num_samps, std::vector<rx_metadata_t> &mds, std::vector<size_t> &offsets)
+{
+    samps.assign(rx_stream->get_num_channels(), std::vector<fc32_t>(num_samps));
+    size_t num_recvd = 0;
+    while (num_recvd < num_samps) {
+        rx_streamer::buffs_type::value_type buffs[4];
+        for (size_t ch = 0; ch < samps.size(); ch++) buffs[ch] = &samps[ch][num_recvd];
+        rx_metadata_t md;
+        const size_t n = rx_stream->recv(
+            rx_streamer::buffs_type(buffs, samps.size()), std::min<size_t>(num_samps - num_recvd, 3000), md, 0.0);
+        if (n == 0) break;
+        mds.push_back(md);
+        offsets.push_back(num_recvd);
+        num_recvd += n;
+        if (md.end_of_burst) break;
+    }
+    return num_recvd;
+}
+
+//! Get the largest error to a tone of a frequency in cycles per output sample
+static double max_tone_error(const std::vector<fc32_t> &samps, const size_t ch,
+    const double freq, const size_t begin, const size_t end)
+{
+    double max_error = 0.0;
+    for (size_t i = begin; i < end; i++) {
+        max_error = std::max<double>(max_error,
+            std::abs(samps[i] - tone_rx_streamer::expected(ch, freq*i)));
+    }
+    return max_error;
+}
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_host_dsp_is_requested)
+{
+    stream_args_t args("fc32");
+    BOOST_CHECK(not rx_host_dsp::is_requested(args));
+    args.args = device_addr_t("host_rate=1e6");
+    BOOST_CHECK(rx_host_dsp::is_requested(args));
+    args.args = device_addr_t("host_freq=1e3");
+    BOOST_CHECK(rx_host_dsp::is_requested(args));
+    BOOST_CHECK(not rx_host_dsp::get_simd_name().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_host_dsp_bad_args)
+{
+    rx_streamer::sptr rx_stream = boost::make_shared<tone_rx_streamer>(1, 1e6, 0.0);
+    stream_args_t args("sc16");
+    args.args = device_addr_t("host_rate=1e6");
+    BOOST_CHECK_THROW(rx_host_dsp::make(rx_stream, args, 1e6), shd::value_error);
+    args.cpu_format = "fc32";
+    args.args = device_addr_t("host_rate=1e3");
+    BOOST_CHECK_THROW(rx_host_dsp::make(rx_stream, args, 1e6), shd::value_error);
+    args.args = device_addr_t("host_rate=-1");
+    BOOST_CHECK_THROW(rx_host_dsp::make(rx_stream, args, 1e6), shd::value_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_host_dsp_resample)
+{
+    const double in_rate = 1e6, ratio = 0.75, freq = 0.05;
+    rx_streamer::sptr rx_stream = boost::make_shared<tone_rx_streamer>(2, in_rate, freq);
+    stream_args_t args("fc32");
+    args.args = device_addr_t("host_rate=750e3");
+    rx_host_dsp::sptr dsp = rx_host_dsp::make(rx_stream, args, in_rate);
+    BOOST_CHECK_EQUAL(dsp->get_rate(), 750e3);
+    BOOST_CHECK_EQUAL(dsp->get_num_channels(), 2);
+    BOOST_CHECK_EQUAL(dsp->get_max_num_samps(), 750);
+    const size_t num_taps = dsp->get_num_taps();
+    BOOST_REQUIRE(num_taps != 0);
+
+    const size_t num_samps = 20000;
+    std::vector<std::vector<fc32_t> > samps;
+    std::vector<rx_metadata_t> mds;
+    std::vector<size_t> offsets;
+    BOOST_REQUIRE_EQUAL(recv_all(dsp, samps, num_samps, mds, offsets), num_samps);
+
+    //the output n is the input at n/ratio once the filter is full
+    for (size_t ch = 0; ch < 2; ch++) {
+        BOOST_CHECK_LT(max_tone_error(samps[ch], ch, freq/ratio, num_taps, num_samps), 2e-3);
+    }
+
+    //the time specs count output samples from the first input
+    for (size_t i = 0; i < mds.size(); i++) {
+        BOOST_CHECK(mds[i].has_time_spec);
+        BOOST_CHECK_EQUAL(mds[i].start_of_burst, i == 0);
+        BOOST_CHECK_EQUAL(mds[i].time_spec.to_ticks(dsp->get_rate()), (long long)offsets[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_host_dsp_shift)
+{
+    //the NCO alone shifts the tone to DC in place
+    const double in_rate = 1e6, freq = -0.123;
+    rx_streamer::sptr rx_stream = boost::make_shared<tone_rx_streamer>(1, in_rate, freq);
+    stream_args_t args("fc32");
+    args.args = device_addr_t("host_freq=-123e3");
+    rx_host_dsp::sptr dsp = rx_host_dsp::make(rx_stream, args, in_rate);
+    BOOST_CHECK_EQUAL(dsp->get_num_taps(), 0);
+
+    const size_t num_samps = 100000;
+    std::vector<std::vector<fc32_t> > samps;
+    std::vector<rx_metadata_t> mds;
+    std::vector<size_t> offsets;
+    BOOST_REQUIRE_EQUAL(recv_all(dsp, samps, num_samps, mds, offsets), num_samps);
+    BOOST_CHECK_LT(max_tone_error(samps[0], 0, 0.0, 0, num_samps), 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(test_host_dsp_shift_and_resample_threads)
+{
+    //the same outputs with worker threads as without
+    const double in_rate = 1e6, freq = 0.2;
+    std::vector<std::vector<fc32_t> > samps[2];
+    for (size_t t = 0; t < 2; t++) {
+        rx_streamer::sptr rx_stream = boost::make_shared<tone_rx_streamer>(3, in_rate, freq);
+        stream_args_t args("fc32");
+        args.args = device_addr_t("host_rate=400e3,host_freq=190e3");
+        if (t == 1) args.args["dsp_threads"] = "2";
+        rx_host_dsp::sptr dsp = rx_host_dsp::make(rx_stream, args, in_rate);
+
+        const size_t num_samps = 10000;
+        std::vector<rx_metadata_t> mds;
+        std::vector<size_t> offsets;
+        BOOST_REQUIRE_EQUAL(recv_all(dsp, samps[t], num_samps, mds, offsets), num_samps);
+        //10 kHz after the shift is 0.025 cycles per output
+        for (size_t ch = 0; ch < 3; ch++) {
+            BOOST_CHECK_LT(max_tone_error(samps[t][ch], ch, 0.025, dsp->get_num_taps(), num_samps), 2e-3);
+        }
+    }
+    for (size_t ch = 0; ch < 3; ch++) {
+        BOOST_CHECK(samps[0][ch] == samps[1][ch]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_host_dsp_burst)
+{
+    //a burst of outputs asks for the inputs that make them and ends on time
+    const double in_rate = 1e6, freq = 0.01;
+    rx_streamer::sptr rx_stream = boost::make_shared<tone_rx_streamer>(1, in_rate, freq);
+    stream_args_t args("fc32");
+    args.args = device_addr_t("host_rate=2.5e6");
+    rx_host_dsp::sptr dsp = rx_host_dsp::make(rx_stream, args, in_rate);
+
+    for (size_t burst = 0; burst < 2; burst++) {
+        stream_cmd_t cmd(stream_cmd_t::STREAM_MODE_NUM_SAMPS_AND_DONE);
+        cmd.num_samps = 12345;
+        dsp->issue_stream_cmd(cmd);
+
+        std::vector<std::vector<fc32_t> > samps;
+        std::vector<rx_metadata_t> mds;
+        std::vector<size_t> offsets;
+        BOOST_CHECK_EQUAL(recv_all(dsp, samps, 20000, mds, offsets), 12345);
+        BOOST_REQUIRE(not mds.empty());
+        BOOST_CHECK(mds.front().start_of_burst);
+        BOOST_CHECK(mds.back().end_of_burst);
+        BOOST_CHECK_EQUAL(mds.front().time_spec.get_real_secs(), 0.0);
+        BOOST_CHECK_LT(max_tone_error(samps[0], 0, freq/2.5,
+            dsp->get_num_taps()*3, 12345 - dsp->get_num_taps()*3), 2e-3);
+    }
+}
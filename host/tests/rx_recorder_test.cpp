@@ -0,0 +1,171 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/rx_recorder.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace shd;
+namespace fs = boost::filesystem;
+
+/***********************************************************************
+ * A streamer of sample counters, which overflows once
+ **********************************************************************/
+class counter_rx_streamer : public rx_streamer
+{
+public:
+    counter_rx_streamer(const size_t num_chans, const size_t num_samps, const size_t overflow_at):
+        _num_chans(num_chans), _num_samps(num_samps), _overflow_at(overflow_at), _next(0)
+    {
+        /* NOP */
+    }
+
+    size_t get_num_channels(void) const{ return _num_chans; }
+    size_t get_max_num_samps(void) const{ return 1000; }
+
+    size_t recv(const buffs_type &buffs, const size_t nsamps_per_buff,
+        rx_metadata_t &md, const double, const bool)
+    {
+        md.reset();
+        if (_next == _overflow_at) {
+            _overflow_at = ~size_t(0);
+            md.error_code = rx_metadata_t::ERROR_CODE_OVERFLOW;
+            return 0;
+        }
+        const size_t nsamps = std::min(std::min(nsamps_per_buff, get_max_num_samps()), _num_samps - _next);
+        if (nsamps == 0) {
+            md.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+            return 0;
+        }
+        for (size_t ch = 0; ch < _num_chans; ch++) {
+            uint32_t *samps = reinterpret_cast<uint32_t *>(buffs[ch]);
+            for (size_t i = 0; i < nsamps; i++) samps[i] = expected(ch, _next + i);
+        }
+        _next += nsamps;
+        return nsamps;
+    }
+
+    void issue_stream_cmd(const stream_cmd_t &){}
+
+    static uint32_t expected(const size_t ch, const size_t n)
+    {
+        return uint32_t((ch << 28) | n);
+    }
+
+private:
+    const size_t _num_chans, _num_samps;
+    size_t _overflow_at, _next;
+};
+
+struct temp_dir_fixture
+{
+    temp_dir_fixture(void): dir(fs::temp_directory_path() / fs::unique_path())
+    {
+        fs::create_directories(dir);
+    }
+    ~temp_dir_fixture(void)
+    {
+        fs::remove_all(dir);
+    }
+
+    std::vector<std::string> files(const size_t num_chans)
+    {
+        std::vector<std::string> names;
+        for (size_t ch = 0; ch < num_chans; ch++) {
+            names.push_back((dir / str(boost::format("ch%u.dat") % ch)).string());
+        }
+        return names;
+    }
+
+    fs::path dir;
+};
+
+static void check_file(const std::string &file, const size_t ch, const size_t num_samps)
+{
+    BOOST_REQUIRE_EQUAL(fs::file_size(file), num_samps*sizeof(uint32_t));
+    std::vector<uint32_t> samps(num_samps);
+    std::ifstream in(file.c_str(), std::ios::binary);
+    in.read(reinterpret_cast<char *>(&samps.front()), num_samps*sizeof(uint32_t));
+    size_t num_wrong = 0;
+    for (size_t i = 0; i < num_samps; i++) {
+        if (samps[i] != counter_rx_streamer::expected(ch, i)) num_wrong++;
+    }
+    BOOST_CHECK_EQUAL(num_wrong, 0);
+}
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_record_until_timeout)
+{
+    temp_dir_fixture tmp;
+    const size_t num_samps = 5*4096 + 123;
+    rx_streamer::sptr rx_stream = boost::make_shared<counter_rx_streamer>(2, num_samps, 3000);
+
+    //small buffers, so the last one is partial and the writer falls behind
+    rx_recorder::sptr recorder = rx_recorder::make(
+        rx_stream, "sc16", tmp.files(2), device_addr_t("buff_size=16384,num_buffs=2"));
+    BOOST_CHECK_EQUAL(recorder->record(0), num_samps);
+    recorder->close();
+
+    const rx_recorder::stats_t stats = recorder->get_stats();
+    BOOST_CHECK_EQUAL(stats.num_samps, num_samps);
+    BOOST_CHECK_EQUAL(stats.num_bytes_written, 2*num_samps*sizeof(uint32_t));
+    BOOST_CHECK_EQUAL(stats.num_overflows, 1);
+    BOOST_CHECK_EQUAL(stats.num_errors, 0);
+    check_file(tmp.files(2)[0], 0, num_samps);
+    check_file(tmp.files(2)[1], 1, num_samps);
+}
+
+BOOST_AUTO_TEST_CASE(test_record_num_samps)
+{
+    temp_dir_fixture tmp;
+    rx_streamer::sptr rx_stream = boost::make_shared<counter_rx_streamer>(1, 100000, ~size_t(0));
+    rx_recorder::sptr recorder = rx_recorder::make(
+        rx_stream, "sc16", tmp.files(1), device_addr_t("buff_size=16384"));
+
+    //the partial buffer carries over to the next call
+    BOOST_CHECK_EQUAL(recorder->record(5000), 5000);
+    BOOST_CHECK_EQUAL(recorder->record(3001), 3001);
+    recorder.reset();
+    check_file(tmp.files(1)[0], 0, 8001);
+}
+
+BOOST_AUTO_TEST_CASE(test_record_buffered)
+{
+    temp_dir_fixture tmp;
+    rx_streamer::sptr rx_stream = boost::make_shared<counter_rx_streamer>(1, 10000, ~size_t(0));
+    rx_recorder::sptr recorder = rx_recorder::make(
+        rx_stream, "sc16", tmp.files(1), device_addr_t("direct=0"));
+    BOOST_CHECK_EQUAL(recorder->record(0), 10000);
+    recorder->close();
+    BOOST_CHECK(not recorder->get_stats().direct_io);
+    check_file(tmp.files(1)[0], 0, 10000);
+}
+
+BOOST_AUTO_TEST_CASE(test_record_wrong_files)
+{
+    temp_dir_fixture tmp;
+    rx_streamer::sptr rx_stream = boost::make_shared<counter_rx_streamer>(2, 100, ~size_t(0));
+    BOOST_CHECK_THROW(rx_recorder::make(rx_stream, "sc16", tmp.files(1)), shd::value_error);
+}
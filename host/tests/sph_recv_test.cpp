@@ -19,6 +19,7 @@
 #include "../lib/transport/super_recv_packet_handler.hpp"
 #include <boost/shared_array.hpp>
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <complex>
 #include <vector>
 #include <list>
@@ -39,6 +40,25 @@ struct overflow_handler_type{
     size_t num_overflow;
 };
 
+/***********************************************************************
+ * A dummy flow control handler for testing
+ **********************************************************************/
+struct flowctrl_handler_type{
+    flowctrl_handler_type(void){
+        num_refused = 0;
+    }
+    bool handle(const size_t seq){
+        if (num_refused > 0){
+            num_refused--;
+            return false; //no send buffer
+        }
+        acks.push_back(seq);
+        return true;
+    }
+    size_t num_refused;
+    std::vector<size_t> acks;
+};
+
 /***********************************************************************
  * A dummy managed receive buffer for testing
  **********************************************************************/
@@ -62,7 +82,7 @@ private:
  **********************************************************************/
 class dummy_recv_xport_class{
 public:
-    dummy_recv_xport_class(const std::string &end) : io_status(true) {
+    dummy_recv_xport_class(const std::string &end) : io_status(true), arrive_on_wait(false) {
         _end = end;
     }
 
@@ -70,6 +90,11 @@ public:
         io_status = status;
     }
 
+    //! Packets are only there when the caller waits for them
+    void set_arrive_on_wait(bool arrive){
+        arrive_on_wait = arrive;
+    }
+
     void push_back_packet(
         shd::transport::vrt::if_packet_info_t &ifpi,
         const uint32_t optional_msg_word = 0
@@ -86,9 +111,21 @@ public:
         _lens.push_back(ifpi.num_packet_words32*sizeof(uint32_t));
     }
 
-    shd::transport::managed_recv_buffer::sptr get_recv_buff(double){
+    void push_back_packet_with_payload(
+        shd::transport::vrt::if_packet_info_t &ifpi,
+        const uint32_t first_word
+    ){
+        this->push_back_packet(ifpi);
+        uint32_t *payload = reinterpret_cast<uint32_t *>(_mems.back().get()) + ifpi.num_header_words32;
+        for (size_t i = 0; i < ifpi.num_payload_words32; i++){
+            payload[i] = uint32_t(first_word + i*0x00010003);
+        }
+    }
+
+    shd::transport::managed_recv_buffer::sptr get_recv_buff(double timeout){
         if (!io_status) throw shd::io_error("IO error exception"); //simulate an IO error
         if (_mems.empty()) return shd::transport::managed_recv_buffer::sptr(); //timeout
+        if (arrive_on_wait and timeout == 0.0) return shd::transport::managed_recv_buffer::sptr();
         _mrbs.push_back(boost::shared_ptr<dummy_mrb>(new dummy_mrb()));
         shd::transport::managed_recv_buffer::sptr mrb = _mrbs.back()->get_new(_mems.front(), _lens.front());
         _mems.pop_front();
@@ -102,6 +139,7 @@ private:
     std::vector<boost::shared_ptr<dummy_mrb> > _mrbs;
     std::string _end;
     bool io_status;
+    bool arrive_on_wait;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -133,9 +171,11 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_normal){
     static const size_t NUM_PKTS_TO_TEST = 30;
 
     //generate a bunch of packets
+    size_t num_accum_bytes = 0;
     for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
         ifpi.num_payload_words32 = 10 + i%10;
         dummy_recv_xport.push_back_packet(ifpi);
+        num_accum_bytes += ifpi.num_packet_words32*sizeof(uint32_t);
         ifpi.packet_count++;
         ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
     }
@@ -174,6 +214,20 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_normal){
         BOOST_CHECK_EQUAL(metadata.error_code, shd::rx_metadata_t::ERROR_CODE_TIMEOUT);
     }
 
+    //check the counters
+    const shd::stream_metrics_t metrics = handler.get_metrics();
+    BOOST_CHECK_EQUAL(metrics.num_calls, NUM_PKTS_TO_TEST + 3);
+    BOOST_CHECK_EQUAL(metrics.num_samps, num_accum_samps);
+    BOOST_CHECK_EQUAL(metrics.num_timeouts, 3);
+    BOOST_CHECK_EQUAL(metrics.num_overflows, 0);
+    BOOST_CHECK_EQUAL(metrics.num_seq_errors, 0);
+    BOOST_REQUIRE_EQUAL(metrics.xports.size(), 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_packets, NUM_PKTS_TO_TEST);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_bytes, num_accum_bytes);
+    uint64_t num_hist_calls = 0;
+    BOOST_FOREACH(const uint64_t num, metrics.latency_hist) num_hist_calls += num;
+    BOOST_CHECK_EQUAL(num_hist_calls, metrics.num_calls);
+
     //simulate the transport failing
     dummy_recv_xport.set_io_status(false);
     BOOST_REQUIRE_THROW(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), shd::io_error);
@@ -260,6 +314,14 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_sequence_error){
         BOOST_CHECK_EQUAL(metadata.error_code, shd::rx_metadata_t::ERROR_CODE_TIMEOUT);
     }
 
+    //the lost packet is counted for the streamer and the transport
+    const shd::stream_metrics_t metrics = handler.get_metrics();
+    BOOST_CHECK_EQUAL(metrics.num_seq_errors, 1);
+    BOOST_CHECK_EQUAL(metrics.num_overflows, 0);
+    BOOST_REQUIRE_EQUAL(metrics.xports.size(), 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_seq_errors, 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_packets, NUM_PKTS_TO_TEST - 1);
+
     //simulate the transport failing
     dummy_recv_xport.set_io_status(false);
     BOOST_REQUIRE_THROW(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), shd::io_error);
@@ -356,11 +418,120 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_inline_message){
         BOOST_CHECK_EQUAL(metadata.error_code, shd::rx_metadata_t::ERROR_CODE_TIMEOUT);
     }
 
+    //the overflow message is counted as a packet and an overflow
+    const shd::stream_metrics_t metrics = handler.get_metrics();
+    BOOST_CHECK_EQUAL(metrics.num_overflows, 1);
+    BOOST_CHECK_EQUAL(metrics.num_seq_errors, 0);
+    BOOST_REQUIRE_EQUAL(metrics.xports.size(), 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_packets, NUM_PKTS_TO_TEST + 1);
+
     //simulate the transport failing
     dummy_recv_xport.set_io_status(false);
     BOOST_REQUIRE_THROW(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), shd::io_error);
 }
 
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_flowctrl){
+////////////////////////////////////////////////////////////////////////
+    shd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    dummy_recv_xport_class dummy_recv_xport("big");
+    shd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = shd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 10;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 150;
+    //the vrt packets have 4 bit sequence numbers
+    static const size_t MIN_WINDOW = 2;
+    static const size_t MAX_WINDOW = 12;
+
+    //generate a bunch of packets
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        dummy_recv_xport.push_back_packet(ifpi);
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+    }
+
+    //create the super receive packet handler
+    shd::transport::sph::recv_packet_handler handler(1);
+    handler.set_vrt_unpacker(&shd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xport, _1));
+    handler.set_converter(id);
+
+    flowctrl_handler_type flowctrl_handler;
+    handler.set_xport_handle_flowctrl(
+        0, boost::bind(&flowctrl_handler_type::handle, &flowctrl_handler, _1),
+        MIN_WINDOW, true, MAX_WINDOW
+    );
+    BOOST_REQUIRE_EQUAL(flowctrl_handler.acks.size(), 1);
+
+    std::vector<std::complex<float> > buff(10);
+    shd::rx_metadata_t metadata;
+    size_t num_recvd = 0;
+    size_t num_acks = 1;
+
+    //the consumer keeps up: the interval grows up to the max
+    dummy_recv_xport.set_arrive_on_wait(true);
+    for (; num_recvd < 50; num_recvd++){
+        BOOST_REQUIRE_EQUAL(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), 10);
+    }
+    const std::vector<size_t> &acks = flowctrl_handler.acks;
+    size_t last_interval = 0;
+    for (; num_acks < acks.size(); num_acks++){
+        const size_t interval = (acks[num_acks] - acks[num_acks-1]) & 0xf;
+        BOOST_CHECK(interval >= last_interval);
+        last_interval = interval;
+    }
+    BOOST_CHECK_EQUAL(last_interval, MAX_WINDOW);
+
+    //the packets are waiting: the interval shrinks to the min
+    dummy_recv_xport.set_arrive_on_wait(false);
+    for (; num_recvd < 100; num_recvd++){
+        BOOST_REQUIRE_EQUAL(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), 10);
+    }
+    for (; num_acks < acks.size(); num_acks++){
+        const size_t interval = (acks[num_acks] - acks[num_acks-1]) & 0xf;
+        BOOST_CHECK(interval <= last_interval);
+        last_interval = interval;
+    }
+    BOOST_CHECK_EQUAL(last_interval, MIN_WINDOW);
+
+    //an ack that cannot be sent is sent with the next packet
+    flowctrl_handler.num_refused = 2;
+    for (; num_recvd < NUM_PKTS_TO_TEST; num_recvd++){
+        BOOST_REQUIRE_EQUAL(handler.recv(&buff.front(), buff.size(), metadata, 1.0, true), 10);
+    }
+    BOOST_REQUIRE(acks.size() > num_acks);
+    BOOST_CHECK_EQUAL((acks[num_acks] - acks[num_acks-1]) & 0xf, MIN_WINDOW + 2);
+    BOOST_CHECK_EQUAL((acks[num_acks+1] - acks[num_acks]) & 0xf, MIN_WINDOW);
+
+    //the acks and the waiting packets are counted
+    const shd::stream_metrics_t metrics = handler.get_metrics();
+    BOOST_REQUIRE_EQUAL(metrics.xports.size(), 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_packets, NUM_PKTS_TO_TEST);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_fc_acks, acks.size() - 1);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_queued_packets, NUM_PKTS_TO_TEST - 50);
+    BOOST_CHECK_EQUAL(metrics.xports[0].max_queued_packets, NUM_PKTS_TO_TEST - 50);
+}
+
 ////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_normal){
 ////////////////////////////////////////////////////////////////////////
@@ -450,6 +621,100 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_normal){
     BOOST_REQUIRE_THROW(handler.recv(buffs, NUM_SAMPS_PER_BUFF, metadata, 1.0, true), shd::io_error);
 }
 
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_convert_threads){
+////////////////////////////////////////////////////////////////////////
+    shd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    shd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = shd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t NUM_SAMPS_PER_BUFF = 20;
+    static const size_t NCHANNELS = 4;
+
+    //the same packets go to a serial handler and a threaded handler
+    std::vector<dummy_recv_xport_class> serial_xports(NCHANNELS, dummy_recv_xport_class("big"));
+    std::vector<dummy_recv_xport_class> threaded_xports(NCHANNELS, dummy_recv_xport_class("big"));
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = 10 + i%10;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            const uint32_t first_word = uint32_t(ch*0x01000100 + i*0x00050007);
+            serial_xports[ch].push_back_packet_with_payload(ifpi, first_word);
+            threaded_xports[ch].push_back_packet_with_payload(ifpi, first_word);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+    }
+
+    //create the super receive packet handlers
+    shd::transport::sph::recv_packet_handler serial_handler(NCHANNELS);
+    shd::transport::sph::recv_packet_handler threaded_handler(NCHANNELS);
+    serial_handler.set_vrt_unpacker(&shd::transport::vrt::if_hdr_unpack_be);
+    threaded_handler.set_vrt_unpacker(&shd::transport::vrt::if_hdr_unpack_be);
+    serial_handler.set_tick_rate(TICK_RATE);
+    threaded_handler.set_tick_rate(TICK_RATE);
+    serial_handler.set_samp_rate(SAMP_RATE);
+    threaded_handler.set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        serial_handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &serial_xports[ch], _1));
+        threaded_handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &threaded_xports[ch], _1));
+    }
+    serial_handler.set_converter(id);
+    threaded_handler.set_converter(id);
+    threaded_handler.set_convert_threads(shd::device_addr_t("convert_threads=3"));
+    serial_handler.set_scale_factor(1/16384.);
+    threaded_handler.set_scale_factor(1/16384.);
+
+    //check that both handlers produce the same samples
+    std::vector<std::complex<float> > serial_mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<std::complex<float> > threaded_mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<std::complex<float> *> serial_buffs(NCHANNELS), threaded_buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        serial_buffs[ch] = &serial_mem[ch*NUM_SAMPS_PER_BUFF];
+        threaded_buffs[ch] = &threaded_mem[ch*NUM_SAMPS_PER_BUFF];
+    }
+    shd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        const size_t num_samps_serial = serial_handler.recv(
+            serial_buffs, NUM_SAMPS_PER_BUFF, metadata, 1.0, true
+        );
+        const size_t num_samps_threaded = threaded_handler.recv(
+            threaded_buffs, NUM_SAMPS_PER_BUFF, metadata, 1.0, true
+        );
+        BOOST_CHECK_EQUAL(metadata.error_code, shd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_REQUIRE_EQUAL(num_samps_threaded, num_samps_serial);
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            BOOST_CHECK_EQUAL_COLLECTIONS(
+                serial_buffs[ch], serial_buffs[ch] + num_samps_serial,
+                threaded_buffs[ch], threaded_buffs[ch] + num_samps_threaded
+            );
+        }
+    }
+
+    //subsequent receives should be a timeout
+    threaded_handler.recv(threaded_buffs, NUM_SAMPS_PER_BUFF, metadata, 1.0, true);
+    BOOST_CHECK_EQUAL(metadata.error_code, shd::rx_metadata_t::ERROR_CODE_TIMEOUT);
+}
+
 ////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_sequence_error){
 ////////////////////////////////////////////////////////////////////////
@@ -20,6 +20,7 @@
 #include <boost/shared_array.hpp>
 #include <boost/bind.hpp>
 #include <complex>
+#include <cmath>
 #include <vector>
 #include <list>
 
@@ -49,10 +50,35 @@ private:
  **********************************************************************/
 class dummy_send_xport_class{
 public:
-    dummy_send_xport_class(const std::string &end){
+    dummy_send_xport_class(const std::string &end):
+        _num_flushes(0), _num_packets_at_flush(0), _stall(false), _full(false)
+    {
         _end = end;
     }
 
+    //! Have no buffer right away, only when waiting
+    void set_stall(const bool stall){
+        _stall = stall;
+    }
+
+    //! Have no buffer at all
+    void set_full(const bool full){
+        _full = full;
+    }
+
+    void flush(void){
+        _num_flushes++;
+        _num_packets_at_flush = _mems.size();
+    }
+
+    size_t get_num_flushes(void) const{
+        return _num_flushes;
+    }
+
+    size_t get_num_packets_at_flush(void) const{
+        return _num_packets_at_flush;
+    }
+
     void pop_front_packet(
         shd::transport::vrt::if_packet_info_t &ifpi
     ){
@@ -67,7 +93,18 @@ public:
         _lens.pop_front();
     }
 
-    shd::transport::managed_send_buffer::sptr get_send_buff(double){
+    void pop_front_packet(
+        shd::transport::vrt::if_packet_info_t &ifpi,
+        std::vector<uint32_t> &payload
+    ){
+        const boost::shared_array<char> mem = _mems.front();
+        this->pop_front_packet(ifpi);
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(mem.get()) + ifpi.num_header_words32;
+        payload.assign(words, words + ifpi.num_payload_words32);
+    }
+
+    shd::transport::managed_send_buffer::sptr get_send_buff(double timeout){
+        if (_full or (_stall and timeout == 0.0)) return shd::transport::managed_send_buffer::sptr();
         _msbs.push_back(boost::shared_ptr<dummy_msb>(new dummy_msb()));
         _mems.push_back(boost::shared_array<char>(new char[1000]));
         _lens.push_back(1000);
@@ -80,8 +117,16 @@ private:
     std::list<size_t> _lens;
     std::vector<boost::shared_ptr<dummy_msb> > _msbs;
     std::string _end;
+    size_t _num_flushes;
+    size_t _num_packets_at_flush;
+    bool _stall, _full;
 };
 
+static bool underflow_async_receiver(shd::async_metadata_t &md, const double){
+    md.event_code = shd::async_metadata_t::EVENT_CODE_UNDERFLOW;
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_one_packet_mode){
 ////////////////////////////////////////////////////////////////////////
@@ -190,3 +235,167 @@ BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_full_buffer_mode){
         num_accum_samps += ifpi.num_payload_words32;
     }
 }
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_flush){
+////////////////////////////////////////////////////////////////////////
+    shd::convert::id_type id;
+    id.input_format = "fc32";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    static const size_t NUM_PKTS_TO_TEST = 30;
+
+    //create the super send packet handler
+    shd::transport::sph::send_packet_handler handler(1);
+    handler.set_vrt_packer(&shd::transport::vrt::if_hdr_pack_be);
+    handler.set_tick_rate(100e6);
+    handler.set_samp_rate(10e6);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    handler.set_xport_chan_flush(0, boost::bind(&dummy_send_xport_class::flush, &dummy_send_xport));
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(20);
+
+    //allocate metadata and buffer
+    std::vector<std::complex<float> > buff(20*NUM_PKTS_TO_TEST);
+    shd::tx_metadata_t metadata;
+    metadata.start_of_burst = true;
+    metadata.end_of_burst = true;
+
+    //a multi-packet send is flushed once, after the last packet
+    handler.send(&buff.front(), buff.size(), metadata, 1.0);
+    BOOST_CHECK_EQUAL(dummy_send_xport.get_num_flushes(), 1UL);
+    BOOST_CHECK_EQUAL(dummy_send_xport.get_num_packets_at_flush(), NUM_PKTS_TO_TEST);
+
+    handler.send(&buff.front(), 10, metadata, 1.0);
+    BOOST_CHECK_EQUAL(dummy_send_xport.get_num_flushes(), 2UL);
+    BOOST_CHECK_EQUAL(dummy_send_xport.get_num_packets_at_flush(), NUM_PKTS_TO_TEST+1);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_metrics){
+////////////////////////////////////////////////////////////////////////
+    shd::convert::id_type id;
+    id.input_format = "fc32";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    static const size_t NUM_PKTS_TO_TEST = 10;
+
+    //create the super send packet handler
+    shd::transport::sph::send_packet_handler handler(1);
+    handler.set_vrt_packer(&shd::transport::vrt::if_hdr_pack_be);
+    handler.set_tick_rate(100e6);
+    handler.set_samp_rate(10e6);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    handler.set_async_receiver(&underflow_async_receiver);
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(20);
+
+    std::vector<std::complex<float> > buff(20*NUM_PKTS_TO_TEST);
+    shd::tx_metadata_t metadata;
+
+    //every packet has to wait for a buffer
+    dummy_send_xport.set_stall(true);
+    BOOST_CHECK_EQUAL(handler.send(&buff.front(), buff.size(), metadata, 1.0), buff.size());
+
+    //no buffer comes
+    dummy_send_xport.set_full(true);
+    BOOST_CHECK_EQUAL(handler.send(&buff.front(), 10, metadata, 1.0), 0UL);
+
+    shd::async_metadata_t async_metadata;
+    BOOST_CHECK(handler.recv_async_msg(async_metadata));
+
+    size_t num_accum_bytes = 0;
+    shd::transport::vrt::if_packet_info_t ifpi;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        dummy_send_xport.pop_front_packet(ifpi);
+        num_accum_bytes += (ifpi.num_header_words32 + ifpi.num_payload_words32 + (ifpi.has_tlr? 1 : 0))*sizeof(uint32_t);
+    }
+
+    const shd::stream_metrics_t metrics = handler.get_metrics();
+    BOOST_CHECK_EQUAL(metrics.num_calls, 2UL);
+    BOOST_CHECK_EQUAL(metrics.num_samps, buff.size());
+    BOOST_CHECK_EQUAL(metrics.num_timeouts, 1UL);
+    BOOST_CHECK_EQUAL(metrics.num_underflows, 1UL);
+    BOOST_CHECK_EQUAL(metrics.num_fc_stalls, NUM_PKTS_TO_TEST + 1);
+    BOOST_REQUIRE_EQUAL(metrics.xports.size(), 1UL);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_packets, NUM_PKTS_TO_TEST);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_bytes, num_accum_bytes);
+    BOOST_CHECK_EQUAL(metrics.xports[0].num_fc_stalls, NUM_PKTS_TO_TEST + 1);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_multi_channel_convert_threads){
+////////////////////////////////////////////////////////////////////////
+    shd::convert::id_type id;
+    id.input_format = "fc32";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t NCHANNELS = 4;
+
+    std::vector<dummy_send_xport_class> serial_xports(NCHANNELS, dummy_send_xport_class("big"));
+    std::vector<dummy_send_xport_class> threaded_xports(NCHANNELS, dummy_send_xport_class("big"));
+
+    //create the super send packet handlers
+    shd::transport::sph::send_packet_handler serial_handler(NCHANNELS);
+    shd::transport::sph::send_packet_handler threaded_handler(NCHANNELS);
+    serial_handler.set_vrt_packer(&shd::transport::vrt::if_hdr_pack_be);
+    threaded_handler.set_vrt_packer(&shd::transport::vrt::if_hdr_pack_be);
+    serial_handler.set_tick_rate(100e6);
+    threaded_handler.set_tick_rate(100e6);
+    serial_handler.set_samp_rate(10e6);
+    threaded_handler.set_samp_rate(10e6);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        serial_handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_send_xport_class::get_send_buff, &serial_xports[ch], _1));
+        threaded_handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_send_xport_class::get_send_buff, &threaded_xports[ch], _1));
+    }
+    serial_handler.set_converter(id);
+    threaded_handler.set_converter(id);
+    threaded_handler.set_convert_threads(shd::device_addr_t("convert_threads=3"));
+    serial_handler.set_max_samples_per_packet(20);
+    threaded_handler.set_max_samples_per_packet(20);
+
+    //different samples on every channel
+    std::vector<std::vector<std::complex<float> > > mem(NCHANNELS);
+    std::vector<const std::complex<float> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        for (size_t i = 0; i < 20*NUM_PKTS_TO_TEST; i++){
+            mem[ch].push_back(std::complex<float>(
+                std::sin(0.01f*i*(ch+1)), std::cos(0.02f*i*(ch+1))));
+        }
+        buffs[ch] = &mem[ch].front();
+    }
+
+    shd::tx_metadata_t metadata;
+    metadata.start_of_burst = true;
+    metadata.end_of_burst = true;
+    BOOST_CHECK_EQUAL(serial_handler.send(buffs, 20*NUM_PKTS_TO_TEST, metadata, 1.0), 20*NUM_PKTS_TO_TEST);
+    BOOST_CHECK_EQUAL(threaded_handler.send(buffs, 20*NUM_PKTS_TO_TEST, metadata, 1.0), 20*NUM_PKTS_TO_TEST);
+
+    //check that both handlers produce the same packets
+    shd::transport::vrt::if_packet_info_t serial_ifpi, threaded_ifpi;
+    std::vector<uint32_t> serial_payload, threaded_payload;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            serial_xports[ch].pop_front_packet(serial_ifpi, serial_payload);
+            threaded_xports[ch].pop_front_packet(threaded_ifpi, threaded_payload);
+            BOOST_CHECK_EQUAL(threaded_ifpi.packet_count, serial_ifpi.packet_count);
+            BOOST_CHECK_EQUAL(threaded_ifpi.eob, serial_ifpi.eob);
+            BOOST_CHECK_EQUAL_COLLECTIONS(
+                serial_payload.begin(), serial_payload.end(),
+                threaded_payload.begin(), threaded_payload.end()
+            );
+        }
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/stream_metrics_export.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <fstream>
+#include <string>
+
+using namespace shd;
+namespace fs = boost::filesystem;
+
+static stream_metrics_t make_metrics(const uint64_t num_samps)
+{
+    stream_metrics_t metrics;
+    metrics.num_calls = 2;
+    metrics.num_samps = num_samps;
+    metrics.latency_hist[3] = 2;
+    metrics.xports.resize(1);
+    metrics.xports[0].num_packets = 4;
+    return metrics;
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_metrics_to_string)
+{
+    const std::string json = make_metrics(1000).to_string("rx7");
+    BOOST_CHECK(boost::starts_with(json, "{\"name\":\"rx7\",\"num_calls\":2,\"num_samps\":1000,"));
+    BOOST_CHECK(boost::contains(json, "\"latency_hist\":[0,0,0,2,0,"));
+    BOOST_CHECK(boost::contains(json, "\"xports\":[{\"num_packets\":4,"));
+    BOOST_CHECK(boost::contains(json, "\"num_fc_acks\":0,\"num_queued_packets\":0,\"max_queued_packets\":0,"));
+    BOOST_CHECK(boost::ends_with(json, "}]}"));
+    BOOST_CHECK(not boost::contains(json, "\n"));
+
+    BOOST_CHECK(boost::starts_with(stream_metrics_t().to_string(), "{\"num_calls\":0,"));
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_metrics_register)
+{
+    stream_metrics_export::sptr first = stream_metrics_export::register_source(
+        "rx", boost::bind(&make_metrics, 1));
+    stream_metrics_export::sptr second = stream_metrics_export::register_source(
+        "tx", boost::bind(&make_metrics, 2));
+    BOOST_CHECK(boost::starts_with(first->get_name(), "rx"));
+    BOOST_CHECK(boost::starts_with(second->get_name(), "tx"));
+
+    const std::string dump = stream_metrics_export::dump();
+    BOOST_CHECK(boost::contains(dump, "\"name\":\"" + first->get_name() + "\",\"num_calls\":2,\"num_samps\":1,"));
+    BOOST_CHECK(boost::contains(dump, "\"name\":\"" + second->get_name() + "\",\"num_calls\":2,\"num_samps\":2,"));
+    BOOST_CHECK(boost::starts_with(dump, "{\"time\":"));
+
+    //a source is gone with its registration
+    first.reset();
+    BOOST_CHECK(not boost::contains(stream_metrics_export::dump(), "\"num_samps\":1,"));
+    second.reset();
+    BOOST_CHECK(stream_metrics_export::dump().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_metrics_file)
+{
+    const fs::path file = fs::temp_directory_path() / fs::unique_path();
+    stream_metrics_export::sptr source = stream_metrics_export::register_source(
+        "rx", boost::bind(&make_metrics, 3));
+    stream_metrics_export::set_destination("file:" + file.string(), 0.01);
+
+    //wait for a few dumps
+    size_t num_lines = 0;
+    for (size_t i = 0; i < 500 and num_lines < 3; i++) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        std::ifstream in(file.string().c_str());
+        std::string line;
+        num_lines = 0;
+        while (std::getline(in, line)) {
+            BOOST_CHECK(boost::contains(line, "\"num_samps\":3,"));
+            num_lines++;
+        }
+    }
+    stream_metrics_export::set_destination("");
+    BOOST_CHECK(num_lines >= 3);
+    fs::remove(file);
+
+    BOOST_CHECK_THROW(stream_metrics_export::set_destination("file:"), shd::value_error);
+}
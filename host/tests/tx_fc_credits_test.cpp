@@ -0,0 +1,122 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/tx_fc_credits.hpp"
+#include <boost/thread/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+
+using namespace shd;
+using namespace shd::transport;
+
+static const uint32_t SEQ_MASK = 0xfff;
+
+BOOST_AUTO_TEST_CASE(test_tx_fc_credits_window){
+    tx_fc_credits credits(4, SEQ_MASK);
+    for (size_t i = 0; i < 4; i++){
+        BOOST_CHECK_EQUAL(credits.get_credit(), 4-i);
+        BOOST_REQUIRE(credits.wait(0.0));
+        credits.consume();
+    }
+    BOOST_CHECK(not credits.wait(0.0));
+
+    //acks are not visible before they are published
+    credits.ack(2);
+    BOOST_CHECK_EQUAL(credits.get_credit(), 0);
+    credits.publish();
+    BOOST_CHECK_EQUAL(credits.get_credit(), 2);
+    BOOST_CHECK(credits.wait(0.0));
+}
+
+BOOST_AUTO_TEST_CASE(test_tx_fc_credits_seq_wrap){
+    tx_fc_credits credits(16, SEQ_MASK);
+    uint32_t seq = 0;
+    for (size_t n = 0; n < 3*(SEQ_MASK+1); n += 10){
+        for (size_t i = 0; i < 10; i++){
+            BOOST_REQUIRE(credits.wait(0.0));
+            credits.consume();
+        }
+        //the device acks with the low bits of the sequence number
+        seq += 10;
+        credits.ack(seq & SEQ_MASK);
+        credits.publish();
+        BOOST_REQUIRE_EQUAL(credits.get_credit(), 16);
+    }
+}
+
+static void ack_later(tx_fc_credits *credits, const uint32_t seq){
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    credits->ack(seq);
+    credits->publish();
+}
+
+BOOST_AUTO_TEST_CASE(test_tx_fc_credits_blocking){
+    tx_fc_credits credits(1, SEQ_MASK);
+    credits.consume();
+    BOOST_CHECK(not credits.wait(0.01));
+
+    //the waiting sender is woken by the ack
+    boost::thread acker(boost::bind(&ack_later, &credits, 1));
+    const time_spec_t start = time_spec_t::get_system_time();
+    BOOST_CHECK(credits.wait(5.0));
+    const double waited = (time_spec_t::get_system_time() - start).get_real_secs();
+    BOOST_CHECK(waited > 0.03);
+    BOOST_CHECK(waited < 1.0);
+    acker.join();
+}
+
+/***********************************************************************
+ * A device that consumes the packets in flight and acks them
+ **********************************************************************/
+struct credit_device{
+    credit_device(const size_t num_packets):
+        num_packets(num_packets), num_sent(0), max_in_flight(0){}
+
+    void consume(tx_fc_credits *credits){
+        uint32_t num_consumed = 0;
+        while (num_consumed < num_packets){
+            const uint32_t sent = num_sent;
+            if (sent == num_consumed){
+                boost::this_thread::yield();
+                continue;
+            }
+            max_in_flight = std::max<uint32_t>(max_in_flight, sent - num_consumed);
+            num_consumed = sent;
+            credits->ack(num_consumed & SEQ_MASK);
+            credits->publish();
+        }
+    }
+
+    const uint32_t num_packets;
+    boost::atomic<uint32_t> num_sent;
+    uint32_t max_in_flight;
+};
+
+BOOST_AUTO_TEST_CASE(test_tx_fc_credits_threads){
+    const size_t window = 32;
+    tx_fc_credits credits(window, SEQ_MASK);
+    credit_device device(100000);
+    boost::thread reader(boost::bind(&credit_device::consume, &device, &credits));
+    for (size_t i = 0; i < device.num_packets; i++){
+        BOOST_REQUIRE(credits.wait(5.0));
+        credits.consume();
+        device.num_sent++;
+    }
+    reader.join();
+    BOOST_CHECK(device.max_in_flight <= window);
+}
@@ -0,0 +1,203 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/tx_player.hpp>
+#include <shd/exception.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace shd;
+namespace fs = boost::filesystem;
+
+static uint32_t expected(const size_t ch, const size_t n)
+{
+    return uint32_t((ch << 28) | n);
+}
+
+/***********************************************************************
+ * A streamer that keeps what is sent, a few samples per call
+ **********************************************************************/
+class collecting_tx_streamer : public tx_streamer
+{
+public:
+    collecting_tx_streamer(const size_t num_chans):
+        samps(num_chans), player(NULL), stop_at(~size_t(0)), _timed_out(false)
+    {
+        /* NOP */
+    }
+
+    size_t get_num_channels(void) const{ return samps.size(); }
+    size_t get_max_num_samps(void) const{ return 1000; }
+
+    size_t send(const buffs_type &buffs, const size_t nsamps_per_buff,
+        const tx_metadata_t &md, const double)
+    {
+        //time out once, the player has to send again
+        if (not _timed_out and nsamps_per_buff != 0) {
+            _timed_out = true;
+            return 0;
+        }
+        const size_t nsamps = std::min(nsamps_per_buff, get_max_num_samps());
+        for (size_t ch = 0; ch < samps.size(); ch++) {
+            const uint32_t *in = reinterpret_cast<const uint32_t *>(buffs[ch]);
+            samps[ch].insert(samps[ch].end(), in, in + nsamps);
+        }
+        mds.push_back(md);
+        if (player != NULL and samps[0].size() >= stop_at) player->stop();
+        return nsamps;
+    }
+
+    bool recv_async_msg(async_metadata_t &, double){ return false; }
+
+    std::vector<std::vector<uint32_t> > samps;
+    std::vector<tx_metadata_t> mds;
+    tx_player *player;
+    size_t stop_at;
+
+private:
+    bool _timed_out;
+};
+
+struct temp_dir_fixture
+{
+    temp_dir_fixture(void): dir(fs::temp_directory_path() / fs::unique_path())
+    {
+        fs::create_directories(dir);
+    }
+    ~temp_dir_fixture(void)
+    {
+        fs::remove_all(dir);
+    }
+
+    //! Write files of sample counters, with extra bytes at the end
+    std::vector<std::string> files(const size_t num_chans, const size_t num_samps, const size_t extra = 0)
+    {
+        std::vector<std::string> names;
+        for (size_t ch = 0; ch < num_chans; ch++) {
+            names.push_back((dir / str(boost::format("ch%u.dat") % ch)).string());
+            std::vector<uint32_t> samps(num_samps);
+            for (size_t i = 0; i < num_samps; i++) samps[i] = expected(ch, i);
+            std::ofstream out(names.back().c_str(), std::ios::binary);
+            out.write(reinterpret_cast<const char *>(&samps.front()), num_samps*sizeof(uint32_t));
+            out.write("\0\0\0", extra);
+        }
+        return names;
+    }
+
+    fs::path dir;
+};
+
+static void check_samps(const std::vector<uint32_t> &samps, const size_t ch, const size_t file_samps)
+{
+    size_t num_wrong = 0;
+    for (size_t i = 0; i < samps.size(); i++) {
+        if (samps[i] != expected(ch, i % file_samps)) num_wrong++;
+    }
+    BOOST_CHECK_EQUAL(num_wrong, 0);
+}
+
+/***********************************************************************
+ * Tests
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_play_loops)
+{
+    temp_dir_fixture tmp;
+    const size_t num_samps = 5*4096 + 123;
+    boost::shared_ptr<collecting_tx_streamer> tx_stream = boost::make_shared<collecting_tx_streamer>(2);
+
+    //small buffers, so the last one is partial and the player waits for the reader
+    tx_player::sptr player = tx_player::make(
+        tx_stream, "sc16", tmp.files(2, num_samps), device_addr_t("buff_size=16384,num_buffs=2"));
+    tx_metadata_t md;
+    md.start_of_burst = true;
+    md.has_time_spec = true;
+    md.time_spec = time_spec_t(1.5);
+    BOOST_CHECK_EQUAL(player->play(md, 3), 3*num_samps);
+
+    const tx_player::stats_t stats = player->get_stats();
+    BOOST_CHECK_EQUAL(stats.num_samps, 3*num_samps);
+    BOOST_CHECK_EQUAL(stats.num_loops, 3);
+    for (size_t ch = 0; ch < 2; ch++) {
+        BOOST_REQUIRE_EQUAL(tx_stream->samps[ch].size(), 3*num_samps);
+        check_samps(tx_stream->samps[ch], ch, num_samps);
+    }
+
+    //a timed start of burst first, the end of burst last
+    BOOST_REQUIRE(tx_stream->mds.size() > 2);
+    BOOST_CHECK(tx_stream->mds.front().start_of_burst);
+    BOOST_CHECK(tx_stream->mds.front().has_time_spec);
+    BOOST_CHECK_EQUAL(tx_stream->mds.front().time_spec.get_real_secs(), 1.5);
+    BOOST_CHECK(not tx_stream->mds.front().end_of_burst);
+    size_t num_wrong = 0;
+    for (size_t i = 1; i < tx_stream->mds.size() - 1; i++) {
+        const tx_metadata_t &md_i = tx_stream->mds[i];
+        if (md_i.start_of_burst or md_i.has_time_spec or md_i.end_of_burst) num_wrong++;
+    }
+    BOOST_CHECK_EQUAL(num_wrong, 0);
+    BOOST_CHECK(tx_stream->mds.back().end_of_burst);
+}
+
+BOOST_AUTO_TEST_CASE(test_play_odd_size)
+{
+    temp_dir_fixture tmp;
+    boost::shared_ptr<collecting_tx_streamer> tx_stream = boost::make_shared<collecting_tx_streamer>(1);
+
+    //a partial sample at the end is not played
+    tx_player::sptr player = tx_player::make(
+        tx_stream, "sc16", tmp.files(1, 777, 2), device_addr_t("direct=0"));
+    BOOST_CHECK_EQUAL(player->play(tx_metadata_t(), 2), 2*777);
+    BOOST_CHECK(not player->get_stats().direct_io);
+    check_samps(tx_stream->samps[0], 0, 777);
+}
+
+BOOST_AUTO_TEST_CASE(test_play_stop)
+{
+    temp_dir_fixture tmp;
+    const size_t num_samps = 3*4096;
+    boost::shared_ptr<collecting_tx_streamer> tx_stream = boost::make_shared<collecting_tx_streamer>(1);
+    tx_player::sptr player = tx_player::make(
+        tx_stream, "sc16", tmp.files(1, num_samps), device_addr_t("buff_size=16384"));
+
+    //stopped in the middle of the file
+    tx_stream->player = player.get();
+    tx_stream->stop_at = 5096;
+    BOOST_CHECK_EQUAL(player->play(tx_metadata_t(), 0), 5096);
+    BOOST_CHECK(tx_stream->mds.back().end_of_burst);
+
+    //the next burst starts over
+    tx_stream->player = NULL;
+    tx_stream->samps[0].clear();
+    BOOST_CHECK_EQUAL(player->play(tx_metadata_t(), 1), num_samps);
+    BOOST_CHECK_EQUAL(tx_stream->samps[0].size(), num_samps);
+    check_samps(tx_stream->samps[0], 0, num_samps);
+}
+
+BOOST_AUTO_TEST_CASE(test_play_wrong_files)
+{
+    temp_dir_fixture tmp;
+    tx_streamer::sptr tx_stream = boost::make_shared<collecting_tx_streamer>(2);
+    BOOST_CHECK_THROW(tx_player::make(tx_stream, "sc16", tmp.files(1, 100)), shd::value_error);
+
+    std::vector<std::string> files = tmp.files(2, 100);
+    std::ofstream(files[1].c_str(), std::ios::binary | std::ios::app).write("\0\0\0\0", 4);
+    BOOST_CHECK_THROW(tx_player::make(tx_stream, "sc16", files), shd::value_error);
+}
@@ -0,0 +1,170 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/rfnoc/blockdef.hpp>
+#include <shd/rfnoc/constants.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <stdint.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+namespace pt = boost::property_tree;
+using namespace shd::rfnoc;
+
+static const uint64_t BASE_NOC_ID = 0xBE00000000000000ULL;
+
+/***********************************************************************
+ * A directory of synthetic block definitions, one NoC ID each
+ **********************************************************************/
+static void write_blockdef(const fs::path &path, const size_t index)
+{
+    std::ofstream xml(path.string().c_str());
+    xml << boost::format(
+        "<nocblock>\n"
+        "  <name>Synthetic%1%</name>\n"
+        "  <blockname>Synthetic%1%</blockname>\n"
+        "  <ids>\n"
+        "    <id revision=\"0\">%2$016X</id>\n"
+        "  </ids>\n"
+        "  <registers>\n"
+        "    <setreg><name>GAIN</name><address>131</address></setreg>\n"
+        "    <setreg><name>RESET</name><address>132</address></setreg>\n"
+        "    <readback><name>RB_GAIN</name><address>0</address></readback>\n"
+        "  </registers>\n"
+        "  <args>\n"
+        "    <arg>\n"
+        "      <name>spp</name>\n"
+        "      <type>int</type>\n"
+        "      <value>256</value>\n"
+        "      <check>GE($spp, 16) AND LE($spp, 4096)</check>\n"
+        "      <check_message>spp must be in [16, 4096].</check_message>\n"
+        "    </arg>\n"
+        "    <arg>\n"
+        "      <name>gain</name>\n"
+        "      <type>double</type>\n"
+        "      <value>1.0</value>\n"
+        "      <action>SR_WRITE(\"GAIN\", $gain)</action>\n"
+        "    </arg>\n"
+        "  </args>\n"
+        "  <ports>\n"
+        "    <sink><name>in</name><type>sc16</type><vlen>$spp</vlen><pkt_size>%%vlen</pkt_size></sink>\n"
+        "    <source><name>out</name><type>sc16</type><vlen>$spp</vlen><pkt_size>%%vlen</pkt_size></source>\n"
+        "  </ports>\n"
+        "</nocblock>\n"
+    ) % index % (BASE_NOC_ID + index);
+}
+
+/***********************************************************************
+ * The lookup as it used to be: parse every file for every block
+ **********************************************************************/
+static bool scan_for_noc_id(const fs::path &blocks_dir, const uint64_t noc_id)
+{
+    const std::string wanted = str(boost::format("%016X") % noc_id);
+    fs::directory_iterator end_itr;
+    for (fs::directory_iterator i(blocks_dir); i != end_itr; ++i) {
+        if (i->path().extension() != ".xml") continue;
+        pt::ptree propt;
+        read_xml(i->path().string(), propt);
+        BOOST_FOREACH(const pt::ptree::value_type &v, propt.get_child("nocblock.ids")) {
+            if (v.first == "id" and wanted.find(v.second.data()) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static double secs_since(const boost::chrono::steady_clock::time_point &start)
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    size_t num_files, num_blocks;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("files", po::value<size_t>(&num_files)->default_value(300), "number of block definitions in the directory")
+        ("blocks", po::value<size_t>(&num_blocks)->default_value(40), "number of blocks on the simulated FPGA image")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or num_files == 0 or num_blocks == 0) {
+        std::cout << boost::format("SHD Block Definition Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Writes a directory of synthetic block definitions and times looking\n"
+            "up the blocks of an FPGA image, as done when a device starts up.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    const fs::path base_dir = fs::temp_directory_path() / fs::unique_path();
+    const fs::path blocks_dir = base_dir / "blocks";
+    fs::create_directories(blocks_dir);
+    for (size_t i = 0; i < num_files; i++) {
+        write_blockdef(blocks_dir / str(boost::format("synthetic%04u.xml") % i), i);
+    }
+    setenv(XML_PATH_ENV.c_str(), base_dir.string().c_str(), 1);
+
+    //the blocks are spread over the whole library
+    std::vector<uint64_t> noc_ids;
+    for (size_t i = 0; i < num_blocks; i++) {
+        noc_ids.push_back(BASE_NOC_ID + (i*num_files)/num_blocks);
+    }
+
+    std::cout << boost::format("%u block definitions, %u blocks to look up") % num_files % num_blocks << std::endl;
+
+    boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    BOOST_FOREACH(const uint64_t noc_id, noc_ids) {
+        if (not scan_for_noc_id(blocks_dir, noc_id)) throw shd::runtime_error("block not found");
+    }
+    const double scan_secs = secs_since(start);
+
+    start = boost::chrono::steady_clock::now();
+    if (not blockdef::make_from_noc_id(noc_ids.front())) throw shd::runtime_error("block not found");
+    const double first_secs = secs_since(start);
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 1; i < noc_ids.size(); i++) {
+        if (not blockdef::make_from_noc_id(noc_ids[i])) throw shd::runtime_error("block not found");
+    }
+    const double rest_secs = secs_since(start);
+
+    std::cout << boost::format("Parse every file per block:  %8.1f ms total") % (scan_secs*1e3) << std::endl;
+    std::cout << boost::format("Index, first block:          %8.1f ms") % (first_secs*1e3) << std::endl;
+    std::cout << boost::format("Index, other blocks:         %8.3f ms each") % (rest_secs*1e3/std::max<size_t>(noc_ids.size()-1, 1)) << std::endl;
+    std::cout << boost::format("Index, all blocks:           %8.1f ms total") % ((first_secs + rest_secs)*1e3) << std::endl;
+
+    fs::remove_all(base_dir);
+    return EXIT_SUCCESS;
+}
@@ -269,7 +269,7 @@ int SHD_SAFE_MAIN(int argc, char *argv[])
     std::string in_format, out_format;
     std::string priorities;
     std::string seed_mode;
-    priority_type prio = -1, max_prio;
+    priority_type prio = -1;
     size_t iterations, n_samples;
     size_t n_inputs, n_outputs;
     buf_init_t buf_seed_mode = RANDOM;
@@ -282,8 +282,7 @@ int SHD_SAFE_MAIN(int argc, char *argv[])
         ("out", po::value<std::string>(&out_format), "Output format (e.g. 'sc16')")
         ("samples",  po::value<size_t>(&n_samples)->default_value(1000000), "Number of samples per iteration")
         ("iterations",  po::value<size_t>(&iterations)->default_value(10000), "Number of iterations per benchmark")
-        ("priorities", po::value<std::string>(&priorities)->default_value("default"), "Converter priorities. Can be 'default', 'all', or a comma-separated list of priorities.")
-        ("max-prio", po::value<priority_type>(&max_prio)->default_value(4), "Largest available priority (advanced feature)")
+        ("priorities", po::value<std::string>(&priorities)->default_value("default"), "Converter priorities. Can be 'default', 'all' (every priority registered on this host), or a comma-separated list of priorities.")
         ("n-inputs",   po::value<size_t>(&n_inputs)->default_value(1),  "Number of input vectors")
         ("n-outputs",  po::value<size_t>(&n_outputs)->default_value(1), "Number of output vectors")
         ("debug-converter", "Skip benchmark and print conversion results. Implies iterations==1 and will only run on a single converter.")
@@ -337,14 +336,14 @@ int SHD_SAFE_MAIN(int argc, char *argv[])
             return EXIT_FAILURE;
         }
     } else if (priorities == "all") {
-        for (priority_type i = 0; i < max_prio; i++) {
-            try {
-                // get_converter() returns a factory function, execute that immediately:
-                converter::sptr conv_for_prio = get_converter(converter_id, i)(); // Can throw a shd::key_error
-                conv_list[i] = conv_for_prio;
-            } catch (...) {
-                continue;
-            }
+        // Only converters the host CPU can run are registered
+        BOOST_FOREACH(priority_type prio_i, get_converter_priorities(converter_id)) {
+            // get_converter() returns a factory function, execute that immediately:
+            conv_list[prio_i] = get_converter(converter_id, prio_i)();
+        }
+        if (conv_list.size() == 0) {
+            std::cout << "No converters found." << std::endl;
+            return EXIT_FAILURE;
         }
     } else { // Assume that priorities contains a list of prios (e.g. 0,2,3)
         std::vector<std::string> prios_in_list;
@@ -149,11 +149,7 @@ def setup_argparse():
     )
     parser.add_argument(
         "-p", "--priorities",
-        help="Converter priorities. Can be 'default', 'all', or a comma-separated list of priorities.",
-    )
-    parser.add_argument(
-        "--max-prio", type=int,
-        help="Largest available priority (advanced feature)",
+        help="Converter priorities. Can be 'default', 'all' (every priority registered on this host), or a comma-separated list of priorities.",
     )
     parser.add_argument(
         "--n-inputs", type=int,
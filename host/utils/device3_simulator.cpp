@@ -0,0 +1,869 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "ctrl_iface.hpp"
+#include "udp_common.hpp"
+#include <shd/utils/safe_main.hpp>
+#include <shd/utils/byteswap.hpp>
+#include <shd/transport/udp_zero_copy.hpp>
+#include <shd/transport/chdr.hpp>
+#include <shd/rfnoc/constants.hpp>
+#include <shd/types/metadata.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/utility.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <deque>
+#include <map>
+#include <vector>
+#include <csignal>
+#include <stdint.h>
+
+namespace po = boost::program_options;
+namespace asio = boost::asio;
+using namespace shd;
+using namespace shd::transport;
+using namespace shd::rfnoc;
+
+/***********************************************************************
+ * The simulated device: one crossbar with a radio, a DDC and a DUC.
+ * Blocks are addressed like on the FPGA, DEVICE:XBAR_PORT:BLOCK_PORT.
+ **********************************************************************/
+static const uint16_t DEVICE_ADDR     = 0x02;
+static const size_t RADIO_XBAR_PORT   = 2;
+static const size_t DDC_XBAR_PORT     = 3;
+static const size_t DUC_XBAR_PORT     = 4;
+
+static const uint64_t RADIO_NOC_ID    = 0x12AD100000000001ULL;
+static const uint64_t DDC_NOC_ID      = 0xDDC0000000000000ULL;
+static const uint64_t DUC_NOC_ID      = 0xD0C0000000000000ULL;
+
+//registers of the radio core (radio_core_regs.vh)
+static const uint32_t RADIO_TIME_HI        = 128;
+static const uint32_t RADIO_TIME_LO        = 129;
+static const uint32_t RADIO_TIME_CTRL      = 130;
+static const uint32_t RADIO_TEST           = 133;
+static const uint32_t RADIO_RX_CTRL_CMD    = 152;
+static const uint32_t RADIO_RX_CTRL_TIME_HI= 153;
+static const uint32_t RADIO_RX_CTRL_TIME_LO= 154;
+static const uint32_t RADIO_RX_CTRL_HALT   = 155;
+static const uint32_t RADIO_RX_CTRL_MAXLEN = 156;
+static const uint32_t RADIO_RX_CTRL_CLEAR  = 157;
+static const uint32_t RADIO_RB_TIME_NOW    = 0;
+static const uint32_t RADIO_RB_TEST        = 2;
+static const uint32_t RADIO_RB_RADIO_NUM   = 4;
+
+static const size_t MAX_PKT_WORDS = 8192/sizeof(uint32_t);
+static const size_t DEFAULT_SPP = 364;
+
+static uint16_t block_addr(const size_t xbar_port, const size_t block_port)
+{
+    return uint16_t((DEVICE_ADDR << 8) | (xbar_port << 4) | block_port);
+}
+
+static double secs_since(const boost::chrono::steady_clock::time_point &start)
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+}
+
+/***********************************************************************
+ * Device simulator
+ *
+ * Speaks CHDR over a single UDP socket, like the X300 10GigE port:
+ * - control packets to any block are acked, SR_READBACK returns the
+ *   NoC ID, buffer size and the radio readbacks,
+ * - the radio streams a sample counter at the sample rate when it gets
+ *   a stream command and stops (with an overflow packet) when the host
+ *   runs out of flow control window,
+ * - samples sent to the radio are played out at the sample rate, the
+ *   buffer space is acked with flow control packets and underflows,
+ *   late bursts, sequence errors and burst acks go to the async endpoint.
+ * Replies go to wherever the source address of a packet last came from.
+ **********************************************************************/
+class device3_sim : boost::noncopyable
+{
+public:
+    struct stats_t{
+        stats_t(void):
+            ctrl_pkts(0), rx_pkts(0), rx_overflows(0), tx_pkts(0),
+            tx_underflows(0), tx_seq_errors(0), tx_late(0), no_route(0)
+        {}
+        uint64_t ctrl_pkts, rx_pkts, rx_overflows, tx_pkts;
+        uint64_t tx_underflows, tx_seq_errors, tx_late, no_route;
+    };
+
+    device3_sim(
+        const unsigned short port,
+        const double tick_rate,
+        const double samp_rate,
+        const size_t tx_buff_log2
+    ):
+        _sock(_io_service, asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), port)),
+        _tick_rate(tick_rate),
+        _ticks_per_samp(tick_rate/samp_rate),
+        _tx_buff_log2(tx_buff_log2),
+        _time_base(0),
+        _time_epoch(boost::chrono::steady_clock::now()),
+        _send_buff(MAX_PKT_WORDS),
+        _async_seq(0),
+        _running(true)
+    {
+        _threads.create_thread(boost::bind(&device3_sim::recv_loop, this));
+        _threads.create_thread(boost::bind(&device3_sim::stream_loop, this));
+    }
+
+    ~device3_sim(void)
+    {
+        _running = false;
+        _threads.join_all();
+    }
+
+    unsigned short get_port(void) const
+    {
+        return _sock.local_endpoint().port();
+    }
+
+    stats_t get_stats(void)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _stats;
+    }
+
+private:
+    struct rx_state_t{
+        rx_state_t(void):
+            active(false), continuous(false), blocked(false),
+            samps_left(0), next_tsf(0), seq_out(0), seq_consumed(0)
+        {}
+        bool active, continuous, blocked;
+        uint64_t samps_left;
+        uint64_t next_tsf; //time of the first sample of the next packet
+        uint32_t seq_out, seq_consumed;
+    };
+
+    struct tx_pkt_t{
+        size_t nsamps;
+        bool eob, has_tsf;
+        uint64_t tsf;
+        size_t seq;
+    };
+
+    struct tx_state_t{
+        tx_state_t(void):
+            in_burst(false), underflowed(false), late(false),
+            play_tsf(0), expected_seq(0), since_ack(0), last_seq(0)
+        {}
+        std::deque<tx_pkt_t> queue;
+        bool in_burst, underflowed, late;
+        uint64_t play_tsf; //time the samples played so far run out
+        size_t expected_seq, since_ack, last_seq;
+    };
+
+    typedef std::map<uint32_t, uint32_t> reg_map_t;
+
+    /*******************************************************************
+     * Time
+     ******************************************************************/
+    uint64_t get_ticks(void) const
+    {
+        return _time_base + uint64_t(secs_since(_time_epoch)*_tick_rate);
+    }
+
+    void set_ticks(const uint64_t ticks)
+    {
+        _time_epoch = boost::chrono::steady_clock::now();
+        _time_base = ticks;
+    }
+
+    uint64_t samps_to_ticks(const size_t nsamps) const
+    {
+        return uint64_t(nsamps*_ticks_per_samp);
+    }
+
+    /*******************************************************************
+     * Packet I/O (called with the mutex held)
+     ******************************************************************/
+    void send_packet(vrt::if_packet_info_t &info, const uint32_t *payload)
+    {
+        const std::map<uint16_t, asio::ip::udp::endpoint>::const_iterator route =
+            _routes.find(uint16_t(info.sid & 0xffff));
+        if (route == _routes.end()) {
+            _stats.no_route++;
+            return;
+        }
+        info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+        info.has_sid = true;
+        info.has_cid = false;
+        info.has_tsi = false;
+        info.has_tlr = false;
+        info.num_payload_bytes = info.num_payload_words32*sizeof(uint32_t);
+        vrt::chdr::if_hdr_pack_be(&_send_buff.front(), info);
+        for (size_t i = 0; i < info.num_payload_words32; i++) {
+            _send_buff[info.num_header_words32+i] = shd::htonx(payload[i]);
+        }
+        boost::system::error_code ec;
+        _sock.send_to(asio::buffer(&_send_buff.front(), info.num_packet_words32*sizeof(uint32_t)), route->second, 0, ec);
+    }
+
+    void send_short(
+        const uint16_t src, const uint16_t dst,
+        const vrt::if_packet_info_t::packet_type_t type,
+        const size_t seq, const bool has_tsf, const uint64_t tsf,
+        const uint32_t word0, const uint32_t word1, const bool error = false
+    ){
+        vrt::if_packet_info_t info;
+        info.packet_type = type;
+        info.num_payload_words32 = 2;
+        info.packet_count = seq;
+        info.sob = false;
+        info.eob = false;
+        info.error = error;
+        info.sid = (uint32_t(src) << 16) | dst;
+        info.has_tsf = has_tsf;
+        info.tsf = tsf;
+        const uint32_t payload[2] = {word0, word1};
+        send_packet(info, payload);
+    }
+
+    /*******************************************************************
+     * Receive side
+     ******************************************************************/
+    void recv_loop(void)
+    {
+        std::vector<uint32_t> buff(MAX_PKT_WORDS);
+        while (_running) {
+            if (not wait_for_recv_ready(_sock.native_handle(), 0.05)) continue;
+            asio::ip::udp::endpoint sender;
+            boost::system::error_code ec;
+            const size_t len = _sock.receive_from(
+                asio::buffer(&buff.front(), buff.size()*sizeof(uint32_t)), sender, 0, ec);
+            if (ec or len < 8) continue;
+
+            boost::mutex::scoped_lock lock(_mutex);
+
+            //an 8 byte packet with a zero header programs the route for a SID
+            if (len == 8 and buff[0] == 0) {
+                _routes[uint16_t(shd::ntohx(buff[1]) >> 16)] = sender;
+                continue;
+            }
+
+            vrt::if_packet_info_t info;
+            info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+            info.num_packet_words32 = len/sizeof(uint32_t);
+            try {
+                vrt::chdr::if_hdr_unpack_be(&buff.front(), info);
+            }
+            catch(const std::exception &ex) {
+                std::cerr << "Bad CHDR packet: " << ex.what() << std::endl;
+                continue;
+            }
+            _routes[uint16_t(info.sid >> 16)] = sender;
+            const uint32_t *payload = &buff[info.num_header_words32];
+
+            switch (info.packet_type) {
+            case vrt::if_packet_info_t::PACKET_TYPE_DATA:
+                handle_tx_data(info);
+                break;
+            case vrt::if_packet_info_t::PACKET_TYPE_FC:
+                if (info.num_payload_words32 >= 2) handle_rx_fc(info, shd::ntohx(payload[1]));
+                break;
+            case vrt::if_packet_info_t::PACKET_TYPE_CMD:
+                if (info.num_payload_words32 >= 2) handle_ctrl(info, shd::ntohx(payload[0]), shd::ntohx(payload[1]));
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void handle_ctrl(const vrt::if_packet_info_t &info, const uint32_t reg, const uint32_t data)
+    {
+        _stats.ctrl_pkts++;
+        const uint16_t addr = uint16_t(info.sid & 0xffff);
+        uint64_t value = 0;
+        if (reg == SR_READBACK) {
+            value = readback(addr, data);
+        }
+        else {
+            _regs[addr][reg] = data;
+            if (((addr >> 4) & 0xf) == RADIO_XBAR_PORT) write_radio(addr, reg);
+            if (reg == SR_CLEAR_RX_FC or reg == SR_CLEAR_TX_FC) {
+                _rx[addr] = rx_state_t();
+                _tx[addr] = tx_state_t();
+            }
+        }
+        //timed commands are acked right away, there is no command queue
+        send_short(addr, uint16_t(info.sid >> 16),
+            vrt::if_packet_info_t::PACKET_TYPE_RESP, info.packet_count, false, 0,
+            uint32_t(value >> 32), uint32_t(value));
+    }
+
+    uint64_t readback(const uint16_t addr, const uint32_t index)
+    {
+        const size_t xbar_port = (addr >> 4) & 0xf;
+        reg_map_t &regs = _regs[addr];
+        switch (index) {
+        case SR_READBACK_REG_ID:
+            if (xbar_port == RADIO_XBAR_PORT) return RADIO_NOC_ID;
+            if (xbar_port == DDC_XBAR_PORT) return DDC_NOC_ID;
+            if (xbar_port == DUC_XBAR_PORT) return DUC_NOC_ID;
+            return 0;
+        case SR_READBACK_REG_FIFOSIZE:
+            return _tx_buff_log2;
+        case SR_READBACK_REG_USER:
+            if (xbar_port != RADIO_XBAR_PORT) return 0;
+            switch (regs[SR_READBACK_ADDR]) {
+            case RADIO_RB_TIME_NOW: return get_ticks();
+            case RADIO_RB_TEST: return regs[RADIO_TEST];
+            case RADIO_RB_RADIO_NUM: return addr & 0xf;
+            default: return 0;
+            }
+        default:
+            return 0;
+        }
+    }
+
+    void write_radio(const uint16_t addr, const uint32_t reg)
+    {
+        reg_map_t &regs = _regs[addr];
+        rx_state_t &rx = _rx[addr];
+        switch (reg) {
+        case RADIO_TIME_CTRL:
+            set_ticks((uint64_t(regs[RADIO_TIME_HI]) << 32) | regs[RADIO_TIME_LO]);
+            break;
+        case RADIO_RX_CTRL_TIME_LO: {
+            //the stream command latches on the low time word
+            const uint32_t cmd = regs[RADIO_RX_CTRL_CMD];
+            const bool now = (cmd >> 31) & 1, chain = (cmd >> 30) & 1;
+            const bool reload = (cmd >> 29) & 1, stop = (cmd >> 28) & 1;
+            if (stop) {
+                rx.active = false;
+                break;
+            }
+            rx.active = true;
+            rx.blocked = false;
+            rx.continuous = chain and reload;
+            rx.samps_left = cmd & 0x0fffffff;
+            const uint64_t cmd_tsf = (uint64_t(regs[RADIO_RX_CTRL_TIME_HI]) << 32) | regs[RADIO_RX_CTRL_TIME_LO];
+            rx.next_tsf = now? get_ticks() : std::max(cmd_tsf, get_ticks());
+            break;
+        }
+        case RADIO_RX_CTRL_HALT:
+        case RADIO_RX_CTRL_CLEAR:
+            rx.active = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void handle_rx_fc(const vrt::if_packet_info_t &info, const uint32_t seq32)
+    {
+        //the host acks the last packet it has consumed
+        _rx[uint16_t(info.sid & 0xffff)].seq_consumed = seq32 + 1;
+    }
+
+    void handle_tx_data(const vrt::if_packet_info_t &info)
+    {
+        const uint16_t addr = uint16_t(info.sid & 0xffff);
+        tx_state_t &tx = _tx[addr];
+        if (info.packet_count != (tx.expected_seq & 0xfff)) {
+            _stats.tx_seq_errors++;
+            send_async(addr, async_metadata_t::EVENT_CODE_SEQ_ERROR, get_ticks());
+        }
+        tx.expected_seq = info.packet_count + 1;
+        tx_pkt_t pkt;
+        pkt.nsamps = info.num_payload_bytes/sizeof(uint32_t);
+        pkt.eob = info.eob;
+        pkt.has_tsf = info.has_tsf;
+        pkt.tsf = info.tsf;
+        pkt.seq = info.packet_count;
+        tx.queue.push_back(pkt);
+    }
+
+    /*******************************************************************
+     * Stream side: produce RX packets and play out TX packets in time
+     ******************************************************************/
+    void stream_loop(void)
+    {
+        std::vector<uint32_t> samps(MAX_PKT_WORDS);
+        while (_running) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                const uint64_t now = get_ticks();
+                for (std::map<uint16_t, rx_state_t>::iterator it = _rx.begin(); it != _rx.end(); ++it) {
+                    produce_rx(it->first, it->second, now, samps);
+                }
+                for (std::map<uint16_t, tx_state_t>::iterator it = _tx.begin(); it != _tx.end(); ++it) {
+                    consume_tx(it->first, it->second, now);
+                }
+            }
+            boost::this_thread::sleep(boost::posix_time::microseconds(50));
+        }
+    }
+
+    void produce_rx(const uint16_t addr, rx_state_t &rx, const uint64_t now, std::vector<uint32_t> &samps)
+    {
+        reg_map_t &regs = _regs[addr];
+        const size_t max_spp = MAX_PKT_WORDS - 4;
+        size_t spp = regs.count(RADIO_RX_CTRL_MAXLEN)? regs[RADIO_RX_CTRL_MAXLEN] : DEFAULT_SPP;
+        spp = std::max<size_t>(1, std::min(spp, max_spp));
+        const uint16_t dst = uint16_t(regs[SR_NEXT_DST_SID] & 0xffff);
+        const bool window_en = regs[SR_FLOW_CTRL_WINDOW_EN] != 0;
+        const uint32_t window = regs[SR_FLOW_CTRL_WINDOW_SIZE];
+
+        while (rx.active) {
+            const size_t nsamps = rx.continuous? spp : size_t(std::min<uint64_t>(spp, rx.samps_left));
+            if (now < rx.next_tsf + samps_to_ticks(nsamps)) return;
+
+            //no room on the host: the samples are lost
+            if (window_en and uint32_t(rx.seq_out - rx.seq_consumed) > window) {
+                if (not rx.blocked) {
+                    _stats.rx_overflows++;
+                    const uint16_t resp_dst = regs.count(SR_RESP_OUT_DST_SID)?
+                        uint16_t(regs[SR_RESP_OUT_DST_SID] & 0xffff) : dst;
+                    send_short(addr, resp_dst,
+                        vrt::if_packet_info_t::PACKET_TYPE_RESP, rx.seq_out, true, rx.next_tsf,
+                        rx_metadata_t::ERROR_CODE_OVERFLOW, 0, true);
+                    rx.seq_out++;
+                }
+                rx.blocked = true;
+            }
+            else {
+                rx.blocked = false;
+                const uint64_t first_samp = uint64_t(rx.next_tsf/_ticks_per_samp);
+                for (size_t i = 0; i < nsamps; i++) {
+                    samps[i] = uint32_t(first_samp + i);
+                }
+                vrt::if_packet_info_t info;
+                info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_DATA;
+                info.num_payload_words32 = nsamps;
+                info.packet_count = rx.seq_out++;
+                info.sob = false;
+                info.eob = not rx.continuous and rx.samps_left == nsamps;
+                info.sid = (uint32_t(addr) << 16) | dst;
+                info.has_tsf = true;
+                info.tsf = rx.next_tsf;
+                send_packet(info, &samps.front());
+                _stats.rx_pkts++;
+            }
+
+            rx.next_tsf += samps_to_ticks(nsamps);
+            if (not rx.continuous) {
+                rx.samps_left -= nsamps;
+                if (rx.samps_left == 0) rx.active = false;
+            }
+        }
+    }
+
+    void consume_tx(const uint16_t addr, tx_state_t &tx, const uint64_t now)
+    {
+        reg_map_t &regs = _regs[addr];
+        const uint32_t pkts_per_ack = regs[SR_FLOW_CTRL_PKTS_PER_ACK];
+        while (true) {
+            if (tx.queue.empty()) {
+                if (tx.in_burst and not tx.underflowed and not tx.late and now >= tx.play_tsf) {
+                    _stats.tx_underflows++;
+                    send_async(addr, async_metadata_t::EVENT_CODE_UNDERFLOW, tx.play_tsf);
+                    tx.underflowed = true;
+                }
+                return;
+            }
+
+            const tx_pkt_t &pkt = tx.queue.front();
+            if (not tx.in_burst) {
+                tx.in_burst = true;
+                tx.underflowed = false;
+                tx.late = pkt.has_tsf and pkt.tsf < now;
+                tx.play_tsf = pkt.has_tsf? pkt.tsf : now;
+                if (tx.late) {
+                    _stats.tx_late++;
+                    send_async(addr, async_metadata_t::EVENT_CODE_TIME_ERROR, now);
+                }
+            }
+            else if (tx.underflowed) {
+                tx.underflowed = false;
+                tx.play_tsf = now;
+            }
+
+            //a late burst is dropped, otherwise the buffer frees up as the samples go out
+            const uint64_t end_tsf = tx.play_tsf + samps_to_ticks(pkt.nsamps);
+            if (not tx.late) {
+                if (now < end_tsf) return;
+                tx.play_tsf = end_tsf;
+            }
+            _stats.tx_pkts++;
+            tx.last_seq = pkt.seq;
+            const bool eob = pkt.eob;
+            tx.queue.pop_front();
+
+            if (++tx.since_ack >= (pkts_per_ack & 0x7fffffff) or eob or not (pkts_per_ack >> 31)) {
+                tx.since_ack = 0;
+                send_short(addr, resp_in_dst(addr),
+                    vrt::if_packet_info_t::PACKET_TYPE_FC, 0, false, 0, 0, uint32_t(tx.last_seq));
+            }
+            if (eob) {
+                if (not tx.late) send_async(addr, async_metadata_t::EVENT_CODE_BURST_ACK, tx.play_tsf);
+                tx.in_burst = false;
+                tx.late = false;
+            }
+        }
+    }
+
+    uint16_t resp_in_dst(const uint16_t addr)
+    {
+        return uint16_t(_regs[addr][SR_RESP_IN_DST_SID] & 0xffff);
+    }
+
+    void send_async(const uint16_t addr, const uint32_t event_code, const uint64_t tsf)
+    {
+        send_short(addr, resp_in_dst(addr),
+            vrt::if_packet_info_t::PACKET_TYPE_RESP, _async_seq++, true, tsf, event_code, 0);
+    }
+
+    asio::io_service _io_service;
+    asio::ip::udp::socket _sock;
+    const double _tick_rate;
+    const double _ticks_per_samp;
+    const size_t _tx_buff_log2;
+    boost::mutex _mutex;
+    uint64_t _time_base;
+    boost::chrono::steady_clock::time_point _time_epoch;
+    std::map<uint16_t, asio::ip::udp::endpoint> _routes;
+    std::map<uint16_t, reg_map_t> _regs;
+    std::map<uint16_t, rx_state_t> _rx;
+    std::map<uint16_t, tx_state_t> _tx;
+    std::vector<uint32_t> _send_buff;
+    size_t _async_seq;
+    stats_t _stats;
+    volatile bool _running;
+    boost::thread_group _threads;
+};
+
+/***********************************************************************
+ * Self test: a host talking to the simulator through the transports
+ * and control interface used by device3
+ **********************************************************************/
+static const uint16_t HOST_ADDR = 0x00;
+
+static zero_copy_if::sptr make_xport(const unsigned short port, const uint32_t sid)
+{
+    zero_copy_xport_params default_buff_args;
+    default_buff_args.recv_frame_size = MAX_PKT_WORDS*sizeof(uint32_t);
+    default_buff_args.send_frame_size = MAX_PKT_WORDS*sizeof(uint32_t);
+    default_buff_args.num_recv_frames = 64;
+    default_buff_args.num_send_frames = 64;
+    udp_zero_copy::buff_params buff_params;
+    zero_copy_if::sptr xport = udp_zero_copy::make(
+        "127.0.0.1", boost::lexical_cast<std::string>(port),
+        default_buff_args, buff_params, device_addr_t("recv_buff_size=4000000"));
+
+    //program the route back to this transport, as done for the X300 framer
+    managed_send_buffer::sptr buff = xport->get_send_buff(1.0);
+    buff->cast<uint32_t *>()[0] = 0;
+    buff->cast<uint32_t *>()[1] = shd::htonx(sid);
+    buff->commit(8);
+    return xport;
+}
+
+static uint32_t make_sid(const uint16_t host_ep, const uint16_t dev_addr)
+{
+    return (uint32_t((HOST_ADDR << 8) | host_ep) << 16) | dev_addr;
+}
+
+static void send_chdr(
+    zero_copy_if::sptr xport, vrt::if_packet_info_t &info,
+    const uint32_t *payload
+){
+    managed_send_buffer::sptr buff = xport->get_send_buff(1.0);
+    if (not buff) throw shd::runtime_error("timed out getting a send buffer");
+    uint32_t *pkt = buff->cast<uint32_t *>();
+    info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    info.has_sid = true;
+    info.num_payload_bytes = info.num_payload_words32*sizeof(uint32_t);
+    vrt::chdr::if_hdr_pack_be(pkt, info);
+    for (size_t i = 0; i < info.num_payload_words32; i++) {
+        pkt[info.num_header_words32+i] = shd::htonx(payload[i]);
+    }
+    buff->commit(info.num_packet_words32*sizeof(uint32_t));
+}
+
+static managed_recv_buffer::sptr recv_chdr(
+    zero_copy_if::sptr xport, vrt::if_packet_info_t &info, const double timeout
+){
+    managed_recv_buffer::sptr buff = xport->get_recv_buff(timeout);
+    if (not buff) return buff;
+    info.link_type = vrt::if_packet_info_t::LINK_TYPE_CHDR;
+    info.num_packet_words32 = buff->size()/sizeof(uint32_t);
+    vrt::chdr::if_hdr_unpack_be(buff->cast<const uint32_t *>(), info);
+    return buff;
+}
+
+static void test_ctrl(const unsigned short port, const size_t num_writes)
+{
+    const uint16_t radio = block_addr(RADIO_XBAR_PORT, 0);
+    zero_copy_if::sptr xport = make_xport(port, make_sid(0x10, radio));
+    ctrl_iface::sptr ctrl = ctrl_iface::make(true, xport, xport, make_sid(0x10, radio), "sim");
+
+    const size_t xbar_ports[] = {RADIO_XBAR_PORT, DDC_XBAR_PORT, DUC_XBAR_PORT};
+    for (size_t i = 0; i < 3; i++) {
+        const uint16_t addr = block_addr(xbar_ports[i], 0);
+        zero_copy_if::sptr block_xport = make_xport(port, make_sid(0x11+i, addr));
+        ctrl_iface::sptr block_ctrl = ctrl_iface::make(true, block_xport, block_xport, make_sid(0x11+i, addr), "sim");
+        std::cout << boost::format("Block %04X: NoC ID %016X") % addr % block_ctrl->peek64(SR_READBACK_REG_ID*8) << std::endl;
+    }
+
+    ctrl->poke32(RADIO_TEST*4, 0x5a5a1234);
+    ctrl->poke32(SR_READBACK_ADDR*4, RADIO_RB_TEST);
+    if (ctrl->peek64(SR_READBACK_REG_USER*8) != 0x5a5a1234) {
+        throw shd::runtime_error("radio test register readback failed");
+    }
+
+    wb_iface::poke32_list_type writes;
+    for (size_t i = 0; i < num_writes; i++) {
+        writes.push_back(std::make_pair(wb_iface::wb_addr_type(RADIO_TEST*4), uint32_t(i)));
+    }
+    boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    ctrl->set_ack_window(1);
+    ctrl->poke32_batch(writes);
+    const double serial_secs = secs_since(start);
+    start = boost::chrono::steady_clock::now();
+    ctrl->set_ack_window(64);
+    ctrl->poke32_batch(writes);
+    const double windowed_secs = secs_since(start);
+    if (ctrl->peek64(SR_READBACK_REG_USER*8) != num_writes-1) {
+        throw shd::runtime_error("radio test register readback failed");
+    }
+    std::cout << boost::format("Control: %u writes, %.1f us each acked one by one, %.1f us each in a window")
+        % num_writes % (serial_secs*1e6/num_writes) % (windowed_secs*1e6/num_writes) << std::endl;
+}
+
+static void test_rx(
+    const unsigned short port, const double tick_rate, const double samp_rate,
+    const double duration, const size_t spp, const size_t fc_window, const bool send_acks
+){
+    const uint16_t radio = block_addr(RADIO_XBAR_PORT, 0);
+    const uint32_t ctrl_sid = make_sid(0x20, radio);
+    const uint32_t data_sid = make_sid(0x21, radio);
+    zero_copy_if::sptr ctrl_xport = make_xport(port, ctrl_sid);
+    zero_copy_if::sptr data_xport = make_xport(port, data_sid);
+    ctrl_iface::sptr ctrl = ctrl_iface::make(true, ctrl_xport, ctrl_xport, ctrl_sid, "sim");
+
+    ctrl->poke32(SR_CLEAR_RX_FC*4, 0xc1ea12);
+    ctrl->poke32(SR_NEXT_DST_SID*4, (1 << 16) | (data_sid >> 16));
+    ctrl->poke32(SR_FLOW_CTRL_WINDOW_SIZE*4, uint32_t(fc_window));
+    ctrl->poke32(SR_FLOW_CTRL_WINDOW_EN*4, 1);
+    ctrl->poke32(RADIO_RX_CTRL_MAXLEN*4, uint32_t(spp));
+    const uint64_t num_samps = uint64_t(duration*samp_rate);
+    ctrl->poke32(RADIO_RX_CTRL_CMD*4, (1u << 31) | uint32_t(num_samps));
+    ctrl->poke32(RADIO_RX_CTRL_TIME_HI*4, 0);
+    const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    ctrl->poke32(RADIO_RX_CTRL_TIME_LO*4, 0);
+
+    const double ticks_per_samp = tick_rate/samp_rate;
+    uint64_t num_recvd = 0, num_pkts = 0, seq_errors = 0, time_errors = 0, overflows = 0;
+    size_t expected_seq = 0;
+    uint32_t seq32 = 0;
+    bool have_tsf = false, eob = false;
+    uint64_t next_tsf = 0;
+    while (not eob) {
+        vrt::if_packet_info_t info;
+        managed_recv_buffer::sptr buff = recv_chdr(data_xport, info, 1.0);
+        if (not buff) break;
+        if ((info.packet_count & 0xfff) != (expected_seq & 0xfff)) seq_errors++;
+        expected_seq = info.packet_count + 1;
+        if (info.packet_type != vrt::if_packet_info_t::PACKET_TYPE_DATA) {
+            overflows++;
+            have_tsf = false;
+            continue;
+        }
+        if (have_tsf and info.tsf != next_tsf) time_errors++;
+        const size_t nsamps = info.num_payload_words32;
+        next_tsf = info.tsf + uint64_t(nsamps*ticks_per_samp);
+        have_tsf = true;
+        num_recvd += nsamps;
+        num_pkts++;
+        eob = info.eob;
+        seq32 = uint32_t(num_pkts + overflows - 1);
+        buff.reset();
+
+        if (send_acks and num_pkts % std::max<size_t>(1, fc_window/8) == 0) {
+            vrt::if_packet_info_t fc_info;
+            fc_info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_FC;
+            fc_info.num_payload_words32 = 2;
+            fc_info.packet_count = seq32;
+            fc_info.sob = false;
+            fc_info.eob = false;
+            fc_info.sid = data_sid;
+            fc_info.has_tsf = false;
+            const uint32_t payload[2] = {0, seq32};
+            send_chdr(data_xport, fc_info, payload);
+        }
+    }
+    const double secs = secs_since(start);
+
+    std::cout << boost::format("RX %s: %u samples in %u packets, %.3f Msps, %u sequence errors, %u time errors, %u overflows")
+        % (send_acks? "with flow control" : "without acks")
+        % num_recvd % num_pkts % (num_recvd/secs/1e6) % seq_errors % time_errors % overflows << std::endl;
+    if (seq_errors or time_errors) throw shd::runtime_error("RX stream is broken");
+    if (send_acks and num_recvd != num_samps) throw shd::runtime_error("RX stream lost samples");
+    if (not send_acks and overflows == 0) throw shd::runtime_error("RX stream did not stop for flow control");
+}
+
+static void test_tx(
+    const unsigned short port, const double tick_rate, const double samp_rate,
+    const double duration, const size_t spp
+){
+    const uint16_t radio = block_addr(RADIO_XBAR_PORT, 0);
+    const uint32_t ctrl_sid = make_sid(0x30, radio);
+    const uint32_t data_sid = make_sid(0x31, radio);
+    zero_copy_if::sptr ctrl_xport = make_xport(port, ctrl_sid);
+    zero_copy_if::sptr data_xport = make_xport(port, data_sid);
+    ctrl_iface::sptr ctrl = ctrl_iface::make(true, ctrl_xport, ctrl_xport, ctrl_sid, "sim");
+
+    ctrl->poke32(SR_CLEAR_TX_FC*4, 0xc1ea12);
+    ctrl->poke32(SR_RESP_IN_DST_SID*4, data_sid >> 16);
+    ctrl->poke32(SR_FLOW_CTRL_PKTS_PER_ACK*4, (1u << 31) | 4);
+    const size_t buff_bytes = 8*(size_t(1) << (ctrl->peek64(SR_READBACK_REG_FIFOSIZE*8) & 0xff));
+    size_t credits = buff_bytes/(spp*sizeof(uint32_t));
+    ctrl->poke32(SR_READBACK_ADDR*4, RADIO_RB_TIME_NOW);
+    const uint64_t start_tsf = ctrl->peek64(SR_READBACK_REG_USER*8) + uint64_t(0.05*tick_rate);
+
+    std::vector<uint32_t> samps(spp, 0);
+    size_t seq = 0, last_ack = ~size_t(0);
+    uint64_t underflows = 0, burst_acks = 0, num_sent = 0;
+
+    //drain flow control and async messages
+    struct async_reader{
+        static void read(zero_copy_if::sptr xport, const double timeout,
+            size_t &credits, size_t &last_ack, uint64_t &underflows, uint64_t &burst_acks)
+        {
+            vrt::if_packet_info_t info;
+            managed_recv_buffer::sptr buff;
+            for (double t = timeout; (buff = recv_chdr(xport, info, t)); t = 0.0) {
+                const uint32_t *payload = buff->cast<const uint32_t *>() + info.num_header_words32;
+                if (info.packet_type == vrt::if_packet_info_t::PACKET_TYPE_FC) {
+                    const size_t seq_ack = shd::ntohx(payload[1]);
+                    credits += (seq_ack - last_ack) & 0xfff;
+                    last_ack = seq_ack;
+                }
+                else {
+                    const uint32_t code = shd::ntohx(payload[0]);
+                    if (code & async_metadata_t::EVENT_CODE_UNDERFLOW) underflows++;
+                    if (code & async_metadata_t::EVENT_CODE_BURST_ACK) burst_acks++;
+                }
+            }
+        }
+    };
+
+    //two bursts: the first stops without an end of burst and underflows
+    const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    for (size_t burst = 0; burst < 2; burst++) {
+        const uint64_t num_pkts = uint64_t(duration*samp_rate/2)/spp;
+        for (uint64_t n = 0; n < num_pkts; n++) {
+            while (credits == 0) {
+                async_reader::read(data_xport, 0.1, credits, last_ack, underflows, burst_acks);
+            }
+            credits--;
+            vrt::if_packet_info_t info;
+            info.packet_type = vrt::if_packet_info_t::PACKET_TYPE_DATA;
+            info.num_payload_words32 = spp;
+            info.packet_count = seq++;
+            info.sob = n == 0;
+            info.eob = burst == 1 and n == num_pkts-1;
+            info.sid = data_sid;
+            info.has_tsf = burst == 0 and n == 0;
+            info.tsf = start_tsf;
+            send_chdr(data_xport, info, &samps.front());
+            num_sent += spp;
+        }
+        const boost::chrono::steady_clock::time_point wait_start = boost::chrono::steady_clock::now();
+        while ((burst == 0? underflows : burst_acks) == 0 and secs_since(wait_start) < 2.0) {
+            async_reader::read(data_xport, 0.1, credits, last_ack, underflows, burst_acks);
+        }
+    }
+    const double secs = secs_since(start);
+
+    std::cout << boost::format("TX: %u samples in %.3f s, %.3f Msps, %u underflows, %u burst acks")
+        % num_sent % secs % (num_sent/secs/1e6) % underflows % burst_acks << std::endl;
+    if (underflows != 1 or burst_acks != 1) throw shd::runtime_error("TX async messages are wrong");
+}
+
+static bool stop_signal_called = false;
+static void sig_int_handler(int){ stop_signal_called = true; }
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    unsigned short port;
+    double tick_rate, samp_rate, duration;
+    size_t spp, tx_buff_log2, fc_window;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("port", po::value<unsigned short>(&port)->default_value(49153), "UDP port to listen on (0 for any)")
+        ("tick-rate", po::value<double>(&tick_rate)->default_value(200e6), "device tick rate in Hz")
+        ("rate", po::value<double>(&samp_rate)->default_value(10e6), "sample rate of the radio in Sps")
+        ("tx-buff", po::value<size_t>(&tx_buff_log2)->default_value(14), "radio TX buffer size, log2 of 8 byte lines")
+        ("selftest", "run a host against the simulator and exit")
+        ("duration", po::value<double>(&duration)->default_value(1.0), "self test streaming duration in seconds")
+        ("spp", po::value<size_t>(&spp)->default_value(DEFAULT_SPP), "self test samples per packet")
+        ("fc-window", po::value<size_t>(&fc_window)->default_value(32), "self test RX flow control window in packets")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or spp == 0 or spp > MAX_PKT_WORDS-4) {
+        std::cout << boost::format("SHD Device3 Simulator %s") % desc << std::endl;
+        std::cout <<
+            "Emulates the CHDR endpoints of a device3 (radio, DDC and DUC blocks)\n"
+            "on a localhost UDP port: control, timed RX streams and TX play out,\n"
+            "both under flow control. With --selftest, a host talks to it through\n"
+            "the UDP transport and block control interface and reports the rates.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    device3_sim sim(vm.count("selftest")? 0 : port, tick_rate, samp_rate, tx_buff_log2);
+
+    if (vm.count("selftest")) {
+        test_ctrl(sim.get_port(), 1000);
+        test_rx(sim.get_port(), tick_rate, samp_rate, duration, spp, fc_window, true);
+        test_rx(sim.get_port(), tick_rate, samp_rate, 0.05, spp, fc_window, false);
+        test_tx(sim.get_port(), tick_rate, samp_rate, duration, spp);
+        return EXIT_SUCCESS;
+    }
+
+    std::signal(SIGINT, &sig_int_handler);
+    std::cout << boost::format("Simulating device %02X on UDP port %u, press Ctrl + C to stop") % DEVICE_ADDR % sim.get_port() << std::endl;
+    while (not stop_signal_called) {
+        boost::this_thread::sleep(boost::posix_time::seconds(1));
+        const device3_sim::stats_t stats = sim.get_stats();
+        std::cout << boost::format("ctrl %u, rx %u (%u overflows), tx %u (%u underflows, %u late, %u seq errors)")
+            % stats.ctrl_pkts % stats.rx_pkts % stats.rx_overflows % stats.tx_pkts
+            % stats.tx_underflows % stats.tx_late % stats.tx_seq_errors << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
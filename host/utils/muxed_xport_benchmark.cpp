@@ -0,0 +1,242 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/utils/atomic.hpp>
+#include <shd/transport/udp_zero_copy.hpp>
+#include <shd/transport/muxed_zero_copy_if.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+namespace po = boost::program_options;
+namespace asio = boost::asio;
+using namespace shd::transport;
+
+/***********************************************************************
+ * Frame layout: stream number, then the send time in nanoseconds
+ **********************************************************************/
+struct frame_hdr_t {
+    uint32_t stream_num;
+    uint32_t pad;
+    int64_t send_time_ns;
+};
+
+static int64_t now_ns(void){
+    return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+        boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t classify_frame(void *buff, size_t size){
+    if (size < sizeof(frame_hdr_t)) throw shd::value_error("short frame");
+    return reinterpret_cast<const frame_hdr_t *>(buff)->stream_num;
+}
+
+/***********************************************************************
+ * Consumer: drains one muxed stream and records the one-way latency
+ **********************************************************************/
+struct consumer_result_t {
+    consumer_result_t(void): num_frames(0), num_bytes(0) {}
+    uint64_t num_frames;
+    uint64_t num_bytes;
+    std::vector<double> latencies_us;
+};
+
+static void consume_stream(
+    zero_copy_if::sptr stream,
+    consumer_result_t &result,
+    shd::atomic_uint32_t &num_received,
+    volatile bool &running
+){
+    while (running){
+        managed_recv_buffer::sptr mrb = stream->get_recv_buff(0.1);
+        if (not mrb) continue;
+        const int64_t latency_ns = now_ns() - mrb->cast<const frame_hdr_t *>()->send_time_ns;
+        result.num_frames++;
+        result.num_bytes += mrb->size();
+        if (result.latencies_us.size() < 1000000){
+            result.latencies_us.push_back(latency_ns/1e3);
+        }
+        mrb.reset();
+        num_received.inc();
+    }
+}
+
+/***********************************************************************
+ * Sender: sends frames to the streams in turn, either as fast as the
+ * socket takes them, or one at a time waiting for each to arrive
+ **********************************************************************/
+static void send_frames(
+    asio::ip::udp::socket &sock,
+    const size_t num_streams,
+    const size_t frame_size,
+    const bool one_at_a_time,
+    shd::atomic_uint32_t &num_received,
+    volatile bool &running
+){
+    std::vector<char> frame(frame_size, 0x5a);
+    frame_hdr_t *hdr = reinterpret_cast<frame_hdr_t *>(&frame.front());
+    hdr->pad = 0;
+    uint32_t num_sent = 0;
+    for (size_t stream_num = 0; running; stream_num = (stream_num+1) % num_streams){
+        hdr->stream_num = uint32_t(stream_num);
+        hdr->send_time_ns = now_ns();
+        boost::system::error_code ec;
+        sock.send(asio::buffer(frame), 0, ec);
+        if (ec == asio::error::no_buffer_space) boost::this_thread::yield();
+        if (ec) continue;
+        num_sent++;
+        if (not one_at_a_time) continue;
+        const int64_t give_up_ns = now_ns() + 100000000; //the frame may be dropped
+        while (running and num_received.read() != num_sent and now_ns() < give_up_ns){
+            boost::this_thread::yield();
+        }
+        num_sent = num_received.read();
+    }
+}
+
+static void run_benchmark(
+    const size_t num_streams,
+    const size_t frame_size,
+    const size_t num_recv_frames,
+    const double duration,
+    const bool latency_mode
+){
+    asio::io_service io_service;
+    asio::ip::udp::socket sender(io_service,
+        asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0));
+    const std::string port = boost::lexical_cast<std::string>(sender.local_endpoint().port());
+
+    zero_copy_xport_params default_buff_args;
+    default_buff_args.recv_frame_size = frame_size;
+    default_buff_args.send_frame_size = frame_size;
+    default_buff_args.num_recv_frames = num_recv_frames;
+    default_buff_args.num_send_frames = 1;
+    udp_zero_copy::buff_params buff_params;
+    udp_zero_copy::sptr xport = udp_zero_copy::make(
+        "127.0.0.1", port, default_buff_args, buff_params, shd::device_addr_t());
+
+    //the transport is connected to the sender's port,
+    //so learn its ephemeral port from a hello frame
+    managed_send_buffer::sptr hello = xport->get_send_buff(1.0);
+    hello->commit(4);
+    hello.reset();
+    std::vector<char> scratch(frame_size);
+    asio::ip::udp::endpoint xport_endpoint;
+    sender.receive_from(asio::buffer(scratch), xport_endpoint);
+    sender.connect(xport_endpoint);
+
+    muxed_zero_copy_if::sptr muxed = muxed_zero_copy_if::make(xport, &classify_frame, num_streams);
+    std::vector<zero_copy_if::sptr> streams;
+    for (size_t i = 0; i < num_streams; i++){
+        streams.push_back(muxed->make_stream(uint32_t(i)));
+    }
+
+    volatile bool running = true;
+    shd::atomic_uint32_t num_received;
+    std::vector<consumer_result_t> results(num_streams);
+    boost::thread_group consumers;
+    for (size_t i = 0; i < num_streams; i++){
+        consumers.create_thread(boost::bind(&consume_stream,
+            streams[i], boost::ref(results[i]), boost::ref(num_received), boost::ref(running)));
+    }
+
+    const boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    boost::thread sender_thread(boost::bind(&send_frames, boost::ref(sender),
+        num_streams, frame_size, latency_mode, boost::ref(num_received), boost::ref(running)));
+    boost::this_thread::sleep(boost::posix_time::microseconds(long(duration*1e6)));
+    running = false;
+    sender_thread.join();
+    consumers.join_all();
+    const double secs = boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+
+    uint64_t num_frames = 0, num_bytes = 0;
+    std::vector<double> latencies_us;
+    BOOST_FOREACH(const consumer_result_t &result, results){
+        num_frames += result.num_frames;
+        num_bytes += result.num_bytes;
+        latencies_us.insert(latencies_us.end(), result.latencies_us.begin(), result.latencies_us.end());
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const double median_us = latencies_us.empty()? 0.0 : latencies_us[latencies_us.size()/2];
+    const double p99_us = latencies_us.empty()? 0.0 : latencies_us[latencies_us.size()*99/100];
+
+    std::cout << boost::format("%d,%s,%.0f,%.3f,%.1f,%.1f,%d")
+        % num_streams
+        % (latency_mode? "latency" : "throughput")
+        % (num_frames/secs)
+        % (num_bytes/secs/1e9)
+        % median_us
+        % p99_us
+        % muxed->get_num_dropped_frames()
+        << std::endl;
+
+    streams.clear();
+    muxed.reset();
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    std::string num_streams_list;
+    size_t frame_size, num_recv_frames;
+    double duration;
+
+    po::options_description desc("Muxed transport benchmark options:");
+    desc.add_options()
+        ("help", "help message")
+        ("streams", po::value<std::string>(&num_streams_list)->default_value("1,4,16"), "Comma-separated list of stream counts to compare")
+        ("frame-size", po::value<size_t>(&frame_size)->default_value(8000), "Datagram size in bytes")
+        ("num-recv-frames", po::value<size_t>(&num_recv_frames)->default_value(128), "Number of receive frames of the base transport")
+        ("duration", po::value<double>(&duration)->default_value(3.0), "Duration of each run in seconds")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or frame_size < sizeof(frame_hdr_t)){
+        std::cout << boost::format("SHD Muxed Transport Benchmark %s") % desc << std::endl;
+        std::cout << "  Streams datagrams over the loopback interface into a udp_zero_copy\n"
+                     "  transport that is demuxed into N streams, one consumer thread each.\n"
+                     "  Throughput mode sends as fast as possible. Latency mode sends one\n"
+                     "  frame at a time and reports the time from send to consumer.\n" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> stream_counts;
+    boost::split(stream_counts, num_streams_list, boost::is_any_of(","), boost::token_compress_on);
+
+    std::cout << "streams,mode,frames_per_sec,GB/s,median_latency_us,p99_latency_us,dropped" << std::endl;
+    BOOST_FOREACH(const std::string &count, stream_counts){
+        const size_t num_streams = boost::lexical_cast<size_t>(count);
+        run_benchmark(num_streams, frame_size, num_recv_frames, duration, false);
+        run_benchmark(num_streams, frame_size, num_recv_frames, duration, true);
+    }
+
+    return EXIT_SUCCESS;
+}
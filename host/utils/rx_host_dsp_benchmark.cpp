@@ -0,0 +1,130 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/utils/rx_host_dsp.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iostream>
+#include <complex>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace po = boost::program_options;
+using namespace shd;
+
+typedef boost::chrono::steady_clock clock_type;
+
+/***********************************************************************
+ * A streamer that hands out the same noise as fast as it is asked for,
+ * so the time spent is that of the DSP stage
+ **********************************************************************/
+class noise_rx_streamer : public rx_streamer
+{
+public:
+    noise_rx_streamer(const size_t num_chans):
+        _num_chans(num_chans), _noise(get_max_num_samps())
+    {
+        for (size_t i = 0; i < _noise.size(); i++) {
+            _noise[i] = std::complex<float>(float(std::rand())/RAND_MAX - 0.5f, float(std::rand())/RAND_MAX - 0.5f);
+        }
+    }
+
+    size_t get_num_channels(void) const{ return _num_chans; }
+    size_t get_max_num_samps(void) const{ return 2000; }
+
+    size_t recv(const buffs_type &buffs, const size_t nsamps_per_buff,
+        rx_metadata_t &md, const double, const bool)
+    {
+        md.reset();
+        const size_t nsamps = std::min(nsamps_per_buff, get_max_num_samps());
+        for (size_t ch = 0; ch < _num_chans; ch++) {
+            std::copy(_noise.begin(), _noise.begin() + nsamps, static_cast<std::complex<float> *>(buffs[ch]));
+        }
+        return nsamps;
+    }
+
+    void issue_stream_cmd(const stream_cmd_t &){}
+
+private:
+    const size_t _num_chans;
+    std::vector<std::complex<float> > _noise;
+};
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    std::string ratios, args;
+    size_t num_chans;
+    double duration;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("ratios", po::value<std::string>(&ratios)->default_value("0.1,0.3,0.75,1.0,1.6,4.0"), "comma separated output over input rates")
+        ("chans", po::value<size_t>(&num_chans)->default_value(1), "number of channels")
+        ("duration", po::value<double>(&duration)->default_value(1.0), "seconds per ratio")
+        ("args", po::value<std::string>(&args)->default_value("host_freq=1.234e3"), "more stream args (host_freq, dsp_threads, dsp_cpus)")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or num_chans == 0 or duration <= 0.0) {
+        std::cout << boost::format("SHD RX Host DSP Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Runs the host DSP stage on noise at each rate ratio and prints the\n"
+            "input rate it keeps up with. A ratio of 1.0 only runs the NCO.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    std::vector<std::string> ratio_list;
+    boost::split(ratio_list, ratios, boost::is_any_of(","));
+
+    std::cout << boost::format("SIMD kernels: %s, %u channel(s)") % rx_host_dsp::get_simd_name() % num_chans << std::endl;
+    std::cout << boost::format("%8s %6s %14s %14s") % "Ratio" % "Taps" % "In MS/s/chan" % "Out MS/s/chan" << std::endl;
+    BOOST_FOREACH(const std::string &ratio_str, ratio_list) {
+        const double in_rate = 100e6, ratio = boost::lexical_cast<double>(ratio_str);
+        stream_args_t stream_args("fc32");
+        stream_args.args = device_addr_t(args);
+        stream_args.args["host_rate"] = boost::lexical_cast<std::string>(in_rate*ratio);
+        rx_host_dsp::sptr dsp = rx_host_dsp::make(
+            boost::make_shared<noise_rx_streamer>(num_chans), stream_args, in_rate);
+
+        std::vector<std::vector<std::complex<float> > > buffs(num_chans, std::vector<std::complex<float> >(10000));
+        std::vector<void *> buff_ptrs;
+        for (size_t ch = 0; ch < num_chans; ch++) buff_ptrs.push_back(&buffs[ch].front());
+
+        rx_metadata_t md;
+        size_t num_out = 0;
+        const clock_type::time_point start = clock_type::now();
+        double secs = 0.0;
+        while (secs < duration) {
+            num_out += dsp->recv(buff_ptrs, buffs[0].size(), md, 1.0);
+            secs = boost::chrono::duration<double>(clock_type::now() - start).count();
+        }
+        std::cout << boost::format("%8.3f %6u %14.1f %14.1f")
+            % ratio % dsp->get_num_taps() % (num_out/ratio/secs/1e6) % (num_out/secs/1e6) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
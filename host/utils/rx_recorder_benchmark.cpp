@@ -0,0 +1,204 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/utils/rx_recorder.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+using namespace shd;
+
+typedef boost::chrono::steady_clock clock_type;
+
+static double secs_between(const clock_type::time_point &start, const clock_type::time_point &end)
+{
+    return boost::chrono::duration<double>(end - start).count();
+}
+
+/***********************************************************************
+ * A streamer that delivers a packet of samples whenever the sample
+ * rate says it has arrived, and records how late the caller picks it
+ * up. A device has to buffer the samples for the longest delay.
+ **********************************************************************/
+class paced_rx_streamer : public rx_streamer
+{
+public:
+    paced_rx_streamer(const size_t num_samps, const double samp_rate):
+        _num_samps(num_samps), _samp_rate(samp_rate), _next(0),
+        _max_delay(0.0), _total_delay(0.0), _num_pkts(0)
+    {
+        /* NOP */
+    }
+
+    size_t get_num_channels(void) const{ return 1; }
+    size_t get_max_num_samps(void) const{ return 2000; }
+
+    size_t recv(const buffs_type &buffs, const size_t nsamps_per_buff,
+        rx_metadata_t &md, const double, const bool)
+    {
+        if (_next == 0) _start = clock_type::now();
+        md.reset();
+        const size_t nsamps = std::min(std::min(nsamps_per_buff, get_max_num_samps()), _num_samps - _next);
+        if (nsamps == 0) {
+            md.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+            return 0;
+        }
+
+        //wait for the samples to arrive or note how long they waited
+        const double arrival = (_next + nsamps)/_samp_rate;
+        const double delay = secs_between(_start, clock_type::now()) - arrival;
+        if (delay < 0.0) {
+            boost::this_thread::sleep(boost::posix_time::microseconds(long(-delay*1e6)));
+        }
+        else {
+            _max_delay = std::max(_max_delay, delay);
+        }
+        _total_delay += std::max(delay, 0.0);
+        _num_pkts++;
+
+        uint32_t *samps = reinterpret_cast<uint32_t *>(buffs[0]);
+        for (size_t i = 0; i < nsamps; i++) samps[i] = uint32_t(_next + i);
+        _next += nsamps;
+        return nsamps;
+    }
+
+    void issue_stream_cmd(const stream_cmd_t &){}
+
+    double get_max_delay(void) const{ return _max_delay; }
+    double get_mean_delay(void) const{ return _total_delay/std::max<size_t>(1, _num_pkts); }
+
+private:
+    const size_t _num_samps;
+    const double _samp_rate;
+    size_t _next;
+    double _max_delay, _total_delay;
+    size_t _num_pkts;
+    clock_type::time_point _start;
+};
+
+struct result_t{
+    double secs;
+    double max_delay, mean_delay;
+    bool direct_io;
+};
+
+//! What rx_samples_to_file does: write on the receive thread
+static result_t run_ofstream(const std::string &file, const size_t num_samps, const double samp_rate)
+{
+    boost::shared_ptr<paced_rx_streamer> rx_stream = boost::make_shared<paced_rx_streamer>(num_samps, samp_rate);
+    std::vector<uint32_t> buff(rx_stream->get_max_num_samps());
+    std::ofstream outfile(file.c_str(), std::ofstream::binary);
+    const clock_type::time_point start = clock_type::now();
+    rx_streamer &streamer = *rx_stream;
+    rx_metadata_t md;
+    while (size_t nsamps = streamer.recv(&buff.front(), buff.size(), md, 1.0)) {
+        outfile.write(reinterpret_cast<const char *>(&buff.front()), nsamps*sizeof(uint32_t));
+    }
+    outfile.close();
+    result_t result;
+    result.secs = secs_between(start, clock_type::now());
+    result.max_delay = rx_stream->get_max_delay();
+    result.mean_delay = rx_stream->get_mean_delay();
+    result.direct_io = false;
+    return result;
+}
+
+static result_t run_recorder(const std::string &file, const size_t num_samps, const double samp_rate, const std::string &args)
+{
+    boost::shared_ptr<paced_rx_streamer> rx_stream = boost::make_shared<paced_rx_streamer>(num_samps, samp_rate);
+    rx_recorder::sptr recorder = rx_recorder::make(
+        rx_stream, "sc16", std::vector<std::string>(1, file), device_addr_t(args));
+    const clock_type::time_point start = clock_type::now();
+    recorder->record(0);
+    recorder->close();
+    result_t result;
+    result.secs = secs_between(start, clock_type::now());
+    result.max_delay = rx_stream->get_max_delay();
+    result.mean_delay = rx_stream->get_mean_delay();
+    result.direct_io = recorder->get_stats().direct_io;
+    return result;
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    std::string dirs, args;
+    size_t size_mb;
+    double rate;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("dirs", po::value<std::string>(&dirs)->default_value("/dev/shm,/var/tmp"), "comma separated directories to write to")
+        ("size", po::value<size_t>(&size_mb)->default_value(1024), "MiB to record per run")
+        ("rate", po::value<double>(&rate)->default_value(50e6), "sc16 sample rate of the simulated stream in Sps")
+        ("args", po::value<std::string>(&args)->default_value(""), "recorder arguments (buff_size, num_buffs, direct)")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or size_mb == 0 or rate <= 0.0) {
+        std::cout << boost::format("SHD RX Recorder Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Records a stream of samples to each directory, once writing on the\n"
+            "receive thread with std::ofstream and once with the rx_recorder.\n"
+            "The longest delay before recv() picks up a packet is what the device\n"
+            "has to buffer to not overflow.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    const size_t num_samps = size_mb*1024*1024/sizeof(uint32_t);
+    std::vector<std::string> dir_list;
+    boost::split(dir_list, dirs, boost::is_any_of(","));
+
+    std::cout << boost::format("%.1f Msps, %u MiB per run") % (rate/1e6) % size_mb << std::endl;
+    std::cout << boost::format("%-12s %-10s %10s %14s %14s %7s")
+        % "Directory" % "Writer" % "MB/s" % "Max delay ms" % "Mean delay us" % "Direct" << std::endl;
+    BOOST_FOREACH(const std::string &dir, dir_list) {
+        if (not fs::is_directory(dir)) {
+            std::cout << boost::format("%-12s skipped, not a directory") % dir << std::endl;
+            continue;
+        }
+        const std::string file = (fs::path(dir) / fs::unique_path("rx_recorder_%%%%%%%%.dat")).string();
+        for (size_t mode = 0; mode < 2; mode++) {
+            const result_t result = (mode == 0)?
+                run_ofstream(file, num_samps, rate) : run_recorder(file, num_samps, rate, args);
+            fs::remove(file);
+            std::cout << boost::format("%-12s %-10s %10.1f %14.2f %14.2f %7s")
+                % dir % ((mode == 0)? "ofstream" : "recorder")
+                % (num_samps*sizeof(uint32_t)/result.secs/1e6)
+                % (result.max_delay*1e3) % (result.mean_delay*1e6)
+                % (result.direct_io? "yes" : "no") << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/transport/bounded_buffer.hpp>
+#include <shd/transport/spsc_ring.hpp>
+#include <shd/transport/zero_copy.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+namespace po = boost::program_options;
+using namespace shd::transport;
+
+//! The queues carry what the transports carry
+typedef managed_recv_buffer::sptr elem_type;
+
+/***********************************************************************
+ * A dummy buffer, so the elements have the cost of a real refcount
+ **********************************************************************/
+class dummy_mrb : public managed_recv_buffer{
+public:
+    void release(void){
+        /* NOP */
+    }
+
+    sptr get_new(void){
+        return make(this, _mem, sizeof(_mem));
+    }
+
+private:
+    char _mem[64];
+};
+
+/***********************************************************************
+ * Throughput: one thread pushes, the other pops as fast as it can
+ **********************************************************************/
+template <typename queue_type>
+static void push_all(queue_type &queue, const size_t num_elems, const elem_type &elem){
+    for (size_t i = 0; i < num_elems; i++){
+        queue.push_with_wait(elem);
+    }
+}
+
+template <typename queue_type>
+static double run_throughput(const size_t depth, const size_t num_elems){
+    queue_type queue(depth);
+    dummy_mrb mrb;
+    const elem_type elem = mrb.get_new();
+
+    const boost::chrono::high_resolution_clock::time_point start =
+        boost::chrono::high_resolution_clock::now();
+    boost::thread producer(boost::bind(&push_all<queue_type>, boost::ref(queue), num_elems, elem));
+    elem_type popped;
+    for (size_t i = 0; i < num_elems; i++){
+        queue.pop_with_wait(popped);
+        popped.reset();
+    }
+    producer.join();
+    const boost::chrono::duration<double> elapsed =
+        boost::chrono::high_resolution_clock::now() - start;
+    return num_elems/elapsed.count();
+}
+
+/***********************************************************************
+ * Latency: ping-pong one element between two threads through two
+ * queues and time every round trip
+ **********************************************************************/
+template <typename queue_type>
+static void echo_all(queue_type &ping, queue_type &pong, const size_t num_elems){
+    elem_type elem;
+    for (size_t i = 0; i < num_elems; i++){
+        ping.pop_with_wait(elem);
+        pong.push_with_wait(elem);
+        elem.reset();
+    }
+}
+
+template <typename queue_type>
+static std::vector<double> run_latency(const size_t depth, const size_t num_elems){
+    queue_type ping(depth), pong(depth);
+    dummy_mrb mrb;
+    elem_type elem = mrb.get_new();
+
+    std::vector<double> handoffs_ns;
+    handoffs_ns.reserve(num_elems);
+    boost::thread echo(boost::bind(&echo_all<queue_type>, boost::ref(ping), boost::ref(pong), num_elems));
+    for (size_t i = 0; i < num_elems; i++){
+        const boost::chrono::high_resolution_clock::time_point start =
+            boost::chrono::high_resolution_clock::now();
+        ping.push_with_wait(elem);
+        pong.pop_with_wait(elem);
+        const boost::chrono::duration<double> elapsed =
+            boost::chrono::high_resolution_clock::now() - start;
+        //a round trip is two handoffs
+        handoffs_ns.push_back(elapsed.count()*1e9/2);
+    }
+    echo.join();
+    std::sort(handoffs_ns.begin(), handoffs_ns.end());
+    return handoffs_ns;
+}
+
+template <typename queue_type>
+static void run_benchmarks(const std::string &name, const size_t depth, const size_t num_elems){
+    const double elems_per_sec = run_throughput<queue_type>(depth, num_elems);
+    const std::vector<double> handoffs_ns = run_latency<queue_type>(depth, num_elems/10+1);
+    std::cout << boost::format(
+        "%-16s %12.3f Melem/s   handoff median %8.0f ns   p99 %8.0f ns"
+    ) % name % (elems_per_sec/1e6)
+      % handoffs_ns[handoffs_ns.size()/2]
+      % handoffs_ns[handoffs_ns.size()*99/100] << std::endl;
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[]){
+    size_t depth, num_elems;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("depth", po::value<size_t>(&depth)->default_value(32), "capacity of the queues")
+        ("num", po::value<size_t>(&num_elems)->default_value(1000000), "number of elements to pass through the queue")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or depth == 0 or num_elems == 0){
+        std::cout << boost::format("SHD SPSC Ring Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Compare the mutex-based bounded_buffer with the lock-free spsc_ring.\n"
+            "Throughput: one thread pushes buffer pointers, another pops them.\n"
+            "Latency: one buffer pointer is passed back and forth between two threads.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    std::cout << boost::format("Queue depth %u, %u elements") % depth % num_elems << std::endl;
+    run_benchmarks<bounded_buffer<elem_type> >("bounded_buffer", depth, num_elems);
+    run_benchmarks<spsc_ring<elem_type> >("spsc_ring", depth, num_elems);
+    return EXIT_SUCCESS;
+}
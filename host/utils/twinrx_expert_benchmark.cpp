@@ -0,0 +1,274 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Builds the expert graph of a two-channel TwinRX, exactly as db_twinrx.cpp
+// does, on top of a null control interface and times the property writes
+// that the application makes to tune it.
+
+#include "twinrx_experts.hpp"
+#include <expert_factory.hpp>
+#include <shd/utils/safe_main.hpp>
+#include <shd/property_tree.hpp>
+#include <shd/smini/dboard_iface.hpp>
+#include <shd/types/time_spec.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/assign/list_of.hpp>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+namespace po = boost::program_options;
+using namespace shd;
+using namespace shd::smini;
+using namespace shd::smini::dboard::twinrx;
+using namespace shd::experts;
+
+/***********************************************************************
+ * Null hardware: every control call returns immediately
+ **********************************************************************/
+class null_twinrx_ctrl : public twinrx_ctrl {
+public:
+    void commit() {}
+    void set_chan_enabled(channel_t, bool, bool) {}
+    void set_preamp1(channel_t, preamp_state_t, bool) {}
+    void set_preamp2(channel_t, bool, bool) {}
+    void set_lb_preamp_preselector(channel_t, bool, bool) {}
+    void set_signal_path(channel_t, signal_path_t, bool) {}
+    void set_lb_preselector(channel_t, preselector_path_t, bool) {}
+    void set_hb_preselector(channel_t, preselector_path_t, bool) {}
+    void set_input_atten(channel_t, uint8_t, bool) {}
+    void set_lb_atten(channel_t, uint8_t, bool) {}
+    void set_hb_atten(channel_t, uint8_t, bool) {}
+    void set_lo1_source(channel_t, lo_source_t, bool) {}
+    void set_lo2_source(channel_t, lo_source_t, bool) {}
+    void set_lo1_export_source(lo_export_source_t, bool) {}
+    void set_lo2_export_source(lo_export_source_t, bool) {}
+    void set_antenna_mapping(antenna_mapping_t, bool) {}
+    void set_crossover_cal_mode(cal_mode_t, bool) {}
+    double set_lo1_synth_freq(channel_t, double freq, bool) { return freq; }
+    double set_lo2_synth_freq(channel_t, double freq, bool) { return freq; }
+    bool read_lo1_locked(channel_t) { return true; }
+    bool read_lo2_locked(channel_t) { return true; }
+};
+
+class null_dboard_iface : public dboard_iface {
+public:
+    special_props_t get_special_props(void) { return special_props_t(); }
+    void write_aux_dac(unit_t, aux_dac_t, double) {}
+    double read_aux_adc(unit_t, aux_adc_t) { return 0.0; }
+    void set_pin_ctrl(unit_t, uint32_t, uint32_t) {}
+    uint32_t get_pin_ctrl(unit_t) { return 0; }
+    void set_atr_reg(unit_t, atr_reg_t, uint32_t, uint32_t) {}
+    uint32_t get_atr_reg(unit_t, atr_reg_t) { return 0; }
+    void set_gpio_ddr(unit_t, uint32_t, uint32_t) {}
+    uint32_t get_gpio_ddr(unit_t) { return 0; }
+    void set_gpio_out(unit_t, uint32_t, uint32_t) {}
+    uint32_t get_gpio_out(unit_t) { return 0; }
+    uint32_t read_gpio(unit_t) { return 0; }
+    void write_spi(unit_t, const spi_config_t &, uint32_t, size_t) {}
+    uint32_t read_write_spi(unit_t, const spi_config_t &, uint32_t, size_t) { return 0; }
+    void set_clock_rate(unit_t, double) {}
+    double get_clock_rate(unit_t) { return 100e6; }
+    std::vector<double> get_clock_rates(unit_t) { return std::vector<double>(1, 100e6); }
+    void set_clock_enabled(unit_t, bool) {}
+    double get_codec_rate(unit_t) { return 200e6; }
+    void set_fe_connection(unit_t, const std::string&, const fe_connection_t&) {}
+    time_spec_t get_command_time(void) { return time_spec_t(0.0); }
+    void set_command_time(const time_spec_t&) {}
+    void write_i2c(uint16_t, const byte_vector_t &) {}
+    byte_vector_t read_i2c(uint16_t, size_t num_bytes) { return byte_vector_t(num_bytes); }
+};
+
+/***********************************************************************
+ * The TwinRX expert graph (mirrors twinrx_rcvr_fe and twinrx_rcvr)
+ **********************************************************************/
+static void add_fe_nodes(expert_container::sptr expert, property_tree::sptr subtree, const std::string &ch)
+{
+    expert_factory::add_data_node<time_spec_t>(expert, prepend_ch("time/rx_frontend", ch), time_spec_t(0.0));
+    expert_factory::add_prop_node<time_spec_t>(expert, subtree,
+        "time/cmd", prepend_ch("time/cmd", ch), time_spec_t(0.0));
+    expert_factory::add_dual_prop_node<double>(expert, subtree,
+        "freq/value", prepend_ch("freq/desired", ch), prepend_ch("freq/coerced", ch),
+        1.0e9, AUTO_RESOLVE_ON_READ_WRITE);
+    expert_factory::add_dual_prop_node<double>(expert, subtree,
+        "if_freq/value", prepend_ch("if_freq/desired", ch), prepend_ch("if_freq/coerced", ch),
+        150e6, AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_dual_prop_node<double>(expert, subtree,
+        "los/LO1/freq/value", prepend_ch("los/LO1/freq/desired", ch), prepend_ch("los/LO1/freq/coerced", ch),
+        0.0, AUTO_RESOLVE_ON_READ_WRITE);
+    expert_factory::add_dual_prop_node<double>(expert, subtree,
+        "los/LO2/freq/value", prepend_ch("los/LO2/freq/desired", ch), prepend_ch("los/LO2/freq/coerced", ch),
+        0.0, AUTO_RESOLVE_ON_READ_WRITE);
+    expert_factory::add_prop_node<std::string>(expert, subtree,
+        "los/all/source/value", prepend_ch("los/all/source", ch), "internal", AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_prop_node<bool>(expert, subtree,
+        "los/all/export", prepend_ch("los/all/export", ch), false, AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_prop_node<double>(expert, subtree,
+        "gains/all/value", prepend_ch("gain", ch), 0.0, AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_prop_node<std::string>(expert, subtree,
+        "gains/all/profile/value", prepend_ch("gain_profile", ch), "default", AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_prop_node<std::string>(expert, subtree,
+        "antenna/value", prepend_ch("antenna", ch), (ch == "0" ? "RX1" : "RX2"), AUTO_RESOLVE_ON_WRITE);
+    expert_factory::add_prop_node<bool>(expert, subtree,
+        "enabled", prepend_ch("enabled", ch), false, AUTO_RESOLVE_ON_WRITE);
+
+    expert_factory::add_data_node<lo_inj_side_t>(expert, prepend_ch("ch/LO1/inj_side", ch), INJ_LOW_SIDE);
+    expert_factory::add_data_node<lo_inj_side_t>(expert, prepend_ch("ch/LO2/inj_side", ch), INJ_LOW_SIDE);
+    expert_factory::add_data_node<twinrx_ctrl::signal_path_t>(expert,
+        prepend_ch("ch/signal_path", ch), twinrx_ctrl::PATH_LOWBAND);
+    expert_factory::add_data_node<twinrx_ctrl::preselector_path_t>(expert,
+        prepend_ch("ch/lb_presel", ch), twinrx_ctrl::PRESEL_PATH1);
+    expert_factory::add_data_node<twinrx_ctrl::preselector_path_t>(expert,
+        prepend_ch("ch/hb_presel", ch), twinrx_ctrl::PRESEL_PATH1);
+    expert_factory::add_data_node<bool>(expert, prepend_ch("ch/lb_preamp_presel", ch), false);
+    expert_factory::add_data_node<bool>(expert, prepend_ch("ant/lb_preamp_presel", ch), false);
+    expert_factory::add_data_node<twinrx_ctrl::preamp_state_t>(expert,
+        prepend_ch("ch/preamp1", ch), twinrx_ctrl::PREAMP_BYPASS);
+    expert_factory::add_data_node<twinrx_ctrl::preamp_state_t>(expert,
+        prepend_ch("ant/preamp1", ch), twinrx_ctrl::PREAMP_BYPASS);
+    expert_factory::add_data_node<bool>(expert, prepend_ch("ch/preamp2", ch), false);
+    expert_factory::add_data_node<bool>(expert, prepend_ch("ant/preamp2", ch), false);
+    expert_factory::add_data_node<uint8_t>(expert, prepend_ch("ch/input_atten", ch), 0);
+    expert_factory::add_data_node<uint8_t>(expert, prepend_ch("ant/input_atten", ch), 0);
+    expert_factory::add_data_node<uint8_t>(expert, prepend_ch("ch/lb_atten", ch), 0);
+    expert_factory::add_data_node<uint8_t>(expert, prepend_ch("ch/hb_atten", ch), 0);
+    expert_factory::add_data_node<twinrx_ctrl::lo_source_t>(expert,
+        prepend_ch("ch/LO1/source", ch), twinrx_ctrl::LO_INTERNAL);
+    expert_factory::add_data_node<twinrx_ctrl::lo_source_t>(expert,
+        prepend_ch("ch/LO2/source", ch), twinrx_ctrl::LO_INTERNAL);
+    expert_factory::add_data_node<lo_synth_mapping_t>(expert, prepend_ch("synth/LO1/mapping", ch), MAPPING_NONE);
+    expert_factory::add_data_node<lo_synth_mapping_t>(expert, prepend_ch("synth/LO2/mapping", ch), MAPPING_NONE);
+}
+
+static expert_container::sptr make_twinrx_expert(property_tree::sptr tree)
+{
+    expert_container::sptr expert = expert_factory::create_container("twinrx_expert");
+    twinrx_ctrl::sptr ctrl = boost::make_shared<null_twinrx_ctrl>();
+    dboard_iface::sptr db_iface = boost::make_shared<null_dboard_iface>();
+    const std::vector<std::string> fe_names = boost::assign::list_of("0")("1");
+
+    BOOST_FOREACH(const std::string& fe, fe_names) {
+        add_fe_nodes(expert, tree->subtree("rx_frontends/" + fe), fe);
+    }
+
+    expert_factory::add_data_node<twinrx_ctrl::lo_export_source_t>(expert,
+        "com/LO1/export_source", twinrx_ctrl::LO_EXPORT_DISABLED);
+    expert_factory::add_data_node<twinrx_ctrl::lo_export_source_t>(expert,
+        "com/LO2/export_source", twinrx_ctrl::LO_EXPORT_DISABLED);
+    expert_factory::add_data_node<twinrx_ctrl::antenna_mapping_t>(expert,
+        "com/ant_mapping", twinrx_ctrl::ANTX_NATIVE);
+    expert_factory::add_data_node<twinrx_ctrl::cal_mode_t>(expert,
+        "com/cal_mode", twinrx_ctrl::CAL_DISABLED);
+    expert_factory::add_data_node<bool>(expert, "com/synth/LO1/hopping_enabled", false);
+    expert_factory::add_data_node<bool>(expert, "com/synth/LO2/hopping_enabled", false);
+
+    BOOST_FOREACH(const std::string& fe, fe_names) {
+        expert_factory::add_worker_node<twinrx_freq_path_expert>(expert, expert->node_retriever(), fe);
+        expert_factory::add_worker_node<twinrx_freq_coercion_expert>(expert, expert->node_retriever(), fe);
+        expert_factory::add_worker_node<twinrx_chan_gain_expert>(expert, expert->node_retriever(), fe);
+        expert_factory::add_worker_node<twinrx_scheduling_expert>(expert, expert->node_retriever(), fe);
+        expert_factory::add_worker_node<twinrx_nyquist_expert>(expert, expert->node_retriever(), fe, db_iface);
+    }
+    expert_factory::add_worker_node<twinrx_lo_config_expert>(expert, expert->node_retriever());
+    expert_factory::add_worker_node<twinrx_lo_mapping_expert>(expert, expert->node_retriever(), STAGE_LO1);
+    expert_factory::add_worker_node<twinrx_lo_mapping_expert>(expert, expert->node_retriever(), STAGE_LO2);
+    expert_factory::add_worker_node<twinrx_antenna_expert>(expert, expert->node_retriever());
+    expert_factory::add_worker_node<twinrx_ant_gain_expert>(expert, expert->node_retriever());
+    expert_factory::add_worker_node<twinrx_settings_expert>(expert, expert->node_retriever(), ctrl);
+
+    expert->resolve_all(true);
+    return expert;
+}
+
+/***********************************************************************
+ * Timing
+ **********************************************************************/
+static void run_benchmark(
+    const std::string &name,
+    const size_t num_iterations,
+    const boost::function<void(size_t)> &operation
+){
+    std::vector<double> latencies_us;
+    latencies_us.reserve(num_iterations);
+    for (size_t i = 0; i < num_iterations; i++){
+        const boost::chrono::high_resolution_clock::time_point start =
+            boost::chrono::high_resolution_clock::now();
+        operation(i);
+        const boost::chrono::duration<double> elapsed =
+            boost::chrono::high_resolution_clock::now() - start;
+        latencies_us.push_back(elapsed.count()*1e6);
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    std::cout << boost::format("%-24s median %8.2f us   p99 %8.2f us")
+        % name
+        % latencies_us[latencies_us.size()/2]
+        % latencies_us[latencies_us.size()*99/100] << std::endl;
+}
+
+static void tune(property_tree::sptr tree, size_t i){
+    //hop between a low band and a high band frequency
+    tree->access<double>("rx_frontends/0/freq/value").set((i % 2)? 2.4e9 : 900e6 + (i % 64)*1e5);
+}
+
+static void set_gain(property_tree::sptr tree, size_t i){
+    tree->access<double>("rx_frontends/0/gains/all/value").set(double(i % 64));
+}
+
+static void read_freq(property_tree::sptr tree, size_t){
+    tree->access<double>("rx_frontends/0/freq/value").get();
+}
+
+static void full_resolve(expert_container::sptr expert, size_t){
+    expert->resolve_all(true);
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[]){
+    size_t num_iterations;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("iterations", po::value<size_t>(&num_iterations)->default_value(20000), "number of operations to time")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or num_iterations == 0){
+        std::cout << boost::format("SHD TwinRX Expert Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Build the expert graph of a two-channel TwinRX on top of null hardware\n"
+            "and time the property accesses that tune it.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    property_tree::sptr tree = property_tree::make();
+    expert_container::sptr expert = make_twinrx_expert(tree);
+
+    run_benchmark("tune (freq write)", num_iterations, boost::bind(&tune, tree, _1));
+    run_benchmark("gain write", num_iterations, boost::bind(&set_gain, tree, _1));
+    run_benchmark("freq read", num_iterations, boost::bind(&read_freq, tree, _1));
+    run_benchmark("resolve_all(force)", num_iterations, boost::bind(&full_resolve, expert, _1));
+    return EXIT_SUCCESS;
+}
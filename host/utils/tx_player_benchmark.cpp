@@ -0,0 +1,213 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/utils/tx_player.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/format.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+using namespace shd;
+
+typedef boost::chrono::steady_clock clock_type;
+
+static double secs_between(const clock_type::time_point &start, const clock_type::time_point &end)
+{
+    return boost::chrono::duration<double>(end - start).count();
+}
+
+/***********************************************************************
+ * A streamer that takes a packet of samples whenever the sample rate
+ * says the device needs it, and records how late the caller hands it
+ * over. A device has to buffer the samples for the longest lateness.
+ **********************************************************************/
+class paced_tx_streamer : public tx_streamer
+{
+public:
+    paced_tx_streamer(const double samp_rate):
+        _samp_rate(samp_rate), _next(0),
+        _max_late(0.0), _total_late(0.0), _num_pkts(0)
+    {
+        /* NOP */
+    }
+
+    size_t get_num_channels(void) const{ return 1; }
+    size_t get_max_num_samps(void) const{ return 2000; }
+
+    size_t send(const buffs_type &, const size_t nsamps_per_buff,
+        const tx_metadata_t &, const double)
+    {
+        if (_next == 0) _start = clock_type::now();
+        const size_t nsamps = std::min(nsamps_per_buff, get_max_num_samps());
+        if (nsamps == 0) return 0;
+
+        //wait until the device has room or note how late the samples are
+        const double due = _next/_samp_rate;
+        const double late = secs_between(_start, clock_type::now()) - due;
+        if (late < 0.0) {
+            boost::this_thread::sleep(boost::posix_time::microseconds(long(-late*1e6)));
+        }
+        else {
+            _max_late = std::max(_max_late, late);
+        }
+        _total_late += std::max(late, 0.0);
+        _num_pkts++;
+        _next += nsamps;
+        return nsamps;
+    }
+
+    bool recv_async_msg(async_metadata_t &, double){ return false; }
+
+    double get_max_late(void) const{ return _max_late; }
+    double get_mean_late(void) const{ return _total_late/std::max<size_t>(1, _num_pkts); }
+
+private:
+    const double _samp_rate;
+    size_t _next;
+    double _max_late, _total_late;
+    size_t _num_pkts;
+    clock_type::time_point _start;
+};
+
+struct result_t{
+    double secs;
+    double max_late, mean_late;
+    bool direct_io;
+};
+
+//! Drop the file from the page cache, so it is read from the disk
+static void evict_file(const std::string &file)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+//! What tx_samples_from_file does: read on the send thread
+static result_t run_ifstream(const std::string &file, const double samp_rate)
+{
+    boost::shared_ptr<paced_tx_streamer> tx_stream = boost::make_shared<paced_tx_streamer>(samp_rate);
+    std::vector<uint32_t> buff(tx_stream->get_max_num_samps());
+    std::ifstream infile(file.c_str(), std::ifstream::binary);
+    const clock_type::time_point start = clock_type::now();
+    tx_streamer &streamer = *tx_stream;
+    tx_metadata_t md;
+    while (not infile.eof()) {
+        infile.read(reinterpret_cast<char *>(&buff.front()), buff.size()*sizeof(uint32_t));
+        const size_t nsamps = size_t(infile.gcount()/sizeof(uint32_t));
+        streamer.send(&buff.front(), nsamps, md, 1.0);
+    }
+    result_t result;
+    result.secs = secs_between(start, clock_type::now());
+    result.max_late = tx_stream->get_max_late();
+    result.mean_late = tx_stream->get_mean_late();
+    result.direct_io = false;
+    return result;
+}
+
+static result_t run_player(const std::string &file, const double samp_rate, const std::string &args)
+{
+    boost::shared_ptr<paced_tx_streamer> tx_stream = boost::make_shared<paced_tx_streamer>(samp_rate);
+    tx_player::sptr player = tx_player::make(
+        tx_stream, "sc16", std::vector<std::string>(1, file), device_addr_t(args));
+    const clock_type::time_point start = clock_type::now();
+    player->play(tx_metadata_t());
+    result_t result;
+    result.secs = secs_between(start, clock_type::now());
+    result.max_late = tx_stream->get_max_late();
+    result.mean_late = tx_stream->get_mean_late();
+    result.direct_io = player->get_stats().direct_io;
+    return result;
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    std::string dirs, args;
+    size_t size_mb;
+    double rate;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("dirs", po::value<std::string>(&dirs)->default_value("/dev/shm,/var/tmp"), "comma separated directories to read from")
+        ("size", po::value<size_t>(&size_mb)->default_value(1024), "MiB to play per run")
+        ("rate", po::value<double>(&rate)->default_value(50e6), "sc16 sample rate of the simulated stream in Sps")
+        ("args", po::value<std::string>(&args)->default_value(""), "player arguments (buff_size, num_buffs, direct)")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or size_mb == 0 or rate <= 0.0) {
+        std::cout << boost::format("SHD TX Player Benchmark %s") % desc << std::endl;
+        std::cout <<
+            "Plays a file of samples from each directory, once reading on the\n"
+            "send thread with std::ifstream and once with the tx_player. The\n"
+            "file is dropped from the page cache before each run. The longest\n"
+            "lateness of send() is what the device has to buffer to not underflow.\n"
+            << std::endl;
+        return ~0;
+    }
+
+    std::vector<std::string> dir_list;
+    boost::split(dir_list, dirs, boost::is_any_of(","));
+    const std::vector<char> chunk(1024*1024, 0);
+
+    std::cout << boost::format("%.1f Msps, %u MiB per run") % (rate/1e6) % size_mb << std::endl;
+    std::cout << boost::format("%-12s %-10s %10s %14s %14s %7s")
+        % "Directory" % "Reader" % "MB/s" % "Max late ms" % "Mean late us" % "Direct" << std::endl;
+    BOOST_FOREACH(const std::string &dir, dir_list) {
+        if (not fs::is_directory(dir)) {
+            std::cout << boost::format("%-12s skipped, not a directory") % dir << std::endl;
+            continue;
+        }
+        const std::string file = (fs::path(dir) / fs::unique_path("tx_player_%%%%%%%%.dat")).string();
+        {
+            std::ofstream outfile(file.c_str(), std::ofstream::binary);
+            for (size_t i = 0; i < size_mb; i++) outfile.write(&chunk.front(), chunk.size());
+        }
+        for (size_t mode = 0; mode < 2; mode++) {
+            evict_file(file);
+            const result_t result = (mode == 0)?
+                run_ifstream(file, rate) : run_player(file, rate, args);
+            std::cout << boost::format("%-12s %-10s %10.1f %14.2f %14.2f %7s")
+                % dir % ((mode == 0)? "ifstream" : "player")
+                % (size_mb*1024*1024/result.secs/1e6)
+                % (result.max_late*1e3) % (result.mean_late*1e6)
+                % (result.direct_io? "yes" : "no") << std::endl;
+        }
+        fs::remove(file);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+//
+// Copyright 2017 Ettus Research LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <shd/utils/safe_main.hpp>
+#include <shd/transport/udp_zero_copy.hpp>
+#include <shd/exception.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+
+namespace po = boost::program_options;
+namespace asio = boost::asio;
+using namespace shd::transport;
+
+/***********************************************************************
+ * Sender: blasts fixed-size datagrams at the receiving transport
+ **********************************************************************/
+static void blast_frames(
+    asio::ip::udp::socket &sock,
+    const size_t frame_size,
+    volatile bool &running
+){
+    std::vector<char> frame(frame_size, 0x5a);
+    while (running){
+        boost::system::error_code ec;
+        sock.send(asio::buffer(frame), 0, ec);
+        if (ec == asio::error::no_buffer_space) boost::this_thread::yield();
+    }
+}
+
+struct benchmark_result_t {
+    uint64_t num_frames;
+    uint64_t num_bytes;
+    uint64_t num_syscalls;
+    double wall_secs;
+    double cpu_secs;
+};
+
+/***********************************************************************
+ * Receiver: drains the transport for the given duration and records
+ * the wall clock and thread CPU time it took
+ **********************************************************************/
+static benchmark_result_t run_benchmark(
+    const size_t recv_batch,
+    const size_t frame_size,
+    const size_t num_recv_frames,
+    const double duration,
+    const std::string &args
+){
+    asio::io_service io_service;
+    asio::ip::udp::socket sender(io_service,
+        asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0));
+    const std::string port = boost::lexical_cast<std::string>(sender.local_endpoint().port());
+
+    zero_copy_xport_params default_buff_args;
+    default_buff_args.recv_frame_size = frame_size;
+    default_buff_args.send_frame_size = frame_size;
+    default_buff_args.num_recv_frames = num_recv_frames;
+    default_buff_args.num_send_frames = 1;
+    shd::device_addr_t hints(args);
+    hints["recv_batch"] = boost::lexical_cast<std::string>(recv_batch);
+    udp_zero_copy::buff_params buff_params;
+    udp_zero_copy::sptr xport = udp_zero_copy::make(
+        "127.0.0.1", port, default_buff_args, buff_params, hints);
+
+    //the transport is connected to the sender's port,
+    //so learn its ephemeral port from a hello frame
+    managed_send_buffer::sptr hello = xport->get_send_buff(1.0);
+    hello->commit(4);
+    hello.reset();
+    std::vector<char> scratch(frame_size);
+    asio::ip::udp::endpoint xport_endpoint;
+    sender.receive_from(asio::buffer(scratch), xport_endpoint);
+    sender.connect(xport_endpoint);
+
+    volatile bool running = true;
+    boost::thread sender_thread(&blast_frames, boost::ref(sender), frame_size, boost::ref(running));
+
+    benchmark_result_t result = benchmark_result_t();
+    const udp_zero_copy::recv_stats_t stats_start = xport->get_recv_stats();
+    const boost::chrono::steady_clock::time_point wall_start = boost::chrono::steady_clock::now();
+    const boost::chrono::thread_clock::time_point cpu_start = boost::chrono::thread_clock::now();
+    const boost::chrono::steady_clock::time_point wall_end = wall_start
+        + boost::chrono::microseconds(int64_t(duration * 1e6));
+
+    while (boost::chrono::steady_clock::now() < wall_end){
+        managed_recv_buffer::sptr mrb = xport->get_recv_buff(0.1);
+        if (not mrb) continue;
+        result.num_bytes += mrb->size();
+    }
+
+    result.cpu_secs = boost::chrono::duration<double>(
+        boost::chrono::thread_clock::now() - cpu_start).count();
+    result.wall_secs = boost::chrono::duration<double>(
+        boost::chrono::steady_clock::now() - wall_start).count();
+    const udp_zero_copy::recv_stats_t stats_end = xport->get_recv_stats();
+    result.num_frames = stats_end.num_frames - stats_start.num_frames;
+    result.num_syscalls = stats_end.num_syscalls - stats_start.num_syscalls;
+
+    running = false;
+    sender_thread.join();
+    return result;
+}
+
+int SHD_SAFE_MAIN(int argc, char *argv[])
+{
+    std::string batches, args;
+    size_t frame_size, num_recv_frames;
+    double duration;
+
+    po::options_description desc("UDP loopback benchmark options:");
+    desc.add_options()
+        ("help", "help message")
+        ("batches", po::value<std::string>(&batches)->default_value("1,8,32"), "Comma-separated list of recv_batch values to compare")
+        ("frame-size", po::value<size_t>(&frame_size)->default_value(8000), "Datagram size in bytes")
+        ("num-recv-frames", po::value<size_t>(&num_recv_frames)->default_value(128), "Number of receive frames of the transport")
+        ("args", po::value<std::string>(&args)->default_value(""), "Extra transport hints, ex: recv_xport=tpacket")
+        ("duration", po::value<double>(&duration)->default_value(3.0), "Duration of each run in seconds")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")){
+        std::cout << boost::format("SHD UDP Loopback Benchmark %s") % desc << std::endl;
+        std::cout << "  Streams datagrams over the loopback interface into a udp_zero_copy\n"
+                     "  transport and reports frames per receive syscall and the CPU time\n"
+                     "  the receiving thread spends per GB/s of throughput.\n" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> batch_list;
+    boost::split(batch_list, batches, boost::is_any_of(","), boost::token_compress_on);
+
+    std::cout << "recv_batch,frames,GB/s,frames_per_syscall,cpu_secs_per_GB" << std::endl;
+    BOOST_FOREACH(const std::string &batch, batch_list){
+        const benchmark_result_t result = run_benchmark(
+            boost::lexical_cast<size_t>(batch), frame_size, num_recv_frames, duration, args);
+        const double gbytes = result.num_bytes / 1e9;
+        std::cout << boost::format("%s,%d,%.3f,%.2f,%.3f")
+            % batch
+            % result.num_frames
+            % (gbytes / result.wall_secs)
+            % (result.num_syscalls? double(result.num_frames) / result.num_syscalls : 0.0)
+            % (gbytes > 0? result.cpu_secs / gbytes : 0.0)
+            << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}